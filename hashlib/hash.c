@@ -0,0 +1,241 @@
+/*
+ * hash.c: backend independent support functions for tb_hash_t type
+ *
+ * Copyright (c) 2006-2010, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * this file is built both into tboot (freestanding, -nostdinc) and into
+ * libhash.a for the tools (built with NO_TBOOT_LOGLVL), so it only relies
+ * on the streaming functions of the backend and on nothing from libc
+ */
+#ifdef NO_TBOOT_LOGLVL
+#include <stdint.h>
+#include <stddef.h>
+#else
+#include <types.h>
+#endif
+#include <stdbool.h>
+#include "../include/hash.h"
+
+/* data fed to all digests of a multi context before moving on */
+#define HASH_MULTI_WINDOW   (32 * 1024)
+
+/*
+ * are_hashes_equal
+ *
+ * compare whether two hash values are equal.
+ *
+ */
+bool are_hashes_equal(const tb_hash_t *hash1, const tb_hash_t *hash2,
+                      uint16_t hash_alg)
+{
+    unsigned int len = get_hash_size(hash_alg);
+    uint8_t diff = 0;
+
+    if ( hash1 == NULL || hash2 == NULL || len == 0 )
+        return false;
+
+    for ( unsigned int i = 0; i < len; i++ )
+        diff |= hash1->sha512[i] ^ hash2->sha512[i];
+    return diff == 0;
+}
+
+/*
+ * hash_buffer
+ *
+ * hash the buffer according to the algorithm
+ *
+ */
+bool hash_buffer(const unsigned char* buf, size_t size, tb_hash_t *hash,
+                 uint16_t hash_alg)
+{
+    hash_ctx_t ctx;
+
+    if ( hash == NULL || !hash_init(&ctx, hash_alg) )
+        return false;
+    if ( !hash_update(&ctx, buf, size) ) {
+        hash_abort(&ctx);
+        return false;
+    }
+    return hash_final(&ctx, hash);
+}
+
+/*
+ * extend_hash
+ *
+ * perform "extend" of two hashes (i.e. hash1 = SHA(hash1 || hash2)
+ *
+ */
+bool extend_hash(tb_hash_t *hash1, const tb_hash_t *hash2, uint16_t hash_alg)
+{
+    unsigned int len = get_hash_size(hash_alg);
+    hash_ctx_t ctx;
+
+    if ( hash1 == NULL || hash2 == NULL || len == 0 )
+        return false;
+
+    /* both halves are fed straight from the operands, no staging copy */
+    if ( !hash_init(&ctx, hash_alg) )
+        return false;
+    if ( !hash_update(&ctx, hash1, len) || !hash_update(&ctx, hash2, len) ) {
+        hash_abort(&ctx);
+        return false;
+    }
+    return hash_final(&ctx, hash1);
+}
+
+void copy_hash(tb_hash_t *dest_hash, const tb_hash_t *src_hash,
+               uint16_t hash_alg)
+{
+    unsigned int len = get_hash_size(hash_alg);
+
+    if ( dest_hash == NULL || src_hash == NULL )
+        return;
+
+    for ( unsigned int i = 0; i < len; i++ )
+        dest_hash->sha512[i] = src_hash->sha512[i];
+}
+
+static int hex_digit(char c)
+{
+    if ( c >= '0' && c <= '9' )
+        return c - '0';
+    if ( c >= 'a' && c <= 'f' )
+        return c - 'a' + 10;
+    if ( c >= 'A' && c <= 'F' )
+        return c - 'A' + 10;
+    return -1;
+}
+
+/*
+ * import a hash in the format "755567de6e0a3ee1b71a895b76..."
+ */
+bool import_hash(const char *string, tb_hash_t *hash, uint16_t alg)
+{
+    unsigned int len = get_hash_size(alg);
+
+    if ( string == NULL || hash == NULL || len == 0 )
+        return false;
+
+    for ( unsigned int i = 0; i < len; i++ ) {
+        int hi, lo;
+
+        if ( (hi = hex_digit(string[2*i])) < 0 ||
+             (lo = hex_digit(string[2*i + 1])) < 0 )
+            return false;
+        hash->sha512[i] = (uint8_t)(hi << 4 | lo);
+    }
+    return string[2*len] == '\0';
+}
+
+/*
+ * multi-digest contexts
+ *
+ * computing several banks over the same (large) image one digest at a time
+ * streams the image through the cache once per bank; feeding every digest
+ * one window at a time reads it from memory only once
+ */
+bool hash_multi_init(hash_multi_ctx_t *mctx, const uint16_t *algs,
+                     unsigned int count)
+{
+    if ( mctx == NULL || algs == NULL || count == 0 ||
+         count > HASH_MULTI_MAX_ALGS )
+        return false;
+
+    for ( mctx->count = 0; mctx->count < count; mctx->count++ ) {
+        if ( !hash_init(&mctx->ctx[mctx->count], algs[mctx->count]) ) {
+            hash_multi_abort(mctx);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool hash_multi_update(hash_multi_ctx_t *mctx, const void *buf, size_t size)
+{
+    const uint8_t *p = buf;
+
+    if ( mctx == NULL || mctx->count == 0 )
+        return false;
+
+    while ( size > 0 ) {
+        size_t len = size < HASH_MULTI_WINDOW ? size : HASH_MULTI_WINDOW;
+
+        for ( unsigned int i = 0; i < mctx->count; i++ ) {
+            if ( !hash_update(&mctx->ctx[i], p, len) )
+                return false;
+        }
+        p += len;
+        size -= len;
+    }
+    return true;
+}
+
+/* hashes[i] is the digest for the i'th alg passed to hash_multi_init() */
+bool hash_multi_final(hash_multi_ctx_t *mctx, tb_hash_t *hashes)
+{
+    bool ret = true;
+
+    if ( mctx == NULL || mctx->count == 0 )
+        return false;
+    if ( hashes == NULL ) {
+        hash_multi_abort(mctx);
+        return false;
+    }
+
+    for ( unsigned int i = 0; i < mctx->count; i++ )
+        ret = hash_final(&mctx->ctx[i], &hashes[i]) && ret;
+    mctx->count = 0;
+    return ret;
+}
+
+void hash_multi_abort(hash_multi_ctx_t *mctx)
+{
+    if ( mctx == NULL )
+        return;
+
+    for ( unsigned int i = 0; i < mctx->count; i++ )
+        hash_abort(&mctx->ctx[i]);
+    mctx->count = 0;
+}
+
+
+/*
+ * Local variables:
+ * mode: C
+ * c-set-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
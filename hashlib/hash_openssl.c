@@ -0,0 +1,158 @@
+/*
+ * hash_openssl.c: OpenSSL backend of the streaming digests for the tools
+ *
+ * Copyright (c) 2006-2010, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <openssl/evp.h>
+#include <openssl/opensslv.h>
+#include "../include/hash.h"
+
+/*
+ * OpenSSL picks the SHA-NI/AVX2/SSSE3 block functions for the running CPU
+ * itself, so the tools get the vector kernels through EVP.  What is left to
+ * do here is keeping the per-call overhead low: on OpenSSL 3 every
+ * EVP_DigestInit() with an EVP_sha*() method does an implicit provider
+ * fetch, so the methods are fetched once and reused.
+ */
+
+static const struct {
+    const char    *name;
+    const EVP_MD *(*method)(void);
+} md_table[] = {
+    { "SHA1",   EVP_sha1 },
+    { "SHA256", EVP_sha256 },
+    { "SM3",    EVP_sm3 },
+    { "SHA384", EVP_sha384 },
+    { "SHA512", EVP_sha512 },
+};
+static const EVP_MD *mds[sizeof(md_table)/sizeof(md_table[0])];
+static pthread_once_t mds_once = PTHREAD_ONCE_INIT;
+
+static int md_index(uint16_t hash_alg)
+{
+    switch ( hash_alg ) {
+        case TB_HALG_SHA1_LG:
+        case TB_HALG_SHA1:   return 0;
+        case TB_HALG_SHA256: return 1;
+        case TB_HALG_SM3:    return 2;
+        case TB_HALG_SHA384: return 3;
+        case TB_HALG_SHA512: return 4;
+        default:             return -1;
+    }
+}
+
+static void fetch_mds(void)
+{
+    for ( unsigned int i = 0; i < sizeof(mds)/sizeof(mds[0]); i++ ) {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+        mds[i] = EVP_MD_fetch(NULL, md_table[i].name, NULL);
+        if ( mds[i] != NULL )
+            continue;
+#endif
+        mds[i] = md_table[i].method();
+    }
+}
+
+static const EVP_MD *get_md(uint16_t hash_alg)
+{
+    int i = md_index(hash_alg);
+
+    if ( i < 0 )
+        return NULL;
+    pthread_once(&mds_once, fetch_mds);
+    return mds[i];
+}
+
+bool hash_init(hash_ctx_t *ctx, uint16_t hash_alg)
+{
+    const EVP_MD *md = get_md(hash_alg);
+
+    if ( ctx == NULL || md == NULL )
+        return false;
+
+    ctx->alg = hash_alg;
+    ctx->impl = EVP_MD_CTX_new();
+    if ( ctx->impl == NULL )
+        return false;
+    if ( EVP_DigestInit_ex(ctx->impl, md, NULL) != 1 ) {
+        hash_abort(ctx);
+        return false;
+    }
+    return true;
+}
+
+bool hash_update(hash_ctx_t *ctx, const void *buf, size_t size)
+{
+    if ( ctx == NULL || ctx->impl == NULL )
+        return false;
+    if ( size == 0 )
+        return true;
+    return EVP_DigestUpdate(ctx->impl, buf, size) == 1;
+}
+
+bool hash_final(hash_ctx_t *ctx, tb_hash_t *hash)
+{
+    bool ret;
+
+    if ( ctx == NULL || ctx->impl == NULL )
+        return false;
+
+    ret = hash != NULL &&
+          EVP_DigestFinal_ex(ctx->impl, (uint8_t *)hash, NULL) == 1;
+    hash_abort(ctx);
+    return ret;
+}
+
+void hash_abort(hash_ctx_t *ctx)
+{
+    if ( ctx == NULL || ctx->impl == NULL )
+        return;
+
+    EVP_MD_CTX_free(ctx->impl);
+    ctx->impl = NULL;
+}
+
+
+/*
+ * Local variables:
+ * mode: C
+ * c-set-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -39,8 +39,20 @@
  * build/support flags
  */
 
+/* largest MLE (tboot text/rodata) that the MLE page table can map */
+#ifndef MLE_MAX_SIZE
+#define MLE_MAX_SIZE             0x0800000
+#endif
+
+/* MLE page table (4k pages only): 1 pg dir ptr table, 1 pg dir per 1GB */
+/* and 1 ptable per 2MB of MLE; it sits between the multiboot header page */
+/* and the MLE */
+#define MLE_PT_PAGES             (1 + ((MLE_MAX_SIZE + 0x3fffffff) >> 30) + \
+                                  ((MLE_MAX_SIZE + 0x1fffff) >> 21))
+
 /* address tboot will load and execute at */
-#define TBOOT_START              0x0804000
+#define TBOOT_START              (TBOOT_BASE_ADDR + 0x1000 + \
+                                  MLE_PT_PAGES * 0x1000)
 
 /* start address of tboot MLE page table, also the beginning of tboot memory */
 #define TBOOT_BASE_ADDR          0x0800000
@@ -73,6 +85,7 @@
 #define TBOOT_KERNEL_CMDLINE_SIZE    0x0400
 
 
+/* # per-cpu slots to reserve if the MADT can't be read */
 #ifndef NR_CPUS
 #define NR_CPUS     512
 #endif
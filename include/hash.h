@@ -96,6 +96,47 @@ static inline unsigned int get_hash_size(uint16_t hash_alg)
         return 0;
 }
 
+/*
+ * streaming digests
+ *
+ * hash_init()/hash_update()/hash_final() are provided by the backend of
+ * the component linking the library: tboot's own sha1/sha2 code in the
+ * boot environment, OpenSSL for the tools.  hash_final() releases the
+ * context; hash_abort() releases one that will not be finalized.
+ */
+
+/* words of state the boot backend keeps inline (sha512_state is largest) */
+#define HASH_CTX_STATE_WORDS    32
+
+typedef struct {
+    uint16_t   alg;
+    union {
+        void      *impl;                          /* hosted backend */
+        uint64_t   state[HASH_CTX_STATE_WORDS];   /* boot backend */
+    };
+} hash_ctx_t;
+
+/* every supported bank: sha1, sha256, sm3, sha384, sha512 */
+#define HASH_MULTI_MAX_ALGS     5
+
+/* several digests of the same data, fed one window at a time */
+typedef struct {
+    unsigned int count;
+    hash_ctx_t   ctx[HASH_MULTI_MAX_ALGS];
+} hash_multi_ctx_t;
+
+extern bool hash_init(hash_ctx_t *ctx, uint16_t hash_alg);
+extern bool hash_update(hash_ctx_t *ctx, const void *buf, size_t size);
+extern bool hash_final(hash_ctx_t *ctx, tb_hash_t *hash);
+extern void hash_abort(hash_ctx_t *ctx);
+
+extern bool hash_multi_init(hash_multi_ctx_t *mctx, const uint16_t *algs,
+                            unsigned int count);
+extern bool hash_multi_update(hash_multi_ctx_t *mctx, const void *buf,
+                              size_t size);
+extern bool hash_multi_final(hash_multi_ctx_t *mctx, tb_hash_t *hashes);
+extern void hash_multi_abort(hash_multi_ctx_t *mctx);
+
 extern bool are_hashes_equal(const tb_hash_t *hash1, const tb_hash_t *hash2,
                              uint16_t hash_alg);
 extern bool hash_buffer(const unsigned char* buf, size_t size, tb_hash_t *hash,
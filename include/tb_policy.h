@@ -90,8 +90,20 @@ typedef struct __packed {
 
 #define TB_POLCTL_EXTEND_PCR17       0x1  /* extend policy into PCR 17 */
 
+/*
+ * version 3 policies have the same layout as version 2, but an entry may be
+ * continued by the entries immediately following it that have the same
+ * mod_num, pcr, hash_type and nv_index; together they form one set of
+ * allowed hashes, so that a module (or NV index) can have more than
+ * TB_POL_MAX_ENTRY_HASHES hashes
+ */
+#define TB_POL_VERSION               2
+#define TB_POL_VERSION_EXT           3
+
+#define TB_POL_MAX_ENTRY_HASHES      255  /* max hashes in one entry */
+
 typedef struct __packed {
-    uint8_t             version;          /* currently 2 */
+    uint8_t             version;          /* TB_POL_VERSION_* */
     uint8_t             policy_type;      /* TB_POLTYPE_* */
     /* TODO should be changed to 16bit for TPM 2.0 */
     uint8_t             hash_alg;         /* TB_HALG_* */
@@ -111,6 +123,10 @@ typedef struct __packed {
 
 #define TB_POLICY_INDEX     0x20000001  /* policy index for Verified Launch */
 
+/* max size of an extended policy, which does not fit in TPM NV and so */
+/* is delivered in a custom element of the LCP policy data file */
+#define MAX_TB_POLICY_EXT_SIZE   0x8000
+
 
 /*
  * helper fns
@@ -246,6 +262,34 @@ static inline tb_policy_entry_t* find_policy_entry(const tb_policy_t *policy,
     return NULL;
 }
 
+/*
+ * return the entry that continues pol_entry (version 3 policies only), or
+ * NULL if pol_entry is the last entry of its set
+ */
+static inline tb_policy_entry_t* get_next_policy_entry_in_set(
+                const tb_policy_t *policy, const tb_policy_entry_t *pol_entry)
+{
+    /* assumes policy has already been validated */
+
+    if ( policy == NULL || pol_entry == NULL )
+        return NULL;
+    if ( policy->version < TB_POL_VERSION_EXT )
+        return NULL;
+
+    tb_policy_entry_t *next = (void *)pol_entry +
+        calc_policy_entry_size(pol_entry, policy->hash_alg);
+    if ( (void *)next >= (void *)policy + calc_policy_size(policy) )
+        return NULL;
+
+    if ( next->mod_num != pol_entry->mod_num ||
+         next->pcr != pol_entry->pcr ||
+         next->hash_type != pol_entry->hash_type ||
+         next->nv_index != pol_entry->nv_index )
+        return NULL;
+
+    return next;
+}
+
 /*
  * verify and display policy
  */
@@ -264,7 +308,8 @@ static inline bool verify_policy(const tb_policy_t *policy, size_t size, bool pr
         return false;
     }
 
-    if ( policy->version != 0x02 ) {
+    if ( policy->version != TB_POL_VERSION &&
+         policy->version != TB_POL_VERSION_EXT ) {
         if ( print ) PRINT(TBOOT_ERR"unsupported version (%u)\n", policy->version);
         return false;
     }
@@ -38,6 +38,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <unistd.h>
+#include <time.h>
+#include <pthread.h>
 #define _GNU_SOURCE
 #include <getopt.h>
 #include <errno.h>
@@ -92,6 +94,10 @@ static const char help[] =
     "                                     TPM1.2: 2.0, 2.1, 2.2, 2.3, 2.4 \n"
     "                                     TPM2.0: 3.0, 3.1, 3.2>\n"
     "                                   If not set policy ver will be 3.0\n"
+    "        [--jobs <number>]          number of threads checking and hashing\n"
+    "                                   the lists (default: number of CPUs)\n"
+    "        [--timing <FILE>]          write a JSON report of the time spent\n"
+    "                                   on each list to FILE\n"
     "--show\n"
     "        [--brief]                  brief format output\n"
     "        [policy file]              policy file\n"
@@ -125,6 +131,8 @@ static struct option long_opts[] =
     {"auxalg",         required_argument,    NULL,     'x'},
     {"sign",           required_argument,    NULL,     's'},
     {"polver",         required_argument,    NULL,     'e'},
+    {"jobs",           required_argument,    NULL,     'j'},
+    {"timing",         required_argument,    NULL,     'T'},
 
     {"verbose",        no_argument,          (int *)&verbose, true},
     {0, 0, 0, 0}
@@ -156,10 +164,16 @@ size_t         list_21_sizes[] = { 0, 0, 0, 0, 0, 0, 0, 0 };
 uint8_t        pol_type = LCP_POLTYPE_ANY;
 uint8_t        max_sinit_min_version = 0xFF;
 uint8_t        max_biosac_min_version = 0;
+static int     nr_jobs = 0; // Default: number of CPUs
+static char    timing_file[MAX_PATH] = "";
 
 //Prototypes:
 static int create_legacy(void);
 static lcp_policy_data_t2 *create_poldata(void);
+static bool hash_poldata(const lcp_policy_data_t2 *poldata, lcp_hash_t2 *hash,
+                         uint16_t hash_alg);
+static bool write_timing_report(unsigned int nr_lists, uint64_t total_us);
+static uint64_t now_us(void);
 static int create(void);
 static int show(void);
 
@@ -175,6 +189,7 @@ int create_legacy(void)
     if (pol == NULL) {
         ERROR("Error: failed to allocate policy.\n");
     }
+    uint64_t start_us = now_us();
     memset_s(pol, policy_size, 0x00);
     pol->version = pol_ver;
     pol->hash_alg = LCP_POLHALG_SHA1; //Legacy value for TPM 1.2
@@ -191,11 +206,20 @@ int create_legacy(void)
             free(pol);
             return 1;
         }
-        calc_policy_data_hash(poldata, (lcp_hash_t2 *) &pol->policy_hash, pol->hash_alg);
+        if ( !hash_poldata(poldata, (lcp_hash_t2 *) &pol->policy_hash,
+                           pol->hash_alg) ) {
+            free(pol);
+            free(poldata);
+            return 1;
+        }
     }
 
-    bool ok;
-    ok = write_file(policy_file, pol, policy_size);
+    bool ok = true;
+    if ( *timing_file != '\0' )
+        ok = write_timing_report(poldata != NULL ? poldata->num_lists : 0,
+                                 now_us() - start_us);
+    if ( ok )
+        ok = write_file(policy_file, pol, policy_size);
     if ( ok && pol->policy_type == LCP_POLTYPE_LIST )
         ok = write_file(poldata_file, poldata, get_policy_data_size(poldata));
 
@@ -205,22 +229,186 @@ int create_legacy(void)
     return ok ? 0 : 1;
 }
 
-lcp_policy_data_t2 *create_poldata(void)
+/*
+ * Each list is checked and then hashed without looking at the other lists,
+ * so both steps run on up to --jobs threads.  A list whose bytes are
+ * identical to an earlier list's is not checked or hashed again; it reuses
+ * the earlier result.
+ */
+typedef struct {
+    /* bytes worked on: the mapped file while checking, then the copy in
+       the policy data while hashing */
+    const void        *data;
+    size_t            size;
+    const void        *file_data;  /* mapped list file */
+    size_t            file_size;
+    uint16_t          version;
+    int               same_as;     /* earlier list with the same bytes or -1 */
+    lcp_list_t        *pollist;    /* 1.0 and 2.0 lists, as read and checked */
+    lcp_list_2_1_view view;        /* 2.1 lists */
+    bool              ok;
+    lcp_hash_t2       hash;
+    uint64_t          check_us;
+    uint64_t          hash_us;
+} list_work_t;
+
+static list_work_t lists[LCP_MAX_LISTS];
+static uint16_t    list_hash_alg;
+static int         used_jobs;
+
+static struct {
+    unsigned int nr;
+    unsigned int next;
+    void         (*process)(list_work_t *list, unsigned int i);
+} list_queue;
+
+uint64_t now_us(void)
 {
-    lcp_policy_data_t2 *poldata = NULL;
-    lcp_policy_list_t2_1 *pollist21 = NULL;
-    void *file_data = NULL;
-    lcp_list_t *pollist = NULL;
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void find_same_lists(unsigned int nr)
+{
+    for ( unsigned int i = 0; i < nr; i++ ) {
+        lists[i].same_as = -1;
+        for ( unsigned int j = 0; j < i; j++ ) {
+            int diff;
+
+            if ( lists[j].same_as != -1 || lists[j].size != lists[i].size )
+                continue;
+            if ( memcmp_s(lists[j].data, lists[j].size, lists[i].data,
+                          lists[i].size, &diff) == 0 && diff == 0 ) {
+                LOG("list %u is the same as list %u\n", i, j);
+                lists[i].same_as = j;
+                break;
+            }
+        }
+    }
+}
+
+static void *list_worker(void *arg)
+{
+    (void)arg;
+
+    while ( true ) {
+        unsigned int i = __sync_fetch_and_add(&list_queue.next, 1);
+
+        if ( i >= list_queue.nr )
+            break;
+        if ( lists[i].same_as == -1 )
+            list_queue.process(&lists[i], i);
+    }
+    return NULL;
+}
+
+static void run_lists(unsigned int nr,
+                      void (*process)(list_work_t *list, unsigned int i))
+{
+    pthread_t threads[LCP_MAX_LISTS];
+    int num_threads = 0;
+    int jobs = nr_jobs;
+
+    if ( jobs <= 0 )
+        jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    if ( jobs > (int)nr )
+        jobs = nr;
+    list_queue.nr = nr;
+    list_queue.next = 0;
+    list_queue.process = process;
+
+    /* this thread works too, so start one fewer */
+    while ( num_threads < jobs - 1 &&
+            pthread_create(&threads[num_threads], NULL, list_worker, NULL) == 0 )
+        num_threads++;
+    used_jobs = num_threads + 1;
+    LOG("processing %u lists with %d threads\n", nr, used_jobs);
 
+    list_worker(NULL);
+    for ( int i = 0; i < num_threads; i++ )
+        pthread_join(threads[i], NULL);
+
+    for ( unsigned int i = 0; i < nr; i++ ) {
+        if ( lists[i].same_as != -1 ) {
+            list_work_t *same = &lists[lists[i].same_as];
+            lists[i].ok = same->ok;
+            lists[i].hash = same->hash;
+        }
+    }
+}
+
+static void check_list(list_work_t *list, unsigned int i)
+{
+    uint64_t start_us = now_us();
     bool no_sigblock_ok = false;
-    size_t file_len;
-    uint16_t version;
+
+    if ( MAJOR_VER(list->version) == MAJOR_VER(LCP_TPM12_POLICY_LIST_VERSION) ||
+         MAJOR_VER(list->version) == MAJOR_VER(LCP_TPM20_POLICY_LIST_VERSION) ) {
+        list->pollist = read_policy_list_file(files[i], false, &no_sigblock_ok);
+        list->ok = list->pollist != NULL;
+    }
+    else if ( MAJOR_VER(list->version) == MAJOR_VER(LCP_TPM20_POLICY_LIST2_1_VERSION_300) ) {
+        //2.1 lists are checked straight from the mapped file
+        list->ok = get_policy_list_2_1_view(list->data, list->size, &list->view) &&
+                   (list->view.sig == NULL ||
+                    verify_policy_list_2_1_view_sig(&list->view));
+    }
+    else {
+        list->ok = true;
+    }
+    list->check_us = now_us() - start_us;
+}
+
+static void release_lists(unsigned int nr)
+{
+    for ( unsigned int i = 0; i < nr; i++ ) {
+        free(lists[i].pollist);
+        lists[i].pollist = NULL;
+        unmap_file(lists[i].file_data, lists[i].file_size);
+        lists[i].file_data = NULL;
+    }
+}
+
+lcp_policy_data_t2 *create_poldata(void)
+{
+    lcp_policy_data_t2 *poldata = NULL;
     uint16_t use_only_version; //Sets the version of list to use
-    size_t list_size;
+
+    memset_s(lists, sizeof(lists), 0);
+    for ( unsigned int i = 0; i < nr_files; i++ ) {
+        list_work_t *list = &lists[i];
+
+        list->file_data = map_file(files[i], &list->file_size);
+        if ( list->file_data == NULL ) {
+            release_lists(i);
+            return NULL;
+        }
+        if ( list->file_size < sizeof(uint16_t) ) {
+            ERROR("Error: %s is too small\n", files[i]);
+            release_lists(i + 1);
+            return NULL;
+        }
+        list->data = list->file_data;
+        list->size = list->file_size;
+        memcpy_s((void*)&list->version, sizeof(uint16_t), list->data, sizeof(uint16_t));
+        if (i == 0) {
+            use_only_version = list->version; //Read version of first list
+        }
+        if ( use_only_version != list->version ) { //If version differs, that's error
+            ERROR("ERROR: Mixing list versions is not supported.\n");
+            release_lists(i + 1);
+            return NULL;
+        }
+    }
+    find_same_lists(nr_files);
+    run_lists(nr_files, check_list);
 
     poldata = malloc(sizeof(*poldata));
     if ( poldata == NULL ) {
         ERROR("Error: failed to allocate memory\n");
+        release_lists(nr_files);
         return NULL;
     }
     memset_s(poldata, sizeof(*poldata), 0);
@@ -228,76 +416,136 @@ lcp_policy_data_t2 *create_poldata(void)
             sizeof(poldata->file_signature));
     poldata->num_lists = 0;
 
-    for ( unsigned int i = 0; i < nr_files; i++ ) {
-        file_data = read_file(files[i], &file_len, false);
-        if ( file_data == NULL ) {
+    /* lists go into the policy data in command line order */
+    for ( unsigned int i = 0; i < nr_files && poldata != NULL; i++ ) {
+        const list_work_t *list = &lists[i];
+
+        if ( list->same_as != -1 )
+            list = &lists[list->same_as];
+        if ( !list->ok ) {
             free(poldata);
-            return NULL;
+            poldata = NULL;
         }
-        memcpy_s((void*)&version, sizeof(uint16_t), file_data, sizeof(uint16_t));
-        if (i == 0) {
-            use_only_version = version; //Read version of first list
-        }
-        free(file_data);
-        if ( use_only_version != version ) { //If version differs, that's error
-            ERROR("ERROR: Mixing list versions is not supported.\n");
-            free(poldata);
-            return NULL;
+        else if ( MAJOR_VER(list->version) == MAJOR_VER(LCP_TPM12_POLICY_LIST_VERSION) ) {
+            poldata = add_tpm12_policy_list(poldata,
+                                    &list->pollist->tpm12_policy_list);
         }
-        if ( MAJOR_VER(version) == MAJOR_VER(LCP_TPM12_POLICY_LIST_VERSION) ) {
-                pollist = read_policy_list_file(files[i], false, &no_sigblock_ok);
-                if ( pollist == NULL ) {
-                    free(poldata);
-                    return NULL;
-                }
-                poldata = add_tpm12_policy_list(poldata, (lcp_policy_list_t *)pollist);
-                free(pollist);
-                pollist = NULL;
+        else if ( MAJOR_VER(list->version) == MAJOR_VER(LCP_TPM20_POLICY_LIST_VERSION) ) {
+            poldata = add_tpm20_policy_list(poldata,
+                                    &list->pollist->tpm20_policy_list);
         }
-        else if( MAJOR_VER(version) == MAJOR_VER(LCP_TPM20_POLICY_LIST_VERSION) ) {
-                pollist = read_policy_list_file(files[i], false, &no_sigblock_ok);
-                if ( pollist == NULL ) {
-                    free(poldata);
-                    return NULL;
-                }
-                poldata = add_tpm20_policy_list(poldata, (lcp_policy_list_t2 *)pollist);
-                free(pollist);
-                pollist = NULL;
-        }
-        else if ( MAJOR_VER(version) == MAJOR_VER(LCP_TPM20_POLICY_LIST2_1_VERSION_300) ) {
-            bool result;
-            pollist21 = read_policy_list_2_1_file(false, files[i]);
-            if (pollist21 == NULL) {
-                free(poldata);
-                return NULL;
-            }
-            if (pollist21->KeySignatureOffset != 0) { //list is signed
-                result = verify_tpm20_pollist_2_1_sig(pollist21);
-                if (!result) {
-                    free(poldata);
-                    return NULL;
-                }
-            }
-            poldata = add_tpm20_policy_list2_1(poldata, &list_size, pollist21);
-            if (poldata == NULL) {
-                free(pollist21);
-                return NULL;
-            }
-            list_21_sizes[i] = list_size;
-            free(pollist21);
-            pollist21 = NULL;
-        }
-        if ( poldata == NULL ) {
-            if (pollist != NULL)
-                free(pollist);
-            if (pollist21 != NULL)
-                free(pollist21);
-            return NULL;
+        else if ( MAJOR_VER(list->version) == MAJOR_VER(LCP_TPM20_POLICY_LIST2_1_VERSION_300) ) {
+            poldata = add_tpm20_policy_list2_1_raw(poldata, list->view.pollist,
+                                                   list->view.size);
+            list_21_sizes[i] = list->view.size;
         }
     }
+    release_lists(nr_files);
     return poldata;
 }
 
+static void measure_list(list_work_t *list, unsigned int i)
+{
+    uint64_t start_us = now_us();
+
+    (void)i;
+    list->ok = calc_policy_list_hash(list->data, &list->hash, list_hash_alg);
+    list->hash_us = now_us() - start_us;
+}
+
+bool hash_poldata(const lcp_policy_data_t2 *poldata, lcp_hash_t2 *hash,
+                  uint16_t hash_alg)
+/*
+This function: calculates the policy hash the way calc_policy_data_hash()
+does, hashing the lists concurrently
+
+In: policy data, hash buffer, hash alg
+Out: true on success, false on failure
+*/
+{
+    size_t hash_size = get_lcp_hash_size(hash_alg);
+    uint8_t hash_list[hash_size * LCP_MAX_LISTS];
+    const lcp_list_t *pollist = &poldata->policy_lists[0];
+
+    LOG("[hash_poldata]\n");
+    if ( poldata->num_lists > LCP_MAX_LISTS ) {
+        ERROR("Error: too many lists: %u\n", poldata->num_lists);
+        return false;
+    }
+    for ( unsigned int i = 0; i < poldata->num_lists; i++ ) {
+        lists[i].data = pollist;
+        lists[i].size = get_policy_list_size(pollist);
+        pollist = (void *)pollist + lists[i].size;
+    }
+    list_hash_alg = hash_alg;
+    find_same_lists(poldata->num_lists);
+    run_lists(poldata->num_lists, measure_list);
+
+    for ( unsigned int i = 0; i < poldata->num_lists; i++ ) {
+        if ( !lists[i].ok ) {
+            ERROR("ERROR: cannot calculate policy list hash.\n");
+            return false;
+        }
+        memcpy_s(hash_list + i * hash_size, sizeof(hash_list) - i * hash_size,
+                 &lists[i].hash, hash_size);
+    }
+
+    /* hash list */
+    return hash_buffer(hash_list, hash_size * poldata->num_lists,
+                       (tb_hash_t *)hash, hash_alg);
+}
+
+static void write_json_string(FILE *fp, const char *str)
+{
+    fputc('"', fp);
+    for ( ; *str != '\0'; str++ ) {
+        if ( *str == '"' || *str == '\\' )
+            fprintf(fp, "\\%c", *str);
+        else if ( (unsigned char)*str < 0x20 )
+            fprintf(fp, "\\u%04x", (unsigned char)*str);
+        else
+            fputc(*str, fp);
+    }
+    fputc('"', fp);
+}
+
+bool write_timing_report(unsigned int nr_lists, uint64_t total_us)
+/*
+This function: writes what --create spent on each list as JSON, times are
+in microseconds; "reused" lists had the same bytes as an earlier list
+
+In: number of lists in the policy data, time spent on the whole policy
+Out: true on success, false on failure
+*/
+{
+    FILE *fp = fopen(timing_file, "w");
+    if ( fp == NULL ) {
+        ERROR("Error: failed to open file %s for writing: %s\n",
+              timing_file, strerror(errno));
+        return false;
+    }
+
+    fprintf(fp, "{\n  \"jobs\": %d,\n  \"total_us\": %llu,\n  \"lists\": [",
+            nr_lists > 0 ? used_jobs : 0, (unsigned long long)total_us);
+    for ( unsigned int i = 0; i < nr_lists; i++ ) {
+        fprintf(fp, "%s\n    { \"file\": ", i > 0 ? "," : "");
+        write_json_string(fp, files[i]);
+        fprintf(fp, ", \"version\": \"0x%04x\", \"size\": %zu, \"reused\": %s, "
+                "\"check_us\": %llu, \"hash_us\": %llu }",
+                lists[i].version, lists[i].size,
+                lists[i].same_as != -1 ? "true" : "false",
+                (unsigned long long)lists[i].check_us,
+                (unsigned long long)lists[i].hash_us);
+    }
+    fprintf(fp, "%s]\n}\n", nr_lists > 0 ? "\n  " : "");
+
+    if ( fclose(fp) != 0 ) {
+        ERROR("Error: writing file %s\n", timing_file);
+        return false;
+    }
+    return true;
+}
+
 int create(void)
 {
     lcp_policy_data_t2 *poldata = NULL;
@@ -307,6 +555,7 @@ int create(void)
         ERROR("Error: failed to allocate policy\n");
         return 1;
     }
+    uint64_t start_us = now_us();
     memset_s(pol, sizeof(*pol), 0);
     pol->version = pol_ver;
     pol->hash_alg = lcp_hash_alg;
@@ -397,32 +646,20 @@ int create(void)
                     pollist = NULL;
                 }
                 else if ( MAJOR_VER(version) == 3 ) {
-                    bool result;
-                    lcp_policy_list_t2_1 *pollist21 = read_policy_list_2_1_file(false, files[i]);
-                    if (pollist21 == NULL) {
+                    lcp_list_2_1_view view;
+                    if ( !get_policy_list_2_1_view(file_data, file_len, &view) ||
+                         (view.sig != NULL &&
+                          !verify_policy_list_2_1_view_sig(&view)) ) {
+                        free(file_data);
                         free(pol);
                         free(poldata);
                         return 1;
                     }
-                    if (pollist21->KeySignatureOffset != 0) { //list is signed
-                        result = verify_tpm20_pollist_2_1_sig(pollist21);
-                        if (!result) {
-                            free(pol);
-                            free(poldata);
-                            return 1;
-                        }
-                    }
-                    size_t list_size;
-                    poldata = add_tpm20_policy_list2_1(poldata, &list_size ,pollist21);
-                    if (poldata == NULL) {
-                        free(pol);
-                        free(pollist21);
-                        return 1;
-                    }
-                    list_21_sizes[i] = list_size;
-                    free(pollist21);
-                    pollist21 = NULL;
+                    poldata = add_tpm20_policy_list2_1_raw(poldata, view.pollist,
+                                                           view.size);
+                    list_21_sizes[i] = view.size;
                 }
+                free(file_data);
                 if ( poldata == NULL ) {
                     free(pol);
                     if (pollist != NULL)
@@ -431,7 +668,11 @@ int create(void)
                 }
             }
         }
-        calc_policy_data_hash(poldata, &pol->policy_hash, pol->hash_alg);
+        if ( !hash_poldata(poldata, &pol->policy_hash, pol->hash_alg) ) {
+            free(pol);
+            free(poldata);
+            return 1;
+        }
     }
     else {
         ERROR("Error: unknown policy type\n");
@@ -441,8 +682,12 @@ int create(void)
 
     LOG("pol alg=0x%x, mask=0x%x, aux_mask=0x%x, sign_mask=0x%x\n", pol->hash_alg, pol->lcp_hash_alg_mask, pol->aux_hash_alg_mask, pol->lcp_sign_alg_mask);
 
-    bool ok;
-    ok = write_file(policy_file, pol, get_policy_size(pol));
+    bool ok = true;
+    if ( *timing_file != '\0' )
+        ok = write_timing_report(poldata != NULL ? poldata->num_lists : 0,
+                                 now_us() - start_us);
+    if ( ok )
+        ok = write_file(policy_file, pol, get_policy_size(pol));
     if ( ok && pol->policy_type == LCP_POLTYPE_LIST )
         ok = write_file(poldata_file, poldata, get_policy_data_size(poldata));
 
@@ -698,6 +943,20 @@ int main (int argc, char *argv[])
             }
             break;
 
+        case 'j':            /* jobs */
+            nr_jobs = strtol(optarg, NULL, 0);
+            if ( nr_jobs <= 0 ) {
+                ERROR("Error: --jobs must be a positive number\n");
+                return 1;
+            }
+            LOG("cmdline opt: jobs: %d\n", nr_jobs);
+            break;
+
+        case 'T':            /* timing report */
+            strlcpy(timing_file, optarg, sizeof(timing_file));
+            LOG("cmdline opt: timing: %s\n", timing_file);
+            break;
+
         case 0:
         case -1:
             break;
@@ -39,6 +39,8 @@
 #include <stdbool.h>
 #include <unistd.h>
 #include <time.h>
+#include <ctype.h>
+#include <pthread.h>
 #define _GNU_SOURCE
 #include <getopt.h>
 #include <errno.h>
@@ -64,6 +66,7 @@
 #include "pollist2_1.h"
 #include "polelt.h"
 #include "pollist1.h"
+#include "signer.h"
 
 #define TOOL_VER_MAJOR 0x1
 #define TOOL_VER_MINOR 0x1
@@ -97,10 +100,19 @@ static const char help[] =
     "        [--hashalg]              LCP_POLICY_LIST2_1 option:\n"
     "                                 <sha1|sha256|sha384|sha512|sm2> hash algorithm\n"
     "        --pub <key file>         PEM file of public key\n"
-    "        [--priv <key file>]      PEM file of private key\n"
+    "        [--priv <key file>]      PEM file of private key, or with\n"
+    "                                 --signer unix:<path> the key's name\n"
+    "        [--signer <signer>]      <file|unix:<path>> where to sign:\n"
+    "                                 in process (default) or by the\n"
+    "                                 lcp2_signd serving <path>\n"
     "        [--rev <rev ctr>]        revocation counter value\n"
     "        [--nosig]                don't add SigBlock\n"
     "        --out <FILE>             policy list file to sign\n"
+    "        or\n"
+    "        --batch <FILE>           file listing policy list files to sign,\n"
+    "                                 one per line\n"
+    "        [--jobs <number>]        number of signing threads for --batch\n"
+    "                                 (default: number of CPUs)\n"
     "\n--addsig\n"
     "Adds signature file to LCP_POLICY_LIST_2 - this option cannot be used\n"
     "with LCP_POLICY_LIST_2_1.\n"
@@ -112,6 +124,10 @@ static const char help[] =
     "\n--verify\n"
     "Verifies signed LCP_POLICY_LIST_2_1 signature.\n"
     "        <FILE>                   policy list file with signature\n"
+    "        or\n"
+    "        --batch <FILE>           file listing policy list files to verify,\n"
+    "                                 one per line\n"
+    "        [--jobs <number>]        number of threads for --batch\n"
     "\n--help\n"
     "\n--verbose                      enable verbose output; can be\n"
     "                                 specified with any command\n\n"
@@ -144,6 +160,9 @@ static struct option long_opts[] =
     {"sig",            required_argument,    NULL,     's'},
     {"listver",        required_argument,    NULL,     'l'},
     {"verbose",        no_argument,          NULL,     't'},
+    {"batch",          required_argument,    NULL,     'b'},
+    {"jobs",           required_argument,    NULL,     'j'},
+    {"signer",         required_argument,    NULL,     'g'},
 
     {0, 0, 0, 0}
 };
@@ -163,6 +182,8 @@ static unsigned int   nr_files = 0;
 static char           files[MAX_FILES][MAX_PATH];
 static char           hash_alg_name[32] = "";
 static uint16_t       hash_alg_cli = TPM_ALG_SHA256; //Default
+static char           batch_file[MAX_PATH] = "";
+static int            nr_jobs = 0; // Default: number of CPUs
 
 static int create_list_2_1(void)
 {
@@ -283,17 +304,18 @@ static int create(void)
     return write_ok ? 0 : 1;
 }
 
-static int sign(void)
+static int sign_list(const char *list_file)
 {
     LOG("[sign]\n");
     bool result;
-    void *file_data = read_file(pollist_file, NULL, false);
+    uint16_t list_ver;
+    void *file_data = read_file(list_file, NULL, false);
     sign_user_input user_input;
     if ( file_data == NULL ) {
         return 1;
     }
     //List version is first two bytes of the list file
-    memcpy_s((void*)&version, sizeof(uint16_t), (const void *)file_data, sizeof(uint16_t));
+    memcpy_s((void*)&list_ver, sizeof(uint16_t), (const void *)file_data, sizeof(uint16_t));
     free(file_data); //We just need version
     file_data = NULL;
     //sign_user_input is used to pass some data from users to functions in
@@ -301,7 +323,7 @@ static int sign(void)
     user_input.sig_alg = sigalg_type;
     user_input.hash_alg = hash_alg_cli;
     user_input.rev_ctr = rev_ctr;
-    if (strcpy_s(user_input.list_file, MAX_PATH, pollist_file) != EOK) {
+    if (strcpy_s(user_input.list_file, MAX_PATH, list_file) != EOK) {
         ERROR("Error: cannot open file.\n");
         return 1;
     }
@@ -313,43 +335,35 @@ static int sign(void)
         ERROR("Error: cannot open file.\n");
         return 1;
     }
-    if ( MAJOR_VER(version) == MAJOR_VER(LCP_TPM12_POLICY_LIST_VERSION) ) {
+    if ( MAJOR_VER(list_ver) == MAJOR_VER(LCP_TPM12_POLICY_LIST_VERSION) ) {
         LOG("sign: LCP_POLICY_LIST,sig_alg=LCP_POLSALG_RSA_PKCS_15\n");
         result = sign_lcp_policy_list_t(user_input);
-        if (result) {
-            DISPLAY("List signed successfully and written to %s\n", user_input.list_file);
-            return 0;
-        }
-        else {
-            DISPLAY("Failed to sign and write LCP list.\n");
-            return 1;
-        }
     }
-    else if ( MAJOR_VER(version) == MAJOR_VER(LCP_TPM20_POLICY_LIST_VERSION) ) {
+    else if ( MAJOR_VER(list_ver) == MAJOR_VER(LCP_TPM20_POLICY_LIST_VERSION) ) {
         LOG("sign: LCP_POLICY_LIST2,sig_alg=0x%x\n", user_input.sig_alg);
         result = sign_lcp_policy_list_t2(user_input);
-        if (result) {
-            DISPLAY("List signed successfully and written to %s\n", user_input.list_file);
-            return 0;
-        }
-        else {
-            DISPLAY("Failed to sign and write LCP list.\n");
-            return 1;
-        }
     }
-    else if ( MAJOR_VER(version) == MAJOR_VER(LCP_TPM20_POLICY_LIST2_1_VERSION_300)) {
+    else if ( MAJOR_VER(list_ver) == MAJOR_VER(LCP_TPM20_POLICY_LIST2_1_VERSION_300)) {
         LOG("sign: LCP_POLICY_LIST2_1,sig_alg=0x%x\n", user_input.sig_alg);
         result = sign_lcp_policy_list_t2_1(user_input);
-        if (result) {
-            DISPLAY("List signed successfully and written to %s\n", user_input.list_file);
-            return 0;
-        }
-        else {
-            DISPLAY("Failed to sign and write LCP list.\n");
-            return 1;
-        }
     }
-    return 1;
+    else {
+        ERROR("Error: %s: version unrecognized.\n", list_file);
+        return 1;
+    }
+    if (result) {
+        DISPLAY("List signed successfully and written to %s\n", user_input.list_file);
+        return 0;
+    }
+    else {
+        DISPLAY("Failed to sign and write LCP list %s.\n", user_input.list_file);
+        return 1;
+    }
+}
+
+static int sign(void)
+{
+    return sign_list(pollist_file);
 }
 
 static int addsig(void)
@@ -491,57 +505,222 @@ static int show(void)
     return 0;
 }
 
-static int verify(void)
+/* verify_list() results */
+#define LIST_VERIFIED       0
+#define LIST_UNSIGNED       1
+#define LIST_BAD_SIG        2
+#define LIST_UNSUPPORTED    3
+#define LIST_ERROR          4
+
+static int verify_list(const char *list_file)
 {
     LOG("Verify policy list 2.1\n");
-    lcp_policy_list_t2_1 *pollist2_1 = NULL;
-    void *file_data = NULL;
+    const void *file_data = NULL;
     size_t file_len;
     uint16_t  version;
+    lcp_list_2_1_view view;
+    int status;
 
-    file_data = read_file(files[0], &file_len, true);
+    /* the list is checked and verified in place, straight from the file */
+    file_data = map_file(list_file, &file_len);
     if (file_data == NULL) {
         ERROR("Error: failed to read pollist file.\n");
-        return 1;
+        return LIST_ERROR;
+    }
+    if ( file_len < sizeof(version) ) {
+        ERROR("Error: pollist file too small.\n");
+        unmap_file(file_data, file_len);
+        return LIST_ERROR;
     }
 
     memcpy_s((void*)&version, sizeof(uint16_t), file_data, sizeof(uint16_t));
-    free(file_data);
-    file_data = NULL;
-    if ( MAJOR_VER(version) == 1 ) {
+    if ( MAJOR_VER(version) == 1 || MAJOR_VER(version) == 2 ) {
+        status = LIST_UNSUPPORTED;
+    }
+    else if ( MAJOR_VER(version) == 3 ) {
+        if ( !get_policy_list_2_1_view(file_data, file_len, &view) ) {
+            ERROR("Error: failed to get policy list from file.\n");
+            status = LIST_ERROR;
+        }
+        else if ( view.sig == NULL )
+            status = LIST_UNSIGNED;
+        else
+            status = verify_policy_list_2_1_view_sig(&view) ? LIST_VERIFIED :
+                                                              LIST_BAD_SIG;
+    }
+    else {
+        ERROR("Error: version unrecognized.\n");
+        status = LIST_ERROR;
+    }
+    unmap_file(file_data, file_len);
+    return status;
+}
+
+static int verify(void)
+{
+    switch ( verify_list(files[0]) ) {
+    case LIST_VERIFIED:
+        DISPLAY("List signature correct. Verification successful\n");
+        return 0;
+    case LIST_UNSIGNED:
+        DISPLAY("Verification successful. List is not signed. Exiting.\n");
+        return 0;
+    case LIST_BAD_SIG:
+        DISPLAY("List signature did not verify positively.\n");
+        return 0;
+    case LIST_UNSUPPORTED:
         LOG("Unsupported.\n");
         return 0;
+    default:
+        return 1;
     }
-    else if ( MAJOR_VER(version) == 2 ){
-        LOG("Unsupported.\n");
+}
+
+/* in a batch, anything but a good or absent signature is a failure */
+static int verify_batch_list(const char *list_file)
+{
+    switch ( verify_list(list_file) ) {
+    case LIST_VERIFIED:
+        DISPLAY("%s: list signature correct\n", list_file);
+        return 0;
+    case LIST_UNSIGNED:
+        DISPLAY("%s: list is not signed\n", list_file);
         return 0;
+    case LIST_BAD_SIG:
+        DISPLAY("%s: list signature did not verify positively\n", list_file);
+        return 1;
+    case LIST_UNSUPPORTED:
+        DISPLAY("%s: unsupported list version\n", list_file);
+        return 1;
+    default:
+        DISPLAY("%s: failed to verify list\n", list_file);
+        return 1;
     }
-    else if ( MAJOR_VER(version) == 3 ) {
-        bool result;
-        pollist2_1 = read_policy_list_2_1_file(false, files[0]);
-        if ( pollist2_1 == NULL ) {
-            ERROR("Error: failed to get policy list from file.\n");
-            return 1;
+}
+
+/*
+ * --batch: sign or verify every list named in a manifest file, one per
+ * line (blank lines and lines starting with '#' are skipped), with the
+ * options given on the command line.  The lists are spread over --jobs
+ * threads and the keys are read once for all of them (see the key cache
+ * in lcputils.c), which is what dominates signing lists one per run.
+ */
+static struct {
+    char         **lists;
+    unsigned int nr_lists;
+    unsigned int next;
+    unsigned int failed;
+    int          (*process)(const char *list_file);
+} batch;
+
+static bool read_batch_file(const char *file)
+{
+    char line[MAX_PATH + 2];
+    unsigned int max_lists = 0;
+
+    FILE *fp = fopen(file, "r");
+    if ( fp == NULL ) {
+        ERROR("Error: failed to open file %s: %s\n", file, strerror(errno));
+        return false;
+    }
+
+    while ( fgets(line, sizeof(line), fp) != NULL ) {
+        char *start = line;
+        size_t len = strnlen_s(line, sizeof(line));
+
+        if ( len > 0 && line[len - 1] != '\n' && !feof(fp) ) {
+            ERROR("Error: %s: line too long\n", file);
+            fclose(fp);
+            return false;
+        }
+        while ( len > 0 && isspace((unsigned char)line[len - 1]) )
+            line[--len] = '\0';
+        while ( isspace((unsigned char)*start) )
+            start++;
+        if ( *start == '\0' || *start == '#' )
+            continue;
+
+        if ( batch.nr_lists == max_lists ) {
+            max_lists = max_lists ? 2 * max_lists : 64;
+            char **lists = realloc(batch.lists, max_lists * sizeof(*lists));
+            if ( lists == NULL ) {
+                ERROR("Error: failed to allocate memory\n");
+                fclose(fp);
+                return false;
+            }
+            batch.lists = lists;
         }
-        if ( pollist2_1->KeySignatureOffset == 0 ) {
-            DISPLAY("Verification successful. List is not signed. Exiting.\n");
-            free(pollist2_1);
-            return 0;
+        batch.lists[batch.nr_lists] = strdup(start);
+        if ( batch.lists[batch.nr_lists] == NULL ) {
+            ERROR("Error: failed to allocate memory\n");
+            fclose(fp);
+            return false;
         }
-        result = verify_tpm20_pollist_2_1_sig(pollist2_1);
-        if (!result) {
-            free(pollist2_1);
-            DISPLAY("List signature did not verify positively.\n");
-            return 0;
+        batch.nr_lists++;
+    }
+
+    fclose(fp);
+    return true;
+}
+
+static void *batch_worker(void *arg)
+{
+    (void)arg;
+
+    while ( true ) {
+        unsigned int i = __sync_fetch_and_add(&batch.next, 1);
+
+        if ( i >= batch.nr_lists )
+            break;
+        if ( batch.process(batch.lists[i]) != 0 )
+            __sync_fetch_and_add(&batch.failed, 1);
+    }
+    return NULL;
+}
+
+static int run_batch(int (*process)(const char *list_file))
+{
+    pthread_t *threads;
+    int num_threads = 0;
+    int jobs = nr_jobs;
+    bool read_ok;
+
+    read_ok = read_batch_file(batch_file);
+    if ( read_ok && batch.nr_lists > 0 ) {
+        if ( jobs <= 0 )
+            jobs = sysconf(_SC_NPROCESSORS_ONLN);
+        if ( jobs > (int)batch.nr_lists )
+            jobs = batch.nr_lists;
+        batch.process = process;
+
+        /* this thread works too, so start one fewer */
+        threads = calloc(jobs > 1 ? jobs - 1 : 1, sizeof(*threads));
+        if ( threads == NULL ) {
+            ERROR("Error: failed to allocate memory\n");
+            read_ok = false;
         }
         else {
-            free(pollist2_1);
-            DISPLAY("List signature correct. Verification successful\n");
-            return 0;
-        }
-    }
-    ERROR("Error: version unrecognized.\n");
-    return 1;
+            while ( num_threads < jobs - 1 &&
+                    pthread_create(&threads[num_threads], NULL, batch_worker,
+                                   NULL) == 0 )
+                num_threads++;
+            LOG("processing %u lists with %d threads\n", batch.nr_lists,
+                num_threads + 1);
+
+            batch_worker(NULL);
+            for ( int i = 0; i < num_threads; i++ )
+                pthread_join(threads[i], NULL);
+            free(threads);
+        }
+    }
+
+    if ( read_ok )
+        DISPLAY("%u of %u lists processed successfully\n",
+                batch.nr_lists - batch.failed, batch.nr_lists);
+    for ( unsigned int i = 0; i < batch.nr_lists; i++ )
+        free(batch.lists[i]);
+    free(batch.lists);
+    return (read_ok && batch.failed == 0) ? 0 : 1;
 }
 
 int main(int argc, char *argv[])
@@ -630,6 +809,26 @@ int main(int argc, char *argv[])
         case 't':
             verbose = true;
             break;
+
+        case 'b':            /* batch */
+            strlcpy(batch_file, optarg, sizeof(batch_file));
+            LOG("cmdline opt: batch: %s\n", batch_file);
+            break;
+
+        case 'j':            /* jobs */
+            nr_jobs = strtol(optarg, NULL, 0);
+            if ( nr_jobs <= 0 ) {
+                ERROR("Error: invalid number of jobs\n");
+                return 1;
+            }
+            LOG("cmdline opt: jobs: %d\n", nr_jobs);
+            break;
+
+        case 'g':            /* signer */
+            if ( !set_signer(optarg) )
+                return 1;
+            LOG("cmdline opt: signer: %s\n", optarg);
+            break;
         case 0:
         case -1:
             break;
@@ -669,10 +868,14 @@ int main(int argc, char *argv[])
     }
     else if ( cmd == 'S' ) {        /* --sign */
 
-        if ( *pollist_file == '\0' ) {
+        if ( *pollist_file == '\0' && *batch_file == '\0' ) {
             ERROR("Error: no policy list output file specified\n");
             return 1;
         }
+        if ( *pollist_file != '\0' && *batch_file != '\0' ) {
+            ERROR("Error: --out cannot be used with --batch\n");
+            return 1;
+        }
         if (sigalg_type == TPM_ALG_NULL) {
             ERROR("Error: signature algorithm must be specified.\n");
             return 1;
@@ -704,6 +907,8 @@ int main(int argc, char *argv[])
                 return 1;
             }
         }
+        if ( *batch_file != '\0' )
+            return run_batch(sign_list);
         return sign();
     }
     else if ( cmd == 'A' ) {        /* --addsig */
@@ -725,6 +930,13 @@ int main(int argc, char *argv[])
         return show();
     }
     else if ( cmd == 'V') {  /*--verify*/
+        if ( *batch_file != '\0' ) {
+            if ( nr_files != 0 ) {
+                ERROR("ERROR: policy list file cannot be used with --batch.\n");
+                return 1;
+            }
+            return run_batch(verify_batch_list);
+        }
         if ( *files[0] == '\0' ) {
             ERROR("ERROR: no policy list file specified.");
             return 1;
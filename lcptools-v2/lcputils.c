@@ -42,6 +42,11 @@
 #include <ctype.h>
 #include <errno.h>
 #include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <openssl/rsa.h>
 #include <openssl/engine.h>
 #include <openssl/pem.h>
@@ -175,6 +180,46 @@ void *read_file(const char *file, size_t *length, bool fail_ok)
     return data;
 }
 
+/*
+ * map_file
+ *
+ * map a file read-only, for parsing it in place; release with unmap_file()
+ */
+const void *map_file(const char *file, size_t *length)
+{
+    struct stat st;
+    void *data;
+
+    LOG("[map_file]\n");
+    LOG("map_file: filename=%s\n", file);
+    int fd = open(file, O_RDONLY);
+    if ( fd < 0 ) {
+        ERROR("Error: failed to open file %s: %s\n", file, strerror(errno));
+        return NULL;
+    }
+    if ( fstat(fd, &st) < 0 || st.st_size <= 0 ) {
+        ERROR("Error: failed to get file length or file is empty.\n");
+        close(fd);
+        return NULL;
+    }
+
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if ( data == MAP_FAILED ) {
+        ERROR("Error: failed to map file %s: %s\n", file, strerror(errno));
+        return NULL;
+    }
+
+    *length = st.st_size;
+    return data;
+}
+
+void unmap_file(const void *data, size_t length)
+{
+    if ( data != NULL )
+        munmap((void *)data, length);
+}
+
 bool write_file(const char *file, const void *data, size_t size)
 {
     LOG("[write_file]\n");
@@ -194,81 +239,181 @@ bool write_file(const char *file, const void *data, size_t size)
     return true;
 }
 
-bool parse_line_hashes(const char *line, tb_hash_t *hash, uint16_t alg)
+static int hex_digit(char c)
 {
-    /* skip any leading whitespace */
-    while ( *line != '\0' && isspace(*line) )
-        line++;
+    if ( c >= '0' && c <= '9' )
+        return c - '0';
+    return (c | 0x20) - 'a' + 10;
+}
 
-    /* rest of line is hex of hash */
-    unsigned int i = 0;
-    while ( *line != '\0' && *line != '\n' ) {
-        char *next;
-        switch (alg) {
-        case LCP_POLHALG_SHA1: //Legacy value for TPM 1.2
-            hash->sha1[i++] = (uint8_t)strtoul(line, &next, 16);
-            break;
-        case TPM_ALG_SHA1:
-            hash->sha1[i++] = (uint8_t)strtoul(line, &next, 16);
-            break;
-        case TPM_ALG_SHA256:
-            hash->sha256[i++] = (uint8_t)strtoul(line, &next, 16);
-            break;
-        case TPM_ALG_SHA384:
-            hash->sha384[i++] = (uint8_t)strtoul(line, &next, 16);
-            break;
-        default:
-            ERROR("Error: unsupported alg: 0x%x\n",alg);
-            return false;
-        }
-        if ( next == line )      /* done */
-            break;
-        line = next;
-        /* spaces at end cause strtoul() to interpret as 0, so skip them */
-        while ( *line != '\0' && !isxdigit(*line) )
-            line++;
-    }
+/* what may separate the bytes of a hash on a line */
+static bool is_hash_separator(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == ':' || c == ',';
+}
 
-    if ( i != get_hash_size(alg) ) {
-        ERROR("Error: incorrect number of chars for hash\n");
-        return false;
-    }
+/*
+ * parse one line of a hashes file, from p up to end (the newline isn't
+ * included): hex bytes separated by spaces, tabs, ':' or ',', each
+ * optionally prefixed with 0x, or the whole hash as one hex string
+ *
+ * returns the number of bytes found, 0 for a blank line or -1 (with *bad
+ * pointing at the culprit) if a token isn't a byte, a character is
+ * neither hex nor a separator, or the line holds more than hash_size bytes
+ */
+static int parse_hash_line(const char *p, const char *end, uint8_t *hash,
+                           size_t hash_size, const char **bad)
+{
+    size_t n = 0;
 
-    return true;
+    while ( p < end ) {
+        const char *token;
+        size_t len;
+
+        if ( is_hash_separator(*p) ) {
+            p++;
+            continue;
+        }
+        if ( !isxdigit((unsigned char)*p) ) {
+            *bad = p;
+            return -1;
+        }
+        if ( *p == '0' && end - p > 2 && (p[1] | 0x20) == 'x' &&
+             isxdigit((unsigned char)p[2]) )
+            p += 2;
+        for ( token = p; p < end && isxdigit((unsigned char)*p); p++ )
+            ;
+        len = p - token;
+
+        if ( p < end && !is_hash_separator(*p) ) {
+            *bad = p;
+            return -1;
+        }
+        if ( len <= 2 && n < hash_size ) {
+            hash[n++] = len == 1 ? hex_digit(token[0]) :
+                        hex_digit(token[0]) << 4 | hex_digit(token[1]);
+        }
+        else if ( len == 2 * hash_size && n == 0 ) {
+            for ( ; n < hash_size; n++, token += 2 )
+                hash[n] = hex_digit(token[0]) << 4 | hex_digit(token[1]);
+        }
+        else {
+            *bad = token;
+            return -1;
+        }
+    }
+    return n;
 }
 
-bool parse_file(const char *filename, bool (*parse_line)(const char *line))
+/*
+ * read_hashes_file
+ *
+ * append the hashes in a text file, one per line, to *hashes (which is
+ * realloc()ed); blank lines are skipped.  The file is parsed in place from
+ * a mapping and *hashes grows once per file, so files with tens of
+ * thousands of hashes import quickly.  Entries are zeroed past the hash
+ * size, as sort_unique_hashes() expects.
+ */
+bool read_hashes_file(const char *filename, uint16_t alg, tb_hash_t **hashes,
+                      unsigned int *nr_hashes, unsigned int max_hashes)
 {
-    if ( filename == NULL || parse_line == NULL )
+    size_t hash_size = get_hash_size(alg);
+    size_t size, max_new;
+    const char *data, *p, *end;
+    unsigned int nr, line_nr = 0;
+    tb_hash_t *new_hashes;
+
+    if ( filename == NULL || hashes == NULL || nr_hashes == NULL )
+        return false;
+    if ( hash_size == 0 ) {
+        ERROR("Error: unsupported alg: 0x%x\n", alg);
         return false;
+    }
 
     LOG("reading hashes file %s...\n", filename);
+    data = map_file(filename, &size);
+    if ( data == NULL )
+        return false;
 
-    FILE *fp = fopen(filename, "r");
-    if ( fp == NULL ) {
-        ERROR("Error: failed to open file %s (%s)\n", filename, strerror(errno));
+    /* a hash takes at least two chars per byte */
+    nr = *nr_hashes;
+    max_new = size / (2 * hash_size) + 1;
+    if ( max_new > max_hashes - nr )
+        max_new = max_hashes - nr;
+    new_hashes = realloc(*hashes, (nr + max_new + 1) * sizeof(tb_hash_t));
+    if ( new_hashes == NULL ) {
+        ERROR("Error: failed to allocate memory\n");
+        unmap_file(data, size);
         return false;
     }
+    *hashes = new_hashes;
+
+    for ( p = data, end = data + size; p < end; p++ ) {
+        const char *eol = memchr(p, '\n', end - p);
+        const char *bad = NULL;
+        int len;
+
+        if ( eol == NULL )
+            eol = end;
+        line_nr++;
+        memset_s(&new_hashes[nr], sizeof(tb_hash_t), 0);
+        len = parse_hash_line(p, eol, (uint8_t *)&new_hashes[nr], hash_size,
+                              &bad);
+        if ( len > 0 && (size_t)len != hash_size ) {
+            ERROR("Error: %s:%u: incorrect number of chars for hash\n",
+                  filename, line_nr);
+            break;
+        }
+        if ( len < 0 ) {
+            ERROR("Error: %s:%u: not a hash (column %u)\n", filename,
+                  line_nr, (unsigned int)(bad - p) + 1);
+            break;
+        }
+        if ( len > 0 && ++nr > max_hashes ) {
+            ERROR("Error: too many hashes, at most %u are supported\n",
+                  max_hashes);
+            break;
+        }
+        p = eol;
+    }
+    unmap_file(data, size);
+    if ( p < end )
+        return false;
 
-    static char line[1024];
-    while ( true ) {
-        char *s = fgets(line, sizeof(line), fp);
+    LOG("read %u hashes from %s\n", nr - *nr_hashes, filename);
+    *nr_hashes = nr;
+    return true;
+}
 
-        if ( s == NULL ) {
-            fclose(fp);
-            return true;
-        }
+static int cmp_hashes(const void *hash1, const void *hash2)
+{
+    int diff;
 
-        LOG("read line: %s\n", line);
+    memcmp_s(hash1, sizeof(tb_hash_t), hash2, sizeof(tb_hash_t), &diff);
+    return diff;
+}
 
-        if ( !(*parse_line)(line) ) {
-            fclose(fp);
-            return false;
-        }
-    }
+/*
+ * sort_unique_hashes
+ *
+ * sort hashes read by read_hashes_file() and drop duplicates, so element
+ * hashes can be searched with a binary search; returns how many are left
+ */
+unsigned int sort_unique_hashes(tb_hash_t *hashes, unsigned int nr_hashes)
+{
+    unsigned int nr = 0;
 
-    fclose(fp);
-    return false;
+    if ( nr_hashes == 0 )
+        return 0;
+
+    qsort(hashes, nr_hashes, sizeof(*hashes), cmp_hashes);
+    for ( unsigned int i = 1; i < nr_hashes; i++ ) {
+        if ( cmp_hashes(&hashes[nr], &hashes[i]) != 0 )
+            hashes[++nr] = hashes[i];
+    }
+    if ( nr + 1 < nr_hashes )
+        LOG("dropped %u duplicate hashes\n", nr_hashes - nr - 1);
+    return nr + 1;
 }
 
 const char *hash_alg_to_str(uint16_t alg)
@@ -486,12 +631,13 @@ size_t get_lcp_hash_size(uint16_t hash_alg)
     return 0;
 }
 
-bool verify_rsa_signature(sized_buffer *data, sized_buffer *pubkey, sized_buffer *signature,
+bool verify_rsa_signature(const unsigned char *data, size_t data_size,
+                          sized_buffer *pubkey, sized_buffer *signature,
                           uint16_t hashAlg, uint16_t sig_alg, uint16_t list_ver)
 /*
 This function: verifies policy list's rsapss and rsassa signatures using pubkey
 
-In: Data - pointer to sized buffer with signed LCP policy list contents:
+In: Data - pointer to signed LCP policy list contents, data_size bytes:
     LCP_POLICY_LIST2_1 - entire list up to KeyAndSignature field (that includes
     RevoCation counter) i.e. KeyAndSignatureOffset bytes of data from the list.
     LCP_POLICY_LIST and LCP_POLICY_LIST2 - entire list minus the signature field.
@@ -626,8 +772,7 @@ Out: true/false on verification success or failure
         status = 0;
         goto EXIT;
     }
-    status = hash_buffer((const unsigned char *) data->data, data->size, digest,
-                                                                        hashAlg);
+    status = hash_buffer(data, data_size, digest, hashAlg);
     if (!status) {
         ERROR("Error: failed to hash list contents.\n");
         goto EXIT;
@@ -661,14 +806,15 @@ Out: true/false on verification success or failure
         return status ? true : false;
 }
 
-bool verify_ec_signature(sized_buffer *data, sized_buffer *pubkey_x, 
-                         sized_buffer *pubkey_y, sized_buffer *sig_r,
+bool verify_ec_signature(const unsigned char *data, size_t data_size,
+                         sized_buffer *pubkey_x, sized_buffer *pubkey_y,
+                         sized_buffer *sig_r,
                          sized_buffer *sig_s, uint16_t sigalg, uint16_t hashalg)
 {
      /*
     This function: verifies ecdsa or SM2 signature using pubkey (lists 2.0 and 2.1 only!)
 
-    In: Data - LCP policy list contents:
+    In: Data - LCP policy list contents, data_size bytes:
 
     LCP_LIST_2_1: entire list up to KeyAndSignature field (that includes 
         RevoCation counter) i.e. hash of KeyAndSignatureOffset bytes of the list.
@@ -809,9 +955,9 @@ bool verify_ec_signature(sized_buffer *data, sized_buffer *pubkey_x,
     }
     if (verbose) {
         LOG("Data that was signed:\n");
-        print_hex("    ", data->data, data->size);
+        print_hex("    ", data, data_size);
     }
-    result = EVP_DigestVerifyUpdate(mctx, data->data, data->size);
+    result = EVP_DigestVerifyUpdate(mctx, data, data_size);
     if (result <= 0) {
         ERROR("Error: error while verifying.\n");
         goto OPENSSL_ERROR;
@@ -873,9 +1019,9 @@ bool ec_sign_data(sized_buffer *data, sized_buffer *r, sized_buffer *s, uint16_t
     size_t sig_length;
     EC_KEY *ec_key = NULL;
     EVP_PKEY *evp_key = NULL;
+    EVP_PKEY *cached_key = NULL;
     EVP_MD_CTX *mctx = NULL;
     EVP_PKEY_CTX *pctx = NULL;
-    FILE *fp = NULL;
     ECDSA_SIG *ecdsa_sig = NULL;
     const BIGNUM *sig_r = NULL; //Is freed when ECDSA_SIG is freed
     const BIGNUM *sig_s = NULL; //Is freed when ECDSA_SIG is freed
@@ -891,19 +1037,17 @@ bool ec_sign_data(sized_buffer *data, sized_buffer *r, sized_buffer *s, uint16_t
         ERROR("Error: failed to allocate message digest context.\n");
         goto OPENSSL_ERROR;
     }
-    fp = fopen(privkey_file, "r");
-    if ( fp == NULL ) {
-        ERROR("Error: failed to open file %s: %s\n", privkey_file, strerror(errno));
+    cached_key = read_cached_privkey(privkey_file);
+    if ( cached_key == NULL ) {
         result = 0;
         goto EXIT;
     }
-    ec_key = PEM_read_ECPrivateKey(fp, NULL, NULL, NULL);
+    //The cached key is shared, so sign with a private EVP key around it
+    ec_key = EVP_PKEY_get1_EC_KEY(cached_key);
     if (ec_key == NULL) {
         ERROR("Error: failed to allocate EC key.\n");
         goto OPENSSL_ERROR;
     }
-    fclose(fp);
-    fp = NULL;
     evp_key = EVP_PKEY_new();
     if (evp_key == NULL) {
         ERROR("Error: failed to allocate EVP key.\n");
@@ -914,6 +1058,7 @@ bool ec_sign_data(sized_buffer *data, sized_buffer *r, sized_buffer *s, uint16_t
         ERROR("Error: failed to assign EC key to EVP structure.\n");
         goto OPENSSL_ERROR;
     }
+    ec_key = NULL; //Now owned by evp_key
 
     if (sigalg == TPM_ALG_SM2) {
         result = EVP_PKEY_set_alias_type(evp_key, EVP_PKEY_SM2);
@@ -988,8 +1133,14 @@ bool ec_sign_data(sized_buffer *data, sized_buffer *r, sized_buffer *s, uint16_t
         ERROR("Error: failed to extract signature components.\n");
         goto OPENSSL_ERROR;
     }
-    BN_bn2bin(sig_r, r->data);
-    BN_bn2bin(sig_s, s->data);
+    //r and s are left padded to the buffer size, which must hold them
+    if (BN_num_bytes(sig_r) > (int)r->size || BN_num_bytes(sig_s) > (int)s->size) {
+        ERROR("Error: signature components don't fit the buffers.\n");
+        result = 0;
+        goto EXIT;
+    }
+    BN_bn2binpad(sig_r, r->data, r->size);
+    BN_bn2binpad(sig_s, s->data, s->size);
 
     goto EXIT;
     OPENSSL_ERROR:
@@ -999,20 +1150,20 @@ bool ec_sign_data(sized_buffer *data, sized_buffer *r, sized_buffer *s, uint16_t
         ERR_free_strings();
         result = 0;
     EXIT:
-        if (ec_key != NULL) {
-            OPENSSL_free((void *) ec_key);
-        }
-        if (evp_key != NULL) {
-            OPENSSL_free((void *) evp_key);
-        }
         if (mctx != NULL) {
-            OPENSSL_free((void *) mctx);
+            EVP_MD_CTX_free(mctx);
         }
         if (pctx != NULL) {
-            OPENSSL_free((void *) pctx);
+            EVP_PKEY_CTX_free(pctx);
         }
-        if (fp != NULL) {
-            fclose(fp);
+        if (ec_key != NULL) {
+            EC_KEY_free(ec_key);
+        }
+        if (evp_key != NULL) {
+            EVP_PKEY_free(evp_key);
+        }
+        if (cached_key != NULL) {
+            EVP_PKEY_free(cached_key);
         }
         if (ecdsa_sig != NULL) {
             ECDSA_SIG_free(ecdsa_sig);
@@ -1020,33 +1171,157 @@ bool ec_sign_data(sized_buffer *data, sized_buffer *r, sized_buffer *s, uint16_t
         return result ? true : false;
 }
 
+/*
+ * Key cache
+ *
+ * Keys are parsed from their .pem files once per process, so that signing
+ * a batch of lists with one key pair (lcp2_crtpollist --batch) does not
+ * re-read and re-parse them for every list.  Private keys are kept as
+ * EVP_PKEYs, public keys as the signature structure built from them (which
+ * differs per list format, hence the kind).  Entries are never freed and
+ * are only read once added, so they can be shared by signing threads.
+ */
+typedef struct key_cache_entry {
+    struct key_cache_entry *next;
+    char                   file[MAX_PATH];
+    unsigned int           kind;
+    EVP_PKEY               *privkey;
+    void                   *sig;
+    size_t                 sig_size;
+} key_cache_entry_t;
+
+static key_cache_entry_t *key_cache;
+static pthread_mutex_t key_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static key_cache_entry_t *find_cached_key(const char *file, unsigned int kind)
+{
+    for ( key_cache_entry_t *entry = key_cache; entry != NULL;
+          entry = entry->next ) {
+        if ( entry->kind == kind && strcmp(entry->file, file) == 0 )
+            return entry;
+    }
+    return NULL;
+}
+
+static key_cache_entry_t *add_cached_key(const char *file, unsigned int kind)
+{
+    key_cache_entry_t *entry = calloc(1, sizeof(*entry));
+    if ( entry == NULL )
+        return NULL;
+    if ( strcpy_s(entry->file, sizeof(entry->file), file) != EOK ) {
+        free(entry);
+        return NULL;
+    }
+    entry->kind = kind;
+    entry->next = key_cache;
+    key_cache = entry;
+    return entry;
+}
+
+void *get_cached_pubkey_sig(const char *file, unsigned int kind)
+/*
+    Returns a copy of the signature structure cached for public key file,
+    to be freed by the caller, or NULL if there is none.
+*/
+{
+    key_cache_entry_t *entry;
+    void *sig = NULL;
+
+    pthread_mutex_lock(&key_cache_lock);
+    entry = find_cached_key(file, kind);
+    if ( entry != NULL ) {
+        sig = malloc(entry->sig_size);
+        if ( sig != NULL )
+            memcpy_s(sig, entry->sig_size, entry->sig, entry->sig_size);
+    }
+    pthread_mutex_unlock(&key_cache_lock);
+    return sig;
+}
+
+void cache_pubkey_sig(const char *file, unsigned int kind, const void *sig,
+                      size_t size)
+{
+    void *copy = malloc(size);
+    if ( copy == NULL )
+        return;
+    memcpy_s(copy, size, sig, size);
+
+    pthread_mutex_lock(&key_cache_lock);
+    if ( find_cached_key(file, kind) == NULL ) {
+        key_cache_entry_t *entry = add_cached_key(file, kind);
+        if ( entry != NULL ) {
+            entry->sig = copy;
+            entry->sig_size = size;
+            copy = NULL;
+        }
+    }
+    pthread_mutex_unlock(&key_cache_lock);
+    free(copy);
+}
+
+EVP_PKEY *read_cached_privkey(const char *key_path)
+/*
+    Returns the private key in key_path, with a reference the caller must
+    drop with EVP_PKEY_free(), or NULL on error.
+*/
+{
+    key_cache_entry_t *entry;
+    EVP_PKEY *evp_priv = NULL;
+    FILE *fp;
+
+    pthread_mutex_lock(&key_cache_lock);
+    entry = find_cached_key(key_path, KEY_CACHE_PRIVKEY);
+    if ( entry == NULL ) {
+        fp = fopen(key_path, "r");
+        if ( fp == NULL ) {
+            ERROR("Error: failed to open file %s: %s\n", key_path,
+                  strerror(errno));
+            goto EXIT;
+        }
+        evp_priv = PEM_read_PrivateKey(fp, NULL, NULL, NULL);
+        fclose(fp);
+        if ( evp_priv == NULL ) {
+            ERR_load_crypto_strings();
+            ERROR("OpenSSL error: %s\n", ERR_error_string(ERR_get_error(), NULL));
+            ERR_free_strings();
+            goto EXIT;
+        }
+        entry = add_cached_key(key_path, KEY_CACHE_PRIVKEY);
+        if ( entry == NULL ) {
+            EVP_PKEY_free(evp_priv);
+            evp_priv = NULL;
+            goto EXIT;
+        }
+        entry->privkey = evp_priv;
+    }
+    evp_priv = entry->privkey;
+    EVP_PKEY_up_ref(evp_priv);
+    EXIT:
+        pthread_mutex_unlock(&key_cache_lock);
+        return evp_priv;
+}
+
 EVP_PKEY_CTX *rsa_get_sig_ctx(const char *key_path, uint16_t key_size_bytes)
 {
-    FILE *fp = NULL;
     EVP_PKEY *evp_priv = NULL;
     EVP_PKEY_CTX *context = NULL; //This will be returned
 
     LOG("[rsa_get_sig_ctx]\n");
-    fp = fopen(key_path, "r");
-    if (fp == NULL)
-        goto ERROR;
-
-    evp_priv = PEM_read_PrivateKey(fp, NULL, NULL, NULL);
+    evp_priv = read_cached_privkey(key_path);
     if (evp_priv == NULL)
-        goto OPENSSL_ERROR;
-    fclose(fp);
-    fp = NULL;
+        return NULL;
 
     if (EVP_PKEY_size(evp_priv) != key_size_bytes) {
         ERROR("ERROR: key size incorrect\n");
         goto ERROR;
     }
 
+    //The context holds its own reference to the key
     context = EVP_PKEY_CTX_new(evp_priv, NULL);
     if (context == NULL)
         goto OPENSSL_ERROR;
 
-    OPENSSL_free(evp_priv);
+    EVP_PKEY_free(evp_priv);
     return context;
 
     OPENSSL_ERROR:
@@ -1054,12 +1329,7 @@ EVP_PKEY_CTX *rsa_get_sig_ctx(const char *key_path, uint16_t key_size_bytes)
         ERROR("OpenSSL error: %s\n", ERR_error_string(ERR_get_error(), NULL));
         ERR_free_strings();
     ERROR:
-        if (fp != NULL)
-            fclose(fp);
-        if (evp_priv != NULL)
-            OPENSSL_free(evp_priv);
-        if (context != NULL)
-            OPENSSL_free(context);
+        EVP_PKEY_free(evp_priv);
         return NULL;
 }
 
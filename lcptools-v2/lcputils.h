@@ -76,8 +76,12 @@ extern void parse_comma_sep_ints(char *s, uint16_t ints[],
                                  unsigned int *nr_ints);
 extern void *read_file(const char *file, size_t *length, bool fail_ok);
 extern bool write_file(const char *file, const void *data, size_t size);
-extern bool parse_line_hashes(const char *line, tb_hash_t *hash, uint16_t alg);
-extern bool parse_file(const char *filename, bool (*parse_line)(const char *line));
+extern const void *map_file(const char *file, size_t *length);
+extern void unmap_file(const void *data, size_t length);
+extern bool read_hashes_file(const char *filename, uint16_t alg,
+                             tb_hash_t **hashes, unsigned int *nr_hashes,
+                             unsigned int max_hashes);
+extern unsigned int sort_unique_hashes(tb_hash_t *hashes, unsigned int nr_hashes);
 extern const char *hash_alg_to_str(uint16_t alg);
 extern const char *key_alg_to_str(uint16_t alg);
 extern const char *sig_alg_to_str(uint16_t alg);
@@ -94,12 +98,26 @@ extern bool ec_sign_data(sized_buffer *data, sized_buffer *r, sized_buffer *s,
                     uint16_t hashalg, uint16_t sigalg, const char *privkey_file);
 extern bool rsa_ssa_pss_sign(sized_buffer *sig_block, sized_buffer *data,
         uint16_t sig_alg, uint16_t hash_alg, EVP_PKEY_CTX *private_key_context);
-bool verify_ec_signature(sized_buffer *data, sized_buffer *pubkey_x, 
-                         sized_buffer *pubkey_y, sized_buffer *sig_r,
-                         sized_buffer *sig_s, uint16_t sigalg, uint16_t hashalg);
-bool verify_rsa_signature(sized_buffer *data, sized_buffer *pubkey, sized_buffer *signature,
+bool verify_ec_signature(const unsigned char *data, size_t data_size,
+                         sized_buffer *pubkey_x, sized_buffer *pubkey_y,
+                         sized_buffer *sig_r, sized_buffer *sig_s,
+                         uint16_t sigalg, uint16_t hashalg);
+bool verify_rsa_signature(const unsigned char *data, size_t data_size,
+                          sized_buffer *pubkey, sized_buffer *signature,
                           uint16_t hashAlg, uint16_t sig_alg, uint16_t list_ver);
 EVP_PKEY_CTX *rsa_get_sig_ctx(const char *key_path, uint16_t key_size_bytes);
+
+/* key cache kinds: private keys and per list format public key signatures */
+#define KEY_CACHE_PRIVKEY       0
+#define KEY_CACHE_RSA_SIG2      1
+#define KEY_CACHE_ECC_SIG2      2
+#define KEY_CACHE_RSA_SIG2_1    3
+#define KEY_CACHE_ECC_SIG2_1    4
+
+EVP_PKEY *read_cached_privkey(const char *key_path);
+void *get_cached_pubkey_sig(const char *file, unsigned int kind);
+void cache_pubkey_sig(const char *file, unsigned int kind, const void *sig,
+                      size_t size);
 unsigned char *der_encode_sig_comps(sized_buffer *sig_r, sized_buffer *sig_s, int *length);
 
 
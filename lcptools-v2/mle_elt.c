@@ -49,22 +49,14 @@
 #include "polelt_plugin.h"
 #include "lcputils.h"
 
-#define MAX_HASHES       32
+#define MAX_HASHES       0xFFFF     /* num_hashes is 16 bits */
 
 static uint8_t sinit_min_version;
 static unsigned int nr_hashes;
-static tb_hash_t hashes[MAX_HASHES];
+static tb_hash_t *hashes;
 static char alg_name[32] = "sha1";
 static uint16_t alg_type = TPM_ALG_SHA1;
 
-static bool parse_mle_line(const char *line)
-{
-    if ( nr_hashes == MAX_HASHES )
-        return false;
-
-    return parse_line_hashes(line, &hashes[nr_hashes++], alg_type);
-}
-
 static bool cmdline_handler(int c, const char *opt)
 {
     if ( c == 'm' ) {
@@ -86,7 +78,7 @@ static bool cmdline_handler(int c, const char *opt)
 
     /* MLE hash files */
     LOG("cmdline opt: mle hash file: %s\n", opt);
-    if ( !parse_file(opt, parse_mle_line) )
+    if ( !read_hashes_file(opt, alg_type, &hashes, &nr_hashes, MAX_HASHES) )
         return false;
 
     return true;
@@ -95,6 +87,7 @@ static bool cmdline_handler(int c, const char *opt)
 static lcp_policy_element_t *create(void)
 {
     LOG("[create]\n");
+    nr_hashes = sort_unique_hashes(hashes, nr_hashes);
     size_t data_size =  sizeof(lcp_mle_element_t2) +
         nr_hashes * get_hash_size(alg_type);
     lcp_policy_element_t *elt = malloc(sizeof(*elt) + data_size);
@@ -151,7 +144,8 @@ static polelt_plugin_t plugin = {
     "        [--alg <sha1|sha256|sha384|sha512>]    hash alg of element\n"
     "        <FILE1> [FILE2] ...         one or more files containing MLE\n"
     "                                    hash(es); each file can contain\n"
-    "                                    multiple hashes\n",
+    "                                    multiple hashes; hashes are sorted\n"
+    "                                    and duplicates dropped\n",
     LCP_POLELT_TYPE_MLE2,
     &cmdline_handler,
     &create,
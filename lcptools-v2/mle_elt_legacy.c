@@ -49,26 +49,13 @@
 #include "polelt_plugin.h"
 #include "lcputils.h"
 
-#define MAX_HASHES       32
+#define MAX_HASHES       0xFFFF     /* num_hashes is 16 bits */
 
 static uint8_t sinit_min_version;
 static unsigned int nr_hashes;
-static tb_hash_t hashes[MAX_HASHES];
+static tb_hash_t *hashes;
 static uint16_t alg_type = LCP_POLHALG_SHA1; //Legacy value for TPM 1.2
 
-static bool parse_mle_line(const char *line)
-{
-    bool result;
-    if ( nr_hashes == MAX_HASHES )
-        return false;
-
-    result = parse_line_hashes(line, &hashes[nr_hashes++], alg_type);
-    if (!result) {
-        DISPLAY("Legacy mle element only supports sha1 hash digests.\n");
-    }
-    return result;
-}
-
 static bool cmdline_handler(int c, const char *opt)
 {
     if ( c == 'm' ) {
@@ -83,8 +70,10 @@ static bool cmdline_handler(int c, const char *opt)
 
     /* MLE hash files */
     LOG("cmdline opt: mle hash file: %s\n", opt);
-    if ( !parse_file(opt, parse_mle_line) )
+    if ( !read_hashes_file(opt, alg_type, &hashes, &nr_hashes, MAX_HASHES) ) {
+        DISPLAY("Legacy mle element only supports sha1 hash digests.\n");
         return false;
+    }
 
     return true;
 }
@@ -93,6 +82,8 @@ static lcp_policy_element_t *create(void)
 {
     LOG("[create]\n");
     size_t data_size;
+
+    nr_hashes = sort_unique_hashes(hashes, nr_hashes);
     lcp_policy_element_t *elt = NULL;
     lcp_mle_element_t *mle = NULL;
     lcp_hash_t *hash = NULL;
@@ -149,7 +140,8 @@ static polelt_plugin_t plugin = {
     "        [--minver <ver>]            minimum version of SINIT\n"
     "        <FILE1> [FILE2] ...         one or more files containing MLE\n"
     "                                    hash(es); each file can contain\n"
-    "                                    multiple hashes\n",
+    "                                    multiple hashes; hashes are sorted\n"
+    "                                    and duplicates dropped\n",
     LCP_POLELT_TYPE_MLE,
     &cmdline_handler,
     &create,
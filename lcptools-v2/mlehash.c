@@ -41,8 +41,9 @@
 #include <errno.h>
 #include <zlib.h>
 #include <memory.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
-#include <openssl/evp.h>
 #include <safe_lib.h>
 #define PRINT   printf
 #include "../include/config.h"
@@ -202,42 +203,108 @@ static bool get_elf_image_range(const elf_header_t *elf,
 }
 
 /*
- *
- * expand entire file into memory
- *
+ * the expanded image is the PT_LOAD segments back to back, each followed by
+ * its zero fill (and zeros after the last one); rather than building it,
+ * ranges of it are passed to a visitor straight from the file
  */
-static bool expand_elf_image(const elf_header_t *elf, void *base, size_t size)
+typedef void (*exp_visit_t)(void *arg, const void *data, size_t size);
+
+static const uint8_t exp_zeros[4096];
+
+static bool check_elf_segments(const elf_header_t *elf, size_t file_size,
+                               size_t exp_size)
 {
-    int i;
+    size_t total = 0;
 
-    LOG("[expand_elf_image]\n");
-    LOG("expanding elf image ... ");
-    if ( elf == NULL ) {
-        LOG(": failed! - ELF header pointer is zero.\n");
+    LOG("[check_elf_segments]\n");
+    if ( elf->e_phoff > file_size ||
+         (size_t)elf->e_phnum * elf->e_phentsize > file_size - elf->e_phoff ) {
+        LOG("program headers exceed the file\n");
         return false;
     }
 
-    /* assumed that already passed is_elf_image() check */
+    for ( int i = 0; i < elf->e_phnum; i++ ) {
+        elf_program_header_t *ph = (elf_program_header_t *)
+            ((void *)elf + elf->e_phoff + i*elf->e_phentsize);
 
-    /* load elf image into memory */
-    for (i = 0; i < elf->e_phnum; i++) {
+        if ( ph->p_type != PT_LOAD )
+            continue;
+        if ( ph->p_filesz > ph->p_memsz || ph->p_offset > file_size ||
+             ph->p_filesz > file_size - ph->p_offset ) {
+            LOG("segment %d exceeds the file\n", i);
+            return false;
+        }
+        if ( ph->p_memsz > exp_size - total ) {
+            LOG("expanded image exceeded allocated size\n");
+            return false;
+        }
+        total += ph->p_memsz;
+    }
+    return true;
+}
+
+static void walk_expanded_image(const elf_header_t *elf, size_t off,
+                                size_t size, exp_visit_t visit, void *arg)
+{
+    size_t seg_off = 0, n;
+
+    for ( int i = 0; i < elf->e_phnum && size > 0; i++ ) {
         elf_program_header_t *ph = (elf_program_header_t *)
             ((void *)elf + elf->e_phoff + i*elf->e_phentsize);
+        size_t seg_end = seg_off + ph->p_memsz;
 
-        if (ph->p_type == PT_LOAD) {
-            if ( ph->p_memsz > size ) {
-                LOG("expanded image exceeded allocated size\n");
-                return false;
+        if ( ph->p_type != PT_LOAD )
+            continue;
+
+        while ( size > 0 && off < seg_end ) {
+            size_t rel = off - seg_off;
+            const void *data;
+
+            if ( rel < ph->p_filesz ) {
+                data = (const void *)elf + ph->p_offset + rel;
+                n = ph->p_filesz - rel;
+            }
+            else {
+                data = exp_zeros;
+                n = seg_end - off;
+                if ( n > sizeof(exp_zeros) )
+                    n = sizeof(exp_zeros);
             }
-            memcpy_s(base, size, (void *)elf + ph->p_offset, ph->p_filesz);
-            memset_s(base + ph->p_filesz, ph->p_memsz - ph->p_filesz, 0);
-            base += ph->p_memsz;
-            size -= ph->p_memsz;
+            if ( n > size )
+                n = size;
+            visit(arg, data, n);
+            off += n;
+            size -= n;
         }
+        seg_off = seg_end;
     }
 
-    LOG(": succeeded!.\n");
-    return true;
+    while ( size > 0 ) {
+        n = size < sizeof(exp_zeros) ? size : sizeof(exp_zeros);
+        visit(arg, exp_zeros, n);
+        size -= n;
+    }
+}
+
+static void copy_visitor(void *arg, const void *data, size_t size)
+{
+    uint8_t **dst = arg;
+
+    memcpy_s(*dst, size, data, size);
+    *dst += size;
+}
+
+static void read_expanded_image(const elf_header_t *elf, size_t off,
+                                void *buf, size_t size)
+{
+    uint8_t *dst = buf;
+
+    walk_expanded_image(elf, off, size, copy_visitor, &dst);
+}
+
+static void hash_visitor(void *arg, const void *data, size_t size)
+{
+    hash_update((hash_ctx_t *)arg, data, size);
 }
 
 /*
@@ -266,73 +333,93 @@ static void print_dump(uint32_t s, uint32_t e)
 /*
  * read_mle_file
  *
- * read file from disk, if compressed, uncompress it
+ * map the file from disk; if compressed, inflate it straight into a buffer
+ * that grows as needed (*mapped says whether to munmap() or free() it)
  *
  */
-static bool read_mle_file(const char *filename, void **buffer, size_t *length)
+#define INFLATE_WINDOW_SIZE    (1 << 20)
+
+static bool read_mle_file(const char *filename, void **buffer, size_t *length,
+                          bool *mapped)
 {
     LOG("[read_mle_file]\n");
     gzFile fcompressed = NULL;
-    FILE *fdecompressed = NULL;
     struct stat filestat;
-    char tmpbuffer[1024];
-    unsigned long i;
+    uint8_t magic[2];
+    size_t buf_size;
+    int fd, gz_fd, read_cnt;
 
     *length = 0;
     *buffer = NULL;
+    *mapped = false;
 
     /* check the file exists or not */
     LOG("checking whether the file exists or not ... ");
-    if ( stat(filename, &filestat))
+    fd = open(filename, O_RDONLY);
+    if ( fd < 0 )
+        goto error;
+    if ( fstat(fd, &filestat) )
         goto error;
     LOG(": existed!\n");
 
-    /* try uncompress the file (gzopen will handle uncompressed files too) */
-    LOG("trying to uncompress the file ... ");
-    fcompressed = gzopen(filename, "rb");
-    if ( !fcompressed ) {
-        LOG(": failed!\n");
-        return false;
+    if ( S_ISREG(filestat.st_mode) && filestat.st_size > 0 &&
+         (pread(fd, magic, sizeof(magic), 0) != sizeof(magic) ||
+          magic[0] != 0x1f || magic[1] != 0x8b) ) {
+        LOG("mapping the uncompressed file ... ");
+        *buffer = mmap(NULL, filestat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if ( *buffer == MAP_FAILED ) {
+            *buffer = NULL;
+            goto error;
+        }
+        *length = filestat.st_size;
+        *mapped = true;
+        close(fd);
+        LOG(": succeeded!\n");
+        return true;
     }
-    LOG(": succeeded!\n");
 
-    LOG("creating a temporary file to uncompress ... ");
-    fdecompressed = tmpfile();
-    if ( !fdecompressed )
+    /* gzread() handles uncompressed (e.g. piped) files too */
+    LOG("trying to uncompress the file ... ");
+    gz_fd = dup(fd);
+    if ( gz_fd < 0 )
+        goto error;
+    fcompressed = gzdopen(gz_fd, "rb");
+    if ( !fcompressed ) {
+        close(gz_fd);
         goto error;
-    LOG(": succeeded!\n");
-
-    LOG("opening the decompressed file ... ");
-    while ( !gzeof(fcompressed) ) {
-        i = gzread(fcompressed, tmpbuffer, 1024);
-        *length += i;
-        if ( fwrite(tmpbuffer, 1, i, fdecompressed) != i )
-            goto error;
     }
-    LOG(": succeeded!\n");
+    gzbuffer(fcompressed, INFLATE_WINDOW_SIZE);
+
+    /* images typically inflate to a few times their compressed size */
+    buf_size = INFLATE_WINDOW_SIZE;
+    if ( S_ISREG(filestat.st_mode) && (size_t)filestat.st_size * 4 > buf_size )
+        buf_size = (size_t)filestat.st_size * 4;
+
+    do {
+        if ( *length == buf_size || *buffer == NULL ) {
+            void *new_buffer;
+
+            if ( *buffer != NULL )
+                buf_size *= 2;
+            new_buffer = realloc(*buffer, buf_size);
+            if ( new_buffer == NULL )
+                goto error;
+            *buffer = new_buffer;
+        }
+        read_cnt = gzread(fcompressed, *buffer + *length,
+                          buf_size - *length < INFLATE_WINDOW_SIZE ?
+                          buf_size - *length : INFLATE_WINDOW_SIZE);
+        if ( read_cnt < 0 )
+            goto error;
+        *length += read_cnt;
+    } while ( read_cnt > 0 );
     gzclose(fcompressed);
     fcompressed = NULL;
 
     LOG("testing decompression is ... ");
-    if ( *length > 0 ) {
-        LOG(": succeeded!\n");
-        /* uncompression succeeded */
-        fseek(fdecompressed, 0, SEEK_SET);
-    }
-    else {
-        LOG(": failed!\n");
+    if ( *length == 0 )
         goto error;
-    }
-
-    /* read file into buffer */
-    LOG("reading the decompressed file ... ");
-    *buffer = malloc(*length);
-    if ( *buffer == NULL )
-        goto error;
-    memset_s(*buffer, *length, 0);
-    if ( fread(*buffer, 1, *length, fdecompressed) != *length )
-        goto error;
-    fclose(fdecompressed);
+    close(fd);
     LOG(": succeeded!\n");
     return true;
 
@@ -340,26 +427,80 @@ error:
     LOG(": failed!\n");
     if ( fcompressed )
         gzclose(fcompressed);
-    if ( fdecompressed )
-        fclose(fdecompressed);
+    if ( fd >= 0 )
+        close(fd);
     free(*buffer);
+    *buffer = NULL;
+    *length = 0;
     return false;
 }
 
-static mle_hdr_t *find_mle_hdr(void *start, size_t size)
+static bool find_mle_hdr(const elf_header_t *elf, mle_hdr_t *mle_hdr,
+                         size_t *hdr_off)
 {
     LOG("[find_mle_hdr]\n");
-    void *end;
+    size_t seg_off = 0;
 
-    end = start + size - sizeof(uuid_t);
-    while ( start <= end ) {
-        if ( are_uuids_equal((const uuid_t *)start, &((uuid_t)MLE_HDR_UUID)) ){
-            LOG("find mle hdr succeed!\n");
-            return (mle_hdr_t *)start;
+    /* the header is 16-byte aligned in the expanded image and can't be in */
+    /* the zero fill, so only the file data of each segment is scanned */
+    for ( int i = 0; i < elf->e_phnum; i++ ) {
+        elf_program_header_t *ph = (elf_program_header_t *)
+            ((void *)elf + elf->e_phoff + i*elf->e_phentsize);
+        size_t data_end = seg_off + ph->p_filesz;
+
+        if ( ph->p_type != PT_LOAD )
+            continue;
+
+        for ( size_t off = (seg_off + sizeof(uuid_t) - 1) & ~(sizeof(uuid_t) - 1);
+              off < data_end; off += sizeof(uuid_t) ) {
+            const void *p = (const void *)elf + ph->p_offset + (off - seg_off);
+            uuid_t uuid;
+
+            /* straddles the zero fill or the next segment */
+            if ( off + sizeof(uuid_t) > data_end ) {
+                read_expanded_image(elf, off, &uuid, sizeof(uuid));
+                p = &uuid;
+            }
+            if ( are_uuids_equal((const uuid_t *)p, &((uuid_t)MLE_HDR_UUID)) ) {
+                read_expanded_image(elf, off, mle_hdr, sizeof(*mle_hdr));
+                *hdr_off = off;
+                LOG("find mle hdr succeed!\n");
+                return true;
+            }
         }
-        start += sizeof(uuid_t);
+        seg_off += ph->p_memsz;
     }
-    return NULL;
+    return false;
+}
+
+/*
+ * hash [start, end) of the expanded image, with the command line area
+ * (if any) replaced by cmdline_area
+ */
+static bool hash_mle(const elf_header_t *elf, size_t start, size_t end,
+                     size_t cmdline_start, size_t cmdline_end,
+                     const uint8_t *cmdline_area, tb_hash_t *hash)
+{
+    hash_ctx_t ctx;
+
+    if ( !hash_init(&ctx, alg_type) ) {
+        ERROR("Error: unsupported hash alg (%s)\n", alg_name);
+        return false;
+    }
+
+    if ( cmdline_area != NULL ) {
+        size_t a = cmdline_start < start ? start :
+                   cmdline_start > end ? end : cmdline_start;
+        size_t b = cmdline_end < a ? a : cmdline_end > end ? end : cmdline_end;
+
+        walk_expanded_image(elf, start, a - start, hash_visitor, &ctx);
+        hash_update(&ctx, cmdline_area + (a - cmdline_start), b - a);
+        walk_expanded_image(elf, b, end - b, hash_visitor, &ctx);
+    }
+    else
+        walk_expanded_image(elf, start, end - start, hash_visitor, &ctx);
+
+    return hash_final(&ctx, hash);
 }
 
 /*
@@ -368,11 +509,12 @@ static mle_hdr_t *find_mle_hdr(void *start, size_t size)
 int main(int argc, char* argv[])
 {
     void *elf_start=NULL, *elf_end=NULL;
-    void *exp_start=NULL;
     void *base=NULL;
-    size_t size, exp_size;
+    bool mapped = false;
+    size_t size = 0, exp_size, hdr_off;
     elf_header_t *base_as_elf;
-    mle_hdr_t *mle_hdr;
+    mle_hdr_t mle_hdr;
+    uint8_t *cmdline_area = NULL;
     int c, ret = 1;
     char mle_file[MAX_PATH] = "";
     extern int optind;    /* current index of get_opt() */
@@ -441,7 +583,7 @@ int main(int argc, char* argv[])
         alg_type = str_to_hash_alg(alg_name);
 
         /* read file */
-        if ( !read_mle_file(mle_file, &base, &size) )
+        if ( !read_mle_file(mle_file, &base, &size, &mapped) )
             goto out;
 
         /* expand image */
@@ -449,45 +591,53 @@ int main(int argc, char* argv[])
             goto out;
         base_as_elf = (elf_header_t *)base;
 
-        /* get expanded size and allocate memory for it */
+        /* get expanded size; the image itself is never built, see */
+        /* walk_expanded_image() */
         if ( !get_elf_image_range(base_as_elf, &elf_start, &elf_end) )
             goto out;
         exp_size = elf_end - elf_start;
-        exp_start = malloc(exp_size);
-        if ( exp_start == NULL ) {
-            LOG("not enough memory for expanded image\n");
-            goto out;
-        }
-
-        /* expand the image */
-        if ( !expand_elf_image(base_as_elf, exp_start, exp_size) )
+        if ( !check_elf_segments(base_as_elf, size, exp_size) )
             goto out;
 
         /* find the MLE header in the expanded image */
-        mle_hdr = find_mle_hdr(exp_start, exp_size);
-        if ( mle_hdr == NULL ) {
+        if ( !find_mle_hdr(base_as_elf, &mle_hdr, &hdr_off) ) {
             LOG("no MLE header found in image\n");
             goto out;
         }
+        if ( mle_hdr.mle_start_off > mle_hdr.mle_end_off ||
+             mle_hdr.mle_end_off > exp_size ) {
+            LOG("MLE range is outside the image\n");
+            goto out;
+        }
 
         /* before hashing, find command line area in MLE then zero-fill and copy
            command line param to it */
-        if ( mle_hdr->cmdline_end_off > mle_hdr->cmdline_start_off &&
+        if ( mle_hdr.cmdline_end_off > mle_hdr.cmdline_start_off &&
                 cmdline != NULL ) {
-            memset_s(exp_start + mle_hdr->cmdline_start_off,
-                    mle_hdr->cmdline_end_off - mle_hdr->cmdline_start_off, '\0');
-            strcpy_s(exp_start + mle_hdr->cmdline_start_off,
-                     mle_hdr->cmdline_end_off - mle_hdr->cmdline_start_off,
-                     cmdline);
+            size_t cmdline_size = mle_hdr.cmdline_end_off -
+                                  mle_hdr.cmdline_start_off;
+
+            cmdline_area = calloc(1, cmdline_size);
+            if ( cmdline_area == NULL ) {
+                LOG("not enough memory for command line\n");
+                goto out;
+            }
+            strcpy_s((char *)cmdline_area, cmdline_size, cmdline);
         }
 
         /* hash the MLE portion of the image */
         LOG("begin to hash (%s) the mle portion of the image\n", alg_name);
-        size_t hash_size = mle_hdr->mle_end_off - mle_hdr->mle_start_off;
-        void *hash_buf = exp_start + mle_hdr->mle_start_off;
         lcp_hash_t2 *hash = malloc(sizeof(lcp_hash_t2));
-        hash_buffer(hash_buf, hash_size, (tb_hash_t *)hash, alg_type);
+        if ( hash == NULL )
+            goto out;
+        if ( !hash_mle(base_as_elf, mle_hdr.mle_start_off, mle_hdr.mle_end_off,
+                       mle_hdr.cmdline_start_off, mle_hdr.cmdline_end_off,
+                       cmdline_area, (tb_hash_t *)hash) ) {
+            free(hash);
+            goto out;
+        }
         print_hash((tb_hash_t *)hash, alg_type);
+        free(hash);
     }
 
     else if ( cmd == 'V' ) /* --version */ {
@@ -502,10 +652,11 @@ int main(int argc, char* argv[])
 out:
     if (cmdline)
         free(cmdline);
-    if (base)
+    if (base && mapped)
+        munmap(base, size);
+    else if (base)
         free(base);
-    if (exp_start)
-        free(exp_start);
+    free(cmdline_area);
     return ret;
 }
 
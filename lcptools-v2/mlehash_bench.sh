@@ -0,0 +1,69 @@
+#!/bin/sh
+# Copyright (c) 2006-2010, Intel Corporation
+# All rights reserved.
+
+#
+# mlehash_bench.sh: time lcp2_mlehash on one MLE image in each of the
+# forms it reads differently (gzip'ed file, plain ELF file, pipe)
+#
+# usage: mlehash_bench.sh [<tboot.gz> [<runs> [<lcp2_mlehash>]]]
+#
+# Every form is hashed once untimed, which also checks that they all give
+# the same sha1 and sha256 digest, then <runs> times (default 50) per alg.
+# The plain ELF is inflated into a temp file first so the numbers don't
+# depend on what else is in the tree.  Run "make mlehash-bench" to use
+# this tree's tboot.gz and lcp2_mlehash.
+#
+
+set -e
+
+IMAGE=${1:-../tboot/tboot.gz}
+RUNS=${2:-50}
+MLEHASH=${3:-./lcp2_mlehash}
+CMDLINE="logging=serial,memory"
+
+[ -r "$IMAGE" ] || { echo "no MLE image $IMAGE" >&2; exit 1; }
+[ -x "$MLEHASH" ] || { echo "no lcp2_mlehash at $MLEHASH" >&2; exit 1; }
+
+ELF=$(mktemp)
+trap 'rm -f "$ELF"' EXIT
+gzip -dc -f "$IMAGE" > "$ELF"
+
+now() { date +%s.%N; }
+
+# hash <form> <alg>: one run over the image in that form
+hash() {
+    case $1 in
+    gz)   "$MLEHASH" --create --alg $2 --cmdline "$CMDLINE" "$IMAGE" ;;
+    elf)  "$MLEHASH" --create --alg $2 --cmdline "$CMDLINE" "$ELF" ;;
+    pipe) cat "$IMAGE" | "$MLEHASH" --create --alg $2 --cmdline "$CMDLINE" \
+              /dev/stdin ;;
+    esac
+}
+
+echo "image: $IMAGE ($(wc -c < "$IMAGE") bytes, $(wc -c < "$ELF") unzipped)"
+echo "runs:  $RUNS per form and alg"
+echo
+
+for alg in sha1 sha256; do
+    ref=$(hash gz $alg)
+    for form in elf pipe; do
+        if [ "$(hash $form $alg)" != "$ref" ]; then
+            echo "$alg digest of the $form form differs from gz" >&2
+            exit 1
+        fi
+    done
+
+    for form in gz elf pipe; do
+        start=$(now)
+        i=0
+        while [ $i -lt "$RUNS" ]; do
+            hash $form $alg > /dev/null
+            i=$((i + 1))
+        done
+        end=$(now)
+        awk -v a=$alg -v f=$form -v s="$start" -v e="$end" -v n="$RUNS" \
+            'BEGIN { printf "%-7s %-5s %8.3f s total %8.2f ms/run\n",
+                     a, f, e - s, (e - s) * 1000 / n }'
+    done
+done
@@ -274,6 +274,29 @@ lcp_policy_data_t2 *add_tpm20_policy_list2_1(lcp_policy_data_t2 *poldata,
     }
 }
 
+/*
+ * add a 2.1 list that already is in file layout, e.g. checked with
+ * get_policy_list_2_1_view(), as it is
+ */
+lcp_policy_data_t2 *add_tpm20_policy_list2_1_raw(lcp_policy_data_t2 *poldata,
+                                         const void *list, size_t list_size)
+{
+    LOG("[add_tpm20_policy_list2_1_raw]\n");
+    lcp_policy_data_t2 *new_poldata;
+    size_t old_size = get_policy_data_size(poldata);
+
+    new_poldata = realloc(poldata, old_size + list_size);
+    if ( new_poldata == NULL ) {
+        ERROR("Error: failed to allocate memory\n");
+        free(poldata);
+        return NULL;
+    }
+    memcpy_s((void *)new_poldata + old_size, list_size, list, list_size);
+    new_poldata->num_lists++;
+    LOG("add tpm20 policy list succeed!\n");
+    return new_poldata;
+}
+
 lcp_policy_data_t2 *add_tpm20_policy_list(lcp_policy_data_t2 *poldata,
                                    const lcp_policy_list_t2 *pollist)
 {
@@ -300,13 +323,61 @@ lcp_policy_data_t2 *add_tpm20_policy_list(lcp_policy_data_t2 *poldata,
     return new_poldata;
 }
 
+/*
+ * size of one list of the policy data, as laid out there
+ */
+size_t get_policy_list_size(const lcp_list_t *pollist)
+{
+    uint16_t  version ;
+    memcpy_s((void*)&version,sizeof(version),(const void *)pollist,sizeof(uint16_t));
+    if ( MAJOR_VER(version) == MAJOR_VER(LCP_TPM12_POLICY_LIST_VERSION) )
+        return get_tpm12_policy_list_size(&(pollist->tpm12_policy_list));
+    if ( MAJOR_VER(version) == MAJOR_VER(LCP_TPM20_POLICY_LIST_VERSION) )
+        return get_tpm20_policy_list_size(&(pollist->tpm20_policy_list));
+    if ( MAJOR_VER(version) == MAJOR_VER(LCP_TPM20_POLICY_LIST2_1_VERSION_300) )
+        return get_raw_tpm20_list_2_1_size(&pollist->tpm20_policy_list_2_1);
+    return 0;
+}
+
+/*
+ * measure one list of the policy data, in place; lists don't share any
+ * state, so they can be measured concurrently
+ */
+bool calc_policy_list_hash(const lcp_list_t *pollist, lcp_hash_t2 *hash,
+                           uint16_t hash_alg)
+{
+    uint16_t  version ;
+    memcpy_s((void*)&version,sizeof(version),(const void *)pollist,sizeof(uint16_t));
+    if ( MAJOR_VER(version) == MAJOR_VER(LCP_TPM12_POLICY_LIST_VERSION) ) {
+        LOG("calc_policy_list_hash:version=0x0100\n" );
+        calc_tpm12_policy_list_hash(&(pollist->tpm12_policy_list),
+                hash, hash_alg);
+        return true;
+    }
+    if ( MAJOR_VER(version) == MAJOR_VER(LCP_TPM20_POLICY_LIST_VERSION) ) {
+        LOG("calc_policy_list_hash:version=0x0200\n" );
+        calc_tpm20_policy_list_hash(&(pollist->tpm20_policy_list),
+                hash, hash_alg);
+        return true;
+    }
+    if ( MAJOR_VER(version) == MAJOR_VER(LCP_TPM20_POLICY_LIST2_1_VERSION_300) ) {
+        LOG("calc_policy_list_hash:version=0x0300\n");
+        lcp_list_2_1_view view;
+        /* Poldata has the 2.1 list in file layout, hash it in place */
+        return get_policy_list_2_1_view(pollist, get_policy_list_size(pollist),
+                                        &view) &&
+               calc_policy_list_2_1_view_hash(&view, hash, hash_alg);
+    }
+    ERROR("Error: unknown policy list version 0x%x\n", version);
+    return false;
+}
+
 void calc_policy_data_hash(const lcp_policy_data_t2 *poldata, lcp_hash_t2 *hash,
                            uint16_t hash_alg)
 {
     LOG("[calc_policy_data_hash]\n");
     size_t hash_size = get_lcp_hash_size(hash_alg);
     uint8_t hash_list[hash_size * LCP_MAX_LISTS];
-    lcp_policy_list_t2_1 *pollist21 = NULL;
 
     memset_s(hash_list, sizeof(hash_list), 0);
 
@@ -314,51 +385,18 @@ void calc_policy_data_hash(const lcp_policy_data_t2 *poldata, lcp_hash_t2 *hash,
     lcp_hash_t2 *curr_hash = (lcp_hash_t2 *)hash_list;
     const lcp_list_t *pollist = &poldata->policy_lists[0];
     for ( unsigned int i = 0; i < poldata->num_lists; i++ ) {
-        uint16_t  version ;
-        memcpy_s((void*)&version,sizeof(version),(const void *)pollist,sizeof(uint16_t));
-        if ( MAJOR_VER(version) == MAJOR_VER(LCP_TPM12_POLICY_LIST_VERSION) ) {
-            LOG("calc_policy_data_hash:version=0x0100\n" );
-            calc_tpm12_policy_list_hash(&(pollist->tpm12_policy_list),
-                    curr_hash, hash_alg);
-            pollist = (void *)pollist +
-                    get_tpm12_policy_list_size(&(pollist->tpm12_policy_list));
-            curr_hash = (void *)curr_hash + hash_size;
-        }
-        if ( MAJOR_VER(version) == MAJOR_VER(LCP_TPM20_POLICY_LIST_VERSION) ) {
-            LOG("calc_policy_data_hash:version=0x0200\n" );
-            calc_tpm20_policy_list_hash(&(pollist->tpm20_policy_list),
-                    curr_hash, hash_alg);
-            pollist = (void *)pollist +
-                    get_tpm20_policy_list_size(&(pollist->tpm20_policy_list));
-            curr_hash = (void *)curr_hash + hash_size;
-        }
-        if ( MAJOR_VER(version) == MAJOR_VER(LCP_TPM20_POLICY_LIST2_1_VERSION_300) ) {
-            LOG("calc_policy_data_hash:version=0x0300\n");
-            size_t list_base_size = offsetof(lcp_policy_list_t2_1, PolicyElements)+
-                              pollist->tpm20_policy_list_2_1.PolicyElementsSize;
-            /* Poldata has the 2.1 list in a contiguous buffer, we need to allign
-            it to fit lcp_policy_list_t2_1 structure */
-            pollist21 = get_policy_list_2_1_data(
-                (const void *) pollist, list_base_size,
-                pollist->tpm20_policy_list_2_1.KeySignatureOffset
-            );
-            if (!calc_tpm20_policy_list_2_1_hash(pollist21, curr_hash, hash_alg))  {
-                ERROR("ERROR: cannot calculate policy list hash.\n");
-                free(pollist21);
-                return;
-            }
-            pollist = (void *)pollist + get_raw_tpm20_list_2_1_size(&pollist->tpm20_policy_list_2_1);
-            curr_hash = (void *) curr_hash + hash_size;
+        if ( !calc_policy_list_hash(pollist, curr_hash, hash_alg) ) {
+            ERROR("ERROR: cannot calculate policy list hash.\n");
+            return;
         }
+        pollist = (void *)pollist + get_policy_list_size(pollist);
+        curr_hash = (void *)curr_hash + hash_size;
     }
 
     /* hash list */
     hash_buffer(hash_list, hash_size * poldata->num_lists, (tb_hash_t *)hash,
                 hash_alg);
 
-    if (pollist21 != NULL)
-        free(pollist21);
-
     return;
 }
 
@@ -52,6 +52,12 @@ extern lcp_policy_data_t2 *add_tpm20_policy_list(lcp_policy_data_t2 *poldata,
 extern lcp_policy_data_t2 *add_tpm20_policy_list2_1(lcp_policy_data_t2 *poldata,
                         size_t *list_size, const lcp_policy_list_t2_1 *pollist);
 
+extern lcp_policy_data_t2 *add_tpm20_policy_list2_1_raw(lcp_policy_data_t2 *poldata,
+                                        const void *list, size_t list_size);
+
+extern size_t get_policy_list_size(const lcp_list_t *pollist);
+extern bool calc_policy_list_hash(const lcp_list_t *pollist, lcp_hash_t2 *hash,
+                                  uint16_t hash_alg);
 extern void calc_policy_data_hash(const lcp_policy_data_t2 *poldata,
                                   lcp_hash_t2 *hash, uint16_t hash_alg);
 
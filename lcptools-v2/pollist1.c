@@ -54,6 +54,7 @@
 #include "pollist1.h"
 #include "pollist2.h"
 #include "polelt.h"
+#include "signer.h"
 
 bool verify_tpm12_policy_list(const lcp_policy_list_t *pollist, size_t size,
         bool *no_sigblock, bool size_is_exact)
@@ -341,7 +342,8 @@ bool verify_tpm12_pollist_sig(const lcp_policy_list_t *pollist)
     buffer_reverse_byte_order((uint8_t *) public_key->data, public_key->size);
     buffer_reverse_byte_order((uint8_t *) signature->data, signature->size);
 
-    result = verify_rsa_signature(list_data, public_key, signature, TPM_ALG_NULL,
+    result = verify_rsa_signature(list_data->data, list_data->size,
+                                  public_key, signature, TPM_ALG_NULL,
                                             pollist->sig_alg, pollist->version);
 
     free(signature);
@@ -461,7 +463,6 @@ bool rsa_sign_list1_data(lcp_policy_list_t *pollist, const char *privkey_file)
     size_t list_data_len;
     sized_buffer *signature_block = NULL;
     sized_buffer *digest = NULL;
-    EVP_PKEY_CTX *private_key_context = NULL;
 
     bool status;
 
@@ -504,14 +505,9 @@ bool rsa_sign_list1_data(lcp_policy_list_t *pollist, const char *privkey_file)
         print_hex("", (const void *) digest->data, SHA1_DIGEST_SIZE);
     }
 
-    private_key_context = rsa_get_sig_ctx(privkey_file, sig->pubkey_size);
-    if (private_key_context == NULL) {
-        ERROR("Error: failed to initialize EVP context.\n");
-        goto ERROR;
-    }
     //Now do the signing
-    status = rsa_ssa_pss_sign(signature_block, digest, pollist->sig_alg, TPM_ALG_SHA1,
-                                                           private_key_context);
+    status = signer_rsa_sign(privkey_file, signature_block, digest,
+                             pollist->sig_alg, TPM_ALG_SHA1);
     if (!status) {
         ERROR("Error: failed to sign list data.\n");
         goto ERROR;
@@ -530,7 +526,6 @@ bool rsa_sign_list1_data(lcp_policy_list_t *pollist, const char *privkey_file)
     if (digest != NULL) {
         free(digest);
     }
-    OPENSSL_free((void *) private_key_context);
     return true;
     ERROR:
         if (signature_block != NULL) {
@@ -539,7 +534,6 @@ bool rsa_sign_list1_data(lcp_policy_list_t *pollist, const char *privkey_file)
         if (digest != NULL) {
             free(digest);
         }
-        OPENSSL_free((void *) private_key_context);
         return false;
 }
 
@@ -57,6 +57,7 @@
 #include "pollist2_1.h"
 #include "polelt.h"
 #include "pollist1.h"
+#include "signer.h"
 
 //F-ction prototypes:
 bool verify_tpm20_ec_sig(const lcp_policy_list_t2 *pollist); //Does both ecdsa and sm2
@@ -498,7 +499,8 @@ bool verify_tpm20_ec_sig(const lcp_policy_list_t2 *pollist)
     buffer_reverse_byte_order((uint8_t *) sig_r->data, sig_r->size);
     buffer_reverse_byte_order((uint8_t *) sig_s->data, sig_s->size);
     //Now verify
-    result = verify_ec_signature(pollist_data, pubkey_x, pubkey_y, sig_r, sig_s, sigalg, hashalg);
+    result = verify_ec_signature(pollist_data->data, pollist_data->size,
+                                 pubkey_x, pubkey_y, sig_r, sig_s, sigalg, hashalg);
     if (!result) {
         ERROR("Error: failed to verify SM2 signature.\n");
     }
@@ -576,7 +578,8 @@ bool verify_tpm20_rsa_sig(const lcp_policy_list_t2 *pollist)
     buffer_reverse_byte_order((uint8_t *) signature->data, signature->size);
 
     //Any value for hashalg, it will be overwritten inside function
-    result = verify_rsa_signature(list_data, public_key, signature, TPM_ALG_NULL,
+    result = verify_rsa_signature(list_data->data, list_data->size,
+                                  public_key, signature, TPM_ALG_NULL,
                                             pollist->sig_alg, pollist->version);
     free(list_data);
     free(public_key);
@@ -812,7 +815,7 @@ bool write_tpm20_policy_list_file(const char *file,
     return write_file(file, pollist, len);
 }
 
-lcp_signature_t2 *read_rsa_pubkey_file(const char *file)
+static lcp_signature_t2 *parse_rsa_pubkey_file(const char *file)
 {
     LOG("read_rsa_pubkey_file\n");
     FILE *fp = fopen(file, "r");
@@ -877,7 +880,20 @@ lcp_signature_t2 *read_rsa_pubkey_file(const char *file)
     return sig;
 }
 
-lcp_signature_t2 *read_ecdsa_pubkey(const char *pubkey_file)
+lcp_signature_t2 *read_rsa_pubkey_file(const char *file)
+{
+    lcp_signature_t2 *sig = get_cached_pubkey_sig(file, KEY_CACHE_RSA_SIG2);
+    if ( sig != NULL )
+        return sig;
+
+    sig = parse_rsa_pubkey_file(file);
+    if ( sig != NULL )
+        cache_pubkey_sig(file, KEY_CACHE_RSA_SIG2, sig, sizeof(lcp_rsa_signature_t)
+                         + 2*sig->rsa_signature.pubkey_size);
+    return sig;
+}
+
+static lcp_signature_t2 *parse_ecdsa_pubkey(const char *pubkey_file)
 {
     lcp_signature_t2 *sig = NULL;
     FILE *fp = NULL;
@@ -1032,6 +1048,20 @@ lcp_signature_t2 *read_ecdsa_pubkey(const char *pubkey_file)
             OPENSSL_free((void *) y);
         return NULL;
 }
+
+static lcp_signature_t2 *read_ecdsa_pubkey(const char *pubkey_file)
+{
+    lcp_signature_t2 *sig = get_cached_pubkey_sig(pubkey_file, KEY_CACHE_ECC_SIG2);
+    if ( sig != NULL )
+        return sig;
+
+    sig = parse_ecdsa_pubkey(pubkey_file);
+    if ( sig != NULL )
+        cache_pubkey_sig(pubkey_file, KEY_CACHE_ECC_SIG2, sig,
+                         sizeof(lcp_ecc_signature_t) + 4*sig->ecc_signature.pubkey_size);
+    return sig;
+}
+
 bool ec_sign_list2_data(lcp_policy_list_t2 *pollist, const char *privkey) 
 {
     /*
@@ -1099,7 +1129,7 @@ bool ec_sign_list2_data(lcp_policy_list_t2 *pollist, const char *privkey)
         LOG("Data to be signed:\n");
         print_hex("    ", pollist_data->data, pollist_data->size);
     }
-    result = ec_sign_data(pollist_data, sig_r, sig_s, sigalg, hashalg, privkey);
+    result = signer_ec_sign(privkey, pollist_data, sig_r, sig_s, sigalg, hashalg);
     if (!result) {
         ERROR("Error: failed to sign policy list data.\n");
         goto EXIT;
@@ -1145,7 +1175,6 @@ bool rsa_sign_list2_data(lcp_policy_list_t2 *pollist, const char *privkey_file,
     bool status;
     size_t key_size;
     size_t list_data_len;
-    EVP_PKEY_CTX *private_key_context = NULL;
 
     LOG("rsa_sign_list_data\n");
     if ( pollist == NULL || privkey_file == NULL ) {
@@ -1194,15 +1223,9 @@ bool rsa_sign_list2_data(lcp_policy_list_t2 *pollist, const char *privkey_file,
         print_hex("", (const void *) data_to_sign->data, get_hash_size(hash_alg));
     }
 
-    private_key_context = rsa_get_sig_ctx(privkey_file, key_size);
-    if (private_key_context == NULL) {
-        ERROR("Error: failed to initialize EVP context.\n");
-        status = false;
-        goto END;
-    }
     //Now sign:
-    status = rsa_ssa_pss_sign(signature_block, data_to_sign, pollist->sig_alg,
-                                                 hash_alg, private_key_context);
+    status = signer_rsa_sign(privkey_file, signature_block, data_to_sign,
+                             pollist->sig_alg, hash_alg);
     if (!status) {
         ERROR("Error: failed to sign list data.\n");
         //status is false
@@ -1225,7 +1248,6 @@ bool rsa_sign_list2_data(lcp_policy_list_t2 *pollist, const char *privkey_file,
         if (data_to_sign != NULL) {
             free(data_to_sign);
         }
-        OPENSSL_free((void *) private_key_context);
         return status;
 }
 
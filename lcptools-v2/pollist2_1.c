@@ -55,6 +55,7 @@
 #include "polelt_plugin.h"
 #include "lcputils.h"
 #include "pollist2_1.h"
+#include "signer.h"
 #include "polelt.h"
 
 //Function prototypes:
@@ -63,8 +64,6 @@ static size_t get_tpm20_key_and_signature_2_1_real_size(const lcp_signature_2_1
 static size_t get_tpm20_list_2_1_signature_size(const lcp_signature_2_1 *sig);
 static bool get_rsa_signature_2_1_data(lcp_signature_2_1 *sig, void *data);
 static bool get_ecc_signature_2_1_data(lcp_signature_2_1 *sig, void *data);
-static bool verify_tpm20_pollist_2_1_rsa_sig(lcp_policy_list_t2_1 *pollist);
-static bool verify_tpm20_pollist_2_1_ec_sig(const lcp_policy_list_t2_1 *pollist);
 static void display_tpm20_signature_2_1(const char *prefix, const lcp_signature_2_1 *sig,
                                                         const uint16_t sig_alg);
 static lcp_policy_list_t2_1 *add_tpm20_signature_2_1(lcp_policy_list_t2_1 *pollist,
@@ -649,12 +648,18 @@ bool get_rsa_signature_2_1_data(lcp_signature_2_1 *empty_sig, void *raw_data)
     return true;
 }
 bool verify_tpm20_pollist_2_1_sig(lcp_policy_list_t2_1 *pollist)
+/*
+This function: verifies the signature of a policy list structure by laying it
+out as it is written to a file and verifying a view of that
+
+In: policy list structure containing list and signature
+Out: true if verifies false if not
+*/
 {
     bool result;
-    sig_key_2_1_header *header;
-    size_t base_size = offsetof(lcp_policy_list_t2_1, PolicyElements);
-    size_t elts_size = pollist->PolicyElementsSize;
-    lcp_signature_2_1 *sig;
+    unsigned char *data;
+    size_t size = 0;
+    lcp_list_2_1_view view;
 
     LOG("[verify_tpm20_pollist_2_1_sig]\n");
     if (pollist == NULL) {
@@ -662,320 +667,351 @@ bool verify_tpm20_pollist_2_1_sig(lcp_policy_list_t2_1 *pollist)
         return false;
     }
 
-    sig = get_tpm20_signature_2_1(pollist);
-    if (sig == NULL) {
-        ERROR("Error: failed to get list signature.\n");
-        return false;
-    }
-    header = (sig_key_2_1_header *) sig;
-    uint16_t expected_sig_offset = base_size + elts_size +
-                                offsetof(lcp_signature_2_1, KeyAndSignature);
-
-    if (expected_sig_offset != pollist->KeySignatureOffset) {
-        ERROR("Error: KeySignatureOffset incorrect. Expected: 0x%x, found: 0x%x\n",
-        expected_sig_offset, pollist->KeySignatureOffset);
+    data = fill_tpm20_policy_list_2_1_buffer(pollist, &size);
+    if (data == NULL) {
+        ERROR("Error: failed to get list data.\n");
         return false;
     }
-    if ( header->key_alg == TPM_ALG_RSA ) {
-        LOG("Verifying signature against list data.\n");
-        result = verify_tpm20_pollist_2_1_rsa_sig(pollist);
-    }
-    else if ( header->key_alg == TPM_ALG_ECC ) {
-        //This works with SM2 too.
-        result = verify_tpm20_pollist_2_1_ec_sig(pollist);
-    }
-    else {
-        //Function end
-        ERROR("Error: signature verification failed - unknown key algorithm\n");
-        result = false;
-    }
+    result = get_policy_list_2_1_view(data, size, &view) &&
+             verify_policy_list_2_1_view_sig(&view);
+    free(data);
     return result;
 }
 
-bool verify_tpm20_pollist_2_1_ec_sig(const lcp_policy_list_t2_1 *pollist) 
+  ////////////////////////////////////////////////////
+ /* READ-ONLY VIEWS OF LISTS IN FILE LAYOUT         */
+////////////////////////////////////////////////////
+
+static uint16_t view_read_u16(const uint8_t *p)
 {
-    /*
-        This functions prepares lcp policy list for verification, i.e.
-        generates buffers for list data, public key components, signature
-        components and passes all of it to ec_verify in lcputils
+    uint16_t val;
+    memcpy_s(&val, sizeof(val), p, sizeof(val));
+    return val;
+}
 
-        In: pointer to properly allocated lcp_policy_list_t2_1 structure
-            containing list and signature.
+static uint32_t view_read_u32(const uint8_t *p)
+{
+    uint32_t val;
+    memcpy_s(&val, sizeof(val), p, sizeof(val));
+    return val;
+}
 
-        Out: True on success, false on failure
-    */
-    sized_buffer *pollist_data = NULL;
-    sized_buffer *pubkey_x = NULL;
-    sized_buffer *pubkey_y = NULL;
-    sized_buffer *sig_r = NULL;
-    sized_buffer *sig_s = NULL;
-    lcp_signature_2_1 *sig = NULL;
-    size_t keysize, data_size; //Keysize is in bytes
-    bool result;
-    uint16_t sigalg;
-    uint16_t hashalg;
-    LOG("[verify_tpm20_pollist_2_1_ec_sig]\n");
-    if (pollist == NULL) {
-        ERROR("Error: policy list not defined.\n");
+const lcp_policy_element_t *get_policy_list_2_1_view_element(
+        const lcp_list_2_1_view *view, const lcp_policy_element_t *elt)
+/*
+This function: walks the policy elements of a list view
+
+In: list view, NULL to get the first element or the previous element
+Out: next element, NULL after the last one or if the next one does not fit
+     in PolicyElementsSize
+*/
+{
+    const uint8_t *elts;
+    size_t elts_size, offset;
+
+    if ( view == NULL || view->pollist == NULL )
+        return NULL;
+    elts = (const uint8_t *) view->pollist->PolicyElements;
+    elts_size = view->pollist->PolicyElementsSize;
+    offset = elt == NULL ? 0 : (size_t)((const uint8_t *) elt - elts) + elt->size;
+
+    if ( offset >= elts_size ||
+         elts_size - offset < sizeof(lcp_policy_element_t) )
+        return NULL;
+    elt = (const lcp_policy_element_t *)(elts + offset);
+    if ( elt->size < sizeof(lcp_policy_element_t) ||
+         elt->size > elts_size - offset )
+        return NULL;
+    return elt;
+}
+
+bool get_policy_list_2_1_view(const void *data, size_t size,
+                              lcp_list_2_1_view *view)
+/*
+This function: checks that data holds exactly one LCP_POLICY_LIST_2_1 laid out
+as in a list file and sets up a view of it. Every field the view points to is
+within data, so nothing is copied. The signature itself is not verified.
+
+In: list data (e.g. a mapped list file), its size, view to fill in
+Out: true if the list is well formed, false if not
+*/
+{
+    const lcp_policy_list_t2_1 *pollist = data;
+    const lcp_policy_element_t *elt = NULL;
+    const uint8_t *sig;
+    size_t base_size = offsetof(lcp_policy_list_t2_1, PolicyElements);
+    size_t elts_size = 0;
+    size_t sig_begin, key_offset, scheme_offset, sig_offset;
+
+    LOG("[get_policy_list_2_1_view]\n");
+    if ( data == NULL || view == NULL ) {
+        ERROR("Error: list data not defined.\n");
         return false;
     }
-    //Set size of signed data:
-    data_size = pollist->KeySignatureOffset;
-    //Get sig;
-    sig = get_tpm20_signature_2_1(pollist);
-    if (sig == NULL) {
-        ERROR("Error: failed to get signature 2.1.\n");
+    memset_s(view, sizeof(*view), 0);
+
+    if ( size < base_size ) {
+        ERROR("Error: list data too small: 0x%x\n", size);
         return false;
     }
-
-    //Read data from sig structure:
-    keysize = sig->KeyAndSignature.EccKeyAndSignature.Signature.KeySize / 8;
-    sigalg = sig->KeyAndSignature.EccKeyAndSignature.SigScheme;
-    hashalg = sig->KeyAndSignature.EccKeyAndSignature.Signature.HashAlg;
-
-    //Verify signature components:
-    if ( sig->KeyAndSignature.EccKeyAndSignature.Version != SIGNATURE_VERSION) {
-        ERROR("ERROR: KeyAndSignature struct version not 0x%x.\n", SIGNATURE_VERSION);
+    if ( MAJOR_VER(pollist->Version) !=
+         MAJOR_VER(LCP_TPM20_POLICY_LIST2_1_VERSION_300) ||
+         MINOR_VER(pollist->Version) >
+         MINOR_VER(LCP_TPM20_POLICY_LIST2_1_VERSION_300) ) {
+        ERROR("Error: list version 0x%x not supported\n", pollist->Version);
         return false;
     }
-
-    if ( sig->KeyAndSignature.EccKeyAndSignature.KeyAlg != TPM_ALG_ECC ) {
-        ERROR("ERROR: KeyAlg not TPM_ALG_ECC 0x%x.\n", TPM_ALG_ECC);
+    if ( pollist->PolicyElementsSize > size - base_size ) {
+        ERROR("Error: size incorrect (elements size): 0x%x > 0x%x\n",
+              pollist->PolicyElementsSize, size - base_size);
         return false;
     }
 
-    if ( sigalg != TPM_ALG_ECDSA && sigalg != TPM_ALG_SM2) {
-        ERROR("ERROR: signature scheme 0x%x not supported.\nExpected 0x18 or 0x1B\n",
-                             sig->KeyAndSignature.EccKeyAndSignature.SigScheme);
+    view->pollist = pollist;
+    while ( (elt = get_policy_list_2_1_view_element(view, elt)) != NULL )
+        elts_size += elt->size;
+    if ( elts_size != pollist->PolicyElementsSize ) {
+        ERROR("Error: size incorrect (elt size): 0x%x != 0x%x\n",
+              elts_size, pollist->PolicyElementsSize);
         return false;
     }
 
-    if ( sig->KeyAndSignature.EccKeyAndSignature.Signature.Version != SIGNATURE_VERSION) {
-        ERROR("ERROR: signature structure version not supported. Expected 0x%x, found: 0x%x\n",
-        SIGNATURE_VERSION, sig->KeyAndSignature.RsaKeyAndSignature.Signature.Version);
-        return false;
+    sig_begin = base_size + elts_size;
+    view->size = size;
+    if ( pollist->KeySignatureOffset == 0 ) {
+        if ( sig_begin != size ) {
+            ERROR("Error: size incorrect (no sig): 0x%x != 0x%x\n",
+                  sig_begin, size);
+            return false;
+        }
+        return true;
     }
 
-    if ( hashalg != TPM_ALG_SHA256 && hashalg != TPM_ALG_SHA384 && 
-         hashalg != TPM_ALG_SM3_256) {
-        ERROR("ERROR: hash alg not supported. Expected 0x0B, 0x0C or 0x12, found: 0x%x\n",
-                                                                  hashalg);
+    if ( pollist->KeySignatureOffset !=
+         sig_begin + offsetof(lcp_signature_2_1, KeyAndSignature) ) {
+        ERROR("Error: KeySignatureOffset incorrect. Expected: 0x%x, found: 0x%x\n",
+              sig_begin + offsetof(lcp_signature_2_1, KeyAndSignature),
+              pollist->KeySignatureOffset);
         return false;
     }
-    if ( keysize != MIN_ECC_KEY_SIZE && keysize != MAX_ECC_KEY_SIZE) {
-        ERROR("Error: incorrect keysize, must be 256 or 384 bits. Found: 0x%x.\n",
-                                                                    keysize * 8);
+    if ( size - sig_begin < sizeof(sig_key_2_1_header) ) {
+        ERROR("Error: signature truncated.\n");
         return false;
     }
-    if ( keysize != sig->KeyAndSignature.EccKeyAndSignature.Key.KeySize / 8 ) {
-        ERROR("ERROR: keysize mismatch between key and signature. Expected:"
-                          " 0x%x, found: 0x%x\n", keysize*8, keysize);
+    sig = (const uint8_t *) data + sig_begin;
+    view->sig = (const sig_key_2_1_header *) sig;
+    view->key_size = view->sig->key_size / 8;
+
+    //Key and signature are as big as the key, not as the structures in lcp3.h
+    key_offset = offsetof(lcp_signature_2_1, KeyAndSignature);
+    if ( view->sig->key_alg == TPM_ALG_RSA ) {
+        if ( view->key_size != 256 && view->key_size != 384 ) {
+            ERROR("ERROR: key size %d not supported.\n", view->key_size);
+            return false;
+        }
+        key_offset += offsetof(rsa_key_and_signature, Key);
+        view->pubkey_size = view->key_size;
+        view->signature_size = view->key_size;
+        if ( size - sig_begin < key_offset + offsetof(rsa_public_key, Modulus) ) {
+            ERROR("Error: signature truncated.\n");
+            return false;
+        }
+        view->exponent = view_read_u32(sig + key_offset +
+                                       offsetof(rsa_public_key, Exponent));
+        view->pubkey = sig + key_offset + offsetof(rsa_public_key, Modulus);
+    }
+    else if ( view->sig->key_alg == TPM_ALG_ECC ) {
+        if ( view->key_size != MIN_ECC_KEY_SIZE &&
+             view->key_size != MAX_ECC_KEY_SIZE ) {
+            ERROR("Error: incorrect keysize, must be 256 or 384 bits. Found: 0x%x.\n",
+                  view->key_size * 8);
+            return false;
+        }
+        key_offset += offsetof(ecc_key_and_signature, Key);
+        view->pubkey_size = 2 * view->key_size;
+        view->signature_size = 2 * view->key_size;
+        view->pubkey = sig + key_offset + offsetof(ecc_public_key, QxQy);
+    }
+    else {
+        ERROR("Error: unknown key algorithm 0x%x\n", view->sig->key_alg);
         return false;
     }
-    //Allocate buffers:
-    pollist_data = allocate_sized_buffer(data_size);
-    pubkey_x = allocate_sized_buffer(keysize);
-    pubkey_y = allocate_sized_buffer(keysize);
-    sig_r = allocate_sized_buffer(keysize);
-    sig_s = allocate_sized_buffer(keysize);
 
-    if (pollist_data == NULL || pubkey_x == NULL || pubkey_y == NULL || 
-        sig_r == NULL || sig_s == NULL) {
-        ERROR("Error: failed to allocate data structure.\n");
-        result = false;
-        goto EXIT;
+    //SigScheme follows the key, then the signature structure
+    scheme_offset = (size_t)(view->pubkey - sig) + view->pubkey_size;
+    sig_offset = scheme_offset + sizeof(uint16_t);
+    view->sig_size = sig_offset + offsetof(rsa_signature, Signature) +
+                     view->signature_size;
+    if ( view->sig_size != size - sig_begin ) {
+        ERROR("Error: size incorrect (sig size): 0x%x != 0x%x\n",
+              view->sig_size, size - sig_begin);
+        return false;
     }
-    pollist_data->size = data_size;
-    pubkey_x->size = keysize;
-    pubkey_y->size = keysize;
-    sig_r->size = keysize;
-    sig_s->size = keysize;
+    view->sig_scheme = view_read_u16(sig + scheme_offset);
+    view->sig_version = sig[sig_offset + offsetof(rsa_signature, Version)];
+    view->sig_key_size = view_read_u16(sig + sig_offset +
+                                       offsetof(rsa_signature, KeySize));
+    view->hash_alg = view_read_u16(sig + sig_offset +
+                                   offsetof(rsa_signature, HashAlg));
+    view->signature = sig + sig_offset + offsetof(rsa_signature, Signature);
+    return true;
+}
 
-    //Copy data to buffers
-    memcpy_s(
-        (void *) pollist_data->data, pollist_data->size,
-        (const void *) pollist, data_size
-        );
-    memcpy_s( 
-        (void *) pubkey_x->data, pubkey_x->size,
-        (const void *) sig->KeyAndSignature.EccKeyAndSignature.Key.QxQy,
-        keysize
-        );
-    memcpy_s( 
-        (void *) pubkey_y->data, pubkey_y->size,
-        (const void *) sig->KeyAndSignature.EccKeyAndSignature.Key.QxQy + keysize,
-        keysize
-        );
-    memcpy_s( 
-        (void *) sig_r->data, sig_r->size,
-        (const void *) sig->KeyAndSignature.EccKeyAndSignature.Signature.sigRsigS,
-        keysize
-        );
-    memcpy_s( 
-        (void *) sig_s->data, sig_s->size,
-        (const void *) sig->KeyAndSignature.EccKeyAndSignature.Signature.sigRsigS + keysize,
-        keysize
-        );
-    //r, s, x, y are LE in lcp but openssl needs them BE, so we will flip them.
-    buffer_reverse_byte_order((uint8_t *) pubkey_x->data, pubkey_x->size);
-    buffer_reverse_byte_order((uint8_t *) pubkey_y->data, pubkey_y->size);
-    buffer_reverse_byte_order((uint8_t *) sig_r->data, sig_r->size);
-    buffer_reverse_byte_order((uint8_t *) sig_s->data, sig_s->size);
-
-    //Now verify:
-    result = verify_ec_signature(pollist_data, pubkey_x, pubkey_y, sig_r, sig_s, sigalg, hashalg);
-    if (!result) {
-        ERROR("Error: failed to verify SM2 signature.\n");
+static sized_buffer *get_view_be_buffer(const uint8_t *data, size_t size)
+{
+    //Keys and signatures are LE in lcp but openssl needs them BE
+    sized_buffer *buf = allocate_sized_buffer(size);
+    if ( buf == NULL ) {
+        ERROR("Error: failed to allocate memory for buffer.\n");
+        return NULL;
     }
-    EXIT:
-        if (pollist_data != NULL) {
-            free(pollist_data);
-        }
-        if (pubkey_x != NULL) {
-            free(pubkey_x);
-        }
-        if (pubkey_y != NULL) {
-            free(pubkey_y);
-        }
-        if (sig_r != NULL) {
-            free(sig_r);
-        }
-        if (sig_s != NULL) {
-            free(sig_s);
-        }
-        return result;
+    buf->size = size;
+    memcpy_s((void *) buf->data, size, data, size);
+    buffer_reverse_byte_order((uint8_t *) buf->data, size);
+    return buf;
 }
 
-bool verify_tpm20_pollist_2_1_rsa_sig(lcp_policy_list_t2_1 *pollist)
-/*
-This function: verifies rsa signature block in policy list
-
-In: policy list data that was signed, data size, signature 2.1 structure
-Out: true if verifies false if not
-
-*/
+static bool verify_policy_list_2_1_view_rsa_sig(const lcp_list_2_1_view *view)
 {
-    LOG("[verify_tpm20_pollist_2_1_rsa_sig]\n");
     bool result;
-    size_t key_size_bytes;
-    size_t sig_key_size;
-    uint16_t sig_alg;
-    uint16_t hash_alg_sig;
-    lcp_signature_2_1 *sig = NULL;
-    //Dynamic buffers:
-    sized_buffer *list_data = NULL; //Free before return
-    sized_buffer *key_buffer = NULL; //Free before return
-    sized_buffer *signature_buffer = NULL; //Free before return
+    sized_buffer *key_buffer = NULL;
+    sized_buffer *signature_buffer = NULL;
 
-    if (pollist == NULL) {
-        ERROR("Error: failed to get list data.\n");
+    LOG("[verify_policy_list_2_1_view_rsa_sig]\n");
+    if ( view->exponent != LCP_SIG_EXPONENT ) {
+        ERROR("ERROR: RSA exponent not 0x%x.\n", LCP_SIG_EXPONENT);
         return false;
     }
-
-    sig = get_tpm20_signature_2_1(pollist);
-    if (sig == NULL) {
-        ERROR("Error: failed to get signature.\n");
+    if ( view->sig_scheme != TPM_ALG_RSASSA && view->sig_scheme != TPM_ALG_RSAPSS ) {
+        ERROR("ERROR: signature scheme 0x%x not supported.\nExpected 0x14 or 0x16\n",
+              view->sig_scheme);
         return false;
     }
-
-    key_size_bytes = sig->KeyAndSignature.RsaKeyAndSignature.Key.KeySize / 8;
-    if ( sig->KeyAndSignature.RsaKeyAndSignature.Version != SIGNATURE_VERSION) {
-        ERROR("ERROR: KeyAndSignature struct version not 0x%x.", SIGNATURE_VERSION);
+    if ( view->hash_alg != TPM_ALG_SHA256 && view->hash_alg != TPM_ALG_SHA384 ) {
+        ERROR("ERROR: hash alg not supported. Expected 0x0B or 0x0C, found: 0x%x\n",
+              view->hash_alg);
         return false;
     }
 
-    if ( sig->KeyAndSignature.RsaKeyAndSignature.KeyAlg != TPM_ALG_RSA ) {
-        ERROR("ERROR: KeyAlg not TPM_ALG_RSA 0x%x.", TPM_ALG_RSA);
+    key_buffer = get_view_be_buffer(view->pubkey, view->pubkey_size);
+    signature_buffer = get_view_be_buffer(view->signature, view->signature_size);
+    if ( key_buffer == NULL || signature_buffer == NULL ) {
+        free(key_buffer);
+        free(signature_buffer);
         return false;
     }
 
-    if (key_size_bytes != 256 && key_size_bytes != 384) {
-        ERROR("ERROR: key size %d not supported.\n", key_size_bytes);
-        return false;
+    LOG("Verifying signature against list data.\n");
+    result = verify_rsa_signature((const unsigned char *) view->pollist,
+                                  view->pollist->KeySignatureOffset,
+                                  key_buffer, signature_buffer, view->hash_alg,
+                                  view->sig_scheme,
+                                  LCP_TPM20_POLICY_LIST2_1_VERSION_300);
+    if (result) {
+        DISPLAY("List signature verified positively.\n");
     }
+    else {
+        DISPLAY("List signature did not verify.\n");
+    }
+    free(key_buffer);
+    free(signature_buffer);
+    return result;
+}
+
+static bool verify_policy_list_2_1_view_ec_sig(const lcp_list_2_1_view *view)
+{
+    //This works with SM2 too.
+    bool result = false;
+    size_t keysize = view->key_size;
+    sized_buffer *pubkey_x, *pubkey_y, *sig_r, *sig_s;
 
-    if ( sig->KeyAndSignature.RsaKeyAndSignature.Key.Exponent != LCP_SIG_EXPONENT ) {
-        ERROR("ERROR: RSA exponent not 0x%x.", LCP_SIG_EXPONENT);
+    LOG("[verify_policy_list_2_1_view_ec_sig]\n");
+    if ( view->sig_scheme != TPM_ALG_ECDSA && view->sig_scheme != TPM_ALG_SM2 ) {
+        ERROR("ERROR: signature scheme 0x%x not supported.\nExpected 0x18 or 0x1B\n",
+              view->sig_scheme);
         return false;
     }
-
-    sig_alg = sig->KeyAndSignature.RsaKeyAndSignature.SigScheme;
-    if ( sig_alg != TPM_ALG_RSASSA && sig_alg != TPM_ALG_RSAPSS ) {
-        ERROR("ERROR: signature scheme 0x%x not supported.\nExpected 0x14 or 0x16",
-                             sig_alg);
+    if ( view->hash_alg != TPM_ALG_SHA256 && view->hash_alg != TPM_ALG_SHA384 &&
+         view->hash_alg != TPM_ALG_SM3_256 ) {
+        ERROR("ERROR: hash alg not supported. Expected 0x0B, 0x0C or 0x12, found: 0x%x\n",
+              view->hash_alg);
         return false;
     }
 
-    if ( sig->KeyAndSignature.RsaKeyAndSignature.Signature.Version != SIGNATURE_VERSION) {
-        ERROR("ERROR: signature structure version not supported. Expected 0x%x, found: 0x%x",
-        SIGNATURE_VERSION, sig->KeyAndSignature.RsaKeyAndSignature.Signature.Version);
-        return false;
+    pubkey_x = get_view_be_buffer(view->pubkey, keysize);
+    pubkey_y = get_view_be_buffer(view->pubkey + keysize, keysize);
+    sig_r = get_view_be_buffer(view->signature, keysize);
+    sig_s = get_view_be_buffer(view->signature + keysize, keysize);
+    if ( pubkey_x != NULL && pubkey_y != NULL && sig_r != NULL && sig_s != NULL ) {
+        result = verify_ec_signature((const unsigned char *) view->pollist,
+                                     view->pollist->KeySignatureOffset,
+                                     pubkey_x, pubkey_y, sig_r, sig_s,
+                                     view->sig_scheme, view->hash_alg);
+        if (!result) {
+            ERROR("Error: failed to verify EC signature.\n");
+        }
     }
+    free(pubkey_x);
+    free(pubkey_y);
+    free(sig_r);
+    free(sig_s);
+    return result;
+}
 
-    hash_alg_sig = sig->KeyAndSignature.RsaKeyAndSignature.Signature.HashAlg;
-    if ( hash_alg_sig != TPM_ALG_SHA256 && hash_alg_sig != TPM_ALG_SHA384 ) {
-        ERROR("ERROR: hash alg not supported. Expected 0x0B or 0x0C, found: 0x%x\n",
-                                                                  hash_alg_sig);
+bool verify_policy_list_2_1_view_sig(const lcp_list_2_1_view *view)
+/*
+This function: verifies the signature of a list view against the list data
+it covers, straight from the viewed bytes
+
+In: view set up by get_policy_list_2_1_view
+Out: true if verifies false if not (or if the list is not signed)
+*/
+{
+    LOG("[verify_policy_list_2_1_view_sig]\n");
+    if ( view == NULL || view->sig == NULL ) {
+        ERROR("Error: failed to get list signature.\n");
         return false;
     }
-    sig_key_size = sig->KeyAndSignature.RsaKeyAndSignature.Signature.KeySize;
-    if ( sig_key_size != sig->KeyAndSignature.RsaKeyAndSignature.Key.KeySize ) {
-        ERROR("ERROR: keysize mismatch between key and signature. Expected:"
-                          " 0x%x, found: 0x%x", key_size_bytes, sig_key_size/8);
+    if ( view->sig->version != SIGNATURE_VERSION ) {
+        ERROR("ERROR: KeyAndSignature struct version not 0x%x.\n", SIGNATURE_VERSION);
         return false;
     }
-
-    list_data = allocate_sized_buffer(pollist->KeySignatureOffset);
-    if (list_data == NULL) {
-        ERROR("Error: failed to allocate memory for list data.\n");
+    if ( view->sig_version != SIGNATURE_VERSION ) {
+        ERROR("ERROR: signature structure version not supported. Expected 0x%x, found: 0x%x\n",
+              SIGNATURE_VERSION, view->sig_version);
         return false;
     }
-    key_buffer = allocate_sized_buffer(key_size_bytes);
-    if (key_buffer == NULL){
-        ERROR("Error: failed to allocate memory for buffer.\n");
-        free(list_data);
+    if ( view->sig_key_size != view->sig->key_size ) {
+        ERROR("ERROR: keysize mismatch between key and signature. Expected:"
+              " 0x%x, found: 0x%x\n", view->sig->key_size, view->sig_key_size);
         return false;
     }
-    signature_buffer = allocate_sized_buffer(key_size_bytes);
-    if (signature_buffer == NULL ){
-        ERROR("Error: failed to allocate memory for buffer.\n");
-        free(list_data);
-        free(key_buffer);
+
+    if ( view->sig->key_alg == TPM_ALG_RSA )
+        return verify_policy_list_2_1_view_rsa_sig(view);
+    return verify_policy_list_2_1_view_ec_sig(view);
+}
+
+bool calc_policy_list_2_1_view_hash(const lcp_list_2_1_view *view,
+                                    lcp_hash_t2 *hash, uint16_t hash_alg)
+/*
+This function: computes the hash of a list view the way
+calc_tpm20_policy_list_2_1_hash does for the structure: the whole list if it
+is not signed, the public key if it is
+
+In: view, hash buffer, hash alg
+Out: true on success, false on failure
+*/
+{
+    LOG("[calc_policy_list_2_1_view_hash]\n");
+    if ( view == NULL || view->pollist == NULL || hash == NULL )
         return false;
-    }
-    list_data->size = pollist->KeySignatureOffset;
-    key_buffer->size = key_size_bytes;
-    signature_buffer->size = key_size_bytes;
 
-    memcpy_s( (void *) list_data->data,
-              list_data->size,
-              (const void *) pollist,
-              pollist->KeySignatureOffset);
-    memcpy_s( (void *) key_buffer->data,
-              key_size_bytes,
-              (const void *) sig->KeyAndSignature.RsaKeyAndSignature.Key.Modulus,
-              key_size_bytes);
-    memcpy_s( (void *)signature_buffer->data,
-              key_size_bytes,
-              (const void *) sig->KeyAndSignature.RsaKeyAndSignature.Signature.Signature,
-              key_size_bytes);
-
-    //Remember that key and sig are LE in pollist file, must be BE for openssll
-    buffer_reverse_byte_order((uint8_t *) signature_buffer->data, signature_buffer->size);
-    buffer_reverse_byte_order((uint8_t *) key_buffer->data, key_buffer->size);
-    
-    result = verify_rsa_signature(list_data, key_buffer, signature_buffer,
-                   hash_alg_sig, sig_alg, LCP_TPM20_POLICY_LIST2_1_VERSION_300);
-    if (result) {
-        DISPLAY("List signature verified positively.\n");
-    }
-    else {
-        DISPLAY("List signature did not verify.\n");
-    }
-    free(key_buffer);
-    free(signature_buffer);
-    free(list_data);
-    return result;
+    if ( view->sig == NULL )
+        return hash_buffer((const unsigned char *) view->pollist, view->size,
+                           (tb_hash_t *) hash, hash_alg);
+    return hash_buffer(view->pubkey, view->pubkey_size, (tb_hash_t *) hash,
+                       hash_alg);
 }
 
 void display_tpm20_signature_2_1(const char *prefix, const lcp_signature_2_1 *sig,
@@ -1524,7 +1560,7 @@ Out: true/false write success or failure
     }
 }
 
-static lcp_signature_2_1 *read_rsa_pubkey_file_2_1(const char *file)
+static lcp_signature_2_1 *parse_rsa_pubkey_file_2_1(const char *file)
 /*
 This function: extracts rsa data to a lcp_signature_2_1 structure
 
@@ -1632,6 +1668,20 @@ Out: Pointer to signature structure.
         return NULL;
 }
 
+static lcp_signature_2_1 *read_rsa_pubkey_file_2_1(const char *file)
+{
+    lcp_signature_2_1 *sig = get_cached_pubkey_sig(file, KEY_CACHE_RSA_SIG2_1);
+    if ( sig != NULL )
+        return sig;
+
+    sig = parse_rsa_pubkey_file_2_1(file);
+    if ( sig != NULL )
+        cache_pubkey_sig(file, KEY_CACHE_RSA_SIG2_1, sig, sizeof(rsa_key_and_signature) +
+                         offsetof(lcp_signature_2_1, KeyAndSignature));
+    return sig;
+}
+
+
 bool rsa_sign_list_2_1_data(lcp_policy_list_t2_1 *pollist, const char *privkey_file)
 {
     /*
@@ -1650,7 +1700,6 @@ bool rsa_sign_list_2_1_data(lcp_policy_list_t2_1 *pollist, const char *privkey_f
     lcp_signature_2_1 *sig = NULL;
     sized_buffer *digest = NULL;
     sized_buffer *sig_block = NULL;  //Buffer for generated sig
-    EVP_PKEY_CTX *context = NULL;  //Context for openssl functions
 
     LOG("rsa_sign_list_2_1_data\n");
     if ( pollist == NULL || privkey_file == NULL )
@@ -1693,13 +1742,6 @@ bool rsa_sign_list_2_1_data(lcp_policy_list_t2_1 *pollist, const char *privkey_f
         print_hex("", &digest, get_hash_size(hashalg));
     }
 
-    //Create context using key
-    context = rsa_get_sig_ctx(privkey_file, keysize);
-    if ( context == NULL) {
-        ERROR("ERROR: failed to initialize EVP context.\n");
-        goto ERROR;
-    }
-
     //Allocate mem for signature block:
     sig_block = allocate_sized_buffer(keysize);
     if (sig_block == NULL) {
@@ -1709,7 +1751,7 @@ bool rsa_sign_list_2_1_data(lcp_policy_list_t2_1 *pollist, const char *privkey_f
     sig_block->size = keysize;
 
     //Sign
-    status = rsa_ssa_pss_sign(sig_block, digest, sig_alg, hashalg, context);
+    status = signer_rsa_sign(privkey_file, sig_block, digest, sig_alg, hashalg);
     if (!status) {
         ERROR("ERROR: failed to sign list data.");
         goto ERROR;
@@ -1729,8 +1771,6 @@ bool rsa_sign_list_2_1_data(lcp_policy_list_t2_1 *pollist, const char *privkey_f
     if (digest != NULL) {
         free(digest);
     }
-    if (context != NULL)
-        OPENSSL_free(context);
     return true;
     ERROR:
         if (sig_block != NULL) {
@@ -1739,12 +1779,10 @@ bool rsa_sign_list_2_1_data(lcp_policy_list_t2_1 *pollist, const char *privkey_f
         if (digest != NULL) {
             free(digest);
         }
-        if (context != NULL)
-            OPENSSL_free(context);
         return false;
 }
 
-static lcp_signature_2_1 *read_ecdsa_pubkey_file_2_1(const char *pubkey_file)
+static lcp_signature_2_1 *parse_ecdsa_pubkey_file_2_1(const char *pubkey_file)
 {
     int result;
     lcp_signature_2_1 *sig = NULL;
@@ -1902,6 +1940,20 @@ static lcp_signature_2_1 *read_ecdsa_pubkey_file_2_1(const char *pubkey_file)
         return NULL;
 }
 
+static lcp_signature_2_1 *read_ecdsa_pubkey_file_2_1(const char *pubkey_file)
+{
+    lcp_signature_2_1 *sig = get_cached_pubkey_sig(pubkey_file, KEY_CACHE_ECC_SIG2_1);
+    if ( sig != NULL )
+        return sig;
+
+    sig = parse_ecdsa_pubkey_file_2_1(pubkey_file);
+    if ( sig != NULL )
+        cache_pubkey_sig(pubkey_file, KEY_CACHE_ECC_SIG2_1, sig, sizeof(ecc_key_and_signature) +
+                         offsetof(lcp_signature_2_1, KeyAndSignature));
+    return sig;
+}
+
+
 bool ec_sign_list_2_1_data(lcp_policy_list_t2_1 *pollist, const char *privkey_file)
 {
     /*
@@ -1960,7 +2012,8 @@ bool ec_sign_list_2_1_data(lcp_policy_list_t2_1 *pollist, const char *privkey_fi
     }
 
     //Do the signing
-    result = ec_sign_data(pollist_data, sig_r, sig_s, sigalg, hashalg, privkey_file);
+    result = signer_ec_sign(privkey_file, pollist_data, sig_r, sig_s, sigalg,
+                            hashalg);
 
     if (!result) {
         ERROR("Error: failed to sign pollist data.\n");
@@ -53,6 +53,27 @@ typedef struct __packed {
     uint16_t  key_size;
 } sig_key_2_1_header;
 
+/*
+ * Read-only view of a list laid out as in a list file (e.g. a mapped file).
+ * Pointers are into the viewed data; key and signature are LE as stored.
+ */
+typedef struct {
+    const lcp_policy_list_t2_1 *pollist;
+    size_t                     size;           /* whole list incl. signature */
+    const sig_key_2_1_header   *sig;           /* NULL if list is not signed */
+    size_t                     sig_size;       /* from RevocationCounter on */
+    size_t                     key_size;       /* in bytes */
+    uint32_t                   exponent;       /* RSA only */
+    const uint8_t              *pubkey;        /* Modulus or QxQy */
+    size_t                     pubkey_size;
+    uint16_t                   sig_scheme;
+    uint8_t                    sig_version;
+    uint16_t                   sig_key_size;   /* in bits */
+    uint16_t                   hash_alg;
+    const uint8_t              *signature;     /* Signature or sigRsigS */
+    size_t                     signature_size;
+} lcp_list_2_1_view;
+
 unsigned char *fill_tpm20_policy_list_2_1_buffer(const lcp_policy_list_t2_1 *pollist,
                                                                    size_t *len);
 size_t get_tpm20_list_2_1_real_size(const lcp_policy_list_t2_1 *pollist);
@@ -77,6 +98,13 @@ lcp_signature_2_1 *create_empty_rsa_signature_2_1(void);
 lcp_policy_list_t2_1 *get_policy_list_2_1_data(const void *raw_data, size_t base_size,
                                              uint16_t key_signature_offset);
 bool sign_lcp_policy_list_t2_1(sign_user_input user_input);
+bool get_policy_list_2_1_view(const void *data, size_t size,
+                              lcp_list_2_1_view *view);
+const lcp_policy_element_t *get_policy_list_2_1_view_element(
+        const lcp_list_2_1_view *view, const lcp_policy_element_t *elt);
+bool verify_policy_list_2_1_view_sig(const lcp_list_2_1_view *view);
+bool calc_policy_list_2_1_view_hash(const lcp_list_2_1_view *view,
+                                    lcp_hash_t2 *hash, uint16_t hash_alg);
 
 #endif
 
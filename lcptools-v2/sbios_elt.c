@@ -49,10 +49,10 @@
 #include "polelt_plugin.h"
 #include "lcputils.h"
 
-#define MAX_HASHES       33     /* +1 for fallback_hash */
+#define MAX_HASHES       0x10000    /* num_hashes is 16 bits, +1 for fallback_hash */
 
 static unsigned int nr_hashes;
-static tb_hash_t hashes[MAX_HASHES];
+static tb_hash_t *hashes;
 static char alg_name[32] = "sha1";
 static uint16_t alg_type = TPM_ALG_SHA1;
 
@@ -69,14 +69,6 @@ static lcp_hash_t2 *get_hashes(lcp_sbios_element_t2 *sbios)
     return (void *)get_num_hashes(sbios) + sizeof(sbios->num_hashes);
 }
 
-static bool parse_sbios_line(const char *line)
-{
-    if ( nr_hashes == MAX_HASHES )
-        return false;
-
-    return parse_line_hashes(line, &hashes[nr_hashes++], alg_type);
-}
-
 static bool cmdline_handler(int c, const char *opt)
 {
     if (c == 'a') {
@@ -92,7 +84,7 @@ static bool cmdline_handler(int c, const char *opt)
 
     /* BIOS hash files */
     LOG("cmdline opt: sbios hash file: %s\n", opt);
-    if ( !parse_file(opt, parse_sbios_line) )
+    if ( !read_hashes_file(opt, alg_type, &hashes, &nr_hashes, MAX_HASHES) )
         return false;
     if ( nr_hashes == 0 ) {
         ERROR("Error: no hashes provided\n");
@@ -105,6 +97,19 @@ static bool cmdline_handler(int c, const char *opt)
 static lcp_policy_element_t *create(void)
 {
     LOG("[create]\n");
+    /* the fallback hash stays first and isn't repeated in the list */
+    if ( nr_hashes > 0 ) {
+        unsigned int nr = 1;
+
+        nr_hashes = 1 + sort_unique_hashes(hashes + 1, nr_hashes - 1);
+        for ( unsigned int i = 1; i < nr_hashes; i++ ) {
+            if ( !are_hashes_equal(&hashes[i], &hashes[0], alg_type) )
+                hashes[nr++] = hashes[i];
+        }
+        if ( nr < nr_hashes )
+            LOG("dropped the fallback hash from the hashes list\n");
+        nr_hashes = nr;
+    }
     /* take entire struct size and subtract size of fallback_hash because
        sizeof(lcp_hash_t) is not accurate (hence get_hash_size()), then
        add it back in w/ 'nr_hashes' */
@@ -167,7 +172,8 @@ static polelt_plugin_t plugin = {
     "                                    hash(es); each file can contain\n"
     "                                    multiple hashes; the first hash in\n"
     "                                    the first file will be the fallback\n"
-    "                                    hash\n",
+    "                                    hash; the others are sorted and\n"
+    "                                    duplicates dropped\n",
     LCP_POLELT_TYPE_SBIOS2,
     &cmdline_handler,
     &create,
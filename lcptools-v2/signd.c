@@ -0,0 +1,703 @@
+/*
+ * signd.c: LCP list signing daemon
+ *
+ *
+ * Copyright (c) 2026, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * lcp2_signd holds the private keys and signs for lcp2_crtpollist
+ * --signer unix:<path> over a unix socket (see signer.h for the protocol),
+ * standing in for a network HSM: the build machine only needs the public
+ * keys, and one daemon serves every build thread.  Each connection gets its
+ * own thread; requests on it are answered in order.
+ *
+ * --bench measures signatures per second through the file signer and, with
+ * --socket, through a running daemon.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <getopt.h>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <openssl/evp.h>
+#include <safe_lib.h>
+#define PRINT   printf
+#include "../../include/config.h"
+#include "../../include/hash.h"
+#include "../../include/uuid.h"
+#include "../../include/lcp3.h"
+#include "polelt_plugin.h"
+#include "lcputils.h"
+#include "signer.h"
+
+#define TOOL_VER_MAJOR 0x1
+#define TOOL_VER_MINOR 0x0
+
+static const char help[] =
+    "Usage: lcp2_signd <COMMAND> [OPTIONS]\n"
+    "Sign Intel(R) TXT policy lists for lcp2_crtpollist --signer unix:<path>.\n"
+    "\n--serve\n"
+    "Serves signing requests until killed.\n"
+    "        --socket <path>          unix socket to listen on\n"
+    "        --key <name>=<key file>  PEM file of a private key, used for\n"
+    "                                 lcp2_crtpollist --priv <name>; can be\n"
+    "                                 given more than once\n"
+    "\n--bench\n"
+    "Measures signatures per second.\n"
+    "        --key <name>=<key file>  private key to sign with\n"
+    "        [--socket <path>]        also sign through the lcp2_signd\n"
+    "                                 serving <path>, which must have <name>\n"
+    "        [--sigalg]               <rsa|rsapss|ecdsa> signature algorithm\n"
+    "                                 (default: rsa or ecdsa from the key)\n"
+    "        [--hashalg]              <sha1|sha256|sha384> hash algorithm\n"
+    "                                 (default: sha256)\n"
+    "        [--count <number>]       signatures to make (default: 1000)\n"
+    "        [--jobs <number>]        signing threads (default: number of CPUs)\n"
+    "        [--depth <number>]       requests in flight per connection\n"
+    "                                 (default: 8)\n"
+    "\n--help\n"
+    "\n--verbose                      enable verbose output; can be\n"
+    "                                 specified with any command\n\n"
+    "\n--version                      show tool version.\n";
+
+static struct option long_opts[] =
+{
+    /* commands */
+    {"help",           no_argument,          NULL,     'H'},
+
+    {"serve",          no_argument,          NULL,     'S'},
+    {"bench",          no_argument,          NULL,     'B'},
+    {"version",        no_argument,          NULL,     'v'},
+    /* options */
+    {"socket",         required_argument,    NULL,     's'},
+    {"key",            required_argument,    NULL,     'k'},
+    {"sigalg",         required_argument,    NULL,     'a'},
+    {"hashalg",        required_argument,    NULL,     'h'},
+    {"count",          required_argument,    NULL,     'c'},
+    {"jobs",           required_argument,    NULL,     'j'},
+    {"depth",          required_argument,    NULL,     'd'},
+    {"verbose",        no_argument,          NULL,     't'},
+    {0, 0, 0, 0}
+};
+
+#define MAX_KEYS    32
+
+typedef struct {
+    char     name[SIGND_MAX_KEY_NAME + 1];
+    char     file[MAX_PATH];
+} signd_key_t;
+
+static signd_key_t    keys[MAX_KEYS];
+static unsigned int   nr_keys = 0;
+static char           socket_file[MAX_PATH] = "";
+static uint16_t       sigalg_type = TPM_ALG_NULL; // Default: from the key
+static uint16_t       hash_alg = TPM_ALG_SHA256;
+static unsigned int   count = 1000;
+static int            nr_jobs = 0; // Default: number of CPUs
+static unsigned int   depth = 8;
+
+bool verbose = false;
+
+static bool add_key(const char *arg)
+{
+    const char *eq = strchr(arg, '=');
+
+    if ( eq == NULL || eq == arg || eq[1] == '\0' ) {
+        ERROR("Error: --key must be <name>=<key file>\n");
+        return false;
+    }
+    if ( nr_keys == MAX_KEYS ) {
+        ERROR("Error: too many keys\n");
+        return false;
+    }
+    if ( (size_t)(eq - arg) > SIGND_MAX_KEY_NAME ||
+         strlen(eq + 1) >= MAX_PATH ) {
+        ERROR("Error: key name or file too long\n");
+        return false;
+    }
+    memcpy_s(keys[nr_keys].name, sizeof(keys[0].name), arg, eq - arg);
+    keys[nr_keys].name[eq - arg] = '\0';
+    strlcpy(keys[nr_keys].file, eq + 1, sizeof(keys[0].file));
+    nr_keys++;
+    return true;
+}
+
+static const signd_key_t *find_key(const char *name)
+{
+    for ( unsigned int i = 0; i < nr_keys; i++ ) {
+        if ( strcmp(keys[i].name, name) == 0 )
+            return &keys[i];
+    }
+    return NULL;
+}
+
+/* size of a signature (RSA) or of one of r and s (EC) made with key */
+static size_t get_sig_size(const char *file, bool *is_rsa)
+{
+    EVP_PKEY *pkey = read_cached_privkey(file);
+    size_t size;
+
+    if ( pkey == NULL )
+        return 0;
+    *is_rsa = EVP_PKEY_base_id(pkey) == EVP_PKEY_RSA;
+    if ( *is_rsa )
+        size = EVP_PKEY_size(pkey);
+    else
+        size = (EVP_PKEY_bits(pkey) + 7) / 8;
+    EVP_PKEY_free(pkey);
+    return size;
+}
+
+/*
+ * --serve
+ */
+
+static bool handle_request(int fd, const signd_request_t *req, const char *name,
+                           sized_buffer *data)
+{
+    const signd_key_t *key = find_key(name);
+    signd_response_t resp = { .magic = SIGND_MAGIC, .status = 1, .size = 0 };
+    sized_buffer *sig = NULL, *sig_r = NULL, *sig_s = NULL;
+    bool is_rsa = false;
+    size_t key_sig_size = 0;
+    bool ok;
+
+    /* the signers write as much as the key needs, so the sizes must agree */
+    if ( key != NULL )
+        key_sig_size = get_sig_size(key->file, &is_rsa);
+
+    if ( key == NULL ) {
+        ERROR("Error: unknown key %s\n", name);
+    }
+    else if ( req->sig_size == 0 || req->sig_size > SIGND_MAX_SIG ||
+              req->sig_size != key_sig_size ) {
+        ERROR("Error: bad signature size %u for key %s\n", req->sig_size,
+              name);
+    }
+    else if ( (req->op == SIGND_OP_RSA_SIGN && !is_rsa) ||
+              (req->op == SIGND_OP_EC_SIGN && is_rsa) ) {
+        ERROR("Error: request %u doesn't match the type of key %s\n",
+              req->op, name);
+    }
+    else if ( req->op == SIGND_OP_RSA_SIGN ) {
+        sig = allocate_sized_buffer(req->sig_size);
+        if ( sig != NULL && data->size == get_lcp_hash_size(req->hash_alg) ) {
+            sig->size = req->sig_size;
+            if ( file_signer.rsa_sign(key->file, sig, data, req->sig_alg,
+                                      req->hash_alg) ) {
+                resp.status = 0;
+                resp.size = sig->size;
+            }
+        }
+    }
+    else if ( req->op == SIGND_OP_EC_SIGN ) {
+        sig_r = allocate_sized_buffer(req->sig_size);
+        sig_s = allocate_sized_buffer(req->sig_size);
+        if ( sig_r != NULL && sig_s != NULL ) {
+            sig_r->size = sig_s->size = req->sig_size;
+            memset_s(sig_r->data, sig_r->size, 0);
+            memset_s(sig_s->data, sig_s->size, 0);
+            if ( file_signer.ec_sign(key->file, data, sig_r, sig_s,
+                                     req->sig_alg, req->hash_alg) ) {
+                resp.status = 0;
+                resp.size = 2 * req->sig_size;
+            }
+        }
+    }
+    else {
+        ERROR("Error: unknown request %u\n", req->op);
+    }
+    LOG("%s: key %s, op %u: %s\n", socket_file, name, req->op,
+        resp.status == 0 ? "signed" : "failed");
+
+    ok = signd_write_full(fd, &resp, sizeof(resp));
+    if ( ok && resp.status == 0 && sig != NULL )
+        ok = signd_write_full(fd, sig->data, sig->size);
+    else if ( ok && resp.status == 0 )
+        ok = signd_write_full(fd, sig_r->data, sig_r->size) &&
+             signd_write_full(fd, sig_s->data, sig_s->size);
+    free(sig);
+    free(sig_r);
+    free(sig_s);
+    return ok;
+}
+
+static void *serve_connection(void *arg)
+{
+    int fd = (int)(intptr_t)arg;
+    signd_request_t req;
+    char name[SIGND_MAX_KEY_NAME + 1];
+    sized_buffer *data;
+
+    while ( signd_read_full(fd, &req, sizeof(req)) ) {
+        if ( req.magic != SIGND_MAGIC || req.key_name_size == 0 ||
+             req.key_name_size > SIGND_MAX_KEY_NAME || req.data_size == 0 ||
+             req.data_size > SIGND_MAX_DATA ) {
+            ERROR("Error: bad request, dropping connection\n");
+            break;
+        }
+        if ( !signd_read_full(fd, name, req.key_name_size) )
+            break;
+        name[req.key_name_size] = '\0';
+        data = allocate_sized_buffer(req.data_size);
+        if ( data == NULL )
+            break;
+        data->size = req.data_size;
+        if ( !signd_read_full(fd, data->data, data->size) ||
+             !handle_request(fd, &req, name, data) ) {
+            free(data);
+            break;
+        }
+        free(data);
+    }
+    close(fd);
+    return NULL;
+}
+
+static int serve(void)
+{
+    struct sockaddr_un addr;
+    struct stat st;
+    pthread_attr_t attr;
+    pthread_t thread;
+    int fd;
+
+    for ( unsigned int i = 0; i < nr_keys; i++ ) {
+        bool is_rsa;
+        size_t size = get_sig_size(keys[i].file, &is_rsa);
+
+        if ( size == 0 )
+            return 1;
+        LOG("key %s: %s, %s %zu bytes\n", keys[i].name, keys[i].file,
+            is_rsa ? "RSA" : "EC", size);
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if ( strlen(socket_file) >= sizeof(addr.sun_path) ) {
+        ERROR("Error: socket path too long: %s\n", socket_file);
+        return 1;
+    }
+    strlcpy(addr.sun_path, socket_file, sizeof(addr.sun_path));
+    /*
+     * a stale socket from an earlier run, but nothing else: only a refused
+     * connect() means no daemon is listening on it any more
+     */
+    if ( stat(socket_file, &st) == 0 && S_ISSOCK(st.st_mode) ) {
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if ( fd < 0 ) {
+            ERROR("Error: failed to create socket: %s\n", strerror(errno));
+            return 1;
+        }
+        if ( connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 ) {
+            ERROR("Error: another daemon is serving on %s\n", socket_file);
+            close(fd);
+            return 1;
+        }
+        if ( errno != ECONNREFUSED ) {
+            ERROR("Error: can't tell if %s is in use: %s\n", socket_file,
+                  strerror(errno));
+            close(fd);
+            return 1;
+        }
+        close(fd);
+        unlink(socket_file);
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if ( fd < 0 ) {
+        ERROR("Error: failed to create socket: %s\n", strerror(errno));
+        return 1;
+    }
+    /* whoever can connect can sign: owner only */
+    umask(077);
+    if ( bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+         listen(fd, SOMAXCONN) < 0 ) {
+        ERROR("Error: failed to listen on %s: %s\n", socket_file,
+              strerror(errno));
+        close(fd);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    DISPLAY("lcp2_signd: serving %u keys on %s\n", nr_keys, socket_file);
+
+    while ( true ) {
+        int conn = accept(fd, NULL, NULL);
+
+        if ( conn < 0 ) {
+            if ( errno == EINTR || errno == ECONNABORTED )
+                continue;
+            ERROR("Error: accept failed: %s\n", strerror(errno));
+            break;
+        }
+        if ( pthread_create(&thread, &attr, serve_connection,
+                            (void *)(intptr_t)conn) != 0 ) {
+            ERROR("Error: failed to create thread\n");
+            close(conn);
+        }
+    }
+    pthread_attr_destroy(&attr);
+    close(fd);
+    return 1;
+}
+
+/*
+ * --bench
+ */
+
+static struct {
+    const signd_key_t *key;
+    bool              is_rsa;
+    size_t            sig_size;
+    sized_buffer      *data;        /* digest (RSA) or message (EC) */
+    unsigned int      next;
+    unsigned int      failed;
+    bool              use_socket;
+} bench;
+
+/* claim up to max signatures of the --count still to do */
+static unsigned int claim(unsigned int max)
+{
+    unsigned int start = __sync_fetch_and_add(&bench.next, max);
+
+    if ( start >= count )
+        return 0;
+    return count - start < max ? count - start : max;
+}
+
+static bool bench_sign_one(void)
+{
+    sized_buffer *a = allocate_sized_buffer(bench.sig_size);
+    sized_buffer *b = allocate_sized_buffer(bench.sig_size);
+    bool ok = false;
+
+    if ( a != NULL && b != NULL ) {
+        a->size = b->size = bench.sig_size;
+        if ( bench.is_rsa )
+            ok = file_signer.rsa_sign(bench.key->file, a, bench.data,
+                                      sigalg_type, hash_alg);
+        else
+            ok = file_signer.ec_sign(bench.key->file, bench.data, a, b,
+                                     sigalg_type, hash_alg);
+    }
+    free(a);
+    free(b);
+    return ok;
+}
+
+static void *bench_file_worker(void *arg)
+{
+    (void)arg;
+
+    while ( claim(1) > 0 ) {
+        if ( !bench_sign_one() )
+            __sync_fetch_and_add(&bench.failed, 1);
+    }
+    return NULL;
+}
+
+/*
+ * Keeps up to --depth requests in flight on its own connection, so the
+ * round trip to the daemon overlaps with signing.
+ */
+static void *bench_socket_worker(void *arg)
+{
+    size_t resp_size = bench.is_rsa ? bench.sig_size : 2 * bench.sig_size;
+    uint8_t sig[SIGND_MAX_SIG];
+    uint8_t op = bench.is_rsa ? SIGND_OP_RSA_SIGN : SIGND_OP_EC_SIGN;
+    unsigned int in_flight = 0, n;
+    int fd;
+
+    (void)arg;
+    fd = signd_connect(socket_file);
+    if ( fd < 0 ) {
+        __sync_fetch_and_add(&bench.failed, claim(count));
+        return NULL;
+    }
+    while ( true ) {
+        n = claim(depth - in_flight);
+        for ( unsigned int i = 0; i < n; i++ ) {
+            if ( !signd_send_request(fd, op, bench.key->name, bench.data->data,
+                                     bench.data->size, bench.sig_size,
+                                     sigalg_type, hash_alg) )
+                goto BROKEN;
+            in_flight++;
+        }
+        if ( in_flight == 0 )
+            break;
+        if ( !signd_recv_response(fd, sig, resp_size) )
+            goto BROKEN;
+        in_flight--;
+    }
+    close(fd);
+    return NULL;
+
+    BROKEN:
+        __sync_fetch_and_add(&bench.failed, in_flight);
+        close(fd);
+        return NULL;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool run_bench(const char *name, void *(*worker)(void *), int jobs)
+{
+    pthread_t threads[jobs];
+    int num_threads = 0;
+    double start, elapsed;
+
+    bench.next = 0;
+    bench.failed = 0;
+    start = now();
+    while ( num_threads < jobs &&
+            pthread_create(&threads[num_threads], NULL, worker, NULL) == 0 )
+        num_threads++;
+    if ( num_threads == 0 )
+        worker(NULL);
+    for ( int i = 0; i < num_threads; i++ )
+        pthread_join(threads[i], NULL);
+    elapsed = now() - start;
+
+    if ( bench.failed != 0 ) {
+        ERROR("Error: %s signer: %u of %u signatures failed\n", name,
+              bench.failed, count);
+        return false;
+    }
+    DISPLAY("%-6s signer: %u signatures, %d threads, %.3f s, %.1f signatures/s\n",
+            name, count, num_threads > 0 ? num_threads : 1, elapsed,
+            elapsed > 0 ? count / elapsed : 0.0);
+    return true;
+}
+
+static int bench_signers(void)
+{
+    uint8_t message[4096];
+    int jobs = nr_jobs;
+    bool ok;
+
+    bench.key = &keys[0];
+    bench.sig_size = get_sig_size(bench.key->file, &bench.is_rsa);
+    if ( bench.sig_size == 0 )
+        return 1;
+    if ( 2 * bench.sig_size > SIGND_MAX_SIG ) {
+        ERROR("Error: unsupported key size\n");
+        return 1;
+    }
+    if ( sigalg_type == TPM_ALG_NULL )
+        sigalg_type = bench.is_rsa ? TPM_ALG_RSASSA : TPM_ALG_ECDSA;
+
+    /* something the size of a policy list to sign */
+    for ( size_t i = 0; i < sizeof(message); i++ )
+        message[i] = i;
+    if ( bench.is_rsa ) {
+        bench.data = allocate_sized_buffer(sizeof(tb_hash_t));
+        if ( bench.data == NULL )
+            return 1;
+        bench.data->size = get_lcp_hash_size(hash_alg);
+        if ( !hash_buffer(message, sizeof(message),
+                          (tb_hash_t *)bench.data->data, hash_alg) ) {
+            ERROR("Error: unsupported hash algorithm\n");
+            free(bench.data);
+            return 1;
+        }
+    }
+    else {
+        bench.data = allocate_sized_buffer(sizeof(message));
+        if ( bench.data == NULL )
+            return 1;
+        bench.data->size = sizeof(message);
+        memcpy_s(bench.data->data, bench.data->size, message, sizeof(message));
+    }
+
+    if ( jobs <= 0 )
+        jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    if ( jobs > (int)count )
+        jobs = count;
+    signal(SIGPIPE, SIG_IGN);
+
+    /* warm the key cache so neither run pays for reading the key */
+    ok = bench_sign_one();
+    if ( ok )
+        ok = run_bench(file_signer.name, bench_file_worker, jobs);
+    if ( ok && *socket_file != '\0' )
+        ok = run_bench(socket_signer.name, bench_socket_worker, jobs);
+    free(bench.data);
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    int cmd = 0;
+    bool prev_cmd = false;
+    int c;
+
+    do {
+        c = getopt_long_only(argc, argv, "", long_opts, NULL);
+        switch (c) {
+        /* commands */
+        case 'H':          /* help */
+        case 'S':          /* serve */
+        case 'B':          /* bench */
+        case 'v':          /* version */
+            if ( prev_cmd ) {
+                ERROR("Error: only one command can be specified\n");
+                return 1;
+            }
+            prev_cmd = true;
+            cmd = c;
+            LOG("cmdline opt: command: %c\n", cmd);
+            break;
+
+        case 's':            /* socket */
+            strlcpy(socket_file, optarg, sizeof(socket_file));
+            LOG("cmdline opt: socket: %s\n", socket_file);
+            break;
+
+        case 'k':            /* key */
+            if ( !add_key(optarg) )
+                return 1;
+            LOG("cmdline opt: key: %s\n", optarg);
+            break;
+
+        case 'a':            /* sigalg */
+            sigalg_type = str_to_sig_alg(optarg);
+            if ( sigalg_type != TPM_ALG_RSASSA &&
+                 sigalg_type != TPM_ALG_RSAPSS &&
+                 sigalg_type != TPM_ALG_ECDSA ) {
+                ERROR("Error: unsupported signature algorithm %s\n", optarg);
+                return 1;
+            }
+            break;
+
+        case 'h':            /* hashalg */
+            hash_alg = str_to_hash_alg(optarg);
+            if ( hash_alg == TPM_ALG_NULL ) {
+                ERROR("Error: unsupported hash algorithm %s\n", optarg);
+                return 1;
+            }
+            break;
+
+        case 'c':            /* count */
+            count = strtoul(optarg, NULL, 0);
+            if ( count == 0 ) {
+                ERROR("Error: invalid count\n");
+                return 1;
+            }
+            break;
+
+        case 'j':            /* jobs */
+            nr_jobs = strtol(optarg, NULL, 0);
+            if ( nr_jobs <= 0 ) {
+                ERROR("Error: invalid number of jobs\n");
+                return 1;
+            }
+            break;
+
+        case 'd':            /* depth */
+            depth = strtoul(optarg, NULL, 0);
+            if ( depth == 0 ) {
+                ERROR("Error: invalid depth\n");
+                return 1;
+            }
+            break;
+
+        case 't':
+            verbose = true;
+            break;
+
+        case 0:
+        case -1:
+            break;
+
+        default:
+            ERROR("Error: unrecognized option\n");
+            return 1;
+        }
+    } while ( c != -1 );
+
+    if ( cmd == 0 ) {
+        ERROR("Error: no command option was specified\n");
+        return 1;
+    }
+    else if ( cmd == 'H' ) {        /* --help */
+        DISPLAY("%s", help);
+        return 0;
+    }
+    else if ( cmd == 'v' ) {        /* --version */
+        DISPLAY("lcp2_signd version: %i.%i\nBuild date: %s", TOOL_VER_MAJOR,
+                TOOL_VER_MINOR, __DATE__);
+        return 0;
+    }
+
+    if ( nr_keys == 0 ) {
+        ERROR("Error: no key specified\n");
+        return 1;
+    }
+    if ( cmd == 'S' ) {             /* --serve */
+        if ( *socket_file == '\0' ) {
+            ERROR("Error: no socket specified\n");
+            return 1;
+        }
+        return serve();
+    }
+    return bench_signers();          /* --bench */
+}
+
+
+/*
+ * Local variables:
+ * mode: C
+ * c-set-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,355 @@
+/*
+ * signer.c: LCP list signing backends
+ *
+ *
+ * Copyright (c) 2026, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <openssl/evp.h>
+#include <safe_lib.h>
+#define PRINT   printf
+#include "../../include/config.h"
+#include "../../include/hash.h"
+#include "../../include/uuid.h"
+#include "../../include/lcp3.h"
+#include "polelt_plugin.h"
+#include "lcputils.h"
+#include "signer.h"
+
+/*
+ * file signer: PEM private keys read (and cached) in this process
+ */
+
+static bool file_rsa_sign(const char *key, sized_buffer *sig_block,
+                          sized_buffer *digest, uint16_t sig_alg,
+                          uint16_t hash_alg)
+{
+    EVP_PKEY_CTX *context;
+    bool result;
+
+    context = rsa_get_sig_ctx(key, sig_block->size);
+    if ( context == NULL ) {
+        ERROR("Error: failed to initialize EVP context.\n");
+        return false;
+    }
+    result = rsa_ssa_pss_sign(sig_block, digest, sig_alg, hash_alg, context);
+    EVP_PKEY_CTX_free(context);
+    return result;
+}
+
+static bool file_ec_sign(const char *key, sized_buffer *data, sized_buffer *r,
+                         sized_buffer *s, uint16_t sig_alg, uint16_t hash_alg)
+{
+    return ec_sign_data(data, r, s, sig_alg, hash_alg, key);
+}
+
+const lcp_signer_t file_signer = {
+    .name = "file",
+    .rsa_sign = file_rsa_sign,
+    .ec_sign = file_ec_sign,
+};
+
+/*
+ * socket signer: requests to lcp2_signd, one connection per signing thread
+ */
+
+static char socket_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static pthread_key_t socket_key;
+static pthread_once_t socket_key_once = PTHREAD_ONCE_INIT;
+
+static void close_socket(void *value)
+{
+    close((int)(intptr_t)value - 1);
+}
+
+static void make_socket_key(void)
+{
+    pthread_key_create(&socket_key, close_socket);
+}
+
+int signd_connect(const char *path)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if ( strlen(path) >= sizeof(addr.sun_path) ) {
+        ERROR("Error: socket path too long: %s\n", path);
+        return -1;
+    }
+    strlcpy(addr.sun_path, path, sizeof(addr.sun_path));
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if ( fd < 0 ) {
+        ERROR("Error: failed to create socket: %s\n", strerror(errno));
+        return -1;
+    }
+    if ( connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ) {
+        ERROR("Error: failed to connect to %s: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool signd_read_full(int fd, void *buf, size_t size)
+{
+    uint8_t *p = buf;
+
+    while ( size > 0 ) {
+        ssize_t n = read(fd, p, size);
+        if ( n < 0 && errno == EINTR )
+            continue;
+        if ( n <= 0 )
+            return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool signd_write_full(int fd, const void *buf, size_t size)
+{
+    const uint8_t *p = buf;
+
+    while ( size > 0 ) {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if ( n < 0 && errno == EINTR )
+            continue;
+        if ( n <= 0 )
+            return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool signd_send_request(int fd, uint8_t op, const char *key,
+                        const void *data, size_t data_size, uint32_t sig_size,
+                        uint16_t sig_alg, uint16_t hash_alg)
+{
+    signd_request_t req;
+    size_t key_name_size = strnlen(key, SIGND_MAX_KEY_NAME + 1);
+
+    if ( key_name_size > SIGND_MAX_KEY_NAME || data_size > SIGND_MAX_DATA ) {
+        ERROR("Error: signing request too large\n");
+        return false;
+    }
+    memset(&req, 0, sizeof(req));
+    req.magic = SIGND_MAGIC;
+    req.op = op;
+    req.sig_alg = sig_alg;
+    req.hash_alg = hash_alg;
+    req.key_name_size = key_name_size;
+    req.sig_size = sig_size;
+    req.data_size = data_size;
+
+    return signd_write_full(fd, &req, sizeof(req)) &&
+           signd_write_full(fd, key, key_name_size) &&
+           signd_write_full(fd, data, data_size);
+}
+
+bool signd_recv_response(int fd, uint8_t *sig, size_t sig_size)
+{
+    signd_response_t resp;
+
+    if ( !signd_read_full(fd, &resp, sizeof(resp)) ) {
+        ERROR("Error: no response from signing daemon\n");
+        return false;
+    }
+    if ( resp.magic != SIGND_MAGIC ) {
+        ERROR("Error: bad response from signing daemon\n");
+        return false;
+    }
+    if ( resp.status != 0 ) {
+        ERROR("Error: signing daemon failed to sign (status %u)\n",
+              resp.status);
+        return false;
+    }
+    if ( resp.size != sig_size ) {
+        ERROR("Error: signing daemon returned %u bytes, expected %zu\n",
+              resp.size, sig_size);
+        return false;
+    }
+    return signd_read_full(fd, sig, sig_size);
+}
+
+static int get_socket(void)
+{
+    void *value;
+    int fd;
+
+    pthread_once(&socket_key_once, make_socket_key);
+    value = pthread_getspecific(socket_key);
+    if ( value != NULL )
+        return (int)(intptr_t)value - 1;
+
+    fd = signd_connect(socket_path);
+    if ( fd >= 0 )
+        pthread_setspecific(socket_key, (void *)(intptr_t)(fd + 1));
+    return fd;
+}
+
+static void drop_socket(int fd)
+{
+    /* the stream is out of step after an error, start over next time */
+    pthread_setspecific(socket_key, NULL);
+    close(fd);
+}
+
+static bool socket_sign(uint8_t op, const char *key, const void *data,
+                        size_t data_size, uint32_t sig_size, uint8_t *sig,
+                        size_t size, uint16_t sig_alg, uint16_t hash_alg)
+{
+    int fd = get_socket();
+
+    if ( fd < 0 )
+        return false;
+    if ( !signd_send_request(fd, op, key, data, data_size, sig_size,
+                             sig_alg, hash_alg) ) {
+        ERROR("Error: failed to send signing request: %s\n", strerror(errno));
+        drop_socket(fd);
+        return false;
+    }
+    if ( !signd_recv_response(fd, sig, size) ) {
+        drop_socket(fd);
+        return false;
+    }
+    return true;
+}
+
+static bool socket_rsa_sign(const char *key, sized_buffer *sig_block,
+                            sized_buffer *digest, uint16_t sig_alg,
+                            uint16_t hash_alg)
+{
+    /* only the digest goes over the wire */
+    return socket_sign(SIGND_OP_RSA_SIGN, key, digest->data,
+                       get_lcp_hash_size(hash_alg), sig_block->size,
+                       sig_block->data, sig_block->size, sig_alg, hash_alg);
+}
+
+static bool socket_ec_sign(const char *key, sized_buffer *data, sized_buffer *r,
+                           sized_buffer *s, uint16_t sig_alg, uint16_t hash_alg)
+{
+    uint8_t sig[SIGND_MAX_SIG];
+
+    if ( r->size != s->size || 2 * r->size > sizeof(sig) ) {
+        ERROR("Error: unsupported signature size\n");
+        return false;
+    }
+    if ( !socket_sign(SIGND_OP_EC_SIGN, key, data->data, data->size, r->size,
+                      sig, 2 * r->size, sig_alg, hash_alg) )
+        return false;
+    memcpy_s(r->data, r->size, sig, r->size);
+    memcpy_s(s->data, s->size, sig + r->size, s->size);
+    return true;
+}
+
+const lcp_signer_t socket_signer = {
+    .name = "unix",
+    .rsa_sign = socket_rsa_sign,
+    .ec_sign = socket_ec_sign,
+};
+
+/*
+ * signer selection
+ */
+
+static const lcp_signer_t *signer = &file_signer;
+
+bool set_signer(const char *spec)
+{
+    if ( strcmp(spec, "file") == 0 ) {
+        signer = &file_signer;
+        return true;
+    }
+    if ( strncmp(spec, "unix:", 5) == 0 && spec[5] != '\0' ) {
+        if ( strlen(spec + 5) >= sizeof(socket_path) ) {
+            ERROR("Error: socket path too long: %s\n", spec + 5);
+            return false;
+        }
+        strlcpy(socket_path, spec + 5, sizeof(socket_path));
+        signer = &socket_signer;
+        return true;
+    }
+    ERROR("Error: unknown signer %s\n", spec);
+    return false;
+}
+
+const lcp_signer_t *get_signer(void)
+{
+    return signer;
+}
+
+bool signer_rsa_sign(const char *key, sized_buffer *sig_block,
+                     sized_buffer *digest, uint16_t sig_alg, uint16_t hash_alg)
+{
+    if ( key == NULL || sig_block == NULL || digest == NULL ) {
+        ERROR("Error: one or more data buffers is not defined.\n");
+        return false;
+    }
+    LOG("[signer_rsa_sign] %s signer, key %s\n", signer->name, key);
+    return signer->rsa_sign(key, sig_block, digest, sig_alg, hash_alg);
+}
+
+bool signer_ec_sign(const char *key, sized_buffer *data, sized_buffer *r,
+                    sized_buffer *s, uint16_t sig_alg, uint16_t hash_alg)
+{
+    if ( key == NULL || data == NULL || r == NULL || s == NULL ) {
+        ERROR("Error: one or more data buffers not defined.\n");
+        return false;
+    }
+    LOG("[signer_ec_sign] %s signer, key %s\n", signer->name, key);
+    return signer->ec_sign(key, data, r, s, sig_alg, hash_alg);
+}
+
+
+/*
+ * Local variables:
+ * mode: C
+ * c-set-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
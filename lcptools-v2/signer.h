@@ -0,0 +1,125 @@
+/*
+ * signer.h: LCP list signing backends
+ *
+ *
+ * Copyright (c) 2026, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __SIGNER_H__
+#define __SIGNER_H__
+
+/*
+ * A signer makes the list signatures for a private key named by key.  The
+ * default "file" signer reads key as a PEM private key file and signs in
+ * process.  The "unix:<path>" signer hands the work to lcp2_signd listening
+ * on the unix socket <path>, which holds the keys; key is then the name the
+ * key was loaded under there, so the private key never has to be on the
+ * machine building the lists.
+ *
+ * Both produce the same big-endian results as rsa_ssa_pss_sign() and
+ * ec_sign_data(): an RSA signature of sig_block->size bytes over a digest,
+ * or the r and s halves of an ECDSA/SM2 signature over the raw data.
+ */
+typedef struct {
+    const char *name;
+    bool (*rsa_sign)(const char *key, sized_buffer *sig_block,
+                     sized_buffer *digest, uint16_t sig_alg, uint16_t hash_alg);
+    bool (*ec_sign)(const char *key, sized_buffer *data, sized_buffer *r,
+                    sized_buffer *s, uint16_t sig_alg, uint16_t hash_alg);
+} lcp_signer_t;
+
+extern const lcp_signer_t file_signer;
+extern const lcp_signer_t socket_signer;
+
+extern bool set_signer(const char *spec);
+extern const lcp_signer_t *get_signer(void);
+extern bool signer_rsa_sign(const char *key, sized_buffer *sig_block,
+                            sized_buffer *digest, uint16_t sig_alg,
+                            uint16_t hash_alg);
+extern bool signer_ec_sign(const char *key, sized_buffer *data, sized_buffer *r,
+                           sized_buffer *s, uint16_t sig_alg, uint16_t hash_alg);
+
+/*
+ * lcp2_signd protocol
+ *
+ * A client sends a request header followed by key_name_size bytes of key
+ * name and data_size bytes of data, and gets back a response header followed
+ * by size bytes of signature (RSA) or of r then s (ECDSA/SM2, sig_size bytes
+ * each).  Requests on one connection are answered in order, so a client may
+ * write several requests before reading the first response.  Fields are in
+ * host byte order: the socket never leaves the machine.
+ */
+#define SIGND_MAGIC             0x4453434c  /* "LCSD" */
+#define SIGND_OP_RSA_SIGN       1           /* data is a digest */
+#define SIGND_OP_EC_SIGN        2           /* data is the message */
+#define SIGND_MAX_KEY_NAME      255
+#define SIGND_MAX_DATA          (16 * 1024 * 1024)
+#define SIGND_MAX_SIG           1024
+
+typedef struct __packed {
+    uint32_t magic;
+    uint8_t  op;
+    uint8_t  reserved;
+    uint16_t sig_alg;
+    uint16_t hash_alg;
+    uint16_t key_name_size;
+    uint32_t sig_size;
+    uint32_t data_size;
+} signd_request_t;
+
+typedef struct __packed {
+    uint32_t magic;
+    uint32_t status;    /* 0 on success */
+    uint32_t size;
+} signd_response_t;
+
+extern int signd_connect(const char *path);
+extern bool signd_read_full(int fd, void *buf, size_t size);
+extern bool signd_write_full(int fd, const void *buf, size_t size);
+extern bool signd_send_request(int fd, uint8_t op, const char *key,
+                               const void *data, size_t data_size,
+                               uint32_t sig_size,
+                               uint16_t sig_alg, uint16_t hash_alg);
+extern bool signd_recv_response(int fd, uint8_t *sig, size_t sig_size);
+
+#endif    /* __SIGNER_H__ */
+
+
+/*
+ * Local variables:
+ * mode: C
+ * c-set-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -49,21 +49,13 @@
 #include "polelt_plugin.h"
 #include "lcputils.h"
 
-#define MAX_HASHES       32
+#define MAX_HASHES       0xFFFF     /* num_hashes is 16 bits */
 
 static unsigned int nr_hashes;
-static tb_hash_t hashes[MAX_HASHES];
+static tb_hash_t *hashes;
 static char alg_name[32] = "sha1";
 static uint16_t alg_type = TPM_ALG_SHA1;
 
-static bool parse_stm_line(const char *line)
-{
-    if ( nr_hashes == MAX_HASHES )
-        return false;
-
-    return parse_line_hashes(line, &hashes[nr_hashes++], alg_type);
-}
-
 static bool cmdline_handler(int c, const char *opt)
 {
     if (c == 'a') {
@@ -79,7 +71,7 @@ static bool cmdline_handler(int c, const char *opt)
 
     /* MLE hash files */
     LOG("cmdline opt: mle hash file: %s\n", opt);
-    if ( !parse_file(opt, parse_stm_line) )
+    if ( !read_hashes_file(opt, alg_type, &hashes, &nr_hashes, MAX_HASHES) )
         return false;
 
     return true;
@@ -88,6 +80,7 @@ static bool cmdline_handler(int c, const char *opt)
 static lcp_policy_element_t *create(void)
 {
     LOG("[create]\n");
+    nr_hashes = sort_unique_hashes(hashes, nr_hashes);
     size_t data_size =  sizeof(lcp_stm_element_t2) +
         nr_hashes * get_hash_size(alg_type);
     lcp_policy_element_t *elt = malloc(sizeof(*elt) + data_size);
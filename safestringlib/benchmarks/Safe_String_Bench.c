@@ -0,0 +1,164 @@
+/*
+ ============================================================================
+ Name        : Safe_String_Bench.c
+ Description : Safe String memory routine benchmark
+
+ Runs memset_s, memset32_s, memcpy_s and memmove_s (overlapping)
+ at common sizes with every mem_prim kernel level the CPU supports
+ and prints bytes per cycle.  On x86 cycles are TSC ticks, which
+ are reference cycles and not core cycles when the clock is
+ scaled; elsewhere nanoseconds are used instead.  A call that
+ returns an error is reported as failed rather than timed.
+ ============================================================================
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <safe_lib.h>
+#include "mem_primitives_lib.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TICK_UNIT   "cycle"
+static inline unsigned long long ticks(void) { return __rdtsc(); }
+#else
+#define TICK_UNIT   "ns"
+static inline unsigned long long ticks(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif
+
+/* bytes moved per measurement, and best of this many measurements */
+#define BENCH_BYTES     (64U << 20)
+#define BENCH_ROUNDS    5
+
+/* odd offset into the buffers, so the kernels do their head/tail work */
+#define BENCH_SKEW      3
+
+enum bench_op { OP_MEMSET, OP_MEMSET32, OP_MEMCPY, OP_MEMMOVE, OP_COUNT };
+
+static const char *op_names[OP_COUNT] = {
+    "memset_s", "memset32_s", "memcpy_s", "memmove_s",
+};
+
+static const char *level_names[] = { "scalar", "sse2", "avx2" };
+
+static const rsize_t sizes[] = {
+    16, 64, 256, 1024, 4096, 64 * 1024, 1024 * 1024,
+};
+
+static uint8_t *dst_buf;
+static uint8_t *src_buf;
+
+static errno_t
+run_op (enum bench_op op, rsize_t size)
+{
+    uint8_t *dst = dst_buf + BENCH_SKEW;
+    uint8_t *src = src_buf + BENCH_SKEW;
+
+    switch (op) {
+    case OP_MEMSET:
+        return memset_s(dst, size, 0x5a);
+    case OP_MEMSET32:
+        /* memset32_s takes uint32_t counts, keep the byte size */
+        return memset32_s((uint32_t *)dst_buf, size / 4, 0x5a5a5a5a);
+    case OP_MEMCPY:
+        return memcpy_s(dst, size, src, size);
+    case OP_MEMMOVE:
+        /* dest one byte above src, overlapping by size - 1 bytes:
+           the backward direction */
+        return memmove_s(dst + 1, size, dst, size);
+    default:
+        return EINVAL;
+    }
+}
+
+/* best rate over the rounds, or -1 if any call was rejected */
+static double
+bench (enum bench_op op, rsize_t size)
+{
+    unsigned long iters = BENCH_BYTES / size;
+    double best = 0;
+
+    if (run_op(op, size) != EOK) {
+        return -1;
+    }
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        unsigned long long start = ticks();
+        errno_t rc = EOK;
+        double rate;
+
+        for (unsigned long i = 0; i < iters; i++) {
+            rc |= run_op(op, size);
+        }
+        rate = (double)size * iters / (double)(ticks() - start);
+        if (rc != EOK) {
+            return -1;
+        }
+        if (rate > best) {
+            best = rate;
+        }
+    }
+    return best;
+}
+
+int
+main (void)
+{
+    int max_level = mem_prim_simd_level();
+    int status = 0;
+    rsize_t max_size = sizes[sizeof(sizes)/sizeof(sizes[0]) - 1];
+
+    dst_buf = malloc(max_size + 64);
+    src_buf = malloc(max_size + 64);
+    if (dst_buf == NULL || src_buf == NULL) {
+        printf("out of memory\n");
+        return 1;
+    }
+    memset(dst_buf, 0, max_size + 64);
+    memset(src_buf, 0xa5, max_size + 64);
+
+    printf("bytes/%s, best of %d runs of %u MB, widest kernel: %s\n\n",
+           TICK_UNIT, BENCH_ROUNDS, BENCH_BYTES >> 20,
+           level_names[max_level]);
+
+    printf("%-12s %-7s", "routine", "kernel");
+    for (unsigned int s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
+        if (sizes[s] >= 1024) {
+            printf(" %7luK", (unsigned long)(sizes[s] >> 10));
+        } else {
+            printf(" %8lu", (unsigned long)sizes[s]);
+        }
+    }
+    printf("\n");
+
+    for (int op = 0; op < OP_COUNT; op++) {
+        for (int level = MEM_PRIM_SIMD_NONE; level <= max_level; level++) {
+            mem_prim_simd_select(level);
+            printf("%-12s %-7s", op_names[op], level_names[level]);
+            for (unsigned int s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
+                double rate = bench(op, sizes[s]);
+
+                if (rate < 0) {
+                    printf(" %8s", "failed");
+                    status = 1;
+                } else {
+                    printf(" %8.2f", rate);
+                }
+            }
+            printf("\n");
+        }
+    }
+
+    free(dst_buf);
+    free(src_buf);
+    return status;
+}
@@ -36,6 +36,10 @@
  * that are used by the safe_mem_library.   These routines
  * may also be used by an application, but the application
  * is responsible for all parameter validation and alignment.
+ *
+ * Lengths of at least one vector are handed to the SSE2/AVX2
+ * kernels in mem_primitives_simd.c when the CPU has them; the
+ * loops below are used for short lengths and everywhere else.
  */
 
 /**
@@ -74,6 +78,10 @@ mem_prim_set (void *dest, uint32_t len, uint8_t value)
     uint32_t *lp;
     uint32_t value32;
 
+    if (mem_prim_simd_set(dest, len, value * 0x01010101U)) {
+        return;
+    }
+
     count = len;
 
     dp = dest;
@@ -178,6 +186,10 @@ mem_prim_set (void *dest, uint32_t len, uint8_t value)
 void
 mem_prim_set16 (uint16_t *dp, uint32_t len, uint16_t value)
 {
+    if (mem_prim_simd_set(dp, (size_t)len * sizeof(uint16_t),
+                          value * 0x00010001U)) {
+        return;
+    }
 
     while (len != 0) {
 
@@ -249,6 +261,9 @@ mem_prim_set16 (uint16_t *dp, uint32_t len, uint16_t value)
 void
 mem_prim_set32 (uint32_t *dp, uint32_t len, uint32_t value)
 {
+    if (mem_prim_simd_set(dp, (size_t)len * sizeof(uint32_t), value)) {
+        return;
+    }
 
     while (len != 0) {
 
@@ -330,6 +345,10 @@ mem_prim_move (void *dest, const void *src, uint32_t len)
 
     uint32_t tsp;
 
+    if (mem_prim_simd_move(dest, src, len)) {
+        return;
+    }
+
     /*
      * Determine if we need to copy forward or backward (overlap)
      */
@@ -494,6 +513,9 @@ mem_prim_move (void *dest, const void *src, uint32_t len)
 void
 mem_prim_move8 (uint8_t *dp, const uint8_t *sp, uint32_t len)
 {
+    if (mem_prim_simd_move(dp, sp, len)) {
+        return;
+    }
 
     /*
      * Determine if we need to copy forward or backward (overlap)
@@ -625,6 +647,9 @@ mem_prim_move8 (uint8_t *dp, const uint8_t *sp, uint32_t len)
 void
 mem_prim_move16 (uint16_t *dp, const uint16_t *sp, uint32_t len)
 {
+    if (mem_prim_simd_move(dp, sp, (size_t)len * sizeof(uint16_t))) {
+        return;
+    }
 
     /*
      * Determine if we need to copy forward or backward (overlap)
@@ -755,6 +780,9 @@ mem_prim_move16 (uint16_t *dp, const uint16_t *sp, uint32_t len)
 void
 mem_prim_move32 (uint32_t *dp, const uint32_t *sp, uint32_t len)
 {
+    if (mem_prim_simd_move(dp, sp, (size_t)len * sizeof(uint32_t))) {
+        return;
+    }
 
     /*
      * Determine if we need to copy forward or backward (overlap)
@@ -71,4 +71,26 @@ extern void
 mem_prim_set32(uint32_t *dest, uint32_t dmax, uint32_t value);
 
 
+/* vector kernels (mem_primitives_simd.c) */
+#define MEM_PRIM_SIMD_NONE   0
+#define MEM_PRIM_SIMD_SSE2   1
+#define MEM_PRIM_SIMD_AVX2   2
+
+/* level in use, detected on first call */
+extern int
+mem_prim_simd_level(void);
+
+/* use at most level, returns the level in use */
+extern int
+mem_prim_simd_select(int level);
+
+/* set len bytes to the repeated 4 byte pattern, 0 if not done */
+extern int
+mem_prim_simd_set(void *dest, size_t len, uint32_t pattern);
+
+/* move len bytes (handles overlap), 0 if not done */
+extern int
+mem_prim_simd_move(void *dest, const void *src, size_t len);
+
+
 #endif  /* __MEM_PRIMITIVES_LIB_H__ */
@@ -0,0 +1,440 @@
+/*------------------------------------------------------------------
+ * mem_primitives_simd.c - Vector kernels for the memory primitives
+ *
+ * Copyright (c) 2005-2009 Cisco Systems
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *------------------------------------------------------------------
+ */
+
+#include "mem_primitives_lib.h"
+
+/*
+ * mem_primitives_simd.c provides SSE2 and AVX2 versions of the
+ * set and move loops of mem_primitives_lib.c.  The kernels are
+ * built with per-function target attributes, so the library
+ * itself is still compiled for the baseline ISA, and the widest
+ * one the running CPU supports is picked the first time a
+ * primitive is called.  Everything else (parameter checking,
+ * constraint handlers) stays with the callers, the kernels only
+ * replace the inner loops.
+ */
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && \
+    !defined(__KERNEL__)
+#define MEM_PRIM_HAVE_SIMD
+#include <immintrin.h>
+#endif
+
+#ifdef MEM_PRIM_HAVE_SIMD
+
+#define SIMD_TARGET_SSE2   __attribute__((target("sse2")))
+#define SIMD_TARGET_AVX2   __attribute__((target("avx2")))
+
+/* -1 until the first call has asked the CPU */
+static int simd_level = -1;
+
+static int
+simd_detect (void)
+{
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        return MEM_PRIM_SIMD_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return MEM_PRIM_SIMD_SSE2;
+    }
+    return MEM_PRIM_SIMD_NONE;
+}
+
+
+/*
+ * The set kernels store a 4 byte pattern (the byte, uint16_t or
+ * uint32_t value replicated).  A store at byte offset k from dest
+ * has to start with pattern byte k % 4, hence the rotation.
+ */
+static inline uint32_t
+pattern_at (uint32_t pattern, uintptr_t offset)
+{
+    unsigned int shift = (offset & 3) * 8;
+
+    return shift ? (pattern >> shift) | (pattern << (32 - shift)) : pattern;
+}
+
+
+static void SIMD_TARGET_SSE2
+set_sse2 (uint8_t *dp, size_t len, uint32_t pattern)
+{
+    uint8_t *end = dp + len;
+    uint8_t *ap;
+    __m128i v;
+
+    /* unaligned head and tail, aligned stores in between */
+    _mm_storeu_si128((__m128i *)dp, _mm_set1_epi32((int)pattern));
+    _mm_storeu_si128((__m128i *)(end - 16),
+        _mm_set1_epi32((int)pattern_at(pattern, len - 16)));
+
+    ap = (uint8_t *)(((uintptr_t)dp + 16) & ~(uintptr_t)15);
+    v = _mm_set1_epi32((int)pattern_at(pattern, ap - dp));
+
+    for (; ap + 64 <= end; ap += 64) {
+        _mm_store_si128((__m128i *)ap, v);
+        _mm_store_si128((__m128i *)(ap + 16), v);
+        _mm_store_si128((__m128i *)(ap + 32), v);
+        _mm_store_si128((__m128i *)(ap + 48), v);
+    }
+    for (; ap + 16 <= end; ap += 16) {
+        _mm_store_si128((__m128i *)ap, v);
+    }
+}
+
+
+static void SIMD_TARGET_AVX2
+set_avx2 (uint8_t *dp, size_t len, uint32_t pattern)
+{
+    uint8_t *end = dp + len;
+    uint8_t *ap;
+    __m256i v;
+
+    _mm256_storeu_si256((__m256i *)dp, _mm256_set1_epi32((int)pattern));
+    _mm256_storeu_si256((__m256i *)(end - 32),
+        _mm256_set1_epi32((int)pattern_at(pattern, len - 32)));
+
+    ap = (uint8_t *)(((uintptr_t)dp + 32) & ~(uintptr_t)31);
+    v = _mm256_set1_epi32((int)pattern_at(pattern, ap - dp));
+
+    for (; ap + 128 <= end; ap += 128) {
+        _mm256_store_si256((__m256i *)ap, v);
+        _mm256_store_si256((__m256i *)(ap + 32), v);
+        _mm256_store_si256((__m256i *)(ap + 64), v);
+        _mm256_store_si256((__m256i *)(ap + 96), v);
+    }
+    for (; ap + 32 <= end; ap += 32) {
+        _mm256_store_si256((__m256i *)ap, v);
+    }
+    _mm256_zeroupper();
+}
+
+
+/*
+ * Moves.  Disjoint buffers get aligned destination stores with
+ * unaligned head and tail vectors, both loaded before anything
+ * is written.  Overlapping buffers are walked in the same
+ * direction as the scalar code (forward if dp < sp, backward
+ * otherwise), every block being loaded in full before it is
+ * stored, with the last few bytes done one at a time.
+ */
+static inline int
+overlaps (const uint8_t *dp, const uint8_t *sp, size_t len)
+{
+    return (dp < sp + len) && (sp < dp + len);
+}
+
+
+static void SIMD_TARGET_SSE2
+move_sse2 (uint8_t *dp, const uint8_t *sp, size_t len)
+{
+    if (!overlaps(dp, sp, len)) {
+        __m128i head = _mm_loadu_si128((const __m128i *)sp);
+        __m128i tail = _mm_loadu_si128((const __m128i *)(sp + len - 16));
+        size_t skew = 16 - ((uintptr_t)dp & 15);
+        uint8_t *end = dp + len - 16;
+
+        _mm_storeu_si128((__m128i *)dp, head);
+        for (dp += skew, sp += skew; dp + 64 <= end; dp += 64, sp += 64) {
+            __m128i a = _mm_loadu_si128((const __m128i *)sp);
+            __m128i b = _mm_loadu_si128((const __m128i *)(sp + 16));
+            __m128i c = _mm_loadu_si128((const __m128i *)(sp + 32));
+            __m128i d = _mm_loadu_si128((const __m128i *)(sp + 48));
+            _mm_store_si128((__m128i *)dp, a);
+            _mm_store_si128((__m128i *)(dp + 16), b);
+            _mm_store_si128((__m128i *)(dp + 32), c);
+            _mm_store_si128((__m128i *)(dp + 48), d);
+        }
+        for (; dp < end; dp += 16, sp += 16) {
+            _mm_store_si128((__m128i *)dp,
+                            _mm_loadu_si128((const __m128i *)sp));
+        }
+        _mm_storeu_si128((__m128i *)end, tail);
+
+    } else if (dp < sp) {
+        for (; len >= 64; len -= 64, dp += 64, sp += 64) {
+            __m128i a = _mm_loadu_si128((const __m128i *)sp);
+            __m128i b = _mm_loadu_si128((const __m128i *)(sp + 16));
+            __m128i c = _mm_loadu_si128((const __m128i *)(sp + 32));
+            __m128i d = _mm_loadu_si128((const __m128i *)(sp + 48));
+            _mm_storeu_si128((__m128i *)dp, a);
+            _mm_storeu_si128((__m128i *)(dp + 16), b);
+            _mm_storeu_si128((__m128i *)(dp + 32), c);
+            _mm_storeu_si128((__m128i *)(dp + 48), d);
+        }
+        for (; len >= 16; len -= 16, dp += 16, sp += 16) {
+            _mm_storeu_si128((__m128i *)dp,
+                             _mm_loadu_si128((const __m128i *)sp));
+        }
+        while (len--) {
+            *dp++ = *sp++;
+        }
+
+    } else {
+        dp += len;
+        sp += len;
+        for (; len >= 64; len -= 64) {
+            __m128i a, b, c, d;
+            dp -= 64;
+            sp -= 64;
+            a = _mm_loadu_si128((const __m128i *)sp);
+            b = _mm_loadu_si128((const __m128i *)(sp + 16));
+            c = _mm_loadu_si128((const __m128i *)(sp + 32));
+            d = _mm_loadu_si128((const __m128i *)(sp + 48));
+            _mm_storeu_si128((__m128i *)dp, a);
+            _mm_storeu_si128((__m128i *)(dp + 16), b);
+            _mm_storeu_si128((__m128i *)(dp + 32), c);
+            _mm_storeu_si128((__m128i *)(dp + 48), d);
+        }
+        for (; len >= 16; len -= 16) {
+            dp -= 16;
+            sp -= 16;
+            _mm_storeu_si128((__m128i *)dp,
+                             _mm_loadu_si128((const __m128i *)sp));
+        }
+        while (len--) {
+            *--dp = *--sp;
+        }
+    }
+}
+
+
+static void SIMD_TARGET_AVX2
+move_avx2 (uint8_t *dp, const uint8_t *sp, size_t len)
+{
+    if (!overlaps(dp, sp, len)) {
+        __m256i head = _mm256_loadu_si256((const __m256i *)sp);
+        __m256i tail = _mm256_loadu_si256((const __m256i *)(sp + len - 32));
+        size_t skew = 32 - ((uintptr_t)dp & 31);
+        uint8_t *end = dp + len - 32;
+
+        _mm256_storeu_si256((__m256i *)dp, head);
+        for (dp += skew, sp += skew; dp + 128 <= end; dp += 128, sp += 128) {
+            __m256i a = _mm256_loadu_si256((const __m256i *)sp);
+            __m256i b = _mm256_loadu_si256((const __m256i *)(sp + 32));
+            __m256i c = _mm256_loadu_si256((const __m256i *)(sp + 64));
+            __m256i d = _mm256_loadu_si256((const __m256i *)(sp + 96));
+            _mm256_store_si256((__m256i *)dp, a);
+            _mm256_store_si256((__m256i *)(dp + 32), b);
+            _mm256_store_si256((__m256i *)(dp + 64), c);
+            _mm256_store_si256((__m256i *)(dp + 96), d);
+        }
+        for (; dp < end; dp += 32, sp += 32) {
+            _mm256_store_si256((__m256i *)dp,
+                               _mm256_loadu_si256((const __m256i *)sp));
+        }
+        _mm256_storeu_si256((__m256i *)end, tail);
+
+    } else if (dp < sp) {
+        for (; len >= 128; len -= 128, dp += 128, sp += 128) {
+            __m256i a = _mm256_loadu_si256((const __m256i *)sp);
+            __m256i b = _mm256_loadu_si256((const __m256i *)(sp + 32));
+            __m256i c = _mm256_loadu_si256((const __m256i *)(sp + 64));
+            __m256i d = _mm256_loadu_si256((const __m256i *)(sp + 96));
+            _mm256_storeu_si256((__m256i *)dp, a);
+            _mm256_storeu_si256((__m256i *)(dp + 32), b);
+            _mm256_storeu_si256((__m256i *)(dp + 64), c);
+            _mm256_storeu_si256((__m256i *)(dp + 96), d);
+        }
+        for (; len >= 32; len -= 32, dp += 32, sp += 32) {
+            _mm256_storeu_si256((__m256i *)dp,
+                                _mm256_loadu_si256((const __m256i *)sp));
+        }
+        while (len--) {
+            *dp++ = *sp++;
+        }
+
+    } else {
+        dp += len;
+        sp += len;
+        for (; len >= 128; len -= 128) {
+            __m256i a, b, c, d;
+            dp -= 128;
+            sp -= 128;
+            a = _mm256_loadu_si256((const __m256i *)sp);
+            b = _mm256_loadu_si256((const __m256i *)(sp + 32));
+            c = _mm256_loadu_si256((const __m256i *)(sp + 64));
+            d = _mm256_loadu_si256((const __m256i *)(sp + 96));
+            _mm256_storeu_si256((__m256i *)dp, a);
+            _mm256_storeu_si256((__m256i *)(dp + 32), b);
+            _mm256_storeu_si256((__m256i *)(dp + 64), c);
+            _mm256_storeu_si256((__m256i *)(dp + 96), d);
+        }
+        for (; len >= 32; len -= 32) {
+            dp -= 32;
+            sp -= 32;
+            _mm256_storeu_si256((__m256i *)dp,
+                                _mm256_loadu_si256((const __m256i *)sp));
+        }
+        while (len--) {
+            *--dp = *--sp;
+        }
+    }
+    _mm256_zeroupper();
+}
+
+#endif  /* MEM_PRIM_HAVE_SIMD */
+
+
+/**
+ * NAME
+ *    mem_prim_simd_level - Vector kernels used by the primitives
+ *
+ * SYNOPSIS
+ *    #include "mem_primitives_lib.h"
+ *    int
+ *    mem_prim_simd_level(void)
+ *
+ * DESCRIPTION
+ *    Returns the widest instruction set the running CPU supports,
+ *    or the level set by mem_prim_simd_select().  The CPU is only
+ *    queried on the first call.
+ *
+ * RETURN VALUE
+ *    MEM_PRIM_SIMD_NONE, MEM_PRIM_SIMD_SSE2 or MEM_PRIM_SIMD_AVX2
+ *
+ */
+int
+mem_prim_simd_level (void)
+{
+#ifdef MEM_PRIM_HAVE_SIMD
+    int level = __atomic_load_n(&simd_level, __ATOMIC_RELAXED);
+
+    /* racing first callers all store the same value */
+    if (level < 0) {
+        level = simd_detect();
+        __atomic_store_n(&simd_level, level, __ATOMIC_RELAXED);
+    }
+    return level;
+#else
+    return MEM_PRIM_SIMD_NONE;
+#endif
+}
+
+
+/**
+ * NAME
+ *    mem_prim_simd_select - Restrict the vector kernels
+ *
+ * SYNOPSIS
+ *    #include "mem_primitives_lib.h"
+ *    int
+ *    mem_prim_simd_select(int level)
+ *
+ * DESCRIPTION
+ *    Makes the primitives use at most the given level, e.g.
+ *    MEM_PRIM_SIMD_NONE for the scalar loops.  Levels the CPU
+ *    does not support are lowered to the widest one it does.
+ *    Meant for benchmarks and tests, not for use while other
+ *    threads are calling the primitives.
+ *
+ * RETURN VALUE
+ *    the level now in use
+ *
+ */
+int
+mem_prim_simd_select (int level)
+{
+#ifdef MEM_PRIM_HAVE_SIMD
+    int max = simd_detect();
+
+    if (level < MEM_PRIM_SIMD_NONE || level > max) {
+        level = max;
+    }
+    __atomic_store_n(&simd_level, level, __ATOMIC_RELAXED);
+    return level;
+#else
+    (void)level;
+    return MEM_PRIM_SIMD_NONE;
+#endif
+}
+
+
+/*
+ * mem_prim_simd_set and mem_prim_simd_move are called by the
+ * primitives with lengths in bytes.  They return 0 without
+ * touching memory when the length is below one vector or no
+ * vector kernel is available, and the caller falls back to its
+ * scalar loop.
+ */
+int
+mem_prim_simd_set (void *dest, size_t len, uint32_t pattern)
+{
+#ifdef MEM_PRIM_HAVE_SIMD
+    if (len >= 16) {
+        switch (mem_prim_simd_level()) {
+        case MEM_PRIM_SIMD_AVX2:
+            if (len >= 32) {
+                set_avx2(dest, len, pattern);
+                return 1;
+            }
+            /* fall through */
+        case MEM_PRIM_SIMD_SSE2:
+            set_sse2(dest, len, pattern);
+            return 1;
+        default:
+            break;
+        }
+    }
+#else
+    (void)dest;
+    (void)len;
+    (void)pattern;
+#endif
+    return 0;
+}
+
+
+int
+mem_prim_simd_move (void *dest, const void *src, size_t len)
+{
+#ifdef MEM_PRIM_HAVE_SIMD
+    if (len >= 16) {
+        switch (mem_prim_simd_level()) {
+        case MEM_PRIM_SIMD_AVX2:
+            if (len >= 32) {
+                move_avx2(dest, src, len);
+                return 1;
+            }
+            /* fall through */
+        case MEM_PRIM_SIMD_SSE2:
+            move_sse2(dest, src, len);
+            return 1;
+        default:
+            break;
+        }
+    }
+#else
+    (void)dest;
+    (void)src;
+    (void)len;
+#endif
+    return 0;
+}
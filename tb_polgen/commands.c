@@ -38,8 +38,12 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <zlib.h>
-#include <openssl/evp.h>
 #include <safe_lib.h>
 #define PRINT   printf
 #include "../include/config.h"
@@ -52,74 +56,124 @@
 
 extern tb_policy_t *g_policy;
 
-static bool hash_file(const char *filename, bool unzip, tb_hash_t *hash, uint16_t hash_alg)
+/*
+ * image hashing
+ *
+ * files are hashed for every requested algorithm in a single pass: plain
+ * (or not to be unzipped) files are mmap()ed and digested in place, gzip'ed
+ * ones are inflated through a large window; either way each window is fed
+ * to all the digests while it is still in cache
+ */
+
+#define HASH_WINDOW_SIZE    (1 << 20)
+
+static bool hash_mapped_file(int fd, size_t size, hash_multi_ctx_t *mctx)
 {
-    FILE *f;
-    static char buf[1024];
-    int read_cnt;
+    uint8_t *map;
+    bool ret;
 
-    if ( unzip )
-        f = (FILE *)gzopen(filename, "rb");
-    else
-        f = fopen(filename, "rb");
+    if ( size == 0 )
+        return true;
 
-    if ( f == NULL ) {
-        error_msg("File %s does not exist\n", filename);
+    map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if ( map == MAP_FAILED )
         return false;
-    }
+    madvise(map, size, MADV_SEQUENTIAL);
 
-    const EVP_MD *md;
-    uint8_t* hash_out;
-    EVP_MD_CTX *ctx = EVP_MD_CTX_create();
-
-     switch (hash_alg) {
-        case TB_HALG_SHA1:
-            md = EVP_sha1();
-            hash_out = hash->sha1;
-            break;
-        case TB_HALG_SHA256:
-            md = EVP_sha256();
-            hash_out = hash->sha256;
-            break;
-        case TB_HALG_SHA384:
-            md = EVP_sha384();
-            hash_out = hash->sha384;
-            break;
-        case TB_HALG_SHA512:
-            md = EVP_sha512();
-            hash_out = hash->sha512;
-            break;
-        default:
-            error_msg("unsupported hash alg (%d)\n", hash_alg);
-            EVP_MD_CTX_destroy(ctx);
-            if ( unzip ) {
-                gzclose((gzFile)f);
-            } else {
-                fclose(f);
-            }
+    /* a half-fed context can't fall back to streaming */
+    ret = hash_multi_update(mctx, map, size);
+    if ( !ret )
+        hash_multi_abort(mctx);
+
+    munmap(map, size);
+    return ret;
+}
+
+static bool hash_streamed_file(int fd, bool unzip, hash_multi_ctx_t *mctx)
+{
+    gzFile f = NULL;
+    uint8_t *buf;
+    ssize_t read_cnt;
+
+    buf = malloc(HASH_WINDOW_SIZE);
+    if ( buf == NULL )
+        return false;
+
+    if ( unzip ) {
+        /* gzclose() closes the fd it was given, the caller closes ours */
+        int gz_fd = dup(fd);
+
+        if ( gz_fd < 0 || (f = gzdopen(gz_fd, "rb")) == NULL ) {
+            if ( gz_fd >= 0 )
+                close(gz_fd);
+            free(buf);
             return false;
+        }
+        gzbuffer(f, HASH_WINDOW_SIZE);
     }
 
-    EVP_DigestInit(ctx, md);
     do {
         if ( unzip )
-            read_cnt = gzread((gzFile)f, buf, sizeof(buf));
+            read_cnt = gzread(f, buf, HASH_WINDOW_SIZE);
         else
-            read_cnt = fread(buf, 1, sizeof(buf), f);
-        if ( read_cnt == 0 )
-            break;
-
-        EVP_DigestUpdate(ctx, buf, read_cnt);
-    } while ( true );
-    EVP_DigestFinal(ctx, hash_out, NULL);
+            read_cnt = read(fd, buf, HASH_WINDOW_SIZE);
+        if ( read_cnt > 0 && !hash_multi_update(mctx, buf, read_cnt) )
+            read_cnt = -1;
+    } while ( read_cnt > 0 );
 
     if ( unzip )
-        gzclose((gzFile)f);
+        gzclose(f);
+    free(buf);
+    return read_cnt == 0;
+}
+
+/* hashes[i] is the digest of the (unzipped) file for algs[i] */
+bool hash_file(const char *filename, bool unzip, const uint16_t *algs,
+               unsigned int num_algs, tb_hash_t *hashes)
+{
+    hash_multi_ctx_t mctx;
+    uint8_t magic[2];
+    struct stat st;
+    bool ret = false;
+    int fd;
+
+    if ( num_algs == 0 || num_algs > MAX_FILE_HASHES )
+        return false;
+
+    fd = open(filename, O_RDONLY);
+    if ( fd < 0 ) {
+        error_msg("File %s does not exist\n", filename);
+        return false;
+    }
+
+    if ( !hash_multi_init(&mctx, algs, num_algs) ) {
+        error_msg("unsupported hash alg\n");
+        close(fd);
+        return false;
+    }
+
+    /*
+     * gzread() passes non-gzip'ed files through, so only gzip needs zlib;
+     * when the magic can't be peeked at (pread() fails with ESPIPE on a
+     * pipe or FIFO) leave it to gzread() to tell
+     */
+    if ( unzip && pread(fd, magic, sizeof(magic), 0) == sizeof(magic) )
+        unzip = magic[0] == 0x1f && magic[1] == 0x8b;
+
+    if ( !unzip && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+         (off_t)(size_t)st.st_size == st.st_size )
+        ret = hash_mapped_file(fd, st.st_size, &mctx);
+    if ( !ret )
+        ret = hash_streamed_file(fd, unzip, &mctx);
+    if ( !ret ) {
+        error_msg("Error reading %s\n", filename);
+        hash_multi_abort(&mctx);
+    }
     else
-        fclose(f);
-    
-    EVP_MD_CTX_destroy(ctx);
-    return true;
+        ret = hash_multi_final(&mctx, hashes);
+
+    close(fd);
+    return ret;
 }
 
 bool do_show(const param_data_t *params)
@@ -172,15 +226,24 @@ bool do_create(const param_data_t *params)
     return true;
 }
 
-bool do_add(const param_data_t *params)
-{
-    /* read the policy file, if it exists */
-    info_msg("reading existing policy file %s...\n", params->policy_file);
-    if ( !read_policy_file(params->policy_file, NULL) ) {
-        error_msg("Error reading policy file %s\n", params->policy_file);
-        return false;
-    }
+static const struct {
+    int          bank;
+    uint16_t     alg;
+    const char   *name;
+} add_banks[] = {
+    { POLGEN_BANK_SHA1,   TB_HALG_SHA1,   "sha1" },
+    { POLGEN_BANK_SHA256, TB_HALG_SHA256, "sha256" },
+    { POLGEN_BANK_SHA384, TB_HALG_SHA384, "sha384" },
+    { POLGEN_BANK_SHA512, TB_HALG_SHA512, "sha512" },
+};
 
+/*
+ * add (or update) the entry for one module; the image is hashed for the
+ * policy's algorithm and any --bank ones in the same pass, and the latter
+ * are only printed ("<num> <alg> <hex>") for use in other policies
+ */
+static bool add_module(const param_data_t *params)
+{
     /* see if there is already an entry for this module */
     tb_policy_entry_t *pol_entry = find_policy_entry(g_policy,
                                                      params->mod_num);
@@ -197,44 +260,137 @@ bool do_add(const param_data_t *params)
     else
         modify_pol_entry(pol_entry, params->pcr, params->hash_type);
 
-    /* hash command line and files */
-    if ( params->hash_type == TB_HTYPE_IMAGE ) {
-        tb_hash_t final_hash, hash;
-
-        /* hash command line */
-        info_msg("hashing command line \"%s\"...\n", params->cmdline);
-        hash_buffer((unsigned char *)params->cmdline,
-                    strnlen_s(params->cmdline, sizeof(params->cmdline)),
-                    &final_hash, g_policy->hash_alg);
-        if ( verbose ) {
-            info_msg("hash is...");
-            print_hash(&final_hash, g_policy->hash_alg);
-        }
+    if ( params->hash_type != TB_HTYPE_IMAGE )
+        return true;
+
+    /* the policy's algorithm goes first */
+    uint16_t algs[MAX_FILE_HASHES] = { g_policy->hash_alg };
+    tb_hash_t final_hashes[MAX_FILE_HASHES], hashes[MAX_FILE_HASHES];
+    unsigned int num_algs = 1;
 
-        /* hash file */
-        info_msg("hashing image file %s...\n", params->image_file);
-	if ( !hash_file(params->image_file, true, &hash, g_policy->hash_alg) ) {
+    for ( unsigned int i = 0; i < ARRAY_SIZE(add_banks); i++ ) {
+        if ( (params->banks & add_banks[i].bank) &&
+             add_banks[i].alg != g_policy->hash_alg )
+            algs[num_algs++] = add_banks[i].alg;
+    }
+
+    /* hash command line */
+    info_msg("hashing command line \"%s\"...\n", params->cmdline);
+    for ( unsigned int i = 0; i < num_algs; i++ ) {
+        if ( !hash_buffer((unsigned char *)params->cmdline,
+                          strnlen_s(params->cmdline, sizeof(params->cmdline)),
+                          &final_hashes[i], algs[i]) )
             return false;
-	}
-        if ( verbose ) {
-            info_msg("hash is...");
-            print_hash(&hash, g_policy->hash_alg);
-        }
+    }
+    if ( verbose ) {
+        info_msg("hash is...");
+        print_hash(&final_hashes[0], g_policy->hash_alg);
+    }
+
+    /* hash file */
+    info_msg("hashing image file %s...\n", params->image_file);
+    if ( !hash_file(params->image_file, true, algs, num_algs, hashes) )
+        return false;
+    if ( verbose ) {
+        info_msg("hash is...");
+        print_hash(&hashes[0], g_policy->hash_alg);
+    }
 
-        if ( !extend_hash(&final_hash, &hash, g_policy->hash_alg) ){
+    for ( unsigned int i = 0; i < num_algs; i++ ) {
+        if ( !extend_hash(&final_hashes[i], &hashes[i], algs[i]) )
             return false;
-	}
+    }
 
-        if ( verbose ) {
-            info_msg("cumulative hash is...");
-            print_hash(&final_hash, g_policy->hash_alg);
+    if ( verbose ) {
+        info_msg("cumulative hash is...");
+        print_hash(&final_hashes[0], g_policy->hash_alg);
+    }
+
+    if ( !add_hash(pol_entry, &final_hashes[0]) ) {
+        error_msg("cannot add another hash\n");
+        return false;
+    }
+
+    for ( unsigned int i = 0; i < ARRAY_SIZE(add_banks); i++ ) {
+        unsigned int j = 0;
+
+        if ( !(params->banks & add_banks[i].bank) )
+            continue;
+        while ( algs[j] != add_banks[i].alg )
+            j++;
+        printf("%d %s ", params->mod_num, add_banks[i].name);
+        for ( unsigned int k = 0; k < get_hash_size(algs[j]); k++ )
+            printf("%02x", final_hashes[j].sha512[k]);
+        printf("\n");
+    }
+    return true;
+}
+
+/*
+ * a batch file has one module per line, "<num> <pcr> <hash> [<image>
+ * [<command line>]]", with the same values as --num, --pcr, --hash, --image
+ * and --cmdline; '#' starts a comment line
+ */
+static bool add_batch(const param_data_t *params)
+{
+    char *line = malloc(MAX_BATCH_LINE_SIZE);
+    param_data_t *entry = malloc(sizeof(*entry));
+    unsigned int line_num = 0;
+    bool ret = true;
+    FILE *f;
+
+    if ( line == NULL || entry == NULL ) {
+        free(line);
+        free(entry);
+        return false;
+    }
+    f = fopen(params->batch_file, "r");
+    if ( f == NULL ) {
+        error_msg("fopen %s failed, errno %s\n", params->batch_file,
+                  strerror(errno));
+        free(line);
+        free(entry);
+        return false;
+    }
+
+    while ( ret && fgets(line, MAX_BATCH_LINE_SIZE, f) != NULL ) {
+        char *p = line + strspn(line, " \t");
+
+        line_num++;
+        p[strcspn(p, "\r\n")] = '\0';
+        if ( *p == '\0' || *p == '#' )
+            continue;
+
+        *entry = *params;
+        if ( !parse_batch_line(p, entry) ) {
+            error_msg("%s:%u: invalid line\n", params->batch_file, line_num);
+            ret = false;
         }
+        else
+            ret = add_module(entry);
+    }
 
-        if ( !add_hash(pol_entry, &final_hash) ) {
-            error_msg("cannot add another hash\n");
+    fclose(f);
+    free(line);
+    free(entry);
+    return ret;
+}
+
+bool do_add(const param_data_t *params)
+{
+    /* read the policy file, if it exists */
+    info_msg("reading existing policy file %s...\n", params->policy_file);
+    if ( !read_policy_file(params->policy_file, NULL) ) {
+        error_msg("Error reading policy file %s\n", params->policy_file);
+        return false;
+    }
+
+    if ( params->batch_file[0] != '\0' ) {
+        if ( !add_batch(params) )
             return false;
-        }
     }
+    else if ( !add_module(params) )
+        return false;
 
     info_msg("writing new policy file...\n");
     if ( !write_policy_file(params->policy_file) )
@@ -262,12 +418,13 @@ bool do_del(const param_data_t *params)
 
     /* if pos was specified, find it */
     if ( params->pos != -1 ) {
-        if ( params->pos >= pol_entry->num_hashes ) {
+        int num_hashes = get_num_hashes_in_set(pol_entry);
+        if ( params->pos >= num_hashes ) {
             error_msg("specified pos does not exist\n");
             return false;
         }
         /* if entry only has 1 hash, then delete the entire entry */
-        if ( pol_entry->num_hashes == 1 ) {
+        if ( num_hashes == 1 ) {
             if ( !del_entry(pol_entry) ) {
                 error_msg("failed to delete entry\n");
                 return false;
@@ -326,7 +483,7 @@ bool do_unwrap(const param_data_t *params)
     lcp_custom_element_t *custom = (lcp_custom_element_t *)&elt->data;
     tb_policy_t *pol = (tb_policy_t *)&custom->data;
 
-    memcpy_s(g_policy, MAX_TB_POLICY_SIZE, pol, calc_policy_size(pol));
+    memcpy_s(g_policy, MAX_TB_POLICY_EXT_SIZE, pol, calc_policy_size(pol));
 
     info_msg("writing/overwriting policy file...\n");
     if ( !write_policy_file(params->policy_file) )
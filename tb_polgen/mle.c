@@ -0,0 +1,253 @@
+/*
+ * mle.c: measurement of the tboot MLE, as SINIT computes it
+ *
+ * Copyright (c) 2020, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <zlib.h>
+#include <safe_lib.h>
+#define PRINT   printf
+#include "../include/config.h"
+#include "../include/hash.h"
+#include "../include/uuid.h"
+#include "../include/elf_defns.h"
+#include "../include/mle.h"
+#include "../include/tb_policy.h"
+#include "tb_polgen.h"
+
+/*
+ * this follows lcp2_mlehash: the PT_LOAD segments of tboot's ELF image are
+ * laid out back to back (each followed by its zero fill), the command line
+ * area of the MLE header is replaced by the command line given to tboot, and
+ * [mle_start_off, mle_end_off) of that is hashed
+ */
+
+#define READ_WINDOW_SIZE    (1 << 20)
+
+/* read the whole (unzipped) file; gzread() passes plain files through */
+static void *read_image(const char *filename, size_t *size)
+{
+    size_t buf_size = 0;
+    uint8_t *buf = NULL;
+    gzFile f;
+    int read_cnt;
+
+    *size = 0;
+    f = gzopen(filename, "rb");
+    if ( f == NULL ) {
+        error_msg("File %s does not exist\n", filename);
+        return NULL;
+    }
+
+    do {
+        if ( *size == buf_size ) {
+            uint8_t *new_buf = realloc(buf, buf_size + READ_WINDOW_SIZE);
+
+            if ( new_buf == NULL ) {
+                read_cnt = -1;
+                break;
+            }
+            buf = new_buf;
+            buf_size += READ_WINDOW_SIZE;
+        }
+        read_cnt = gzread(f, buf + *size, buf_size - *size);
+        if ( read_cnt > 0 )
+            *size += read_cnt;
+    } while ( read_cnt > 0 );
+    gzclose(f);
+
+    if ( read_cnt < 0 || *size == 0 ) {
+        error_msg("Error reading %s\n", filename);
+        free(buf);
+        return NULL;
+    }
+    return buf;
+}
+
+static const elf_program_header_t *get_phdr(const elf_header_t *elf, int i)
+{
+    return (const elf_program_header_t *)
+        ((const uint8_t *)elf + elf->e_phoff + i*elf->e_phentsize);
+}
+
+static bool is_elf_image(const void *image, size_t size)
+{
+    const elf_header_t *elf = image;
+
+    if ( size < sizeof(*elf) ||
+         elf->e_ident[EI_MAG0] != ELFMAG0 || elf->e_ident[EI_MAG1] != ELFMAG1 ||
+         elf->e_ident[EI_MAG2] != ELFMAG2 || elf->e_ident[EI_MAG3] != ELFMAG3 ||
+         elf->e_ident[EI_DATA] != ELFDATA2LSB || elf->e_type != ET_EXEC ||
+         elf->e_machine != EM_386 || elf->e_version != EV_CURRENT ||
+         elf->e_phentsize < sizeof(elf_program_header_t) )
+        return false;
+
+    /* program headers and segment data must be within the file */
+    if ( elf->e_phoff > size ||
+         (size_t)elf->e_phnum * elf->e_phentsize > size - elf->e_phoff )
+        return false;
+    for ( int i = 0; i < elf->e_phnum; i++ ) {
+        const elf_program_header_t *ph = get_phdr(elf, i);
+
+        if ( ph->p_type == PT_LOAD &&
+             (ph->p_filesz > ph->p_memsz || ph->p_offset > size ||
+              ph->p_filesz > size - ph->p_offset) )
+            return false;
+    }
+    return true;
+}
+
+static uint8_t *expand_image(const elf_header_t *elf, size_t *exp_size)
+{
+    unsigned long end = 0;
+    uint8_t *exp, *p;
+
+    /* the range starts at 0, as get_elf_image_range() in lcp2_mlehash */
+    for ( int i = 0; i < elf->e_phnum; i++ ) {
+        const elf_program_header_t *ph = get_phdr(elf, i);
+
+        if ( ph->p_type == PT_LOAD && end < ph->p_paddr + ph->p_memsz )
+            end = ph->p_paddr + ph->p_memsz;
+    }
+    if ( end == 0 )
+        return NULL;
+
+    *exp_size = end;
+    exp = calloc(1, *exp_size);
+    if ( exp == NULL )
+        return NULL;
+
+    p = exp;
+    for ( int i = 0; i < elf->e_phnum; i++ ) {
+        const elf_program_header_t *ph = get_phdr(elf, i);
+
+        if ( ph->p_type != PT_LOAD )
+            continue;
+        if ( ph->p_memsz > *exp_size - (size_t)(p - exp) ) {
+            free(exp);
+            return NULL;
+        }
+        memcpy_s(p, *exp_size - (p - exp), (const uint8_t *)elf + ph->p_offset,
+                 ph->p_filesz);
+        p += ph->p_memsz;
+    }
+    return exp;
+}
+
+static const mle_hdr_t *find_mle_hdr(const uint8_t *exp, size_t exp_size)
+{
+    for ( size_t off = 0; off + sizeof(mle_hdr_t) <= exp_size;
+          off += sizeof(uuid_t) ) {
+        if ( are_uuids_equal((const uuid_t *)(exp + off),
+                             &((uuid_t)MLE_HDR_UUID)) )
+            return (const mle_hdr_t *)(exp + off);
+    }
+    return NULL;
+}
+
+/* hashes[i] is the MLE measurement of tboot for algs[i] */
+bool hash_mle_file(const char *filename, const char *cmdline,
+                   const uint16_t *algs, unsigned int num_algs,
+                   tb_hash_t *hashes)
+{
+    hash_multi_ctx_t mctx;
+    const mle_hdr_t *mle_hdr;
+    uint8_t *image, *exp = NULL;
+    size_t size, exp_size;
+    bool ret = false;
+
+    image = read_image(filename, &size);
+    if ( image == NULL )
+        return false;
+
+    if ( !is_elf_image(image, size) ||
+         (exp = expand_image((const elf_header_t *)image, &exp_size)) == NULL ) {
+        error_msg("%s is not a valid tboot ELF image\n", filename);
+        goto out;
+    }
+
+    mle_hdr = find_mle_hdr(exp, exp_size);
+    if ( mle_hdr == NULL || mle_hdr->mle_start_off > mle_hdr->mle_end_off ||
+         mle_hdr->mle_end_off > exp_size ||
+         mle_hdr->cmdline_start_off > mle_hdr->cmdline_end_off ||
+         mle_hdr->cmdline_end_off > exp_size ) {
+        error_msg("%s has no valid MLE header\n", filename);
+        goto out;
+    }
+
+    if ( mle_hdr->cmdline_end_off > mle_hdr->cmdline_start_off &&
+         cmdline != NULL ) {
+        size_t cmdline_size = mle_hdr->cmdline_end_off -
+                              mle_hdr->cmdline_start_off;
+        uint8_t *area = exp + mle_hdr->cmdline_start_off;
+
+        if ( strnlen_s(cmdline, cmdline_size) >= cmdline_size ) {
+            error_msg("tboot command line is too long\n");
+            goto out;
+        }
+        memset_s(area, cmdline_size, 0);
+        strcpy_s((char *)area, cmdline_size, cmdline);
+    }
+
+    if ( !hash_multi_init(&mctx, algs, num_algs) ) {
+        error_msg("unsupported hash alg\n");
+        goto out;
+    }
+    if ( !hash_multi_update(&mctx, exp + mle_hdr->mle_start_off,
+                            mle_hdr->mle_end_off - mle_hdr->mle_start_off) ) {
+        hash_multi_abort(&mctx);
+        goto out;
+    }
+    ret = hash_multi_final(&mctx, hashes);
+
+out:
+    free(exp);
+    free(image);
+    return ret;
+}
+
+
+/*
+ * Local variables:
+ * mode: C
+ * c-set-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
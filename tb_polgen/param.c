@@ -60,6 +60,11 @@ static const char *help[] = {
     "                   --hash        any|image\n",
     "                   [--cmdline    \"command line\"]\n",
     "                   [--image      <image file name>]\n",
+    "                   [--bank       sha1|sha256|sha384|sha512]...\n",
+    "                   [--verbose]\n",
+    "                   <policy file name>\n",
+    "tb_polgen --add    --batch       <batch file name>\n",
+    "                   [--bank       sha1|sha256|sha384|sha512]...\n",
     "                   [--verbose]\n",
     "                   <policy file name>\n",
     "tb_polgen --del    --num         <module number>|any\n",
@@ -71,6 +76,10 @@ static const char *help[] = {
     "                   <policy file name>\n",
     "tb_polgen --show   [--verbose]\n",
     "                   <policy file name>\n",
+    "tb_polgen --pcrs   [--bank       sha1|sha256|sm3|sha384|sha512]...\n",
+    "                   [--jobs       <number of hashing threads>]\n",
+    "                   [--verbose]\n",
+    "                   <matrix file name>\n",
     "tb_polgen --help\n",
     NULL
 };
@@ -90,6 +99,7 @@ static struct option long_options[] =
     {"del",            no_argument,          NULL,    'D'},
     {"unwrap",         no_argument,          NULL,    'U'},
     {"show",           no_argument,          NULL,    'S'},
+    {"pcrs",           no_argument,          NULL,    'P'},
 
     {"type",           required_argument,    NULL,    't'},
     {"ctrl",           required_argument,    NULL,    'c'},
@@ -102,6 +112,9 @@ static struct option long_options[] =
     {"image",          required_argument,    NULL,    'i'},
     {"pos",            required_argument,    NULL,    'o'},
     {"elt",            required_argument,    NULL,    'e'},
+    {"bank",           required_argument,    NULL,    'b'},
+    {"jobs",           required_argument,    NULL,    'j'},
+    {"batch",          required_argument,    NULL,    'B'},
 
     {"verbose",        no_argument,          (int*)&verbose, true},
     {0, 0, 0, 0}
@@ -145,6 +158,15 @@ static option_table_t alg_opts[] = {
     {NULL}
 };
 
+static option_table_t bank_opts[] = {
+    {"sha1",         int_opt : POLGEN_BANK_SHA1},
+    {"sha256",       int_opt : POLGEN_BANK_SHA256},
+    {"sm3",          int_opt : POLGEN_BANK_SM3},
+    {"sha384",       int_opt : POLGEN_BANK_SHA384},
+    {"sha512",       int_opt : POLGEN_BANK_SHA512},
+    {NULL}
+};
+
 static bool strtonum(char *optarg, int *i)
 {
     if ( optarg == NULL || i == NULL )
@@ -202,6 +224,10 @@ void print_params(param_data_t *params)
     info_msg("\t image_file = %s\n", params->image_file);
     info_msg("\t elt_file = %s\n", params->elt_file);
     info_msg("\t policy_file = %s\n", params->policy_file);
+    info_msg("\t banks = 0x%x\n", params->banks);
+    info_msg("\t jobs = %d\n", params->jobs);
+    info_msg("\t matrix_file = %s\n", params->matrix_file);
+    info_msg("\t batch_file = %s\n", params->batch_file);
 }
 
 static bool validate_params(param_data_t *params)
@@ -239,6 +265,21 @@ static bool validate_params(param_data_t *params)
                 msg = "Missing policy file\n";
                 goto error;
             }
+            if ( params->banks & POLGEN_BANK_SM3 ) {
+                msg = "--bank sm3 is not supported with --add\n";
+                goto error;
+            }
+            /* the batch file gives the rest for each module */
+            if ( strnlen_s(params->batch_file, sizeof(params->batch_file)) != 0 ) {
+                if ( params->hash_type != -1 || params->mod_num != -1 ||
+                     params->pcr != -1 ||
+                     strnlen_s(params->image_file, sizeof(params->image_file)) != 0 ) {
+                    msg = "--batch cannot be used with --num, --pcr, --hash "
+                          "or --image\n";
+                    goto error;
+                }
+                return true;
+            }
             /* if hash_type is not ANY then need an image file */
             if ( params->hash_type != TB_HTYPE_ANY &&
                  strnlen_s(params->image_file, sizeof(params->image_file)) == 0 ) {
@@ -300,6 +341,17 @@ static bool validate_params(param_data_t *params)
             }
             return true;
 
+        case POLGEN_CMD_PCRS:
+            if ( strnlen_s(params->matrix_file, sizeof(params->matrix_file)) == 0 ) {
+                msg = "Missing matrix file\n";
+                goto error;
+            }
+            if ( params->jobs < 0 ) {
+                msg = "Invalid --jobs value\n";
+                goto error;
+            }
+            return true;
+
         case POLGEN_CMD_HELP:
             return true;
 
@@ -338,9 +390,13 @@ bool parse_input_params(int argc, char **argv, param_data_t *params)
     params->cmdline[0] = '\0';
     params->image_file[0] = '\0';
     params->elt_file[0] = '\0';
+    params->banks = 0;
+    params->jobs = 0;
+    params->matrix_file[0] = '\0';
+    params->batch_file[0] = '\0';
 
     while ( true ) {
-        c = getopt_long_only(argc, argv, "HCADUSt:a:c:n:p:h:l:i:o:e:",
+        c = getopt_long_only(argc, argv, "HCADUSPt:a:c:n:p:h:l:i:o:e:b:j:B:",
                              long_options, &option_index);
         if ( c == -1 )     /* no more args */
             break;
@@ -371,6 +427,10 @@ bool parse_input_params(int argc, char **argv, param_data_t *params)
                 HANDLE_MULTIPLE_CMDS(params->cmd);
                 params->cmd = POLGEN_CMD_SHOW;
                 break;
+            case 'P':                       /* --pcrs */
+                HANDLE_MULTIPLE_CMDS(params->cmd);
+                params->cmd = POLGEN_CMD_PCRS;
+                break;
             /* options */
             case 'n':                       /* --num */
                 if ( !parse_int_option(mod_num_opts, optarg,
@@ -441,6 +501,30 @@ bool parse_input_params(int argc, char **argv, param_data_t *params)
                     
                 strcpy_s(params->cmdline, sizeof(params->cmdline), optarg);
                 break;
+            case 'b':                       /* --bank */
+            {
+                int bank;
+
+                if ( !parse_int_option(bank_opts, optarg, &bank) ) {
+                    error_msg("Unknown --bank option\n");
+                    return false;
+                }
+                params->banks |= bank;
+                break;
+            }
+            case 'j':                       /* --jobs */
+                if ( !strtonum(optarg, &params->jobs) ) {
+                    error_msg("Unknown --jobs option\n");
+                    return false;
+                }
+                break;
+            case 'B':                       /* --batch */
+                if ( optarg == NULL ) {
+                    error_msg("Missing filename for --batch option\n");
+                    return false;
+                }
+                strcpy_s(params->batch_file, sizeof(params->batch_file), optarg);
+                break;
             case 'e':                       /* --elt */
                 if ( optarg == NULL ) {
                     error_msg("Missing filename for --elt option\n");
@@ -453,13 +537,56 @@ bool parse_input_params(int argc, char **argv, param_data_t *params)
         }
     }
 
-    /* last argument is policy file */
+    /* last argument is policy file (matrix file for --pcrs) */
     if ( optind >= argc ){
-        error_msg("Missing filename for policy file\n");
+        error_msg("Missing filename for %s file\n",
+                  params->cmd == POLGEN_CMD_PCRS ? "matrix" : "policy");
         return false;
     }
 
-    strcpy_s(params->policy_file, sizeof(params->policy_file), argv[optind]);
+    if ( params->cmd == POLGEN_CMD_PCRS )
+        strcpy_s(params->matrix_file, sizeof(params->matrix_file), argv[optind]);
+    else
+        strcpy_s(params->policy_file, sizeof(params->policy_file), argv[optind]);
+
+    return validate_params(params);
+}
+
+static char *next_token(char **line)
+{
+    char *tok = *line + strspn(*line, " \t");
+    char *end = tok + strcspn(tok, " \t");
+
+    *line = end + strspn(end, " \t");
+    if ( *end != '\0' )
+        *end = '\0';
+    return tok;
+}
+
+/*
+ * fill in the module options of params from a --batch line,
+ * "<num> <pcr> <hash> [<image> [<command line>]]"
+ */
+bool parse_batch_line(char *line, param_data_t *params)
+{
+    char *num = next_token(&line);
+    char *pcr = next_token(&line);
+    char *hash = next_token(&line);
+    char *image = next_token(&line);
+
+    if ( !parse_int_option(mod_num_opts, num, &params->mod_num) ||
+         !parse_int_option(pcr_opts, pcr, &params->pcr) ||
+         !parse_int_option(hash_type_opts, hash, &params->hash_type) )
+        return false;
+    if ( strnlen_s(line, sizeof(params->cmdline)) > sizeof(params->cmdline) - 1 )
+        return false;
+
+    strcpy_s(params->image_file, sizeof(params->image_file), image);
+    if ( *line != '\0' )
+        strcpy_s(params->cmdline, sizeof(params->cmdline), line);
+    else
+        params->cmdline[0] = '\0';
+    params->batch_file[0] = '\0';
 
     return validate_params(params);
 }
@@ -0,0 +1,655 @@
+/*
+ * pcrs.c: predict the PCR values that tboot's verified launch will produce
+ *
+ * Copyright (c) 2020, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <safe_lib.h>
+#define PRINT   printf
+#include "../include/config.h"
+#include "../include/hash.h"
+#include "../include/tb_error.h"
+#include "../include/tb_policy.h"
+#include "tb_polgen.h"
+
+extern tb_policy_t *g_policy;
+
+/*
+ * The matrix file lists the configurations to predict, e.g.:
+ *
+ *   # defaults for the configurations below
+ *   policy   /boot/tboot.pol              (or "default")
+ *   pcr_map  legacy                       (or "da")
+ *   tboot    /boot/tboot.gz logging=serial  (MLE image and its command line)
+ *   base     17 sha256 <hex>              (PCR value left by SINIT)
+ *
+ *   config   linux-5.4
+ *   module   /boot/vmlinuz-5.4 root=/dev/sda1 ro
+ *   module   /boot/initrd-5.4
+ *
+ * policy, pcr_map, tboot and base lines before the first config apply to
+ * every config; the same lines within a config override them for that
+ * config.  Module and tboot command lines are everything after the file
+ * name, as for --add.
+ *
+ * With a tboot line the MLE measurement is computed from the image, as
+ * lcp2_mlehash does, and extended into PCR 18 (legacy mapping) or PCR 17
+ * (details/authorities mapping); base then only has to give what SINIT
+ * extends before it, which is nothing for PCR 18 with the legacy mapping.
+ * pcr_map da only applies to the TPM 2.0 modes: the tpm12 mode always
+ * predicts the legacy mapping, as tboot's TPM 1.2 default policy does.
+ *
+ * Each image file is hashed once for all banks, however many configs use
+ * it, and the files are spread over --jobs threads; the per-config work
+ * afterwards only hashes command lines and the policy.
+ */
+
+#define MAX_PCRS            (TB_POL_MAX_PCR + 1)
+#define DEF_PCRS            ((1 << 17) | (1 << 18) | (1 << 19))
+#define MAX_LINE_SIZE       (TBOOT_KERNEL_CMDLINE_SIZE + FILENAME_MAX + 16)
+
+static const struct {
+    unsigned int bank;
+    uint16_t     alg;
+    const char   *name;
+} pcr_banks[] = {
+    { POLGEN_BANK_SHA1,   TB_HALG_SHA1,   "sha1" },
+    { POLGEN_BANK_SHA256, TB_HALG_SHA256, "sha256" },
+    { POLGEN_BANK_SM3,    TB_HALG_SM3,    "sm3" },
+    { POLGEN_BANK_SHA384, TB_HALG_SHA384, "sha384" },
+    { POLGEN_BANK_SHA512, TB_HALG_SHA512, "sha512" },
+};
+#define NUM_BANKS           ARRAY_SIZE(pcr_banks)
+
+/* extpol= values of tboot, plus a TPM 1.2 mode; see get_tboot_extpol() */
+typedef struct {
+    const char   *name;
+    uint16_t     cur_alg;
+    bool         all_banks;         /* else only the cur_alg bank */
+    bool         tpm12;
+} extpol_mode_t;
+
+static const extpol_mode_t extpol_modes[] = {
+    { "tpm12",    TB_HALG_SHA1,   false, true },
+    { "sha1",     TB_HALG_SHA1,   false, false },
+    { "sha256",   TB_HALG_SHA256, false, false },
+    { "sm3",      TB_HALG_SM3,    false, false },
+    { "sha384",   TB_HALG_SHA384, false, false },
+    { "sha512",   TB_HALG_SHA512, false, false },
+    { "agile",    TB_HALG_SHA256, true,  false },
+    { "embedded", TB_HALG_SHA256, true,  false },
+};
+
+typedef struct {
+    char         *file;
+    bool         hashed;
+    tb_hash_t    hashes[NUM_BANKS];
+} image_t;
+
+typedef struct {
+    unsigned int image;
+    char         *cmdline;
+} pcr_module_t;
+
+typedef struct {
+    char         *name;
+    char         *policy_file;      /* NULL for tboot's default policy */
+    bool         da;                /* details/authorities PCR mapping */
+    char         *mle_file;         /* tboot image, NULL if not measured */
+    char         *mle_cmdline;
+    tb_hash_t    mle[NUM_BANKS];
+    uint32_t     base_set;          /* PCRs given a base value */
+    tb_hash_t    base[MAX_PCRS][NUM_BANKS];
+    unsigned int num_modules;
+    pcr_module_t *modules;
+} pcr_config_t;
+
+static image_t      *images;
+static unsigned int num_images;
+static pcr_config_t *configs;
+static unsigned int num_configs;
+
+static unsigned int bank_idx(uint16_t alg)
+{
+    for ( unsigned int i = 0; i < NUM_BANKS; i++ ) {
+        if ( pcr_banks[i].alg == alg )
+            return i;
+    }
+    return NUM_BANKS;
+}
+
+/*
+ * image hashing
+ */
+
+/* hash an image for all requested banks in one (unzipped) pass, as --add */
+static bool hash_image(image_t *image, unsigned int banks)
+{
+    uint16_t algs[NUM_BANKS];
+    tb_hash_t hashes[NUM_BANKS];
+    unsigned int num_algs = 0;
+
+    for ( unsigned int i = 0; i < NUM_BANKS; i++ ) {
+        if ( banks & pcr_banks[i].bank )
+            algs[num_algs++] = pcr_banks[i].alg;
+    }
+    if ( !hash_file(image->file, true, algs, num_algs, hashes) )
+        return false;
+
+    for ( unsigned int i = 0, j = 0; i < NUM_BANKS; i++ ) {
+        if ( banks & pcr_banks[i].bank )
+            image->hashes[i] = hashes[j++];
+    }
+    image->hashed = true;
+    return true;
+}
+
+static struct {
+    unsigned int next;
+    unsigned int banks;
+} hash_work;
+
+static void *hash_worker(void *arg)
+{
+    (void)arg;
+
+    while ( true ) {
+        unsigned int i = __sync_fetch_and_add(&hash_work.next, 1);
+
+        if ( i >= num_images )
+            break;
+        hash_image(&images[i], hash_work.banks);
+    }
+    return NULL;
+}
+
+static bool hash_all_images(unsigned int banks, int jobs)
+{
+    pthread_t *threads;
+    int num_threads = 0;
+
+    if ( jobs <= 0 )
+        jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    if ( jobs > (int)num_images )
+        jobs = num_images;
+
+    hash_work.next = 0;
+    hash_work.banks = banks;
+
+    /* this thread works too, so start one fewer */
+    threads = calloc(jobs > 1 ? jobs - 1 : 1, sizeof(*threads));
+    if ( threads == NULL )
+        return false;
+    while ( num_threads < jobs - 1 &&
+            pthread_create(&threads[num_threads], NULL, hash_worker, NULL) == 0 )
+        num_threads++;
+    info_msg("hashing %u images with %d threads...\n", num_images,
+             num_threads + 1);
+
+    hash_worker(NULL);
+    for ( int i = 0; i < num_threads; i++ )
+        pthread_join(threads[i], NULL);
+    free(threads);
+
+    for ( unsigned int i = 0; i < num_images; i++ ) {
+        if ( !images[i].hashed )
+            return false;
+    }
+    return true;
+}
+
+/*
+ * matrix file
+ */
+
+static int find_or_add_image(const char *file)
+{
+    for ( unsigned int i = 0; i < num_images; i++ ) {
+        if ( strcmp(images[i].file, file) == 0 )
+            return i;
+    }
+
+    image_t *new_images = realloc(images, (num_images + 1) * sizeof(*images));
+    if ( new_images == NULL )
+        return -1;
+    images = new_images;
+    memset_s(&images[num_images], sizeof(*images), 0);
+    images[num_images].file = strdup(file);
+    if ( images[num_images].file == NULL )
+        return -1;
+    return num_images++;
+}
+
+static char *next_token(char **line)
+{
+    char *tok = *line + strspn(*line, " \t");
+    char *end = tok + strcspn(tok, " \t");
+
+    *line = end + strspn(end, " \t");
+    if ( *end != '\0' )
+        *end = '\0';
+    return tok;
+}
+
+static bool parse_base(pcr_config_t *cfg, char *line)
+{
+    char *pcr_str = next_token(&line);
+    char *alg_str = next_token(&line);
+    char *hex = next_token(&line);
+    unsigned int i, pcr, hash_size;
+    char *end;
+
+    pcr = strtoul(pcr_str, &end, 0);
+    if ( *pcr_str == '\0' || *end != '\0' || pcr >= MAX_PCRS )
+        return false;
+    for ( i = 0; i < NUM_BANKS; i++ ) {
+        if ( strcasecmp(alg_str, pcr_banks[i].name) == 0 )
+            break;
+    }
+    if ( i == NUM_BANKS )
+        return false;
+
+    hash_size = get_hash_size(pcr_banks[i].alg);
+    if ( strnlen_s(hex, 2*sizeof(tb_hash_t) + 1) != 2*hash_size )
+        return false;
+    for ( unsigned int j = 0; j < hash_size; j++ ) {
+        char byte[3] = { hex[2*j], hex[2*j + 1], '\0' };
+
+        if ( !isxdigit(byte[0]) || !isxdigit(byte[1]) )
+            return false;
+        cfg->base[pcr][i].sha512[j] = strtoul(byte, NULL, 16);
+    }
+    cfg->base_set |= 1 << pcr;
+    return true;
+}
+
+static bool parse_matrix_file(const char *matrix_file)
+{
+    static pcr_config_t defaults;
+    pcr_config_t *cfg = &defaults;
+    char *line = malloc(MAX_LINE_SIZE);
+    unsigned int line_num = 0;
+    bool ret = true;
+    FILE *f;
+
+    if ( line == NULL )
+        return false;
+    f = fopen(matrix_file, "r");
+    if ( f == NULL ) {
+        error_msg("fopen %s failed, errno %s\n", matrix_file, strerror(errno));
+        free(line);
+        return false;
+    }
+
+    while ( ret && fgets(line, MAX_LINE_SIZE, f) != NULL ) {
+        char *p = line;
+        char *key, *val;
+
+        line_num++;
+        p[strcspn(p, "\r\n")] = '\0';
+        key = next_token(&p);
+        if ( *key == '\0' || *key == '#' )
+            continue;
+
+        if ( strcmp(key, "config") == 0 ) {
+            pcr_config_t *new_configs;
+
+            val = next_token(&p);
+            new_configs = realloc(configs, (num_configs + 1) * sizeof(*configs));
+            if ( *val == '\0' || new_configs == NULL ) {
+                ret = false;
+                break;
+            }
+            configs = new_configs;
+            cfg = &configs[num_configs++];
+            *cfg = defaults;
+            cfg->name = strdup(val);
+        }
+        else if ( strcmp(key, "policy") == 0 ) {
+            val = next_token(&p);
+            if ( *val == '\0' )
+                ret = false;
+            cfg->policy_file = strcmp(val, "default") ? strdup(val) : NULL;
+        }
+        else if ( strcmp(key, "pcr_map") == 0 ) {
+            val = next_token(&p);
+            if ( strcmp(val, "da") == 0 )
+                cfg->da = true;
+            else if ( strcmp(val, "legacy") == 0 )
+                cfg->da = false;
+            else
+                ret = false;
+        }
+        else if ( strcmp(key, "tboot") == 0 ) {
+            val = next_token(&p);
+            if ( *val == '\0' ) {
+                ret = false;
+                break;
+            }
+            cfg->mle_file = strdup(val);
+            cfg->mle_cmdline = strdup(p);
+        }
+        else if ( strcmp(key, "base") == 0 )
+            ret = parse_base(cfg, p);
+        else if ( strcmp(key, "module") == 0 && cfg != &defaults ) {
+            pcr_module_t *new_modules;
+            int image;
+
+            val = next_token(&p);
+            image = find_or_add_image(val);
+            new_modules = realloc(cfg->modules,
+                                  (cfg->num_modules + 1) * sizeof(*new_modules));
+            if ( *val == '\0' || image < 0 || new_modules == NULL ||
+                 cfg->num_modules > TB_POL_MAX_MOD_NUM ||
+                 strnlen_s(p, TBOOT_KERNEL_CMDLINE_SIZE) >=
+                 TBOOT_KERNEL_CMDLINE_SIZE ) {
+                ret = false;
+                break;
+            }
+            cfg->modules = new_modules;
+            cfg->modules[cfg->num_modules].image = image;
+            cfg->modules[cfg->num_modules++].cmdline = strdup(p);
+        }
+        else
+            ret = false;
+    }
+
+    if ( !ret )
+        error_msg("%s:%u: invalid line\n", matrix_file, line_num);
+    else if ( num_configs == 0 ) {
+        error_msg("%s: no config found\n", matrix_file);
+        ret = false;
+    }
+    else {
+        for ( unsigned int i = 0; i < num_configs; i++ ) {
+            if ( configs[i].num_modules == 0 ) {
+                error_msg("config %s has no modules\n", configs[i].name);
+                ret = false;
+            }
+        }
+    }
+
+    fclose(f);
+    free(line);
+    return ret;
+}
+
+/* the MLE measurement of each config, hashing each tboot/cmdline only once */
+static bool hash_all_mles(unsigned int banks)
+{
+    uint16_t algs[NUM_BANKS];
+    unsigned int num_algs = 0;
+
+    for ( unsigned int i = 0; i < NUM_BANKS; i++ ) {
+        if ( banks & pcr_banks[i].bank )
+            algs[num_algs++] = pcr_banks[i].alg;
+    }
+
+    for ( unsigned int i = 0; i < num_configs; i++ ) {
+        pcr_config_t *cfg = &configs[i];
+        tb_hash_t hashes[NUM_BANKS];
+        unsigned int j;
+
+        if ( cfg->mle_file == NULL )
+            continue;
+        for ( j = 0; j < i; j++ ) {
+            if ( configs[j].mle_file != NULL &&
+                 strcmp(configs[j].mle_file, cfg->mle_file) == 0 &&
+                 strcmp(configs[j].mle_cmdline, cfg->mle_cmdline) == 0 )
+                break;
+        }
+        if ( j < i ) {
+            memcpy_s(cfg->mle, sizeof(cfg->mle), configs[j].mle,
+                     sizeof(configs[j].mle));
+            continue;
+        }
+
+        info_msg("hashing MLE %s...\n", cfg->mle_file);
+        if ( !hash_mle_file(cfg->mle_file, cfg->mle_cmdline, algs, num_algs,
+                            hashes) )
+            return false;
+        for ( unsigned int k = 0, n = 0; k < NUM_BANKS; k++ ) {
+            if ( banks & pcr_banks[k].bank )
+                cfg->mle[k] = hashes[n++];
+        }
+    }
+    return true;
+}
+
+/*
+ * prediction
+ */
+
+/* mirrors the default policies in tboot/common/policy.c */
+static void load_default_policy(bool tpm12, bool da)
+{
+    tb_policy_entry_t *pol_entry;
+
+    memset_s(g_policy, MAX_TB_POLICY_EXT_SIZE, 0);
+    new_policy(TB_POLTYPE_CONT_NON_FATAL, TB_POLCTL_EXTEND_PCR17,
+               tpm12 ? TB_HALG_SHA1 : TB_HALG_SHA256);
+    add_pol_entry(0, TB_POL_PCR_NONE, TB_HTYPE_ANY);
+    add_pol_entry(TB_POL_MOD_NUM_ANY, da ? 17 : 19, TB_HTYPE_ANY);
+    pol_entry = add_pol_entry(TB_POL_MOD_NUM_NV_RAW, 22, TB_HTYPE_ANY);
+    pol_entry->nv_index = 0x40000010;
+}
+
+/* tboot's TPM 1.2 default policy (_def_policy_12) keeps the legacy PCRs */
+static bool use_da(const pcr_config_t *cfg, const extpol_mode_t *mode)
+{
+    return cfg->da && !mode->tpm12;
+}
+
+static bool load_policy(const pcr_config_t *cfg, const extpol_mode_t *mode)
+{
+    static const char *loaded_file;
+
+    if ( cfg->policy_file == NULL ) {
+        loaded_file = NULL;
+        load_default_policy(mode->tpm12, use_da(cfg, mode));
+        return true;
+    }
+
+    if ( loaded_file != NULL && strcmp(loaded_file, cfg->policy_file) == 0 )
+        return true;
+    loaded_file = NULL;
+    if ( !read_policy_file(cfg->policy_file, NULL) ) {
+        error_msg("Error reading policy file %s\n", cfg->policy_file);
+        return false;
+    }
+    /* as set_policy() does for policies made by older tools */
+    if ( g_policy->hash_alg == 0 )
+        g_policy->hash_alg = TB_HALG_SHA1;
+    loaded_file = cfg->policy_file;
+    return true;
+}
+
+/* SHA( SHA(cmdline) | SHA(image) ) per bank, as hash_module() */
+static bool extend_module(tb_hash_t pcr[NUM_BANKS], const pcr_module_t *module,
+                          unsigned int banks)
+{
+    for ( unsigned int i = 0; i < NUM_BANKS; i++ ) {
+        uint16_t alg = pcr_banks[i].alg;
+        unsigned int hash_size = get_hash_size(alg);
+        uint8_t buf[2*sizeof(tb_hash_t)];
+        tb_hash_t hash;
+
+        if ( !(banks & pcr_banks[i].bank) )
+            continue;
+        if ( !hash_buffer((const unsigned char *)module->cmdline,
+                          strnlen_s(module->cmdline, TBOOT_KERNEL_CMDLINE_SIZE),
+                          (tb_hash_t *)buf, alg) )
+            return false;
+        memcpy_s(buf + hash_size, sizeof(buf) - hash_size,
+                 &images[module->image].hashes[i], hash_size);
+        if ( !hash_buffer(buf, 2*hash_size, &hash, alg) ||
+             !extend_hash(&pcr[i], &hash, alg) )
+            return false;
+    }
+    return true;
+}
+
+/* follows the order of verify_all_modules() and extend_pcrs() */
+static bool predict_mode(const pcr_config_t *cfg, const extpol_mode_t *mode,
+                         unsigned int banks, bool *warn)
+{
+    tb_hash_t pcrs[MAX_PCRS][NUM_BANKS];
+    uint32_t extended = DEF_PCRS | cfg->base_set;
+    uint8_t buf[sizeof(uint32_t) + sizeof(tb_hash_t)];
+    size_t size;
+    bool da = use_da(cfg, mode);
+
+    if ( !mode->all_banks )
+        banks &= pcr_banks[bank_idx(mode->cur_alg)].bank;
+    if ( banks == 0 )
+        return true;
+    if ( !load_policy(cfg, mode) )
+        return false;
+    memcpy_s(pcrs, sizeof(pcrs), cfg->base, sizeof(cfg->base));
+
+    /* SINIT's MLE measurement, see hash_all_mles() */
+    if ( cfg->mle_file != NULL ) {
+        for ( unsigned int i = 0; i < NUM_BANKS; i++ ) {
+            if ( (banks & pcr_banks[i].bank) &&
+                 !extend_hash(&pcrs[da ? 17 : 18][i], &cfg->mle[i],
+                              pcr_banks[i].alg) )
+                return false;
+        }
+    }
+
+    /* policy control | policy hash (or 0s), as verify_g_policy() */
+    memset_s(buf, sizeof(buf), 0);
+    memcpy_s(buf, sizeof(buf), &g_policy->policy_control,
+             sizeof(g_policy->policy_control));
+    if ( (g_policy->policy_control & TB_POLCTL_EXTEND_PCR17) &&
+         !hash_buffer((unsigned char *)g_policy, calc_policy_size(g_policy),
+                      (tb_hash_t *)&buf[sizeof(uint32_t)], mode->cur_alg) )
+        return false;
+    size = sizeof(uint32_t) + get_hash_size(mode->cur_alg);
+    for ( unsigned int i = 0; i < NUM_BANKS; i++ ) {
+        tb_hash_t hash;
+
+        if ( !(banks & pcr_banks[i].bank) )
+            continue;
+        if ( !hash_buffer(buf, size, &hash, pcr_banks[i].alg) ||
+             !extend_hash(&pcrs[17][i], &hash, pcr_banks[i].alg) ||
+             (da && !extend_hash(&pcrs[18][i], &hash, pcr_banks[i].alg)) )
+            return false;
+    }
+
+    /* module 0 always goes to PCR 18 (17 with details/authorities) */
+    if ( !extend_module(pcrs[da ? 17 : 18], &cfg->modules[0], banks) )
+        return false;
+
+    for ( unsigned int i = 0; i < cfg->num_modules; i++ ) {
+        tb_policy_entry_t *pol_entry = find_policy_entry(g_policy, i);
+
+        if ( pol_entry == NULL ) {
+            if ( *warn )
+                error_msg("config %s: policy entry for module %u not found\n",
+                          cfg->name, i);
+            continue;
+        }
+        if ( pol_entry->pcr == TB_POL_PCR_NONE )
+            continue;
+        if ( !extend_module(pcrs[pol_entry->pcr], &cfg->modules[i], banks) )
+            return false;
+        extended |= 1 << pol_entry->pcr;
+    }
+    /* the modules are the same for every mode, so only warn once */
+    *warn = false;
+
+    for ( unsigned int i = 0; i < NUM_BANKS; i++ ) {
+        if ( !(banks & pcr_banks[i].bank) )
+            continue;
+        for ( unsigned int pcr = 0; pcr < MAX_PCRS; pcr++ ) {
+            unsigned int hash_size = get_hash_size(pcr_banks[i].alg);
+
+            if ( !(extended & (1 << pcr)) )
+                continue;
+            printf("%s %s %s %u ", cfg->name, mode->name, pcr_banks[i].name,
+                   pcr);
+            for ( unsigned int j = 0; j < hash_size; j++ )
+                printf("%02x", pcrs[pcr][i].sha512[j]);
+            printf("\n");
+        }
+    }
+    return true;
+}
+
+bool do_pcrs(const param_data_t *params)
+{
+    unsigned int banks = params->banks;
+
+    if ( banks == 0 )
+        banks = POLGEN_BANK_SHA1 | POLGEN_BANK_SHA256;
+
+    info_msg("reading matrix file %s...\n", params->matrix_file);
+    if ( !parse_matrix_file(params->matrix_file) )
+        return false;
+
+    if ( !hash_all_images(banks, params->jobs) || !hash_all_mles(banks) )
+        return false;
+
+    for ( unsigned int i = 0; i < num_configs; i++ ) {
+        bool warn = true;
+
+        for ( unsigned int j = 0; j < ARRAY_SIZE(extpol_modes); j++ ) {
+            if ( !predict_mode(&configs[i], &extpol_modes[j], banks, &warn) ) {
+                error_msg("config %s: prediction failed\n", configs[i].name);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+/*
+ * Local variables:
+ * mode: C
+ * c-set-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
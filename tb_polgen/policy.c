@@ -48,7 +48,7 @@
 #include "tb_polgen.h"
 
 /* buffer for policy read/written from/to policy file */
-static uint8_t _policy_buf[MAX_TB_POLICY_SIZE];
+static uint8_t _policy_buf[MAX_TB_POLICY_EXT_SIZE];
 
 tb_policy_t *g_policy = (tb_policy_t *)_policy_buf;
 
@@ -154,8 +154,8 @@ bool write_policy_file(const char *policy_filename)
 
 void new_policy(int policy_type, int policy_control, int hash_alg)
 {
-    /* current version is 2 */
-    g_policy->version = 2;
+    /* version is raised to TB_POL_VERSION_EXT if an entry overflows */
+    g_policy->version = TB_POL_VERSION;
 
     g_policy->hash_alg = hash_alg;
 
@@ -208,8 +208,51 @@ void modify_pol_entry(tb_policy_entry_t *pol_entry, uint8_t pcr,
 
     info_msg("modifying policy entry for mod_num %u\n", pol_entry->mod_num);
 
-    pol_entry->pcr = pcr;
-    pol_entry->hash_type = hash_type;
+    /* find the next entry of the set before this one is changed */
+    while ( pol_entry != NULL ) {
+        tb_policy_entry_t *next = get_next_policy_entry_in_set(g_policy,
+                                                               pol_entry);
+        pol_entry->pcr = pcr;
+        pol_entry->hash_type = hash_type;
+        pol_entry = next;
+    }
+}
+
+int get_num_hashes_in_set(const tb_policy_entry_t *pol_entry)
+{
+    int num_hashes = 0;
+
+    for ( ; pol_entry != NULL;
+          pol_entry = get_next_policy_entry_in_set(g_policy, pol_entry) )
+        num_hashes += pol_entry->num_hashes;
+
+    return num_hashes;
+}
+
+/* insert an empty entry after pol_entry that continues its set */
+static tb_policy_entry_t *add_continuation_entry(tb_policy_entry_t *pol_entry)
+{
+    size_t pol_size = calc_policy_size(g_policy);
+    if ( g_policy->num_entries == 0xff ||
+         pol_size + sizeof(*pol_entry) > sizeof(_policy_buf) )
+        return NULL;
+
+    unsigned char *entry_end = (unsigned char *)pol_entry +
+        calc_policy_entry_size(pol_entry, g_policy->hash_alg);
+    unsigned char *pol_end = _policy_buf + pol_size;
+    memmove_s(entry_end + sizeof(*pol_entry), pol_end - entry_end,
+            entry_end, pol_end - entry_end);
+
+    tb_policy_entry_t *new_entry = (tb_policy_entry_t *)entry_end;
+    memcpy_s(new_entry, sizeof(*new_entry), pol_entry, sizeof(*pol_entry));
+    new_entry->num_hashes = 0;
+
+    g_policy->num_entries++;
+    g_policy->version = TB_POL_VERSION_EXT;
+
+    info_msg("continuing policy entry for mod_num %u\n", pol_entry->mod_num);
+
+    return new_entry;
 }
 
 bool add_hash(tb_policy_entry_t *pol_entry, const tb_hash_t *hash)
@@ -217,6 +260,16 @@ bool add_hash(tb_policy_entry_t *pol_entry, const tb_hash_t *hash)
     if ( pol_entry == NULL )
         return false;
 
+    /* new hashes go in the last entry of the set, so find it */
+    tb_policy_entry_t *next;
+    while ( (next = get_next_policy_entry_in_set(g_policy, pol_entry)) != NULL )
+        pol_entry = next;
+    if ( pol_entry->num_hashes == TB_POL_MAX_ENTRY_HASHES ) {
+        pol_entry = add_continuation_entry(pol_entry);
+        if ( pol_entry == NULL )
+            return false;
+    }
+
     /* since pol_entry may not be last in policy, need to make space */
     size_t pol_size = calc_policy_size(g_policy);
     size_t hash_size = get_hash_size(g_policy->hash_alg);
@@ -234,13 +287,38 @@ bool add_hash(tb_policy_entry_t *pol_entry, const tb_hash_t *hash)
     return true;
 }
 
+static bool del_one_entry(tb_policy_entry_t *pol_entry)
+{
+    void *start = pol_entry;
+    size_t size = calc_policy_entry_size(pol_entry, g_policy->hash_alg);
+    memmove_s(start, calc_policy_size(g_policy),
+            start + size, calc_policy_size(g_policy) - size);
+
+    g_policy->num_entries--;
+
+    return true;
+}
+
 bool del_hash(tb_policy_entry_t *pol_entry, int i)
 {
     if ( pol_entry == NULL )
         return false;
-    if ( i < 0 || i >= pol_entry->num_hashes )
+    if ( i < 0 )
         return false;
 
+    /* i is the position within the whole set, so find its entry */
+    tb_policy_entry_t *head = pol_entry;
+    while ( i >= pol_entry->num_hashes ) {
+        i -= pol_entry->num_hashes;
+        pol_entry = get_next_policy_entry_in_set(g_policy, pol_entry);
+        if ( pol_entry == NULL )
+            return false;
+    }
+
+    /* drop a continuation entry rather than leave it empty */
+    if ( pol_entry != head && pol_entry->num_hashes == 1 )
+        return del_one_entry(pol_entry);
+
     void *start = get_policy_entry_hash(pol_entry, g_policy->hash_alg, i);
     size_t size = get_hash_size(g_policy->hash_alg);
     memmove_s(start, calc_policy_size(g_policy), 
@@ -256,12 +334,13 @@ bool del_entry(tb_policy_entry_t *pol_entry)
     if ( pol_entry == NULL )
         return false;
 
-    void *start = pol_entry;
-    size_t size = calc_policy_entry_size(pol_entry, g_policy->hash_alg);
-    memmove_s(start, calc_policy_size(g_policy),
-            start + size, calc_policy_size(g_policy) - size);
-
-    g_policy->num_entries--;
+    /* any entries continuing this one move into its place as it is deleted */
+    bool more;
+    do {
+        more = (get_next_policy_entry_in_set(g_policy, pol_entry) != NULL);
+        if ( !del_one_entry(pol_entry) )
+            return false;
+    } while ( more );
 
     return true;
 }
@@ -71,6 +71,9 @@ int main (int argc, char *argv[])
         case POLGEN_CMD_SHOW:
             ret = do_show(&params);
             break;
+        case POLGEN_CMD_PCRS:
+            ret = do_pcrs(&params);
+            break;
         case POLGEN_CMD_HELP:
             display_help_msg();
             ret = true;
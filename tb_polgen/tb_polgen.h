@@ -45,9 +45,21 @@ extern bool verbose;
 
 typedef enum {
     POLGEN_CMD_NONE, POLGEN_CMD_HELP, POLGEN_CMD_CREATE, POLGEN_CMD_ADD,
-    POLGEN_CMD_DEL, POLGEN_CMD_UNWRAP, POLGEN_CMD_SHOW,
+    POLGEN_CMD_DEL, POLGEN_CMD_UNWRAP, POLGEN_CMD_SHOW, POLGEN_CMD_PCRS,
 } polgen_cmd_t;
 
+/* PCR banks for --pcrs (bits of param_data_t.banks) */
+#define POLGEN_BANK_SHA1        0x01
+#define POLGEN_BANK_SHA256      0x02
+#define POLGEN_BANK_SM3         0x04
+#define POLGEN_BANK_SHA384      0x08
+#define POLGEN_BANK_SHA512      0x10
+
+/* most digests hash_file() computes in one pass */
+#define MAX_FILE_HASHES         HASH_MULTI_MAX_ALGS
+
+#define MAX_BATCH_LINE_SIZE     (TBOOT_KERNEL_CMDLINE_SIZE + FILENAME_MAX + 32)
+
 typedef struct {
     polgen_cmd_t   cmd;
     int            policy_type;
@@ -57,18 +69,25 @@ typedef struct {
     int            hash_type;
     int            pos;
     int            hash_alg;
+    int            banks;
+    int            jobs;
     char           cmdline[TBOOT_KERNEL_CMDLINE_SIZE];
     char           image_file[FILENAME_MAX];
     char           elt_file[FILENAME_MAX];
     char           policy_file[FILENAME_MAX];
+    char           matrix_file[FILENAME_MAX];
+    char           batch_file[FILENAME_MAX];
 } param_data_t;
 
 /* in param.c */
 extern bool parse_input_params(int argc, char **argv, param_data_t *params);
 extern void display_help_msg(void);
 extern void print_params(param_data_t *params);
+extern bool parse_batch_line(char *line, param_data_t *params);
 
 /* in commands.c */
+extern bool hash_file(const char *filename, bool unzip, const uint16_t *algs,
+                      unsigned int num_algs, tb_hash_t *hashes);
 extern bool do_create(const param_data_t *params);
 extern bool do_add(const param_data_t *params);
 extern bool do_del(const param_data_t *params);
@@ -85,10 +104,19 @@ extern tb_policy_entry_t *add_pol_entry(uint8_t mod_num, uint8_t pcr,
                                         uint8_t hash_type);
 extern void modify_pol_entry(tb_policy_entry_t *pol_entry, uint8_t pcr,
                              uint8_t hash_type);
+extern int get_num_hashes_in_set(const tb_policy_entry_t *pol_entry);
 extern bool add_hash(tb_policy_entry_t *pol_entry, const tb_hash_t *hash);
 extern bool del_hash(tb_policy_entry_t *pol_entry, int i);
 extern bool del_entry(tb_policy_entry_t *pol_entry);
 
+/* in mle.c */
+extern bool hash_mle_file(const char *filename, const char *cmdline,
+                          const uint16_t *algs, unsigned int num_algs,
+                          tb_hash_t *hashes);
+
+/* in pcrs.c */
+extern bool do_pcrs(const param_data_t *params);
+
 #endif /* __TB_POLGEN_H__ */
 
 
@@ -0,0 +1,65 @@
+#!/bin/sh
+#
+# Copyright (c) 2006-2010, Intel Corporation
+# All rights reserved.
+#
+# checks tb_polgen --pcrs predictions against values worked out here with
+# sha1sum, for the parts that don't depend on the policy hash
+#
+# usage: pcrs_test.sh <tb_polgen>
+#
+
+TB_POLGEN=${1:-./tb_polgen}
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+
+fail()
+{
+    echo "pcrs_test: $*" >&2
+    exit 1
+}
+
+# SHA1 of stdin, as binary
+sha1()
+{
+    sha1sum | cut -d' ' -f1 | xxd -r -p
+}
+
+head -c 4096 /dev/urandom > "$DIR/kernel"
+head -c 512 /dev/urandom > "$DIR/initrd"
+
+cat > "$DIR/matrix" <<END
+policy   default
+config   legacy
+pcr_map  legacy
+module   $DIR/kernel ro
+module   $DIR/initrd
+config   da
+pcr_map  da
+module   $DIR/kernel ro
+module   $DIR/initrd
+END
+
+"$TB_POLGEN" --pcrs --bank sha1 "$DIR/matrix" > "$DIR/out" ||
+    fail "prediction failed"
+
+# tboot's TPM 1.2 default policy measures the modules into PCR 19 and
+# keeps module 0 in PCR 18 whatever pcr_map says
+grep '^legacy tpm12 ' "$DIR/out" | cut -d' ' -f2- > "$DIR/legacy"
+grep '^da tpm12 ' "$DIR/out" | cut -d' ' -f2- > "$DIR/da"
+[ -s "$DIR/legacy" ] || fail "no tpm12 prediction"
+cmp -s "$DIR/legacy" "$DIR/da" ||
+    fail "tpm12 prediction depends on pcr_map"
+
+# PCR 19 = extend(0, SHA1(SHA1(cmdline) | SHA1(image))) for module 1
+{ printf '' | sha1; sha1 < "$DIR/initrd"; } | sha1 > "$DIR/mod1"
+expected=$({ head -c 20 /dev/zero; cat "$DIR/mod1"; } | sha1sum |
+           cut -d' ' -f1)
+grep -qx "tpm12 sha1 19 $expected" "$DIR/da" ||
+    fail "tpm12 PCR 19 with pcr_map da is not $expected"
+
+# with TPM 2.0 the details/authorities mapping leaves PCR 19 alone
+grep -qx 'da sha1 sha1 19 0\{40\}' "$DIR/out" ||
+    fail "sha1 PCR 19 with pcr_map da is not 0"
+
+echo "pcrs_test: ok"
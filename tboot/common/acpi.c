@@ -229,6 +229,46 @@ uint32_t get_madt_apic_base(void)
     return (uint32_t)madt->local_apic_address;
 }
 
+/* fill ids[] (if not NULL) with the APIC ids of the enabled (x2)APICs;
+   returns the # */
+unsigned int get_madt_apic_ids(uint32_t *ids, unsigned int max)
+{
+    struct acpi_madt *madt = get_apic_table();
+    unsigned int count = 0;
+
+    if ( madt == NULL ) {
+        printk(TBOOT_ERR"no MADT table found\n");
+        return 0;
+    }
+
+    /* APIC tables begin after MADT */
+    union acpi_madt_entry *entry = (union acpi_madt_entry *)(madt + 1);
+
+    while ( (void *)entry < ((void *)madt + madt->hdr.length) &&
+            count < max ) {
+        uint8_t length = entry->madt_lapic.length;
+
+        if ( length == 0 )
+            break;
+        if ( entry->madt_lapic.apic_type == ACPI_MADT_LAPIC &&
+             length >= sizeof(entry->madt_lapic) &&
+             (entry->madt_lapic.flags & ACPI_PROC_ENABLE) ) {
+            if ( ids != NULL )
+                ids[count] = entry->madt_lapic.apic_id;
+            count++;
+        }
+        else if ( entry->madt_lapic.apic_type == ACPI_MADT_X2APIC &&
+                  length >= sizeof(entry->madt_x2apic) &&
+                  (entry->madt_x2apic.flags & ACPI_PROC_ENABLE) ) {
+            if ( ids != NULL )
+                ids[count] = entry->madt_x2apic.x2apic_id;
+            count++;
+        }
+        entry = (void *)entry + length;
+    }
+    return count;
+}
+
 struct acpi_table_ioapic *get_acpi_ioapic_table(void)
 {
     struct acpi_madt *madt = get_apic_table();
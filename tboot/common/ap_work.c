@@ -0,0 +1,268 @@
+/*
+ * ap_work.c: simple work queue that lets idle APs help the BSP
+ *
+ * Copyright (c) 2020, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <config.h>
+#include <stdbool.h>
+#include <types.h>
+#include <compiler.h>
+#include <string.h>
+#include <processor.h>
+#include <atomic.h>
+#include <printk.h>
+#include <cmdline.h>
+#include <ap_work.h>
+
+extern bool use_mwait(void);
+
+typedef struct {
+    void        *dst;
+    const void  *src;           /* NULL means zero-fill */
+    size_t      size;
+} ap_job_t;
+
+/*
+ * the claim word holds the batch sequence # in its upper 16 bits and the
+ * index of the next unclaimed job in its lower 16 bits; jobs are claimed
+ * by cmpxchg on the whole word, so a CPU that read the word for an earlier
+ * batch can never claim a job from the current one
+ */
+#define CLAIM_SEQ(seq)      (((seq) & 0xffff) << 16)
+#define CLAIM_IDX(claim)    ((claim) & 0xffff)
+#define CLAIM_CLOSED        0xffff
+
+static struct {
+    /* APs MONITOR this line, so keep these fields first */
+    volatile uint32_t open;
+    volatile uint32_t claim;
+    volatile uint32_t num_jobs;
+    volatile uint32_t done_jobs;
+    volatile uint32_t num_workers;
+    /* only touched by BSP */
+    uint32_t          seq;
+    uint32_t          queued;
+    ap_job_t          jobs[AP_WORK_MAX_JOBS];
+} g_ap_work __attribute__ ((aligned (64)));
+
+static inline bool cmpxchg_u32(volatile uint32_t *p, uint32_t old,
+                               uint32_t new)
+{
+    uint32_t prev;
+
+    __asm__ __volatile__ ("lock; cmpxchgl %2,%1"
+                          : "=a" (prev), "+m" (*p)
+                          : "r" (new), "0" (old)
+                          : "memory");
+    return prev == old;
+}
+
+static void run_job(const ap_job_t *job)
+{
+    if ( job->src == NULL )
+        tb_memset(job->dst, 0, job->size);
+    else
+        tb_memcpy(job->dst, job->src, job->size);
+}
+
+/* claim and run jobs of the current batch until there are none left */
+static void run_jobs(void)
+{
+    while ( true ) {
+        uint32_t claim = g_ap_work.claim;
+        uint32_t idx = CLAIM_IDX(claim);
+
+        if ( idx >= g_ap_work.num_jobs )
+            return;
+        if ( !cmpxchg_u32(&g_ap_work.claim, claim, claim + 1) ) {
+            cpu_relax();
+            continue;
+        }
+
+        run_job(&g_ap_work.jobs[idx]);
+        atomic_inc(&g_ap_work.done_jobs);
+    }
+}
+
+bool ap_work_is_open(void)
+{
+    return g_ap_work.open;
+}
+
+/* called on the BSP before APs are woken post-launch */
+void ap_work_open(void)
+{
+    if ( !get_tboot_ap_work_queue() )
+        return;
+    if ( !use_mwait() ) {
+        printk(TBOOT_WARN"ap_work_queue requires ap_wake_mwait, ignoring\n");
+        return;
+    }
+
+    g_ap_work.queued = 0;
+    g_ap_work.num_jobs = 0;
+    atomic_store_rel_int(&g_ap_work.claim,
+                         CLAIM_SEQ(g_ap_work.seq) | CLAIM_CLOSED);
+    atomic_store_rel_int(&g_ap_work.open, 1);
+    printk(TBOOT_INFO"AP work queue opened\n");
+}
+
+/* called on the BSP before control is transferred to the kernel */
+void ap_work_close(void)
+{
+    if ( !ap_work_is_open() )
+        return;
+
+    ap_work_flush();
+
+    /* store to the monitored line to kick APs out of MWAIT */
+    atomic_store_rel_int(&g_ap_work.open, 0);
+    atomic_store_rel_int(&g_ap_work.claim,
+                         CLAIM_SEQ(g_ap_work.seq) | CLAIM_CLOSED);
+    printk(TBOOT_INFO"AP work queue closed (%u APs joined)\n",
+           atomic_read(&g_ap_work.num_workers));
+}
+
+/*
+ * called on each AP from ap_wait() after it has released ap_lock; the AP
+ * stays here, running jobs as they are posted, until the queue is closed
+ * do not use printk here, as that would serialize the APs
+ */
+void ap_work_loop(void)
+{
+    if ( !ap_work_is_open() )
+        return;
+
+    atomic_inc(&g_ap_work.num_workers);
+    while ( ap_work_is_open() ) {
+        cpu_monitor((const void *)&g_ap_work.claim, 0, 0);
+        mb();
+        run_jobs();
+        if ( !ap_work_is_open() )
+            break;
+        cpu_mwait(0, 0);
+    }
+    atomic_dec(&g_ap_work.num_workers);
+}
+
+/* run all queued jobs, sharing them with any APs in ap_work_loop() */
+void ap_work_flush(void)
+{
+    uint32_t num_jobs = g_ap_work.queued;
+
+    if ( num_jobs == 0 )
+        return;
+    g_ap_work.queued = 0;
+
+    if ( !ap_work_is_open() || atomic_read(&g_ap_work.num_workers) == 0 ) {
+        for ( uint32_t i = 0; i < num_jobs; i++ )
+            run_job(&g_ap_work.jobs[i]);
+        return;
+    }
+
+    /* queue is closed here, so it is safe to reset the batch state */
+    g_ap_work.num_jobs = num_jobs;
+    g_ap_work.done_jobs = 0;
+    g_ap_work.seq++;
+    atomic_store_rel_int(&g_ap_work.claim, CLAIM_SEQ(g_ap_work.seq));
+
+    /* BSP takes its share too */
+    run_jobs();
+    while ( atomic_read(&g_ap_work.done_jobs) < num_jobs )
+        cpu_relax();
+
+    atomic_store_rel_int(&g_ap_work.claim,
+                         CLAIM_SEQ(g_ap_work.seq) | CLAIM_CLOSED);
+}
+
+static void queue_jobs(void *dst, const void *src, size_t size)
+{
+    while ( size > 0 ) {
+        size_t chunk = size < AP_WORK_CHUNK_SIZE ? size : AP_WORK_CHUNK_SIZE;
+
+        if ( g_ap_work.queued == AP_WORK_MAX_JOBS )
+            ap_work_flush();
+
+        ap_job_t *job = &g_ap_work.jobs[g_ap_work.queued++];
+        job->dst = dst;
+        job->src = src;
+        job->size = chunk;
+
+        dst += chunk;
+        if ( src != NULL )
+            src += chunk;
+        size -= chunk;
+    }
+}
+
+/*
+ * jobs of one batch run in no particular order, so callers must flush
+ * between dependent operations; overlapping copies are done inline
+ */
+void ap_work_copy(void *dst, const void *src, size_t size)
+{
+    if ( !ap_work_is_open() ) {
+        tb_memcpy(dst, src, size);
+        return;
+    }
+
+    if ( (unsigned long)dst < (unsigned long)src + size &&
+         (unsigned long)src < (unsigned long)dst + size ) {
+        ap_work_flush();
+        tb_memcpy(dst, src, size);
+        return;
+    }
+
+    queue_jobs(dst, src, size);
+}
+
+void ap_work_zero(void *dst, size_t size)
+{
+    if ( !ap_work_is_open() ) {
+        tb_memset(dst, 0, size);
+        return;
+    }
+
+    queue_jobs(dst, NULL, size);
+}
+
+
+/*
+ * Local variables:
+ * mode: C
+ * c-set-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -79,6 +79,7 @@ static const cmdline_option_t g_tboot_cmdline_options[] = {
     /* serial=<baud>[/<clock_hz>][,<DPS>[,<io-base>[,<irq>[,<serial-bdf>[,<bridge-bdf>]]]]] */
     { "vga_delay",  "0" },           /* # secs */
     { "ap_wake_mwait", "false" },    /* true|false */
+    { "ap_work_queue", "false" },    /* true|false */
     { "pcr_map", "legacy" },         /* legacy|da */
     { "min_ram", "0" },              /* size in bytes | 0 for no min */
     { "call_racm", "false" },        /* true|false|check */
@@ -88,6 +89,7 @@ static const cmdline_option_t g_tboot_cmdline_options[] = {
     { "force_tpm2_legacy_log", "false"}, /* true|false */
     { "save_vtd", "false"},          /* true|false */
     { "dump_memmap", "false"},          /* true|false */
+    { "evtlog_size", "0" },          /* size in bytes | 0 for TXT heap log */
     { NULL, NULL }
 };
 static char g_tboot_param_values[ARRAY_SIZE(g_tboot_cmdline_options)][MAX_VALUE_LEN];
@@ -476,6 +478,15 @@ bool get_tboot_mwait(void)
     return true;
 }
 
+bool get_tboot_ap_work_queue(void)
+{
+    const char *ap_work = get_option_val(g_tboot_cmdline_options,
+                                         g_tboot_param_values, "ap_work_queue");
+    if ( ap_work == NULL || tb_strcmp(ap_work, "true") != 0 )
+        return false;
+    return true;
+}
+
 bool get_tboot_call_racm(void)
 {
     const char *call_racm = get_option_val(g_tboot_cmdline_options,
@@ -583,6 +594,17 @@ bool get_tboot_dump_memmap(void)
     return false;
 }
 
+uint32_t get_tboot_evtlog_size(void)
+{
+    const char *evtlog_size = get_option_val(g_tboot_cmdline_options,
+                                             g_tboot_param_values,
+                                             "evtlog_size");
+    if ( evtlog_size == NULL )
+        return 0;
+
+    return tb_strtoul(evtlog_size, NULL, 0);
+}
+
 /*
  * linux kernel command line parsing
  */
@@ -42,6 +42,7 @@
 #include <uuid.h>
 #include <loader.h>
 #include <elf_defns.h>
+#include <ap_work.h>
 
 extern loader_ctx *g_ldr_ctx;
 bool elf64 = false;
@@ -208,10 +209,10 @@ bool expand_elf_image(const void *image, void **entry_point)
        for ( int i = 0; i < elf->e_phnum; i++ ) {
            elf64_program_header_t *ph = (elf64_program_header_t *)((void *)elf + elf->e_phoff + i*elf->e_phentsize);
            if ( ph->p_type == PT_LOAD ) {
-              tb_memcpy((void *)(unsigned long)ph->p_paddr, (void *)elf +(unsigned long) ph->p_offset,(unsigned long) ph->p_filesz);
-              //tb_memcpy((void *)ph->p_paddr, (void *)elf + ph->p_offset, ph->p_filesz);
-              tb_memset((void *)(unsigned long)(ph->p_paddr + ph->p_filesz), 0, (unsigned long)ph->p_memsz -(unsigned long) ph->p_filesz);
-              //tb_memset((void *)(ph->p_paddr + ph->p_filesz), 0, ph->p_memsz - ph->p_filesz);
+              ap_work_copy((void *)(unsigned long)ph->p_paddr, (void *)elf +(unsigned long) ph->p_offset,(unsigned long) ph->p_filesz);
+              ap_work_zero((void *)(unsigned long)(ph->p_paddr + ph->p_filesz), (unsigned long)ph->p_memsz -(unsigned long) ph->p_filesz);
+              /* finish this segment before the next one may overwrite it */
+              ap_work_flush();
            }
        }
        *entry_point = (void *)(unsigned long)(elf->e_entry);
@@ -225,8 +226,10 @@ bool expand_elf_image(const void *image, void **entry_point)
        for ( int i = 0; i < elf->e_phnum; i++ ) {
            elf_program_header_t *ph = (elf_program_header_t *)((void *)elf + elf->e_phoff + i*elf->e_phentsize);
            if ( ph->p_type == PT_LOAD ) {
-              tb_memcpy((void *)ph->p_paddr, (void *)elf + ph->p_offset, ph->p_filesz);
-              tb_memset((void *)(ph->p_paddr + ph->p_filesz), 0, ph->p_memsz - ph->p_filesz);
+              ap_work_copy((void *)ph->p_paddr, (void *)elf + ph->p_offset, ph->p_filesz);
+              ap_work_zero((void *)(ph->p_paddr + ph->p_filesz), ph->p_memsz - ph->p_filesz);
+              /* finish this segment before the next one may overwrite it */
+              ap_work_flush();
            }
        }
       *entry_point = (void *)elf->e_entry;
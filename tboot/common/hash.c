@@ -1,5 +1,5 @@
 /*
- * hash.c: support functions for tb_hash_t type
+ * hash.c: tboot backend of the streaming digests for tb_hash_t type
  *
  * Copyright (c) 2006-2010, Intel Corporation
  * All rights reserved.
@@ -45,117 +45,82 @@
 #include <hash.h>
 
 /*
- * are_hashes_equal
- *
- * compare whether two hash values are equal.
+ * streaming digests
  *
+ * the backend of the shared front end (hashlib/hash.c, built here as
+ * common/hashlib.o) on top of tboot's own sha1/sha2 code; all of the state
+ * lives inside the context so nothing is allocated
  */
-bool are_hashes_equal(const tb_hash_t *hash1, const tb_hash_t *hash2,
-                      uint16_t hash_alg)
+
+bool hash_init(hash_ctx_t *ctx, uint16_t hash_alg)
 {
-    unsigned int len;
+    COMPILE_TIME_ASSERT(sizeof(struct sha1_ctxt) <= sizeof(ctx->state));
+    COMPILE_TIME_ASSERT(sizeof(hash_state) <= sizeof(ctx->state));
 
-    if ( ( hash1 == NULL ) || ( hash2 == NULL ) ) {
-        printk(TBOOT_ERR"Error: hash pointer is zero.\n");
+    if ( ctx == NULL )
         return false;
-    }
 
-    len = get_hash_size(hash_alg);
-    if ( len > 0 )
-        return (tb_memcmp(hash1, hash2, len) == 0);
+    ctx->alg = hash_alg;
+    if ( hash_alg == TB_HALG_SHA1 ) {
+        sha1_init((struct sha1_ctxt *)ctx->state);
+        return true;
+    }
+    else if ( hash_alg == TB_HALG_SHA256 )
+        return sha256_init((hash_state *)ctx->state) == 0;
+    else if ( hash_alg == TB_HALG_SHA384 )
+        return sha384_init((hash_state *)ctx->state) == 0;
+    else if ( hash_alg == TB_HALG_SHA512 )
+        return sha512_init((hash_state *)ctx->state) == 0;
     else {
         printk(TBOOT_ERR"unsupported hash alg (%u)\n", hash_alg);
         return false;
     }
 }
 
-/*
- * hash_buffer
- *
- * hash the buffer according to the algorithm
- *
- */
-bool hash_buffer(const unsigned char* buf, size_t size, tb_hash_t *hash,
-                 uint16_t hash_alg)
+bool hash_update(hash_ctx_t *ctx, const void *buf, size_t size)
 {
-    if ( hash == NULL ) {
-        printk(TBOOT_ERR"Error: There is no space for output hash.\n");
+    if ( ctx == NULL )
         return false;
-    }
-
-    if ( hash_alg == TB_HALG_SHA1 ) {
-        sha1_buffer(buf, size, hash->sha1);
-        return true;
-    }
-    else if ( hash_alg == TB_HALG_SHA256 ) {
-        sha256_buffer(buf, size, hash->sha256);
-        return true;
-    }
-    else if ( hash_alg == TB_HALG_SHA384 ) {
-        sha384_buffer(buf, size, hash->sha384);
+    if ( size == 0 )
         return true;
-    }
-    else if ( hash_alg == TB_HALG_SHA512 ) {
-        sha512_buffer(buf, size, hash->sha512);
+
+    if ( ctx->alg == TB_HALG_SHA1 ) {
+        sha1_loop((struct sha1_ctxt *)ctx->state, buf, size);
         return true;
     }
-    else if ( hash_alg == TB_HALG_SM3 ) {
-        printk(TBOOT_ERR"unsupported hash alg (%u)\n", hash_alg);
-        return false;
-    }
-    else {
-        printk(TBOOT_ERR"unsupported hash alg (%u)\n", hash_alg);
+    else if ( ctx->alg == TB_HALG_SHA256 )
+        return sha256_process((hash_state *)ctx->state, buf, size) == 0;
+    else if ( ctx->alg == TB_HALG_SHA384 )
+        return sha384_process((hash_state *)ctx->state, buf, size) == 0;
+    else if ( ctx->alg == TB_HALG_SHA512 )
+        return sha512_process((hash_state *)ctx->state, buf, size) == 0;
+    else
         return false;
-    }
 }
 
-/*
- * extend_hash
- *
- * perform "extend" of two hashes (i.e. hash1 = SHA(hash1 || hash2)
- *
- */
-bool extend_hash(tb_hash_t *hash1, const tb_hash_t *hash2, uint16_t hash_alg)
+bool hash_final(hash_ctx_t *ctx, tb_hash_t *hash)
 {
-    uint8_t buf[2*get_hash_size(hash_alg)];
-
-    if ( hash1 == NULL || hash2 == NULL ) {
-        printk(TBOOT_ERR"Error: There is no space for output hash.\n");
+    if ( ctx == NULL || hash == NULL )
         return false;
-    }
 
-    if ( hash_alg == TB_HALG_SHA1 ) {
-        tb_memcpy(buf, &(hash1->sha1), sizeof(hash1->sha1));
-        tb_memcpy(buf + sizeof(hash1->sha1), &(hash2->sha1), sizeof(hash1->sha1));
-        sha1_buffer(buf, 2*sizeof(hash1->sha1), hash1->sha1);
-        return true;
-    }
-    else if ( hash_alg == TB_HALG_SHA256 ) {
-        tb_memcpy(buf, &(hash1->sha256), sizeof(hash1->sha256));
-        tb_memcpy(buf + sizeof(hash1->sha256), &(hash2->sha256), sizeof(hash1->sha256));
-        sha256_buffer(buf, 2*sizeof(hash1->sha256), hash1->sha256);
+    if ( ctx->alg == TB_HALG_SHA1 ) {
+        sha1_result((struct sha1_ctxt *)ctx->state, hash->sha1);
         return true;
     }
-    else if ( hash_alg == TB_HALG_SHA384 ) {
-        tb_memcpy(buf, &(hash1->sha384), sizeof(hash1->sha384));
-        tb_memcpy(buf + sizeof(hash1->sha384), &(hash2->sha384), sizeof(hash1->sha384));
-        sha384_buffer(buf, 2*sizeof(hash1->sha384), hash1->sha384);
-        return true;
-    }
-    else if ( hash_alg == TB_HALG_SHA512 ) {
-        tb_memcpy(buf, &(hash1->sha512), sizeof(hash1->sha512));
-        tb_memcpy(buf + sizeof(hash1->sha512), &(hash2->sha512), sizeof(hash1->sha512));
-        sha512_buffer(buf, 2*sizeof(hash1->sha512), hash1->sha512);
-        return true;
-    }
-    else if ( hash_alg == TB_HALG_SM3 ) {
-        printk(TBOOT_ERR"unsupported hash alg (%u)\n", hash_alg);
-        return false;
-    }
-    else {
-        printk(TBOOT_ERR"unsupported hash alg (%u)\n", hash_alg);
+    else if ( ctx->alg == TB_HALG_SHA256 )
+        return sha256_done((hash_state *)ctx->state, hash->sha256) == 0;
+    else if ( ctx->alg == TB_HALG_SHA384 )
+        return sha384_done((hash_state *)ctx->state, hash->sha384) == 0;
+    else if ( ctx->alg == TB_HALG_SHA512 )
+        return sha512_done((hash_state *)ctx->state, hash->sha512) == 0;
+    else
         return false;
-    }
+}
+
+void hash_abort(hash_ctx_t *ctx)
+{
+    /* nothing is held outside of the context */
+    (void)ctx;
 }
 
 void print_hash(const tb_hash_t *hash, uint16_t hash_alg)
@@ -179,22 +144,6 @@ void print_hash(const tb_hash_t *hash, uint16_t hash_alg)
     }
 }
 
-void copy_hash(tb_hash_t *dest_hash, const tb_hash_t *src_hash,
-               uint16_t hash_alg)
-{
-    unsigned int len;
-
-    if ( dest_hash == NULL || src_hash == NULL ) {
-        printk(TBOOT_WARN"hashes are NULL\n");
-        return;
-    }
-
-    len = get_hash_size(hash_alg);
-    if ( len > 0 )
-        tb_memcpy(dest_hash, src_hash, len);
-    else
-        printk(TBOOT_WARN"unsupported hash alg (%u)\n", hash_alg);
-}
 
 
 
@@ -60,6 +60,9 @@ extern char _end[];
 __data pre_k_s3_state_t g_pre_k_s3_state;
 __data post_k_s3_state_t g_post_k_s3_state;
 
+/* in .bss, so it is empty on S3 resume (module memory may be gone by then) */
+vl_event_data_t g_vl_event_data[MAX_VL_HASHES];
+
 /* state sealed before extending PCRs and launching kernel */
 static __data uint8_t  sealed_pre_k_state[2048];
 static __data uint32_t sealed_pre_k_state_size;
@@ -78,7 +81,8 @@ extern bool hash_policy(tb_hash_t *hash, uint16_t hash_alg);
 extern void apply_policy(tb_error_t error);
 
 #define EVTTYPE_TB_MEASUREMENT (0x400 + 0x101)
-extern bool evtlog_append(uint8_t pcr, hash_list_t *hl, uint32_t type);
+extern bool evtlog_append(uint8_t pcr, hash_list_t *hl, uint32_t type,
+                          const void *data, uint32_t data_size);
 
 typedef struct {
     uint8_t mac_key[POLY1305_KEY_SIZE];
@@ -96,7 +100,9 @@ static bool extend_pcrs(void)
             return false;
         if ( !evtlog_append(g_pre_k_s3_state.vl_entries[i].pcr,
                             &g_pre_k_s3_state.vl_entries[i].hl,
-                            EVTTYPE_TB_MEASUREMENT) )
+                            EVTTYPE_TB_MEASUREMENT,
+                            g_vl_event_data[i].data,
+                            g_vl_event_data[i].size) )
             return false;
     }
 
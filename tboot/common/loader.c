@@ -58,6 +58,7 @@
 #include <cmdline.h>
 #include <tpm.h>
 #include <efi_memmap.h>
+#include <ap_work.h>
 
 /* copy of kernel/VMM command line so that can append 'tboot=0x1234' */
 static char *new_cmdline = (char *)TBOOT_KERNEL_CMDLINE_ADDR;
@@ -1126,6 +1127,59 @@ move_modules(loader_ctx *lctx)
     return;
 }
 
+/*
+ * pre-launch: move every module that overlaps [base, end) to above all of
+ * the modules and the loader context.  tboot only writes the memory after
+ * its image (event log and per-cpu regions) once launched, which is before
+ * the modules are verified, so nothing the loader placed there may stay.
+ */
+bool move_modules_out_of(loader_ctx *lctx, unsigned long base,
+                         unsigned long end)
+{
+    unsigned int mod_count;
+
+    if ( LOADER_CTX_BAD(lctx) )
+        return false;
+    if ( base >= end )
+        return true;
+
+    /* the loader context holds pointers, so it can't simply be copied */
+    if ( (unsigned long)lctx->addr < end && get_loader_ctx_end(lctx) > base ) {
+        printk(TBOOT_ERR"loader context (%p - %lx) overlaps %lx - %lx\n",
+               lctx->addr, get_loader_ctx_end(lctx) - 1, base, end - 1);
+        return false;
+    }
+
+    mod_count = get_module_count(lctx);
+    for ( unsigned int i = 0; i < mod_count; i++ ) {
+        module_t *m = get_module(lctx, i);
+        unsigned long to, size;
+
+        if ( m == NULL || m->mod_start >= end || m->mod_end <= base )
+            continue;
+
+        /* above everything, so the copy can't overlap any module */
+        size = m->mod_end - m->mod_start;
+        to = PAGE_UP(get_highest_mod_end(lctx));
+        if ( to < end )
+            to = PAGE_UP(end);
+        if ( to < get_loader_ctx_end(lctx) )
+            to = PAGE_UP(get_loader_ctx_end(lctx));
+        if ( e820_check_region(to, size) != E820_RAM ) {
+            printk(TBOOT_ERR"no RAM at %lx to move module %u out of "
+                   "%lx - %lx\n", to, i, base, end - 1);
+            return false;
+        }
+
+        printk(TBOOT_INFO"moving module %u (%lu B) from 0x%08X to 0x%08lX\n",
+               i, size, m->mod_start, to);
+        tb_memcpy((void *)to, (void *)m->mod_start, size);
+        m->mod_start = to;
+        m->mod_end = to + size;
+    }
+    return true;
+}
+
 module_t *get_module(loader_ctx *lctx, unsigned int i)
 {
     if (LOADER_CTX_BAD(lctx))
@@ -1486,6 +1540,9 @@ bool launch_kernel(bool is_measured_launch)
         if(!move_modules_above_elf_kernel(g_ldr_ctx, (elf_header_t *)kernel_image))
             return false;
 
+        /* APs must be parked before the kernel can wake them */
+        ap_work_close();
+
         printk(TBOOT_INFO"transfering control to kernel @%p...\n", 
                kernel_entry_point);
         /* (optionally) pause when transferring to kernel */
@@ -1512,6 +1569,9 @@ bool launch_kernel(bool is_measured_launch)
         expand_linux_image(kernel_image, kernel_size,
                            initrd_image, initrd_size,
                            &kernel_entry_point, is_measured_launch);
+        /* APs must be parked before the kernel can wake them */
+        ap_work_close();
+
         printk(TBOOT_INFO"transfering control to kernel @%p...\n", 
                kernel_entry_point);
         /* (optionally) pause when transferring to kernel */
@@ -120,6 +120,12 @@ static void calibrate_tsc(void)
     g_calibrated = true;
 }
 
+uint64_t get_tsc_ticks_per_ms(void)
+{
+    calibrate_tsc();
+    return g_ticks_per_millisec;
+}
+
 void delay(int millisecs)
 {
     if ( millisecs <= 0 )
@@ -0,0 +1,185 @@
+/*
+ * percpu.c: runtime-sized per-CPU stacks and VMCS pages for APs
+ *
+ * Copyright (c) 2020, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <config.h>
+#include <stdbool.h>
+#include <types.h>
+#include <compiler.h>
+#include <string.h>
+#include <page.h>
+#include <processor.h>
+#include <printk.h>
+#include <multiboot.h>
+#include <uuid.h>
+#include <loader.h>
+#include <e820.h>
+#include <percpu.h>
+
+extern unsigned int get_madt_apic_ids(uint32_t *ids, unsigned int max);
+extern uint32_t get_evtlog_region_used(void);
+
+/* read by the AP entry code in boot.S before it has a stack */
+__data uint32_t g_percpu_base = 0;
+__data uint32_t g_percpu_slots = 0;
+__data uint32_t g_percpu_cap = 0;
+__data uint32_t g_percpu_next = 0;
+
+/* size of the region at g_percpu_base that was checked against the e820 */
+static __data uint32_t g_percpu_size = 0;
+
+static uint32_t percpu_count(void)
+{
+    uint32_t count = get_madt_apic_ids(NULL, PERCPU_MAX_CPUS);
+
+    /* no usable MADT, so fall back to the compile-time default */
+    if ( count == 0 )
+        count = NR_CPUS;
+    return count;
+}
+
+static uint32_t percpu_table_size(uint32_t count)
+{
+    return PAGE_UP(count * sizeof(uint32_t));
+}
+
+/*
+ * the region follows tboot's image and event log region; this has to give
+ * the same answer pre- and post-launch, so it only depends on the MADT
+ */
+uint32_t get_percpu_region_size(void)
+{
+    uint32_t count = percpu_count();
+
+    return percpu_table_size(count) + count * PERCPU_SLOT_SIZE;
+}
+
+bool percpu_init(void)
+{
+    uint32_t count = percpu_count();
+    uint32_t base = PAGE_UP((unsigned long)&_end) + get_evtlog_region_used();
+    uint32_t size = get_percpu_region_size();
+
+    /* on S3 there is no e820 copy (g_nr_map is 0), so the region checked */
+    /* on cold boot is trusted as long as it has not moved or grown */
+    if ( (base != g_percpu_base || size != g_percpu_size) &&
+         e820_check_region(base, size) != E820_RAM ) {
+        printk(TBOOT_ERR"per-cpu region (%x - %x) is not RAM\n",
+               base, base + size - 1);
+        return false;
+    }
+
+    /* VMCSs are cleared when created, so only the id table and the log */
+    /* headers need clearing */
+    tb_memset((void *)base, 0xff, percpu_table_size(count));
+    g_percpu_base = base;
+    g_percpu_size = size;
+    g_percpu_slots = base + percpu_table_size(count);
+    for ( uint32_t i = 0; i < count; i++ )
+        tb_memset(percpu_slot_log(i), 0, offsetof(percpu_log_t, data));
+    g_percpu_next = 0;
+    g_percpu_cap = count;
+    mb();
+
+    printk(TBOOT_DETA"per-cpu region: %x - %x (%u slots)\n",
+           base, base + size - 1, count);
+    return true;
+}
+
+/* # APs that found no free slot and are parked in boot.S */
+uint32_t percpu_overflow(void)
+{
+    uint32_t next = *(volatile uint32_t *)&g_percpu_next;
+
+    return next > g_percpu_cap ? next - g_percpu_cap : 0;
+}
+
+/* # slots in use (excludes APs that overflowed) */
+uint32_t percpu_claimed(void)
+{
+    uint32_t next = *(volatile uint32_t *)&g_percpu_next;
+
+    return next < g_percpu_cap ? next : g_percpu_cap;
+}
+
+uint32_t percpu_apicid(uint32_t slot)
+{
+    return ((volatile uint32_t *)g_percpu_base)[slot];
+}
+
+/* the calling AP's slot, found from the stack it is running on */
+static void *this_slot(void)
+{
+    unsigned long esp;
+
+    __asm__ __volatile__ ("mov %%esp,%0" : "=r" (esp));
+    if ( g_percpu_cap == 0 || esp <= g_percpu_slots ||
+         esp > g_percpu_slots + g_percpu_cap * PERCPU_SLOT_SIZE )
+        return NULL;
+
+    return (void *)(g_percpu_slots +
+                    (esp - g_percpu_slots - 1) / PERCPU_SLOT_SIZE *
+                    PERCPU_SLOT_SIZE);
+}
+
+void *percpu_vmcs(void)
+{
+    return this_slot();
+}
+
+/* NULL on the BSP, or on an AP before it has a slot */
+percpu_log_t *percpu_log(void)
+{
+    void *slot = this_slot();
+
+    return slot == NULL ? NULL : (percpu_log_t *)(slot + PAGE_SIZE);
+}
+
+percpu_log_t *percpu_slot_log(uint32_t slot)
+{
+    return (percpu_log_t *)(g_percpu_slots + slot * PERCPU_SLOT_SIZE +
+                            PAGE_SIZE);
+}
+
+
+/*
+ * Local variables:
+ * mode: C
+ * c-set-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -128,13 +128,31 @@ static const tb_policy_map_t g_policy_map[] = {
     },
 };
 
-/* buffer for policy as read from TPM NV */
-#define MAX_POLICY_SIZE                             \
-    (( MAX_TB_POLICY_SIZE > sizeof(lcp_policy_t) )  \
-        ? MAX_TB_POLICY_SIZE                        \
+/* buffer for policy as read from TPM NV or unwrapped from LCP policy data */
+#define MAX_POLICY_SIZE                                 \
+    (( MAX_TB_POLICY_EXT_SIZE > sizeof(lcp_policy_t) )  \
+        ? MAX_TB_POLICY_EXT_SIZE                        \
         : sizeof(lcp_policy_t) )
 static uint8_t _policy_index_buf[MAX_POLICY_SIZE];
 
+/*
+ * sorted index of the allowed hashes of each TB_HTYPE_IMAGE policy entry
+ * (or set of entries for version 3 policies), built by set_policy() so that
+ * verifying a module is a binary search rather than a scan of every hash
+ */
+#define MAX_POLICY_INDEX_HASHES    2048
+
+typedef struct {
+    const tb_policy_entry_t *pol_entry;     /* first entry of the set */
+    uint16_t                first;          /* into _pol_index_hashes[] */
+    uint16_t                count;
+} pol_index_set_t;
+
+static pol_index_set_t  _pol_index_sets[256];
+static unsigned int     _pol_index_num_sets;
+static const tb_hash_t  *_pol_index_hashes[MAX_POLICY_INDEX_HASHES];
+static uint16_t         _pol_index_hash_alg;
+
 /* default policy */
 static const tb_policy_t _def_policy = {
     version        : 2,
@@ -237,9 +255,6 @@ static const tb_policy_t* g_policy = &_def_policy;
  */
 static bool read_policy_from_tpm(uint32_t index, void* policy_index, size_t *policy_index_size)
 {
-#define NV_READ_SEG_SIZE    256
-    unsigned int offset = 0;
-    unsigned int data_size = 0;
     uint32_t ret, index_size;
     struct tpm_if *tpm = get_tpm();
     const struct tpm_if_fp *tpm_fp = get_tpm_fp();
@@ -258,30 +273,15 @@ static bool read_policy_from_tpm(uint32_t index, void* policy_index, size_t *pol
         index_size = *policy_index_size;
     }
 
-
-    do {
-        /* get data_size */
-        if ( (index_size - offset) > NV_READ_SEG_SIZE )
-            data_size = NV_READ_SEG_SIZE;
-        else
-            data_size = (uint32_t)(index_size - offset);
-
-        /* read! */
-        ret = tpm_fp->nv_read(tpm, tpm->cur_loc, index, offset,
-                             (uint8_t *)policy_index + offset, &data_size);
-        if ( !ret || data_size == 0 )
-            break;
-
-        /* adjust offset */
-        offset += data_size;
-    } while ( offset < index_size );
-
-    if ( offset == 0 && !ret ) {
-        printk(TBOOT_ERR"Error: read TPM error: 0x%x from index %x.\n", ret, index);
+    /* read in the largest chunks the TPM allows */
+    if ( !tpm_nv_read_stream(tpm, tpm->cur_loc, index, 0,
+                             (uint8_t *)policy_index, &index_size) ) {
+        printk(TBOOT_ERR"Error: read TPM error: 0x%x from index %x.\n",
+               tpm->error, index);
         return false;
     }
 
-    *policy_index_size = offset;
+    *policy_index_size = index_size;
 
     return true;
 }
@@ -377,8 +377,14 @@ static bool unwrap_lcp_policy(void)
                     /* check uuid in custom element */
                     if ( are_uuids_equal(&custom->uuid,
                              &((uuid_t)LCP_CUSTOM_ELEMENT_TBOOT_UUID)) ) {
-                        tb_memcpy(_policy_index_buf, &custom->data,
-                            elt->size - sizeof(*elt) - sizeof(uuid_t));
+                        uint32_t pol_size = elt->size - sizeof(*elt) -
+                                            sizeof(uuid_t);
+                        if ( pol_size > sizeof(_policy_index_buf) ) {
+                            printk(TBOOT_ERR"Error: tb policy in LCP is too big (%u)\n",
+                                   pol_size);
+                            return false;
+                        }
+                        tb_memcpy(_policy_index_buf, &custom->data, pol_size);
                         return true; /* find tb policy */
                     }
                 }
@@ -408,6 +414,74 @@ static bool unwrap_lcp_policy(void)
     return false;
 }
 
+/* sort hash pointers by hash value (shell sort, as lists are small) */
+static void sort_hashes(const tb_hash_t **hashes, unsigned int count,
+                        unsigned int hash_size)
+{
+    for ( unsigned int gap = count / 2; gap > 0; gap /= 2 ) {
+        for ( unsigned int i = gap; i < count; i++ ) {
+            const tb_hash_t *tmp = hashes[i];
+            unsigned int j = i;
+            while ( j >= gap &&
+                    tb_memcmp(hashes[j - gap], tmp, hash_size) > 0 ) {
+                hashes[j] = hashes[j - gap];
+                j -= gap;
+            }
+            hashes[j] = tmp;
+        }
+    }
+}
+
+static void build_policy_index(void)
+{
+    uint16_t hash_alg = g_policy->hash_alg;
+    unsigned int hash_size = get_hash_size(hash_alg);
+    unsigned int num_hashes = 0;
+    const tb_policy_entry_t *pol_entry = g_policy->entries;
+
+    _pol_index_num_sets = 0;
+    _pol_index_hash_alg = hash_alg;
+
+    for ( int i = 0; i < g_policy->num_entries; ) {
+        const tb_policy_entry_t *first = pol_entry, *last = pol_entry;
+        unsigned int first_hash = num_hashes;
+        bool fits = true;
+
+        /* gather the hashes of the entry and any entries continuing it */
+        for ( ; pol_entry != NULL;
+              pol_entry = get_next_policy_entry_in_set(g_policy, pol_entry) ) {
+            for ( int j = 0; j < pol_entry->num_hashes; j++ ) {
+                if ( num_hashes >= MAX_POLICY_INDEX_HASHES ) {
+                    fits = false;
+                    break;
+                }
+                _pol_index_hashes[num_hashes++] =
+                    get_policy_entry_hash(pol_entry, hash_alg, j);
+            }
+            last = pol_entry;
+            i++;
+        }
+        pol_entry = (void *)last + calc_policy_entry_size(last, hash_alg);
+
+        if ( first->hash_type != TB_HTYPE_IMAGE || !fits ) {
+            if ( !fits )
+                printk(TBOOT_WARN"policy index is full, hashes for mod_num %u"
+                       " will be searched linearly\n", first->mod_num);
+            num_hashes = first_hash;
+            continue;
+        }
+
+        sort_hashes(&_pol_index_hashes[first_hash], num_hashes - first_hash,
+                    hash_size);
+        _pol_index_sets[_pol_index_num_sets].pol_entry = first;
+        _pol_index_sets[_pol_index_num_sets].first = first_hash;
+        _pol_index_sets[_pol_index_num_sets++].count = num_hashes - first_hash;
+    }
+
+    printk(TBOOT_DETA"policy index: %u hashes in %u sets\n", num_hashes,
+           _pol_index_num_sets);
+}
+
 /*
  * set_policy
  *
@@ -438,6 +512,7 @@ tb_error_t set_policy(void)
      * type is LCP_POLTYPE_LIST (since we could have been give a policy data
      * file even though the policy was not a LIST */
     printk(TBOOT_INFO"reading Launch Control Policy from TPM NV...\n");
+    policy_index_size = sizeof(_policy_index_buf);
     if (read_policy_from_tpm(tpm->lcp_own_index, _policy_index_buf,
                              &policy_index_size) &&
             check_index_attribute(tpm->lcp_own_index)) {
@@ -475,8 +550,8 @@ tb_error_t set_policy(void)
     /* sanity check; but if it fails something is really wrong */
     if ( !verify_policy(g_policy, policy_index_size, true) )
         return TB_ERR_FATAL;
-    else
-        return TB_ERR_POLICY_NOT_PRESENT;
+    build_policy_index();
+    return TB_ERR_POLICY_NOT_PRESENT;
 
 policy_found:
     /* compatible with tb_policy tools for TPM 1.2 */
@@ -486,6 +561,7 @@ policy_found:
             tmp_policy->hash_alg = TB_HALG_SHA1;
     }
     g_policy = (tb_policy_t *)_policy_index_buf;
+    build_policy_index();
     return TB_ERR_NONE;
 }
 
@@ -501,6 +577,10 @@ bool hash_policy(tb_hash_t *hash, uint16_t hash_alg)
                        hash, hash_alg);
 }
 
+/* multi-bank image hashing state, too big for the BSP stack */
+static hash_multi_ctx_t _img_mctx;
+static tb_hash_t        _img_hashes[HASH_MULTI_MAX_ALGS];
+
 /* generate hash by hashing cmdline and module image */
 static bool hash_module(hash_list_t *hl,
                         const char* cmdline, void *base,
@@ -583,18 +663,32 @@ static bool hash_module(hash_list_t *hl,
 
     case TB_EXTPOL_EMBEDDED: 
     {
-        tb_hash_t img_hash;
+        /* the image is read once for (up to HASH_MULTI_MAX_ALGS) banks */
         hl->count = tpm->alg_count;
-        for (unsigned int i=0; i<hl->count; i++) {
-            hl->entries[i].alg = tpm->algs[i];
-            if ( !hash_buffer((const unsigned char *)cmdline, tb_strlen(cmdline),
-                        &hl->entries[i].hash, tpm->algs[i]) )
-                return false;
+        for (unsigned int i=0; i<hl->count; i+=HASH_MULTI_MAX_ALGS) {
+            unsigned int n = hl->count - i;
+            if ( n > HASH_MULTI_MAX_ALGS )
+                n = HASH_MULTI_MAX_ALGS;
 
-            if ( !hash_buffer(base, size, &img_hash, tpm->algs[i]) )
+            if ( !hash_multi_init(&_img_mctx, &tpm->algs[i], n) )
                 return false;
-            if ( !extend_hash(&hl->entries[i].hash, &img_hash, tpm->algs[i]) )
+            if ( !hash_multi_update(&_img_mctx, base, size) ) {
+                hash_multi_abort(&_img_mctx);
                 return false;
+            }
+            if ( !hash_multi_final(&_img_mctx, _img_hashes) )
+                return false;
+
+            for (unsigned int j=0; j<n; j++) {
+                hl->entries[i+j].alg = tpm->algs[i+j];
+                if ( !hash_buffer((const unsigned char *)cmdline,
+                            tb_strlen(cmdline), &hl->entries[i+j].hash,
+                            tpm->algs[i+j]) )
+                    return false;
+                if ( !extend_hash(&hl->entries[i+j].hash, &_img_hashes[j],
+                            tpm->algs[i+j]) )
+                    return false;
+            }
         }
 
         break;
@@ -620,10 +714,36 @@ static bool is_hash_in_policy_entry(const tb_policy_entry_t *pol_entry,
     if ( pol_entry->hash_type == TB_HTYPE_ANY )
         return true;
     else if ( pol_entry->hash_type == TB_HTYPE_IMAGE ) {
-        for ( int i = 0; i < pol_entry->num_hashes; i++ ) {
-            if ( are_hashes_equal(get_policy_entry_hash(pol_entry, hash_alg,
-                                                        i), hash, hash_alg) )
-                return true;
+        /* use the sorted index, if this entry is in it */
+        for ( unsigned int i = 0; i < _pol_index_num_sets &&
+                                  hash_alg == _pol_index_hash_alg; i++ ) {
+            const pol_index_set_t *set = &_pol_index_sets[i];
+            if ( set->pol_entry != pol_entry )
+                continue;
+
+            unsigned int lo = 0, hi = set->count;
+            while ( lo < hi ) {
+                unsigned int mid = lo + (hi - lo) / 2;
+                int cmp = tb_memcmp(_pol_index_hashes[set->first + mid], hash,
+                                    get_hash_size(hash_alg));
+                if ( cmp == 0 )
+                    return true;
+                else if ( cmp < 0 )
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return false;
+        }
+
+        for ( ; pol_entry != NULL;
+              pol_entry = get_next_policy_entry_in_set(g_policy, pol_entry) ) {
+            for ( int i = 0; i < pol_entry->num_hashes; i++ ) {
+                if ( are_hashes_equal(get_policy_entry_hash(pol_entry,
+                                                            hash_alg, i),
+                                      hash, hash_alg) )
+                    return true;
+            }
         }
     }
 
@@ -697,6 +817,7 @@ void apply_policy(tb_error_t error)
 
 #define VL_ENTRIES(i)    g_pre_k_s3_state.vl_entries[i]
 #define NUM_VL_ENTRIES   g_pre_k_s3_state.num_vl_entries
+#define VL_EVENT_DATA(i) g_vl_event_data[i]
 
 /*
  * verify modules against Verified Launch policy and save hash
@@ -749,6 +870,9 @@ static tb_error_t verify_module(module_t *module, tb_policy_entry_t *pol_entry,
     else if ( pol_entry == NULL || pol_entry->pcr != TB_POL_PCR_NONE ) {
         uint8_t pcr = (pol_entry == NULL ) ?
                           (g_using_da ? 17 : 18) : pol_entry->pcr;
+        /* log the command line (which starts with the module name) */
+        VL_EVENT_DATA(NUM_VL_ENTRIES).data = cmdline;
+        VL_EVENT_DATA(NUM_VL_ENTRIES).size = tb_strlen(cmdline);
         VL_ENTRIES(NUM_VL_ENTRIES).pcr = pcr;
         VL_ENTRIES(NUM_VL_ENTRIES++).hl = hl;
     }
@@ -825,12 +949,16 @@ static void verify_g_policy(void)
         break;
     }
 
+    /* log exactly what was hashed: policy control | policy hash */
+    VL_EVENT_DATA(NUM_VL_ENTRIES).data = buf;
+    VL_EVENT_DATA(NUM_VL_ENTRIES).size = size;
     VL_ENTRIES(NUM_VL_ENTRIES++).pcr = 17;
     if ( g_using_da ) {
         /* copying hash of policy_control into PCR 18 */
         if ( NUM_VL_ENTRIES >= MAX_VL_HASHES )
             printk(TBOOT_ERR"\t too many hashes to save for DA\n");
         else {
+            VL_EVENT_DATA(NUM_VL_ENTRIES) = VL_EVENT_DATA(NUM_VL_ENTRIES-1);
             VL_ENTRIES(NUM_VL_ENTRIES).hl = VL_ENTRIES(NUM_VL_ENTRIES-1).hl;
             VL_ENTRIES(NUM_VL_ENTRIES++).pcr = 18;
         }
@@ -894,6 +1022,12 @@ static int find_next_nvpolicy_entry(const tb_policy_t *policy, int i)
     if ( policy == NULL || i < 0 || i >= policy->num_entries )
         return -1;
 
+    /* skip the entries continuing entry i: they only add hashes to its */
+    /* set (which verify_nvindex() checks as a whole), not more indices */
+    tb_policy_entry_t *cont = get_policy_entry(policy, i);
+    while ( (cont = get_next_policy_entry_in_set(policy, cont)) != NULL )
+        i++;
+
     for ( i++; i < policy->num_entries; i++ ) {
         tb_policy_entry_t *pol_entry = get_policy_entry(policy, i);
         if ( pol_entry == NULL )
@@ -972,6 +1106,8 @@ static tb_error_t verify_nvindex(tb_policy_entry_t *pol_entry,
     if ( NUM_VL_ENTRIES >= MAX_VL_HASHES )
         printk(TBOOT_WARN"\t too many hashes to save\n");
     else if ( pol_entry->pcr != TB_POL_PCR_NONE ) {
+        VL_EVENT_DATA(NUM_VL_ENTRIES).data = &pol_entry->nv_index;
+        VL_EVENT_DATA(NUM_VL_ENTRIES).size = sizeof(pol_entry->nv_index);
         VL_ENTRIES(NUM_VL_ENTRIES).pcr = pol_entry->pcr;
         VL_ENTRIES(NUM_VL_ENTRIES).hl.count = 1;
         VL_ENTRIES(NUM_VL_ENTRIES).hl.entries[0].alg = TB_HALG_SHA1;
@@ -44,11 +44,30 @@
 #include <cmdline.h>
 #include <tboot.h>
 #include <memlog.h>
+#include <processor.h>
+#include <page.h>
+#include <percpu.h>
 
 uint8_t g_log_level = TBOOT_LOG_LEVEL_ALL;
 uint8_t g_log_targets = TBOOT_LOG_TARGET_SERIAL | TBOOT_LOG_TARGET_VGA;
 
 static struct mutex print_lock;
+static bool last_line_cr = true;
+
+/*
+ * while AP logging is on, APs with a per-cpu slot append their messages
+ * to their own ring instead of taking print_lock, and the BSP merges the
+ * rings into the log targets in TSC order when it stops AP logging
+ */
+static volatile bool g_ap_logs_on = false;
+static uint64_t g_ap_logs_tsc;
+
+typedef struct {
+    uint64_t tsc;
+    uint32_t len;
+} ap_log_rec_t;
+
+#define AP_LOG_RING_SIZE    sizeof(((percpu_log_t *)0)->data)
 
 void printk_init(bool force_vga_off)
 {
@@ -93,23 +112,148 @@ void printk_flush(void)
         if (g_log_targets & TBOOT_LOG_TARGET_VGA) vga_write(s, n);       \
     } while (0)
 
-void printk(const char *fmt, ...)
+static void ap_log_put(percpu_log_t *log, uint32_t off, const void *src,
+                       uint32_t n)
+{
+    for ( uint32_t i = 0; i < n; i++ )
+        log->data[(off + i) % AP_LOG_RING_SIZE] = ((const char *)src)[i];
+}
+
+static void ap_log_get(const percpu_log_t *log, uint32_t off, void *dst,
+                       uint32_t n)
+{
+    for ( uint32_t i = 0; i < n; i++ )
+        ((char *)dst)[i] = log->data[(off + i) % AP_LOG_RING_SIZE];
+}
+
+/* only ever called by the AP that owns log, so needs no lock */
+static void ap_log_write(percpu_log_t *log, const char *s, uint32_t n)
+{
+    ap_log_rec_t rec = { rdtsc(), n };
+    uint32_t head = log->head;
+
+    if ( head - log->tail + sizeof(rec) + n > AP_LOG_RING_SIZE ) {
+        log->dropped++;
+        return;
+    }
+    ap_log_put(log, head, &rec, sizeof(rec));
+    ap_log_put(log, head + sizeof(rec), s, n);
+    /* publish the record only once it is complete */
+    mb();
+    log->head = head + sizeof(rec) + n;
+}
+
+/* write out every buffered AP record, oldest first; print_lock held */
+static void ap_logs_drain(void)
+{
+    uint32_t slots = percpu_claimed();
+    char buf[256 + 32];
+    int n;
+
+    while ( true ) {
+        percpu_log_t *oldest = NULL;
+        ap_log_rec_t rec, oldest_rec;
+
+        for ( uint32_t i = 0; i < slots; i++ ) {
+            percpu_log_t *log = percpu_slot_log(i);
+
+            if ( log->tail == log->head )
+                continue;
+            ap_log_get(log, log->tail, &rec, sizeof(rec));
+            if ( oldest == NULL || rec.tsc < oldest_rec.tsc ) {
+                oldest = log;
+                oldest_rec = rec;
+            }
+        }
+        if ( oldest == NULL )
+            break;
+
+        n = tb_snprintf(buf, sizeof(buf), "[tsc +%Lu] ",
+                        oldest_rec.tsc - g_ap_logs_tsc);
+        ap_log_get(oldest, oldest->tail + sizeof(rec), buf + n,
+                   oldest_rec.len);
+        n += oldest_rec.len;
+        oldest->tail += sizeof(rec) + oldest_rec.len;
+
+        if ( last_line_cr )
+            WRITE_LOGS("TBOOT: ", 8);
+        last_line_cr = (buf[n-1] == '\n');
+        WRITE_LOGS(buf, n);
+    }
+
+    for ( uint32_t i = 0; i < slots; i++ ) {
+        percpu_log_t *log = percpu_slot_log(i);
+        uint32_t dropped = log->dropped;
+
+        if ( dropped == log->reported )
+            continue;
+        n = tb_snprintf(buf, sizeof(buf),
+                        "TBOOT: cpu %u dropped %u log messages\n",
+                        percpu_apicid(i), dropped - log->reported);
+        WRITE_LOGS(buf, n);
+        log->reported = dropped;
+    }
+}
+
+/* called on the BSP once the per-cpu region is set up, before AP wakeup */
+void printk_ap_logs_start(void)
+{
+    g_ap_logs_tsc = rdtsc();
+    g_ap_logs_on = true;
+}
+
+/* called on the BSP to write out whatever the APs have buffered so far */
+void printk_ap_logs_flush(void)
+{
+    if ( g_percpu_cap == 0 )
+        return;
+
+    mtx_enter(&print_lock);
+    ap_logs_drain();
+    mtx_leave(&print_lock);
+}
+
+/* called on the BSP at a rendezvous, once the APs have logged their wakeup */
+void printk_ap_logs_stop(void)
+{
+    if ( !g_ap_logs_on )
+        return;
+
+    g_ap_logs_on = false;
+    /* pairs with the mb() in vprintk(), so that every record is drained */
+    /* either here or by the AP that wrote it */
+    mb();
+
+    printk_ap_logs_flush();
+}
+
+static void vprintk(bool always_buffer, const char *fmt, va_list ap)
 {
     char buf[256];
     char *pbuf = buf;
     int n;
-    va_list ap;
     uint8_t log_level;
-    static bool last_line_cr = true;
+    percpu_log_t *log;
 
     tb_memset(buf, '\0', sizeof(buf));
-    va_start(ap, fmt);
     n = tb_vscnprintf(buf, sizeof(buf), fmt, ap);
 
     log_level = get_loglvl_prefix(&pbuf, &n);
 
     if ( !(g_log_level & log_level) )
-        goto exit;
+        return;
+
+    if ( (always_buffer || g_ap_logs_on) && (log = percpu_log()) != NULL ) {
+        ap_log_write(log, pbuf, n);
+        mb();
+        if ( always_buffer || g_ap_logs_on )
+            return;
+        /* the BSP may have drained before this record was published */
+        mtx_enter(&print_lock);
+        ap_logs_drain();
+        mtx_leave(&print_lock);
+        return;
+    }
 
     mtx_enter(&print_lock);
     /* prepend "TBOOT: " if the last line that was printed ended with a '\n' */
@@ -119,11 +263,30 @@ void printk(const char *fmt, ...)
     last_line_cr = (n > 0 && (*(pbuf+n-1) == '\n'));
     WRITE_LOGS(pbuf, n);
     mtx_leave(&print_lock);
+}
+
+void printk(const char *fmt, ...)
+{
+    va_list ap;
 
-exit:
+    va_start(ap, fmt);
+    vprintk(false, fmt, ap);
     va_end(ap);
 }
 
+/*
+ * for paths the BSP (or the kernel) is waiting on, e.g. INIT-SIPI-SIPI: an
+ * AP with a per-cpu slot always buffers the message, without taking
+ * print_lock, until the BSP next calls printk_ap_logs_flush()
+ */
+void printk_ap(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vprintk(true, fmt, ap);
+    va_end(ap);
+}
 
 /*
  * Local variables:
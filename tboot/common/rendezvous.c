@@ -0,0 +1,191 @@
+/*
+ * rendezvous.c: AP rendezvous with arrival bitmaps and TSC deadlines
+ *
+ * Copyright (c) 2020, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <config.h>
+#include <stdbool.h>
+#include <types.h>
+#include <compiler.h>
+#include <string.h>
+#include <misc.h>
+#include <processor.h>
+#include <atomic.h>
+#include <printk.h>
+#include <rendezvous.h>
+
+extern unsigned int get_madt_apic_ids(uint32_t *ids, unsigned int max);
+
+/* enabled APIC ids from the MADT, for reporting missing APs */
+static uint32_t g_madt_ids[RDV_MAX_APIC_ID];
+
+void rdv_reset(rendezvous_t *rdv)
+{
+    tb_memset(rdv->map, 0, sizeof(rdv->map));
+    /* not atomic_set(), which ORs the value in */
+    atomic_store_rel_int(&rdv->count, 0);
+}
+
+/* called by each AP as it enters the rendezvous */
+void rdv_arrive(rendezvous_t *rdv)
+{
+    uint32_t id = get_apicid();
+
+    if ( id < RDV_MAX_APIC_ID )
+        atomic_set_int(&rdv->map[id / 32], 1u << (id % 32));
+    atomic_inc(&rdv->count);
+}
+
+/* called by each AP as it leaves the rendezvous */
+void rdv_depart(rendezvous_t *rdv)
+{
+    uint32_t id = get_apicid();
+
+    if ( id < RDV_MAX_APIC_ID )
+        atomic_clear_int(&rdv->map[id / 32], 1u << (id % 32));
+    atomic_dec(&rdv->count);
+}
+
+uint32_t rdv_count(rendezvous_t *rdv)
+{
+    return atomic_read(&rdv->count);
+}
+
+static bool rdv_is_in(rendezvous_t *rdv, uint32_t id)
+{
+    return id < RDV_MAX_APIC_ID && (rdv->map[id / 32] & (1u << (id % 32)));
+}
+
+/*
+ * spin (no printk, which would stall on serial) until done() holds or the
+ * deadline passes; the APs only touch the counter and bitmap, so there is
+ * no wake-up event for MWAIT to use to honour the deadline
+ */
+static bool rdv_spin(rendezvous_t *rdv, uint32_t target, bool arriving,
+                     unsigned int timeout_ms, uint64_t *ticks)
+{
+    uint64_t start = rdtsc();
+    uint64_t deadline = start + timeout_ms * get_tsc_ticks_per_ms();
+    uint64_t now = start;
+    bool done;
+
+    while ( true ) {
+        done = arriving ? rdv_count(rdv) >= target : rdv_count(rdv) == 0;
+        if ( done || now >= deadline )
+            break;
+        cpu_relax();
+        now = rdtsc();
+    }
+
+    *ticks = now - start;
+    return done;
+}
+
+/* print the APIC ids of the enabled APs for which in(id) == want_in */
+static void rdv_print_aps(rendezvous_t *rdv, bool want_in)
+{
+    uint32_t bsp = get_apicid();
+    unsigned int n = 0;
+
+    printk(TBOOT_INFO"\t");
+    if ( want_in ) {
+        for ( uint32_t id = 0; id < RDV_MAX_APIC_ID; id++ ) {
+            if ( id != bsp && rdv_is_in(rdv, id) ) {
+                printk(TBOOT_INFO"%u ", id);
+                n++;
+            }
+        }
+    }
+    else {
+        unsigned int count = get_madt_apic_ids(g_madt_ids,
+                                               ARRAY_SIZE(g_madt_ids));
+
+        for ( unsigned int i = 0; i < count; i++ ) {
+            if ( g_madt_ids[i] != bsp && !rdv_is_in(rdv, g_madt_ids[i]) ) {
+                printk(TBOOT_INFO"%u ", g_madt_ids[i]);
+                n++;
+            }
+        }
+    }
+    printk(TBOOT_INFO"%s\n", n == 0 ? "(unknown)" : "");
+}
+
+/*
+ * wait (as the BSP) until target APs have arrived; on timeout, report the
+ * MADT-enabled APs that never did
+ */
+bool rdv_wait_arrived(rendezvous_t *rdv, uint32_t target,
+                      unsigned int timeout_ms)
+{
+    uint64_t ticks;
+
+    if ( rdv_spin(rdv, target, true, timeout_ms, &ticks) ) {
+        printk(TBOOT_DETA"%u APs arrived in %Lu TSC ticks\n", target, ticks);
+        return true;
+    }
+
+    printk(TBOOT_WARN"%u of %u APs arrived within %u ms, missing APIC ids:\n",
+           rdv_count(rdv), target, timeout_ms);
+    rdv_print_aps(rdv, false);
+    return false;
+}
+
+/*
+ * wait (as the BSP) until all APs have left; on timeout, report the APs
+ * that are still in
+ */
+bool rdv_wait_departed(rendezvous_t *rdv, unsigned int timeout_ms)
+{
+    uint64_t ticks;
+
+    if ( rdv_spin(rdv, 0, false, timeout_ms, &ticks) ) {
+        printk(TBOOT_DETA"all APs left in %Lu TSC ticks\n", ticks);
+        return true;
+    }
+
+    printk(TBOOT_WARN"%u APs did not leave within %u ms, APIC ids:\n",
+           rdv_count(rdv), timeout_ms);
+    rdv_print_aps(rdv, true);
+    return false;
+}
+
+
+/*
+ * Local variables:
+ * mode: C
+ * c-set-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -72,6 +72,9 @@
 #include <tpm_20.h>
 #include <vtd.h>
 #include <efi_memmap.h>
+#include <ap_work.h>
+#include <rendezvous.h>
+#include <percpu.h>
 
 extern void _prot_to_real(uint32_t dist_addr);
 extern bool set_policy(void);
@@ -82,15 +85,15 @@ extern void verify_IA32_se_svn_status(const acm_hdr_t *acm_hdr);
 void s3_launch(void);
 extern __data u32 handle2048;
 extern __data tpm_contextsave_out tpm2_context_saved;
-/* counter timeout for waiting for all APs to exit guests */
-#define AP_GUEST_EXIT_TIMEOUT     0x01000000
+/* timeout for waiting for all APs to exit guests */
+#define AP_GUEST_EXIT_TIMEOUT_MS  1000
 
 extern long s3_flag;
 
 extern char s3_wakeup_16[];
 extern char s3_wakeup_end[];
 
-extern atomic_t ap_wfs_count;
+extern rendezvous_t ap_wfs;
 
 extern struct mutex ap_lock;
 
@@ -109,9 +112,11 @@ extern tboot_shared_t _tboot_shared;
  */
 static __data uint8_t g_saved_s3_wakeup_page[PAGE_SIZE];
 
+/* includes the event log region (if used) and per-cpu region after tboot */
 unsigned long get_tboot_mem_end(void)
 {
-    return PAGE_UP((unsigned long)&_end);
+    return PAGE_UP((unsigned long)&_end) + get_evtlog_region_used() +
+           get_percpu_region_size();
 }
 
 static tb_error_t verify_platform(void)
@@ -183,6 +188,10 @@ static void post_launch(void)
     /* init MLE/kernel shared data page early, .num_in_wfs used in ap wakeup*/
     _tboot_shared.num_in_wfs = 0;
 
+    /* let APs help with kernel loading (not on S3, no kernel is loaded) */
+    if ( !s3_flag )
+        ap_work_open();
+
     txt_post_launch();
 
     /* backup DMAR table */
@@ -263,7 +272,7 @@ static void post_launch(void)
     uint32_t key_size = sizeof(_tboot_shared.s3_key);
     if ( !tpm_fp->get_random(tpm, 2, _tboot_shared.s3_key, &key_size) || key_size != sizeof(_tboot_shared.s3_key) )
         apply_policy(TB_ERR_S3_INTEGRITY);
-    _tboot_shared.num_in_wfs = atomic_read(&ap_wfs_count);
+    _tboot_shared.num_in_wfs = rdv_count(&ap_wfs);
     if ( use_mwait() ) {
         _tboot_shared.flags |= TB_FLAG_AP_WAKE_SUPPORT;
         _tboot_shared.ap_wake_trigger = AP_WAKE_TRIGGER_DEF;
@@ -426,6 +435,7 @@ void begin_launch(void *addr, uint32_t magic)
            apply_policy(TB_ERR_SINIT_NOT_PRESENT);
        if (!verify_acmod(g_sinit)) 
            apply_policy(TB_ERR_ACMOD_VERIFY_FAILED);
+       print_acmod_cache_stats();
     }
     
     /* make TPM ready for measured launch */
@@ -600,7 +610,7 @@ void shutdown(void)
    
     /* wait-for-sipi only invoked for APs, so skip all BSP shutdown code */
     if ( _tboot_shared.shutdown_type == TB_SHUTDOWN_WFS ) {
-        atomic_inc(&ap_wfs_count);
+        rdv_arrive(&ap_wfs);
         _tboot_shared.ap_wake_trigger = 0;
         mtx_enter(&ap_lock);
         printk(TBOOT_INFO"shutdown(): TB_SHUTDOWN_WFS\n");
@@ -613,8 +623,10 @@ void shutdown(void)
 
     printk(TBOOT_INFO"wait until all APs ready for txt shutdown\n");
     while( atomic_read(&_tboot_shared.num_in_wfs)
-           < atomic_read(&ap_wfs_count) )
+           < rdv_count(&ap_wfs) )
         cpu_relax();
+    /* e.g. AP park/unpark times from while the kernel ran */
+    printk_ap_logs_flush();
 
     /* ensure localities 0, 1 are inactive (in case kernel used them) */
     /* request TPM current locality to be active */
@@ -685,26 +697,15 @@ void shutdown(void)
         if ( !use_mwait() ) {
             /* force APs to exit mini-guests if any are in and wait until */
             /* all are out before shutting down TXT */
-            printk(TBOOT_INFO"waiting for APs (%u) to exit guests...\n", atomic_read(&ap_wfs_count));
+            printk(TBOOT_INFO"waiting for APs (%u) to exit guests...\n", rdv_count(&ap_wfs));
             force_aps_exit();
-            uint32_t timeout = AP_GUEST_EXIT_TIMEOUT;
-            do {
-                if ( timeout % 0x8000 == 0 )
-                    printk(TBOOT_INFO".");
-                else
-                    cpu_relax();
-                if ( timeout % 0x200000 == 0 )
-                    printk(TBOOT_INFO"\n");
-                timeout--;
-            } while ( ( atomic_read(&ap_wfs_count) > 0 ) && timeout > 0 );
-            printk(TBOOT_INFO"\n");
-            if ( timeout == 0 )
+            if ( !rdv_wait_departed(&ap_wfs, AP_GUEST_EXIT_TIMEOUT_MS) )
                 printk(TBOOT_INFO"AP guest exit loop timed-out\n");
             else
                 printk(TBOOT_INFO"all APs exited guests\n");
         } else {
-            /* reset ap_wfs_count to avoid tboot hash changing in S3 case */
-            atomic_set(&ap_wfs_count, 0);
+            /* reset ap_wfs to avoid tboot hash changing in S3 case */
+            rdv_reset(&ap_wfs);
         }
 
         /* turn off TXT (GETSEC[SEXIT]) */
@@ -54,3 +54,6 @@ SECTIONS
 
   _end = . ;
 }
+
+ASSERT(_mle_start == TBOOT_START, "MLE page table size does not match TBOOT_START")
+ASSERT(_mle_end - _mle_start <= MLE_MAX_SIZE, "MLE too big for MLE page table")
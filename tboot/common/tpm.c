@@ -899,6 +899,45 @@ void tpm_print(struct tpm_if *ti)
     printk(TBOOT_INFO"\t timeout values: A: %u, B: %u, C: %u, D: %u\n", ti->timeout.timeout_a, ti->timeout.timeout_b, ti->timeout.timeout_c, ti->timeout.timeout_d);
 } 
 
+/* used if the TPM driver did not report a max NV read size */
+#define TPM_NV_READ_DEFAULT_MAX    256
+
+/*
+ * read *data_size bytes of NV index starting at offset, using the largest
+ * reads the TPM allows; *data_size is in/out and returns the # bytes read,
+ * which may be short if a read fails part way through
+ */
+bool tpm_nv_read_stream(struct tpm_if *ti, u32 locality, u32 index,
+                        u32 offset, u8 *data, u32 *data_size)
+{
+    const struct tpm_if_fp *tpm_fp = get_tpm_fp();
+    u32 chunk_max, done = 0;
+
+    if ( ti == NULL || tpm_fp == NULL || data == NULL || data_size == NULL )
+        return false;
+
+    chunk_max = ti->nv_read_max ? ti->nv_read_max : TPM_NV_READ_DEFAULT_MAX;
+    while ( done < *data_size ) {
+        u32 chunk = *data_size - done;
+        if ( chunk > chunk_max )
+            chunk = chunk_max;
+
+        if ( !tpm_fp->nv_read(ti, locality, index, offset + done,
+                              data + done, &chunk) || chunk == 0 )
+            break;
+        done += chunk;
+    }
+
+    if ( done == 0 && *data_size != 0 ) {
+        printk(TBOOT_ERR"TPM: read NV index %08x failed, error 0x%x\n",
+               index, ti->error);
+        return false;
+    }
+
+    *data_size = done;
+    return true;
+}
+
 struct tpm_if *get_tpm(void)
 {
     return &g_tpm;
@@ -1623,6 +1623,63 @@ static uint32_t _tpm20_get_random(uint32_t locality,
     return ret;
 }
 
+static uint32_t _tpm20_get_capability(uint32_t locality,
+                                      tpm_get_capability_in *in,
+                                      tpm_get_capability_out *out)
+{
+    u32 ret;
+    u32 cmd_size, rsp_size;
+    u16 rsp_tag;
+    void *other;
+
+    /* only TPM properties are supported */
+    if ( in->capability != TPM_CAP_TPM_PROPERTIES )
+        return TPM_RC_FAILURE;
+
+    reverse_copy_header(TPM_CC_GetCapability, 0);
+
+    other = (void *)cmd_buf + CMD_HEAD_SIZE;
+    reverse_copy_in(other, in->capability);
+    reverse_copy_in(other, in->property);
+    reverse_copy_in(other, in->property_count);
+
+    /* Now set the command size field, now that we know the size of the whole command */
+    cmd_size = (u8 *)other - cmd_buf;
+    reverse_copy(cmd_buf + CMD_SIZE_OFFSET, &cmd_size, sizeof(cmd_size));
+
+    rsp_size = sizeof(*out);
+
+    if (g_tpm_family == TPM_IF_20_FIFO) {
+        if (!tpm_submit_cmd(locality, cmd_buf, cmd_size, rsp_buf, &rsp_size))
+            return TPM_RC_FAILURE;
+        }
+    if (g_tpm_family == TPM_IF_20_CRB) {
+        if (!tpm_submit_cmd_crb(locality, cmd_buf, cmd_size, rsp_buf, &rsp_size))
+            return TPM_RC_FAILURE;
+        }
+
+    reverse_copy(&ret, rsp_buf + RSP_RST_OFFSET, sizeof(ret));
+    if ( ret != TPM_RC_SUCCESS )
+        return ret;
+
+    other = (void *)rsp_buf + RSP_HEAD_SIZE;
+    reverse_copy(&rsp_tag, rsp_buf, sizeof(rsp_tag));
+    if (rsp_tag == TPM_ST_SESSIONS)
+        other += sizeof(u32);
+
+    reverse_copy_out(out->more_data, other);
+    reverse_copy_out(out->data.capability, other);
+    reverse_copy_out(out->data.data.tpm_properties.count, other);
+    if ( out->data.data.tpm_properties.count > MAX_TPM_PROPERTIES )
+        return TPM_RC_FAILURE;
+    for ( u32 i = 0; i < out->data.data.tpm_properties.count; i++ ) {
+        reverse_copy_out(out->data.data.tpm_properties.tpm_property[i].property, other);
+        reverse_copy_out(out->data.data.tpm_properties.tpm_property[i].value, other);
+    }
+
+    return ret;
+}
+
 static uint32_t _tpm20_shutdown(uint32_t locality, u16 type)
 {
     u32 ret;
@@ -2314,6 +2371,29 @@ static bool tpm20_nv_read(struct tpm_if *ti, uint32_t locality,
     return true;
 }
 
+/*
+ * cache of NV index public areas, so that callers that ask for the size and
+ * the attributes of the same index (e.g. the policy code) only cause one
+ * NV_ReadPublic; an entry is dropped when its index is written, as that can
+ * change its attributes
+ */
+#define NV_PUBLIC_CACHE_SIZE    8
+
+static struct {
+    u32     index;          /* 0 means unused */
+    u32     data_size;
+    u32     attr;
+} nv_public_cache[NV_PUBLIC_CACHE_SIZE];
+static unsigned int nv_public_cache_next;
+
+static void nv_public_cache_drop(uint32_t index)
+{
+    for ( unsigned int i = 0; i < NV_PUBLIC_CACHE_SIZE; i++ ) {
+        if ( nv_public_cache[i].index == index )
+            nv_public_cache[i].index = 0;
+    }
+}
+
 static bool tpm20_nv_write(struct tpm_if *ti, uint32_t locality,
                            uint32_t index, uint32_t offset,
                            const uint8_t *data, uint32_t data_size)
@@ -2334,6 +2414,7 @@ static bool tpm20_nv_write(struct tpm_if *ti, uint32_t locality,
     write_in.data.t.size = data_size;
     tb_memcpy(&write_in.data.t.buffer[0], data, data_size);
 
+    nv_public_cache_drop(index);
     ret = _tpm20_nv_write(locality, &write_in, &write_out);
     if ( ret != TPM_RC_SUCCESS ) {
         printk(TBOOT_WARN"TPM: write NV %08x, offset %08x, %08x bytes, return value = %08X\n",
@@ -2345,15 +2426,22 @@ static bool tpm20_nv_write(struct tpm_if *ti, uint32_t locality,
     return true;
 }
 
-static bool tpm20_get_nvindex_size(struct tpm_if *ti, uint32_t locality,
-                                   uint32_t index, uint32_t *size)
+static bool tpm20_get_nv_public(struct tpm_if *ti, uint32_t locality,
+                                uint32_t index, uint32_t *size,
+                                uint32_t *attribute)
 {
     tpm_nv_read_public_in public_in;
     tpm_nv_read_public_out public_out;
+    unsigned int slot;
     u32 ret;
 
-    if ( ti == NULL || size == NULL )
-        return false;
+    for ( unsigned int i = 0; i < NV_PUBLIC_CACHE_SIZE; i++ ) {
+        if ( index != 0 && nv_public_cache[i].index == index ) {
+            *size = nv_public_cache[i].data_size;
+            *attribute = nv_public_cache[i].attr;
+            return true;
+        }
+    }
 
     public_in.index = index;
 
@@ -2372,40 +2460,37 @@ static bool tpm20_get_nvindex_size(struct tpm_if *ti, uint32_t locality,
     }
 
     *size = public_out.nv_public.t.nv_public.data_size;
+    *attribute = *(uint32_t*)(&public_out.nv_public.t.nv_public.attr);
+
+    slot = nv_public_cache_next++ % NV_PUBLIC_CACHE_SIZE;
+    nv_public_cache[slot].index = index;
+    nv_public_cache[slot].data_size = *size;
+    nv_public_cache[slot].attr = *attribute;
 
     return true;
 }
 
-static bool tpm20_get_nvindex_permission(struct tpm_if *ti, uint32_t locality,
-                                    uint32_t index, uint32_t *attribute)
+static bool tpm20_get_nvindex_size(struct tpm_if *ti, uint32_t locality,
+                                   uint32_t index, uint32_t *size)
 {
-    tpm_nv_read_public_in public_in;
-    tpm_nv_read_public_out public_out;
-    u32 ret;
+    u32 attribute;
 
-    if ( ti == NULL || locality >= TPM_NR_LOCALITIES
-         || index == 0 || attribute == NULL )
+    if ( ti == NULL || size == NULL )
         return false;
 
-    public_in.index = index;
+    return tpm20_get_nv_public(ti, locality, index, size, &attribute);
+}
 
-    ret = _tpm20_nv_read_public(locality, &public_in, &public_out);
-    if ( ret != TPM_RC_SUCCESS ) {
-        printk(TBOOT_WARN"TPM: fail to get public data of 0x%08X in TPM NV\n", index);
-        ti->error = ret;
-        return false;
-    }
+static bool tpm20_get_nvindex_permission(struct tpm_if *ti, uint32_t locality,
+                                    uint32_t index, uint32_t *attribute)
+{
+    u32 size;
 
-    if (index != public_out.nv_public.t.nv_public.index) {
-        printk(TBOOT_WARN"TPM: Index 0x%08X is not the one expected 0x%08X\n",
-                index, index);
-        ti->error = TPM_RC_FAILURE;
+    if ( ti == NULL || locality >= TPM_NR_LOCALITIES
+         || index == 0 || attribute == NULL )
         return false;
-    }
 
-    *attribute = *(uint32_t*)(&public_out.nv_public.t.nv_public.attr);
-
-    return true;
+    return tpm20_get_nv_public(ti, locality, index, &size, attribute);
 }
 
 static bool tpm20_seal(struct tpm_if *ti, uint32_t locality,
@@ -2756,6 +2841,26 @@ static bool tpm20_init(struct tpm_if *ti)
     /* create one common password sesson*/
     create_pw_session(&pw_session);
 
+    /* get max NV read size, limited by our own buffers */
+    tpm_get_capability_in cap_in;
+    tpm_get_capability_out cap_out;
+    cap_in.capability = TPM_CAP_TPM_PROPERTIES;
+    cap_in.property = TPM_PT_NV_BUFFER_MAX;
+    cap_in.property_count = 1;
+    ti->nv_read_max = 0;
+    ret = _tpm20_get_capability(ti->cur_loc, &cap_in, &cap_out);
+    if ( ret == TPM_RC_SUCCESS && cap_out.data.data.tpm_properties.count == 1 &&
+         cap_out.data.data.tpm_properties.tpm_property[0].property ==
+             TPM_PT_NV_BUFFER_MAX ) {
+        ti->nv_read_max = cap_out.data.data.tpm_properties.tpm_property[0].value;
+        if ( ti->nv_read_max > MAX_NV_INDEX_SIZE )
+            ti->nv_read_max = MAX_NV_INDEX_SIZE;
+    }
+    else
+        printk(TBOOT_WARN"TPM: failed to get max NV buffer size, return value = %08X\n",
+               ret);
+    printk(TBOOT_DETA"TPM: max NV read size = %u\n", ti->nv_read_max);
+
     /* init supported alg list for banks */
     tpm_pcr_event_in event_in;
     tpm_pcr_event_out event_out;
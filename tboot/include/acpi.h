@@ -322,6 +322,16 @@ struct acpi_madt_platform_int {
 #define	ACPI_MADT_PLATFORM_CPEI		0x00000001
 } __packed;
 
+struct acpi_madt_x2apic {
+	u_int8_t	apic_type;
+#define	ACPI_MADT_X2APIC	9
+	u_int8_t	length;
+	u_int16_t	reserved;
+	u_int32_t	x2apic_id;
+	u_int32_t	flags;		/* Same flags as acpi_madt_lapic */
+	u_int32_t	acpi_proc_uid;
+} __packed;
+
 union acpi_madt_entry {
 	struct acpi_madt_lapic		madt_lapic;
 	struct acpi_madt_ioapic		madt_ioapic;
@@ -332,6 +342,7 @@ union acpi_madt_entry {
 	struct acpi_madt_io_sapic	madt_io_sapic;
 	struct acpi_madt_local_sapic	madt_local_sapic;
 	struct acpi_madt_platform_int	madt_platform_int;
+	struct acpi_madt_x2apic		madt_x2apic;
 } __packed;
 
 struct device_scope {
@@ -505,6 +516,7 @@ extern bool machine_sleep(const tboot_acpi_sleep_info_t *);
 extern void set_s3_resume_vector(const tboot_acpi_sleep_info_t *, uint64_t);
 extern struct acpi_rsdp *get_rsdp(loader_ctx *lctx);
 extern uint32_t get_madt_apic_base(void);
+extern unsigned int get_madt_apic_ids(uint32_t *ids, unsigned int max);
 
 #endif	/* __ACPI_H__ */
 
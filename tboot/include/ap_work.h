@@ -0,0 +1,72 @@
+/*
+ * ap_work.h: simple work queue that lets idle APs help the BSP
+ *
+ * Copyright (c) 2020, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __AP_WORK_H__
+#define __AP_WORK_H__
+
+/*
+ * Post-launch, APs that are parked in ap_wait() (ap_wake_mwait=true) can
+ * be put to use by the BSP for bulk memory work, e.g. copying and zeroing
+ * ELF segments.  The queue is only open between the AP wakeup in
+ * txt_post_launch() and the hand-off to the kernel; while it is closed
+ * (or when no AP has joined) all work is done inline by the caller.
+ */
+
+/* max # jobs in one batch; queueing more forces a flush */
+#define AP_WORK_MAX_JOBS      64
+/* work is split into chunks of this size so that APs can share it */
+#define AP_WORK_CHUNK_SIZE    0x100000      /* 1MB */
+
+extern void ap_work_open(void);
+extern void ap_work_close(void);
+extern bool ap_work_is_open(void);
+extern void ap_work_loop(void);
+
+extern void ap_work_copy(void *dst, const void *src, size_t size);
+extern void ap_work_zero(void *dst, size_t size);
+extern void ap_work_flush(void);
+
+#endif    /* __AP_WORK_H__ */
+
+
+/*
+ * Local variables:
+ * mode: C
+ * c-set-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
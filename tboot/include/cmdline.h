@@ -48,6 +48,7 @@ extern void get_tboot_baud(void);
 extern void get_tboot_fmt(void);
 extern void get_tboot_vga_delay(void);
 extern bool get_tboot_mwait(void);
+extern bool get_tboot_ap_work_queue(void);
 extern bool get_tboot_prefer_da(void);
 extern void get_tboot_min_ram(void);
 extern bool get_tboot_call_racm(void);
@@ -58,6 +59,7 @@ extern void get_tboot_extpol(void);
 extern bool get_tboot_force_tpm2_legacy_log(void);
 extern bool get_tboot_save_vtd(void);
 extern bool get_tboot_dump_memmap(void);
+extern uint32_t get_tboot_evtlog_size(void);
 
 /* for parse cmdline of linux kernel, say vga and mem */
 extern void linux_parse_cmdline(const char *cmdline);
@@ -83,8 +83,17 @@ typedef struct {
     uint8_t  kernel_integ[POLY1305_DIGEST_SIZE];
 } post_k_s3_state_t;
 
+/*
+ * event data logged with each VL measurement (e.g. module command line);
+ * not sealed, so it is only present on the launch that computed it
+ */
+typedef struct {
+    const void *data;
+    uint32_t    size;
+} vl_event_data_t;
 
 extern pre_k_s3_state_t g_pre_k_s3_state;
+extern vl_event_data_t g_vl_event_data[MAX_VL_HASHES];
 extern post_k_s3_state_t g_post_k_s3_state;
 
 extern bool seal_pre_k_state(void);
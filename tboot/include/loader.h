@@ -85,6 +85,8 @@ extern bool verify_modules(loader_ctx *lctx);
 extern module_t *get_module(loader_ctx *lctx, unsigned int i);
 extern unsigned int get_module_count(loader_ctx *lctx);
 extern bool remove_txt_modules(loader_ctx *lctx);
+extern bool move_modules_out_of(loader_ctx *lctx, unsigned long base,
+                                unsigned long end);
 
 extern bool	have_loader_memlimits(loader_ctx *lctx);
 extern bool have_loader_memmap(loader_ctx *lctx);
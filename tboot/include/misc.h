@@ -39,6 +39,7 @@
 extern void print_hex(const char * buf, const void * prtptr, size_t size);
 
 extern void delay(int millisecs);
+extern uint64_t get_tsc_ticks_per_ms(void);
 
 /*
  *  These three "plus overflow" functions take a "x" value
@@ -0,0 +1,104 @@
+/*
+ * percpu.h: runtime-sized per-CPU stacks and VMCS pages for APs
+ *
+ * Copyright (c) 2020, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef __PERCPU_H__
+#define __PERCPU_H__
+
+#include <page.h>
+
+/*
+ * Each AP that joins the MLE claims a slot in the per-CPU region, which
+ * lives in reserved memory just past tboot (and its event log region, if
+ * used) and is sized at runtime from the number of enabled CPUs in the
+ * MADT.  A slot is a VMCS page, then the AP's log buffer (see printk.c),
+ * then its stack.  Slots are handed out densely in arrival order and a
+ * table of APIC ids at the start of the region maps each one back to its
+ * owner, so sparse and x2APIC ids need no more memory than a dense
+ * numbering would.
+ */
+
+#define PERCPU_LOG_SIZE       PAGE_SIZE
+#define PERCPU_STACK_SIZE     PAGE_SIZE
+#define PERCPU_SLOT_SIZE      (PAGE_SIZE + PERCPU_LOG_SIZE + PERCPU_STACK_SIZE)
+
+/* upper bound on slots, whatever the MADT says */
+#define PERCPU_MAX_CPUS       4096
+
+#define PERCPU_ID_FREE        0xffffffff
+
+#ifndef __ASSEMBLY__
+
+/*
+ * single-producer ring of printk records (tsc, length, text), written only
+ * by the owning AP and drained under the print lock; head and tail are
+ * free-running byte counts (an AP would have to log 4GB to wrap them)
+ */
+typedef struct {
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t dropped;
+    uint32_t          reported;     /* dropped count already logged */
+    char              data[PERCPU_LOG_SIZE - 16];
+} percpu_log_t;
+
+extern uint32_t g_percpu_base;     /* APIC id table */
+extern uint32_t g_percpu_slots;    /* first slot */
+extern uint32_t g_percpu_cap;      /* # slots */
+extern uint32_t g_percpu_next;     /* # slots claimed (may exceed cap) */
+
+extern uint32_t get_percpu_region_size(void);
+extern bool percpu_init(void);
+extern uint32_t percpu_overflow(void);
+extern uint32_t percpu_claimed(void);
+extern uint32_t percpu_apicid(uint32_t slot);
+extern void *percpu_vmcs(void);
+extern percpu_log_t *percpu_log(void);
+extern percpu_log_t *percpu_slot_log(uint32_t slot);
+
+#endif /* __ASSEMBLY__ */
+
+#endif    /* __PERCPU_H__ */
+
+
+/*
+ * Local variables:
+ * mode: C
+ * c-set-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -63,7 +63,12 @@ extern serial_port_t g_com_port;
 extern void printk_init(bool force_vga_off);
 extern void printk_disable_vga(void);
 extern void printk_flush(void);
+extern void printk_ap_logs_start(void);
+extern void printk_ap_logs_stop(void);
+extern void printk_ap_logs_flush(void);
 extern void printk(const char *fmt, ...)
                          __attribute__ ((format (printf, 1, 2)));
+extern void printk_ap(const char *fmt, ...)
+                         __attribute__ ((format (printf, 1, 2)));
 
 #endif
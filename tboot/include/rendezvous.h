@@ -0,0 +1,75 @@
+/*
+ * rendezvous.h: AP rendezvous with arrival bitmaps and TSC deadlines
+ *
+ * Copyright (c) 2020, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __RENDEZVOUS_H__
+#define __RENDEZVOUS_H__
+
+/*
+ * A rendezvous counts the APs that are currently "in" (e.g. in
+ * wait-for-sipi) and marks each one's APIC id in a bitmap.  The BSP waits
+ * for the count to reach a target with a TSC deadline rather than a
+ * counted loop, so it proceeds as soon as the last AP arrives (or leaves)
+ * and, on timeout, can report exactly which APs never made it.
+ */
+
+/* APs with larger APIC ids are counted but not tracked in the bitmap */
+#define RDV_MAX_APIC_ID    4096
+
+typedef struct {
+    atomic_t  count;
+    uint32_t  map[RDV_MAX_APIC_ID / 32];
+} rendezvous_t;
+
+extern void rdv_reset(rendezvous_t *rdv);
+extern void rdv_arrive(rendezvous_t *rdv);
+extern void rdv_depart(rendezvous_t *rdv);
+extern uint32_t rdv_count(rendezvous_t *rdv);
+
+extern bool rdv_wait_arrived(rendezvous_t *rdv, uint32_t target,
+                             unsigned int timeout_ms);
+extern bool rdv_wait_departed(rendezvous_t *rdv, unsigned int timeout_ms);
+
+#endif    /* __RENDEZVOUS_H__ */
+
+
+/*
+ * Local variables:
+ * mode: C
+ * c-set-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
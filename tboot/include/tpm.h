@@ -453,6 +453,9 @@ struct tpm_if {
     u32 tb_policy_index;
     u32 tb_err_index;
     u32 sgx_svn_index;
+
+    /* largest chunk that a single nv_read can return */
+    u32 nv_read_max;
 };
 
 struct tpm_if_fp {
@@ -506,6 +509,8 @@ extern bool tpm_detect(void);
 extern void tpm_print(struct tpm_if *ti);
 extern bool tpm_submit_cmd(u32 locality, u8 *in, u32 in_size, u8 *out, u32 *out_size);
 extern bool tpm_submit_cmd_crb(u32 locality, u8 *in, u32 in_size, u8 *out, u32 *out_size);
+extern bool tpm_nv_read_stream(struct tpm_if *ti, u32 locality, u32 index,
+                               u32 offset, u8 *data, u32 *data_size);
 extern bool tpm_wait_cmd_ready(uint32_t locality);
 extern bool tpm_request_locality_crb(uint32_t locality);
 extern bool tpm_relinquish_locality_crb(uint32_t locality);
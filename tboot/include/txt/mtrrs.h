@@ -128,10 +128,12 @@ typedef struct {
     mtrr_physmask_t     mtrr_physmasks[MAX_VARIABLE_MTRRS];
 } mtrr_state_t;
 
-extern bool set_mtrrs_for_acmod(const acm_hdr_t *hdr);
+extern bool plan_mtrrs_for_acmod(const acm_hdr_t *hdr, mtrr_state_t *plan);
+extern bool set_mtrrs_for_acmod(const mtrr_state_t *plan);
 extern void save_mtrrs(mtrr_state_t *saved_state);
 extern void set_all_mtrrs(bool enable);
-extern bool set_mem_type(const void *base, uint32_t size, uint32_t mem_type);
+extern bool plan_mem_type(mtrr_state_t *plan, const void *base, uint32_t size,
+                          uint32_t mem_type);
 extern void restore_mtrrs(const mtrr_state_t *saved_state);
 extern bool validate_mtrrs(const mtrr_state_t *saved_state);
 
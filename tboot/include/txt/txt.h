@@ -61,6 +61,8 @@ extern void txt_shutdown(void);
 extern bool txt_is_powercycle_required(void);
 extern void ap_wait(unsigned int cpuid);
 extern int get_evtlog_type(void);
+extern uint32_t get_evtlog_region_size(void);
+extern uint32_t get_evtlog_region_used(void);
 
 extern uint32_t g_using_da;
 #endif      /* __TXT_TXT_H__ */
@@ -0,0 +1,193 @@
+/*
+ * mtrr_cover_test.c: host test of the variable MTRR cover
+ *
+ * Copyright (c) 2003-2010, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * checks every range inside a window of pages (and a few SINIT-sized
+ * ones at realistic addresses) for an exact, aligned cover that uses no
+ * more MTRRs than a brute force search says is needed
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <types.h>
+#include <txt/mtrr_cover.h>
+
+#define WINDOW_PAGES        1024
+#define MAX_RANGES          64
+
+static unsigned int failures;
+
+#define check(cond, fmt, ...)                                            \
+    do {                                                                 \
+        if ( !(cond) ) {                                                 \
+            if ( failures++ < 20 )                                       \
+                printf("FAIL %s:%d: " fmt "\n", __FILE__, __LINE__,       \
+                       __VA_ARGS__);                                     \
+        }                                                                \
+    } while ( 0 )
+
+/*
+ * fewest aligned power of 2 ranges that cover pfn..end-1, for every pfn
+ * below end: best[pfn] = 1 + min(best[pfn + 2^k]) over the aligned 2^k
+ * that fit
+ */
+static void brute_force(uint32_t end, unsigned int *best)
+{
+    best[end] = 0;
+    for ( uint32_t pfn = end; pfn-- > 0; ) {
+        best[pfn] = ~0U;
+        for ( uint32_t len = 1; pfn + len <= end; len <<= 1 ) {
+            if ( pfn % len != 0 )
+                break;
+            if ( best[pfn + len] + 1 < best[pfn] )
+                best[pfn] = best[pfn + len] + 1;
+        }
+    }
+}
+
+/* the ranges must be aligned powers of 2 laid back to back over the range */
+static void check_cover(uint32_t pfn, uint32_t num_pages,
+                        const mtrr_range_t *ranges, unsigned int nr)
+{
+    uint32_t next = pfn;
+
+    for ( unsigned int i = 0; i < nr; i++ ) {
+        uint32_t len = ranges[i].num_pages;
+
+        check(len != 0 && (len & (len - 1)) == 0,
+              "pfn %#x +%#x: range %u is %#x pages", pfn, num_pages, i, len);
+        check(ranges[i].pfn % len == 0,
+              "pfn %#x +%#x: range %u at %#x not aligned to %#x",
+              pfn, num_pages, i, ranges[i].pfn, len);
+        check(ranges[i].pfn == next,
+              "pfn %#x +%#x: range %u at %#x, expected %#x",
+              pfn, num_pages, i, ranges[i].pfn, next);
+        next = ranges[i].pfn + len;
+    }
+    check(next == pfn + num_pages, "pfn %#x +%#x: cover ends at %#x",
+          pfn, num_pages, next);
+}
+
+static void test_window(void)
+{
+    static unsigned int best[WINDOW_PAGES + 1];
+    mtrr_range_t ranges[MAX_RANGES];
+    unsigned int nr;
+
+    for ( uint32_t end = 1; end <= WINDOW_PAGES; end++ ) {
+        brute_force(end, best);
+        for ( uint32_t pfn = 0; pfn < end; pfn++ ) {
+            bool ok = mtrr_cover_range(pfn, end - pfn, ranges, MAX_RANGES,
+                                       &nr);
+
+            check(ok, "pfn %#x +%#x: no cover", pfn, end - pfn);
+            if ( !ok )
+                continue;
+            check_cover(pfn, end - pfn, ranges, nr);
+            check(nr == best[pfn], "pfn %#x +%#x: %u MTRRs, %u would do",
+                  pfn, end - pfn, nr, best[pfn]);
+        }
+    }
+}
+
+/* SINIT-like ranges: a few hundred KB, page aligned, below 4GB */
+static void test_sinit(void)
+{
+    static const struct {
+        uint32_t base, size;
+        unsigned int nr;
+    } cases[] = {
+        { 0x00800000, 0x00040000, 1 },  /* 256KB at 8MB */
+        { 0xbfe80000, 0x00040000, 1 },
+        { 0x7ffc0000, 0x00031000, 3 },  /* 128KB + 64KB + 4KB */
+        { 0x00801000, 0x0003f000, 6 },  /* one page off an aligned 256KB */
+        { 0xfff00000, 0x00100000, 1 },  /* the last 1MB below 4GB */
+    };
+    mtrr_range_t ranges[MAX_RANGES];
+    unsigned int nr;
+
+    for ( unsigned int i = 0; i < sizeof(cases)/sizeof(cases[0]); i++ ) {
+        uint32_t pfn = cases[i].base >> 12;
+        uint32_t num_pages = cases[i].size >> 12;
+
+        check(mtrr_cover_range(pfn, num_pages, ranges, MAX_RANGES, &nr),
+              "%#x +%#x: no cover", cases[i].base, cases[i].size);
+        check_cover(pfn, num_pages, ranges, nr);
+        check(nr == cases[i].nr, "%#x +%#x: %u MTRRs, expected %u",
+              cases[i].base, cases[i].size, nr, cases[i].nr);
+    }
+}
+
+/* running out of MTRRs must fail rather than write past the array */
+static void test_too_few(void)
+{
+    mtrr_range_t ranges[MAX_RANGES + 1];
+    unsigned int nr = 0;
+
+    /* 1 + 2 + 4 + ... + 128 pages: 8 ranges */
+    ranges[7].pfn = 0xdead;
+    check(!mtrr_cover_range(1, 255, ranges, 7, &nr),
+          "%u ranges reported", nr);
+    check(ranges[7].pfn == 0xdead, "range 7 written: %#x", ranges[7].pfn);
+    check(mtrr_cover_range(1, 255, ranges, 8, &nr) && nr == 8,
+          "%u ranges for 255 pages at pfn 1", nr);
+
+    check(mtrr_cover_range(5, 0, ranges, 0, &nr) && nr == 0,
+          "%u ranges for an empty range", nr);
+}
+
+int main(void)
+{
+    test_window();
+    test_sinit();
+    test_too_few();
+
+    if ( failures != 0 ) {
+        printf("mtrr_cover_test: %u failures\n", failures);
+        return 1;
+    }
+    printf("mtrr_cover_test: ok\n");
+    return 0;
+}
+
+/*
+ * Local variables:
+ * mode: C
+ * c-set-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
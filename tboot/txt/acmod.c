@@ -462,7 +462,8 @@ static bool are_sizes_equal_pad_adjusted(uint32_t acmod_size, acm_hdr_t *acm_hdr
     return false;
 }
 
-static bool is_acmod(const void *acmod_base, uint32_t acmod_size, uint8_t *type, bool quiet)
+static bool check_acmod(const void *acmod_base, uint32_t acmod_size,
+                        uint8_t *type, bool quiet)
 {
     acm_hdr_t *acm_hdr = (acm_hdr_t *)acmod_base;
 
@@ -532,6 +533,108 @@ static bool is_acmod(const void *acmod_base, uint32_t acmod_size, uint8_t *type,
     return true;
 }
 
+/*
+ * the loader walks every module through is_*_acmod() and
+ * does_acmod_match_platform(), and the BIOS SINIT gets the same treatment in
+ * copy_sinit(); remember the verdicts per module so that each one is only
+ * checked (and its id lists printed) once per boot
+ *
+ * entries are keyed by base address plus a fingerprint of the header (which
+ * includes the RSA signature over the rest of the module), so a module that
+ * is moved or replaced in memory is simply checked again
+ */
+#define ACM_FP_CACHE_SIZE    8
+
+typedef struct {
+    const void *base;
+    uint32_t    header_ver;
+    uint32_t    date;
+    uint32_t    size;          /* hdr->size, in dwords */
+    uint32_t    hash;
+    uint32_t    acmod_size;    /* size is_acmod() verdict was for */
+    bool        acmod_checked;
+    bool        is_acmod;
+    uint8_t     type;
+    bool        platform_checked;
+    bool        matches;
+} acm_fp_t;
+
+static acm_fp_t g_acm_fp_cache[ACM_FP_CACHE_SIZE];
+static unsigned int g_acm_fp_next;
+static unsigned int g_acm_fp_skipped;
+
+/* FNV-1a over the fixed part of the header */
+static uint32_t get_acmod_fingerprint(const acm_hdr_t *hdr)
+{
+    const uint8_t *p = (const uint8_t *)hdr;
+    uint32_t hash = 2166136261u;
+
+    for ( unsigned int i = 0; i < sizeof(*hdr); i++ )
+        hash = (hash ^ p[i]) * 16777619u;
+    return hash;
+}
+
+static bool is_same_acmod_fp(const acm_fp_t *fp, const acm_hdr_t *hdr,
+                             uint32_t hash)
+{
+    return fp->header_ver == hdr->header_ver && fp->date == hdr->date &&
+           fp->size == hdr->size && fp->hash == hash;
+}
+
+/* caller must have made sure that a full acm_hdr_t is readable at hdr */
+static acm_fp_t *get_acmod_fp(const acm_hdr_t *hdr)
+{
+    uint32_t hash = get_acmod_fingerprint(hdr);
+
+    for ( unsigned int i = 0; i < ACM_FP_CACHE_SIZE; i++ ) {
+        acm_fp_t *fp = &g_acm_fp_cache[i];
+        if ( fp->base == hdr && is_same_acmod_fp(fp, hdr, hash) )
+            return fp;
+    }
+
+    acm_fp_t *fp = &g_acm_fp_cache[g_acm_fp_next++ % ACM_FP_CACHE_SIZE];
+    fp->base = hdr;
+    fp->header_ver = hdr->header_ver;
+    fp->date = hdr->date;
+    fp->size = hdr->size;
+    fp->hash = hash;
+    fp->acmod_size = 0;
+    fp->acmod_checked = false;
+    fp->is_acmod = false;
+    fp->type = 0;
+    fp->platform_checked = false;
+    fp->matches = false;
+    return fp;
+}
+
+static bool is_acmod(const void *acmod_base, uint32_t acmod_size, uint8_t *type,
+                     bool quiet)
+{
+    acm_fp_t *fp = NULL;
+    uint8_t acm_type = 0;
+
+    if ( acmod_size >= sizeof(acm_hdr_t) ) {
+        fp = get_acmod_fp((const acm_hdr_t *)acmod_base);
+        if ( fp->acmod_checked && fp->acmod_size == acmod_size ) {
+            g_acm_fp_skipped++;
+            if ( type != NULL )
+                *type = fp->type;
+            return fp->is_acmod;
+        }
+    }
+
+    bool ret = check_acmod(acmod_base, acmod_size, &acm_type, quiet);
+    if ( type != NULL )
+        *type = acm_type;
+    if ( fp != NULL ) {
+        fp->acmod_size = acmod_size;
+        fp->acmod_checked = true;
+        fp->is_acmod = ret;
+        fp->type = acm_type;
+    }
+    return ret;
+}
+
 bool is_racm_acmod(const void *acmod_base, uint32_t acmod_size, bool quiet)
 {
     uint8_t type;
@@ -568,36 +671,35 @@ bool is_sinit_acmod(const void *acmod_base, uint32_t acmod_size, bool quiet)
     return true;
 }
 
-bool does_acmod_match_platform(const acm_hdr_t* hdr)
+static bool check_acmod_platform(const acm_hdr_t* hdr)
 {
-    /* used to ensure we don't print chipset/proc info for each module */
-    static bool printed_host_info;
+    /* chipset and processor ids don't change, so read (and print) them once */
+    static bool got_host_info;
+    static txt_didvid_t didvid;
+    static txt_ver_fsbif_qpiif_t ver;
+    static uint32_t fms;
+    static uint64_t platform_id;
 
     /* this fn assumes that the ACM has already passed the is_acmod() checks */
 
-    /* get chipset fusing, device, and vendor id info */
-    txt_didvid_t didvid;
-    didvid._raw = read_pub_config_reg(TXTCR_DIDVID);
-    txt_ver_fsbif_qpiif_t ver;
-    ver._raw = read_pub_config_reg(TXTCR_VER_FSBIF);
-    if ( (ver._raw & 0xffffffff) == 0xffffffff ||
-         (ver._raw & 0xffffffff) == 0x00 )         /* need to use VER.QPIIF */
-        ver._raw = read_pub_config_reg(TXTCR_VER_QPIIF);
-    if ( !printed_host_info ) {
+    if ( !got_host_info ) {
+        /* get chipset fusing, device, and vendor id info */
+        didvid._raw = read_pub_config_reg(TXTCR_DIDVID);
+        ver._raw = read_pub_config_reg(TXTCR_VER_FSBIF);
+        if ( (ver._raw & 0xffffffff) == 0xffffffff ||
+             (ver._raw & 0xffffffff) == 0x00 )     /* need to use VER.QPIIF */
+            ver._raw = read_pub_config_reg(TXTCR_VER_QPIIF);
         printk(TBOOT_DETA"chipset production fused: %x\n", ver.prod_fused );
         printk(TBOOT_DETA"chipset ids: vendor: 0x%x, device: 0x%x, revision: 0x%x\n",
                didvid.vendor_id, didvid.device_id, didvid.revision_id);
-    }
 
-    /* get processor family/model/stepping and platform ID */
-    uint64_t platform_id;
-    uint32_t fms = cpuid_eax(1);
-    platform_id = rdmsr(MSR_IA32_PLATFORM_ID);
-    if ( !printed_host_info ) {
+        /* get processor family/model/stepping and platform ID */
+        fms = cpuid_eax(1);
+        platform_id = rdmsr(MSR_IA32_PLATFORM_ID);
         printk(TBOOT_DETA"processor family/model/stepping: 0x%x\n", fms );
         printk(TBOOT_DETA"platform id: 0x%Lx\n", (unsigned long long)platform_id);
+        got_host_info = true;
     }
-    printed_host_info = true;
 
     /*
      * check if chipset fusing is same
@@ -672,6 +774,20 @@ bool does_acmod_match_platform(const acm_hdr_t* hdr)
     return true;
 }
 
+bool does_acmod_match_platform(const acm_hdr_t* hdr)
+{
+    /* is_acmod() has already put this module in the cache */
+    acm_fp_t *fp = get_acmod_fp(hdr);
+
+    if ( fp->platform_checked ) {
+        g_acm_fp_skipped++;
+        return fp->matches;
+    }
+    fp->platform_checked = true;
+    fp->matches = check_acmod_platform(hdr);
+    return fp->matches;
+}
+
 #ifndef IS_INCLUDED
 acm_hdr_t *get_bios_sinit(const void *sinit_region_base)
 {
@@ -717,6 +833,11 @@ acm_hdr_t *copy_racm(const acm_hdr_t *racm)
     return (acm_hdr_t *)racm_region_base;
 }
 
+void print_acmod_cache_stats(void)
+{
+    printk(TBOOT_DETA"ACM checks skipped (cached): %u\n", g_acm_fp_skipped);
+}
+
 acm_hdr_t *copy_sinit(const acm_hdr_t *sinit)
 {
     /* get BIOS-reserved region from TXT.SINIT.BASE config reg */
@@ -767,13 +888,39 @@ acm_hdr_t *copy_sinit(const acm_hdr_t *sinit)
     if ( sinit_region_base == NULL )
        return NULL;
 
-    /* copy it there */
-    tb_memcpy(sinit_region_base, sinit, sinit->size*4);
-
-    printk(TBOOT_DETA"copied SINIT (size=%x) to %p\n", sinit->size*4,
-           sinit_region_base);
-
-    return (acm_hdr_t *)sinit_region_base;
+    /*
+     * the region may still hold our SINIT from an earlier launch (e.g. across
+     * a warm reboot) even though BIOS didn't report one; don't rewrite it
+     */
+    acm_hdr_t *region_sinit = (acm_hdr_t *)sinit_region_base;
+    if ( region_sinit->header_ver == sinit->header_ver &&
+         region_sinit->date == sinit->date &&
+         region_sinit->size == sinit->size &&
+         get_acmod_fingerprint(region_sinit) == get_acmod_fingerprint(sinit) &&
+         tb_memcmp(region_sinit, sinit, sinit->size*4) == 0 ) {
+        g_acm_fp_skipped++;
+        printk(TBOOT_DETA"SINIT (size=%x) already at %p, skipped copy\n",
+               sinit->size*4, sinit_region_base);
+    }
+    else {
+        /* copy it there */
+        tb_memcpy(sinit_region_base, sinit, sinit->size*4);
+
+        printk(TBOOT_DETA"copied SINIT (size=%x) to %p\n", sinit->size*4,
+               sinit_region_base);
+    }
+
+    /* the copy is byte-identical, so it inherits the module's verdicts */
+    acm_fp_t *src_fp = get_acmod_fp(sinit);
+    acm_fp_t *dst_fp = get_acmod_fp(region_sinit);
+    dst_fp->acmod_size = src_fp->acmod_size;
+    dst_fp->acmod_checked = src_fp->acmod_checked;
+    dst_fp->is_acmod = src_fp->is_acmod;
+    dst_fp->type = src_fp->type;
+    dst_fp->platform_checked = src_fp->platform_checked;
+    dst_fp->matches = src_fp->matches;
+
+    return region_sinit;
 }
 #endif    /* IS_INCLUDED */
 
@@ -48,6 +48,7 @@
 #include <tpm.h>
 #include <loader.h>
 #include <tb_error.h>
+#include <percpu.h>
 #include <txt/mtrrs.h>
 #include <txt/config_regs.h>
 #include <txt/heap.h>
@@ -272,7 +273,7 @@ uint32_t print_event_2_1(void *evt)
             evt_data_ptr += sizeof(uint16_t);
         }
         evt_data_ptr -= sizeof(uint16_t);
-        event_size = (uint32_t)*evt_data_ptr;
+        event_size = *(uint32_t *)evt_data_ptr;
         printk(TBOOT_DETA"\t\t\t     event_data: %u bytes", event_size);
         evt_data_ptr += sizeof(uint32_t);
         print_hex("\t\t\t     ", evt_data_ptr, event_size);
@@ -496,7 +497,8 @@ static bool verify_evt_log(const event_log_container_t *elog)
         return false;
     }
 
-    if ( elog->size != MAX_EVENT_LOG_SIZE ) {
+    /* the container may live in a larger region outside the heap */
+    if ( elog->size < MAX_EVENT_LOG_SIZE ) {
         printk(TBOOT_ERR"Bad event log container size: 0x%x\n", elog->size);
         return false;
     }
@@ -626,7 +628,7 @@ bool verify_bios_data(const txt_heap_t *txt_heap)
                bios_data->num_logical_procs);
         return false;
     }
-    else if ( bios_data->num_logical_procs > NR_CPUS ) {
+    else if ( bios_data->num_logical_procs > PERCPU_MAX_CPUS ) {
         printk(TBOOT_ERR"BIOS data specifies too many CPUs (%u)\n",
                bios_data->num_logical_procs);
         return false;
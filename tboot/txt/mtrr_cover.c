@@ -0,0 +1,93 @@
+/*
+ * mtrr_cover.c: variable MTRR cover of a page range
+ *
+ * Copyright (c) 2003-2010, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * nothing in here touches an MSR or prints, so it is also built on the
+ * host by test/ to check the cover against a brute force search
+ */
+
+#include <types.h>
+#include <stdbool.h>
+#include <txt/mtrr_cover.h>
+
+/* largest power of 2 that is <= n (n != 0) */
+static uint32_t pow2_floor(uint32_t n)
+{
+    while ( n & (n - 1) )
+        n &= n - 1;
+    return n;
+}
+
+/*
+ * each var MTRR maps a power of 2 # pages and its base must be a
+ * multiple of that size; taking the largest such range that still fits
+ * at each step gives the fewest MTRRs that exactly cover the range
+ */
+bool mtrr_cover_range(uint32_t pfn, uint32_t num_pages,
+                      mtrr_range_t *ranges, unsigned int max_ranges,
+                      unsigned int *nr_ranges)
+{
+    unsigned int ndx = 0;
+
+    while ( num_pages > 0 ) {
+        uint32_t pages_in_range = pow2_floor(num_pages);
+
+        if ( pfn != 0 && (pfn & -pfn) < pages_in_range )
+            pages_in_range = pfn & -pfn;
+
+        if ( ndx == max_ranges )
+            return false;
+
+        ranges[ndx].pfn = pfn;
+        ranges[ndx].num_pages = pages_in_range;
+
+        pfn += pages_in_range;
+        num_pages -= pages_in_range;
+        ndx++;
+    }
+
+    *nr_ranges = ndx;
+    return true;
+}
+
+/*
+ * Local variables:
+ * mode: C
+ * c-set-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
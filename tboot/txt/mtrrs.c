@@ -49,6 +49,7 @@
 #include <mle.h>
 #include <txt/config_regs.h>
 #include <txt/mtrrs.h>
+#include <txt/mtrr_cover.h>
 #include <txt/acmod.h>
 #include <tpm.h>
 
@@ -62,9 +63,13 @@
 /* saved MTRR state or NULL if orig. MTRRs have not been changed */
 static __data mtrr_state_t *g_saved_mtrrs = NULL;
 
+static void print_mtrrs(const mtrr_state_t *saved_state);
+static bool validate_mmio_regions(const mtrr_state_t *saved_state);
+
 static uint64_t get_maxphyaddr_mask(void)
 {
     static bool printed_msg = false;
+    static uint64_t maxphyaddr_mask = 0;
     union {
         uint32_t raw;
         struct {
@@ -74,6 +79,11 @@ static uint64_t get_maxphyaddr_mask(void)
 	};
     } num_addr_bits;
 
+    /* get_page_type() calls this for every page it checks, so only do */
+    /* the CPUID once (MAXPHYADDR is the same on all CPUs) */
+    if ( maxphyaddr_mask != 0 )
+        return maxphyaddr_mask;
+
     /* does CPU support 0x80000008 CPUID leaf? (all TXT CPUs should) */
     uint32_t max_ext_fn = cpuid_eax(0x80000000);
     if ( max_ext_fn < 0x80000008 )
@@ -84,14 +94,37 @@ static uint64_t get_maxphyaddr_mask(void)
         printk(TBOOT_DETA"CPU supports %u phys address bits\n", num_addr_bits.num_pa_bits);
 	printed_msg = true;
     }
-    return ((1ULL << num_addr_bits.num_pa_bits) - 1) >> PAGE_SHIFT;
+    maxphyaddr_mask = ((1ULL << num_addr_bits.num_pa_bits) - 1) >> PAGE_SHIFT;
+    return maxphyaddr_mask;
+}
+
+/*
+ * compute the MTRR settings for launching an AC module once, so that they
+ * can be validated up front and re-applied (e.g. on S3) without redoing it
+ */
+bool plan_mtrrs_for_acmod(const acm_hdr_t *hdr, mtrr_state_t *plan)
+{
+    mtrr_state_t check;
+
+    if ( !plan_mem_type(plan, hdr, hdr->size*4, MTRR_TYPE_WRBACK) )
+        return false;
+
+    /* the plan must still leave the MMIO that SINIT touches UC */
+    check = *plan;
+    check.mtrr_def_type.e = 1;
+    if ( !validate_mmio_regions(&check) ) {
+        printk(TBOOT_ERR"MTRRs for acmod would make MMIO cacheable\n");
+        print_mtrrs(&check);
+        return false;
+    }
+    return true;
 }
 
 /*
  * this must be done for each processor so that all have the same
  * memory types
  */
-bool set_mtrrs_for_acmod(const acm_hdr_t *hdr)
+bool set_mtrrs_for_acmod(const mtrr_state_t *plan)
 {
     unsigned long eflags;
     unsigned long cr0, cr4;
@@ -124,8 +157,7 @@ bool set_mtrrs_for_acmod(const acm_hdr_t *hdr)
     /*
      * now set MTRRs for AC mod and rest of memory
      */
-    if ( !set_mem_type(hdr, hdr->size*4, MTRR_TYPE_WRBACK) )
-        return false;
+    restore_mtrrs(plan);
 
     /*
      * now undo some of earlier changes and enable our new settings
@@ -160,7 +192,7 @@ void save_mtrrs(mtrr_state_t *saved_state)
     mtrr_cap.raw = rdmsr(MSR_MTRRcap);
     if ( mtrr_cap.vcnt > MAX_VARIABLE_MTRRS ) {
         /* print warning but continue saving what we can */
-        /* (set_mem_type() won't exceed the array, so we're safe doing this) */
+        /* (plan_mem_type() won't exceed the array, so we're safe doing this) */
         printk(TBOOT_WARN"actual # var MTRRs (%d) > MAX_VARIABLE_MTRRS (%d)\n",
                mtrr_cap.vcnt, MAX_VARIABLE_MTRRS);
         saved_state->num_var_mtrrs = MAX_VARIABLE_MTRRS;
@@ -481,120 +513,58 @@ void restore_mtrrs(const mtrr_state_t *saved_state)
 }
 
 /*
- * set the memory type for specified range (base to base+size)
- * to mem_type and everything else to UC
+ * plan MTRRs that set the memory type for specified range (base to
+ * base+size) to mem_type and everything else to UC; nothing is written
  */
-bool set_mem_type(const void *base, uint32_t size, uint32_t mem_type)
+bool plan_mem_type(mtrr_state_t *plan, const void *base, uint32_t size,
+                   uint32_t mem_type)
 {
-    int num_pages;
-    int ndx;
-    mtrr_def_type_t mtrr_def_type;
     mtrr_cap_t mtrr_cap;
-    mtrr_physmask_t mtrr_physmask;
-    mtrr_physbase_t mtrr_physbase;
+    uint32_t pfn = (unsigned long)base >> PAGE_SHIFT;
+    uint32_t num_pages = PAGE_UP(size) >> PAGE_SHIFT;
+    mtrr_range_t ranges[MAX_VARIABLE_MTRRS];
+    unsigned int ndx, nr_ranges;
 
     /*
      * disable all fixed MTRRs
      * set default type to UC
      */
-    mtrr_def_type.raw = rdmsr(MSR_MTRRdefType);
-    mtrr_def_type.fe = 0;
-    mtrr_def_type.type = MTRR_TYPE_UNCACHABLE;
-    wrmsr(MSR_MTRRdefType, mtrr_def_type.raw);
+    plan->mtrr_def_type.raw = rdmsr(MSR_MTRRdefType);
+    plan->mtrr_def_type.fe = 0;
+    plan->mtrr_def_type.type = MTRR_TYPE_UNCACHABLE;
+    /* set_mtrrs_for_acmod() enables them once caches are flushed */
+    plan->mtrr_def_type.e = 0;
 
     /*
      * initially disable all variable MTRRs (we'll enable the ones we use)
      */
     mtrr_cap.raw = rdmsr(MSR_MTRRcap);
-    for ( ndx = 0; ndx < mtrr_cap.vcnt; ndx++ ) {
-        mtrr_physmask.raw = rdmsr(MTRR_PHYS_MASK0_MSR + ndx*2);
-        mtrr_physmask.v = 0;
-        wrmsr(MTRR_PHYS_MASK0_MSR + ndx*2, mtrr_physmask.raw);
+    plan->num_var_mtrrs = mtrr_cap.vcnt;
+    if ( plan->num_var_mtrrs > MAX_VARIABLE_MTRRS )
+        plan->num_var_mtrrs = MAX_VARIABLE_MTRRS;
+    for ( ndx = 0; ndx < plan->num_var_mtrrs; ndx++ ) {
+        plan->mtrr_physbases[ndx].raw = rdmsr(MTRR_PHYS_BASE0_MSR + ndx*2);
+        plan->mtrr_physmasks[ndx].raw = rdmsr(MTRR_PHYS_MASK0_MSR + ndx*2);
+        plan->mtrr_physmasks[ndx].v = 0;
     }
 
-    /*
-     * map all AC module pages as mem_type
-     */
-
-    num_pages = PAGE_UP(size) >> PAGE_SHIFT;
-    ndx = 0;
-
-    printk(TBOOT_DETA"setting MTRRs for acmod: base=%p, size=%x, num_pages=%d\n",
+    printk(TBOOT_DETA"planning MTRRs for acmod: base=%p, size=%x, num_pages=%u\n",
            base, size, num_pages);
-    /*
-     * Each VAR MTRR base must be a multiple if that MTRR's Size
-    */
-    unsigned long base_v;
-    base_v = (unsigned long) base;
-    int i =0;   
-    // mtrr size in pages
-    int mtrr_s = 1;
-    while ((base_v & 0x01) == 0) {
-          i++;
-          base_v = base_v >>1 ;
 
+    if ( !mtrr_cover_range(pfn, num_pages, ranges, plan->num_var_mtrrs,
+                           &nr_ranges) ) {
+        printk(TBOOT_ERR"exceeded number of var MTRRs when mapping range\n");
+        return false;
     }
-    for (int j=i-12; j>0; j--) mtrr_s =mtrr_s*2; //mtrr_s = mtrr_s << 1
-    printk(TBOOT_DETA"The maximum allowed MTRR range size=%d Pages \n", mtrr_s);
-	
-    while (num_pages >= mtrr_s){
-	
-	/* set the base of the current MTRR */
-        mtrr_physbase.raw = rdmsr(MTRR_PHYS_BASE0_MSR + ndx*2);
-        mtrr_physbase.base = ((unsigned long)base >> PAGE_SHIFT) &
-	                     SINIT_MTRR_MASK;
-        mtrr_physbase.type = mem_type;
-        wrmsr(MTRR_PHYS_BASE0_MSR + ndx*2, mtrr_physbase.raw);
-
-        mtrr_physmask.raw = rdmsr(MTRR_PHYS_MASK0_MSR + ndx*2);
-        mtrr_physmask.mask = ~(mtrr_s - 1) & SINIT_MTRR_MASK;
-        mtrr_physmask.v = 1;
-        wrmsr(MTRR_PHYS_MASK0_MSR + ndx*2, mtrr_physmask.raw);
-		
-        base += (mtrr_s * PAGE_SIZE);
-        num_pages -= mtrr_s;
-        ndx++;
-        if ( ndx == mtrr_cap.vcnt ) {
-            printk(TBOOT_ERR"exceeded number of var MTRRs when mapping range\n");
-            return false;
-        }
-    }
-    while ( num_pages > 0 ) {
-        uint32_t pages_in_range;
-
-        /* set the base of the current MTRR */
-        mtrr_physbase.raw = rdmsr(MTRR_PHYS_BASE0_MSR + ndx*2);
-        mtrr_physbase.base = ((unsigned long)base >> PAGE_SHIFT) &
-	                     SINIT_MTRR_MASK;
-        mtrr_physbase.type = mem_type;
-        wrmsr(MTRR_PHYS_BASE0_MSR + ndx*2, mtrr_physbase.raw);
-
-        /*
-         * calculate MTRR mask
-         * MTRRs can map pages in power of 2
-         * may need to use multiple MTRRS to map all of region
-         */
-        pages_in_range = 1 << (fls(num_pages) - 1);
-
-        mtrr_physmask.raw = rdmsr(MTRR_PHYS_MASK0_MSR + ndx*2);
-        mtrr_physmask.mask = ~(pages_in_range - 1) & SINIT_MTRR_MASK;
-        mtrr_physmask.v = 1;
-        wrmsr(MTRR_PHYS_MASK0_MSR + ndx*2, mtrr_physmask.raw);
-
-        /*prepare for the next loop depending on number of pages
-         * We figure out from the above how many pages could be used in this
-         * mtrr. Then we decrement the count, increment the base,
-         * increment the mtrr we are dealing with, and if num_pages is
-         * still not zero, we do it again.
-         */
-        base += (pages_in_range * PAGE_SIZE);
-        num_pages -= pages_in_range;
-        ndx++;
-        if ( ndx == mtrr_cap.vcnt ) {
-            printk(TBOOT_ERR"exceeded number of var MTRRs when mapping range\n");
-            return false;
-        }
+
+    for ( ndx = 0; ndx < nr_ranges; ndx++ ) {
+        plan->mtrr_physbases[ndx].base = ranges[ndx].pfn & SINIT_MTRR_MASK;
+        plan->mtrr_physbases[ndx].type = mem_type;
+        plan->mtrr_physmasks[ndx].mask = ~(ranges[ndx].num_pages - 1)
+                                         & SINIT_MTRR_MASK;
+        plan->mtrr_physmasks[ndx].v = 1;
     }
+    printk(TBOOT_DETA"acmod needs %u var MTRRs\n", ndx);
     return true;
 }
 
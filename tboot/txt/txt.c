@@ -58,6 +58,9 @@
 #include <acpi.h>
 #include <vtd.h>
 #include <efi_memmap.h>
+#include <ap_work.h>
+#include <rendezvous.h>
+#include <percpu.h>
 #include <txt/txt.h>
 #include <txt/config_regs.h>
 #include <txt/mtrrs.h>
@@ -68,8 +71,8 @@
 #include <txt/vmcs.h>
 #include <io.h>
 
-/* counter timeout for waiting for all APs to enter wait-for-sipi */
-#define AP_WFS_TIMEOUT     0x10000000
+/* timeout for waiting for all APs to enter wait-for-sipi */
+#define AP_WFS_TIMEOUT_MS  5000
 
 __data struct acpi_rsdp g_rsdp;
 extern char _start[];             /* start of module */
@@ -115,7 +118,7 @@ static __text const mle_hdr_t g_mle_hdr = {
  * counts of APs going into wait-for-sipi
  */
 /* count of APs in WAIT-FOR-SIPI */
-atomic_t ap_wfs_count;
+rendezvous_t ap_wfs;
 
 static void print_file_info(void)
 {
@@ -150,28 +153,23 @@ static void print_mle_hdr(const mle_hdr_t *mle_hdr)
 /* page dir/table entry is phys addr + P + R/W + PWT */
 #define MAKE_PDTE(addr)  (((uint64_t)(unsigned long)(addr) & PAGE_MASK) | 0x01)
 
-/* we assume/know that our image is <2MB and thus fits w/in a single */
-/* PT (512*4KB = 2MB) and thus fixed to 1 pg dir ptr and 1 pgdir and */
-/* 1 ptable = 3 pages and just 1 loop loop for ptable MLE page table */
-/* can only contain 4k pages */
+/*
+ * the MLE page table can only contain 4k pages, so it is a full 3-level PAE
+ * table sized for MLE_MAX_SIZE (see config.h); it lives in .mlept, just
+ * below the MLE
+ */
+#define MLE_PT_ENTRIES     (PAGE_SIZE / sizeof(uint64_t))        /* 512 */
 
-static __mlept uint8_t g_mle_pt[3 * PAGE_SIZE];  
-/* pgdir ptr + pgdir + ptab = 3 */
+static __mlept uint8_t g_mle_pt[MLE_PT_PAGES * PAGE_SIZE];
 
 static void *build_mle_pagetable(uint32_t mle_start, uint32_t mle_size)
 {
     void *ptab_base;
-    uint32_t ptab_size, mle_off;
-    void *pg_dir_ptr_tab, *pg_dir, *pg_tab;
-    uint64_t *pte;
+    uint32_t ptab_size, nr_pages, nr_ptabs, nr_pds;
+    uint64_t *pg_dir_ptr_tab, *pg_dir, *pg_tab;
 
     printk(TBOOT_DETA"MLE start=0x%x, end=0x%x, size=0x%x\n", 
            mle_start, mle_start+mle_size, mle_size);
-    if ( mle_size > 512*PAGE_SIZE ) {
-        printk(TBOOT_ERR"MLE size too big for single page table\n");
-        return NULL;
-    }
-
 
     /* should start on page boundary */
     if ( mle_start & ~PAGE_MASK ) {
@@ -179,44 +177,135 @@ static void *build_mle_pagetable(uint32_t mle_start, uint32_t mle_size)
         return NULL;
     }
 
+    nr_pages = (mle_size + PAGE_SIZE - 1) / PAGE_SIZE;
+    if ( nr_pages == 0 )
+        nr_pages = 1;
+    nr_ptabs = (nr_pages + MLE_PT_ENTRIES - 1) / MLE_PT_ENTRIES;
+    nr_pds = (nr_ptabs + MLE_PT_ENTRIES - 1) / MLE_PT_ENTRIES;
+    if ( 1 + nr_pds + nr_ptabs > MLE_PT_PAGES ) {
+        printk(TBOOT_ERR"MLE size too big for MLE page table (max 0x%x)\n",
+               MLE_MAX_SIZE);
+        return NULL;
+    }
+
     /* place ptab_base below MLE */
-    ptab_size = sizeof(g_mle_pt);
+    ptab_size = (1 + nr_pds + nr_ptabs) * PAGE_SIZE;
     ptab_base = &g_mle_pt;
-    tb_memset(ptab_base, 0, ptab_size);
+    tb_memset(ptab_base, 0, sizeof(g_mle_pt));
     printk(TBOOT_DETA"ptab_size=%x, ptab_base=%p\n", ptab_size, ptab_base);
 
+    /*
+     * the pg dirs and ptables are each contiguous, so the i-th entry of the
+     * level above simply points at the i-th page of the level below
+     */
     pg_dir_ptr_tab = ptab_base;
-    pg_dir         = pg_dir_ptr_tab + PAGE_SIZE;
-    pg_tab         = pg_dir + PAGE_SIZE;
-
-    /* only use first entry in page dir ptr table */
-    *(uint64_t *)pg_dir_ptr_tab = MAKE_PDTE(pg_dir);
-
-    /* only use first entry in page dir */
-    *(uint64_t *)pg_dir = MAKE_PDTE(pg_tab);
-
-    pte = pg_tab;
-    mle_off = 0;
-    do {
-        *pte = MAKE_PDTE(mle_start + mle_off);
+    pg_dir         = pg_dir_ptr_tab + MLE_PT_ENTRIES;
+    pg_tab         = pg_dir + nr_pds * MLE_PT_ENTRIES;
 
-        pte++;
-        mle_off += PAGE_SIZE;
-    } while ( mle_off < mle_size );
+    for ( uint32_t i = 0; i < nr_pds; i++ )
+        pg_dir_ptr_tab[i] = MAKE_PDTE(pg_dir + i * MLE_PT_ENTRIES);
+    for ( uint32_t i = 0; i < nr_ptabs; i++ )
+        pg_dir[i] = MAKE_PDTE(pg_tab + i * MLE_PT_ENTRIES);
+    for ( uint32_t i = 0; i < nr_pages; i++ )
+        pg_tab[i] = MAKE_PDTE(mle_start + i * PAGE_SIZE);
 
     return ptab_base;
 }
 
+/* TSC just before GETSEC[SENTER], to report launch time post-launch */
+static __data uint64_t g_senter_tsc = 0;
 
 static __data event_log_container_t *g_elog = NULL;
 static __data heap_event_log_ptr_elt2_t *g_elog_2 = NULL;
 static __data heap_event_log_ptr_elt2_1_t *g_elog_2_1 = NULL;
 
+/* largest event log region accepted from the evtlog_size option */
+#define MAX_EVTLOG_REGION_SIZE   0x1000000    /* 16MB */
+
+/*
+ * where the event log(s) live: os_mle_data->event_log_buffer, or the
+ * evtlog_size region; chosen once when the TXT heap is first set up and
+ * reused on S3 so that the log location never changes
+ */
+static __data void *g_evtlog_base = NULL;
+static __data uint32_t g_evtlog_size = 0;
+
+/*
+ * size of the optional event log region that sits right after tboot's
+ * image, if select_evtlog_region() can use it
+ */
+uint32_t get_evtlog_region_size(void)
+{
+    uint32_t size = get_tboot_evtlog_size();
+
+    if ( size > MAX_EVTLOG_REGION_SIZE )
+        size = MAX_EVTLOG_REGION_SIZE;
+    return PAGE_UP(size);
+}
+
+/*
+ * how much of the memory after tboot's image the event log takes: 0 until
+ * select_evtlog_region() has run, or if it fell back to the TXT heap.
+ * get_tboot_mem_end() counts only this, so that memory the region was
+ * refused for is neither reserved nor hidden from the kernel.
+ */
+uint32_t get_evtlog_region_used(void)
+{
+    if ( g_evtlog_base != (void *)PAGE_UP((unsigned long)&_end) )
+        return 0;
+    return g_evtlog_size;
+}
+
 /* should be called after os_mle_data initialized */
-static void *init_event_log(void)
+static void select_evtlog_region(void)
 {
     os_mle_data_t *os_mle_data = get_os_mle_data_start(get_txt_heap());
-    g_elog = (event_log_container_t *)&os_mle_data->event_log_buffer;
+    unsigned long base = PAGE_UP((unsigned long)&_end);
+    uint32_t size = get_evtlog_region_size();
+
+    /*
+     * chosen already: on S3 the e820 copy is empty and the loader context
+     * stale, so neither can be consulted again, and the log must stay where
+     * the OS was told it is
+     */
+    if ( g_evtlog_base != NULL || s3_flag ) {
+        if ( g_evtlog_base == NULL ) {
+            g_evtlog_base = os_mle_data->event_log_buffer;
+            g_evtlog_size = sizeof(os_mle_data->event_log_buffer);
+        }
+        else if ( g_evtlog_base != os_mle_data->event_log_buffer )
+            tb_memset(g_evtlog_base, 0, g_evtlog_size);
+        return;
+    }
+
+    g_evtlog_base = os_mle_data->event_log_buffer;
+    g_evtlog_size = sizeof(os_mle_data->event_log_buffer);
+    if ( size == 0 )
+        return;
+
+    if ( e820_check_region(base, size) != E820_RAM ) {
+        printk(TBOOT_WARN"event log region (%lx - %lx) is not RAM, "
+               "using TXT heap\n", base, base + size - 1);
+        return;
+    }
+    for ( unsigned int i = 0; i < get_module_count(g_ldr_ctx); i++ ) {
+        module_t *m = get_module(g_ldr_ctx, i);
+        if ( m != NULL && m->mod_start < base + size && m->mod_end > base ) {
+            printk(TBOOT_WARN"module %u overlaps event log region, "
+                   "using TXT heap\n", i);
+            return;
+        }
+    }
+
+    tb_memset((void *)base, 0, size);
+    g_evtlog_base = (void *)base;
+    g_evtlog_size = size;
+    printk(TBOOT_INFO"event log region: %lx - %lx\n", base, base + size - 1);
+}
+
+static void *init_event_log(void)
+{
+    g_elog = (event_log_container_t *)g_evtlog_base;
 
     tb_memcpy((void *)g_elog->signature, EVTLOG_SIGNATURE,
            sizeof(g_elog->signature));
@@ -224,7 +313,7 @@ static void *init_event_log(void)
     g_elog->container_ver_minor = EVTLOG_CNTNR_MINOR_VER;
     g_elog->pcr_event_ver_major = EVTLOG_EVT_MAJOR_VER;
     g_elog->pcr_event_ver_minor = EVTLOG_EVT_MINOR_VER;
-    g_elog->size = sizeof(os_mle_data->event_log_buffer);
+    g_elog->size = g_evtlog_size;
     g_elog->pcr_events_offset = sizeof(*g_elog);
     g_elog->next_event_offset = sizeof(*g_elog);
 
@@ -234,10 +323,8 @@ static void *init_event_log(void)
 /* initialize TCG compliant TPM 2.0 event log descriptor */
 static void init_evtlog_desc_1(heap_event_log_ptr_elt2_1_t *evt_log)
 {
-    os_mle_data_t *os_mle_data = get_os_mle_data_start(get_txt_heap());
-   
-    evt_log->phys_addr = (uint64_t)(unsigned long)(os_mle_data->event_log_buffer);
-    evt_log->allcoated_event_container_size = 2*PAGE_SIZE;
+    evt_log->phys_addr = (uint64_t)(unsigned long)g_evtlog_base;
+    evt_log->allcoated_event_container_size = g_evtlog_size;
     evt_log->first_record_offset = 0;
     evt_log->next_record_offset = 0;
     printk(TBOOT_DETA"TCG compliant TPM 2.0 event log descriptor:\n");
@@ -249,40 +336,33 @@ static void init_evtlog_desc_1(heap_event_log_ptr_elt2_1_t *evt_log)
 
 static void init_evtlog_desc(heap_event_log_ptr_elt2_t *evt_log)
 {
-    unsigned int i;
-    os_mle_data_t *os_mle_data = get_os_mle_data_start(get_txt_heap());
     struct tpm_if *tpm = get_tpm();
-    switch (tpm->extpol) {
-    case TB_EXTPOL_AGILE:
-        for (i=0; i<evt_log->count; i++) {
+    uint32_t size;
+
+    if ( evt_log->count == 0 )
+        return;
+
+    /* split the log area evenly, in whole pages, between the banks */
+    size = (g_evtlog_size / evt_log->count) & PAGE_MASK;
+    for ( unsigned int i = 0; i < evt_log->count; i++ ) {
+        switch (tpm->extpol) {
+        case TB_EXTPOL_AGILE:
             evt_log->event_log_descr[i].alg = tpm->algs_banks[i];
-            evt_log->event_log_descr[i].phys_addr =
-                    (uint64_t)(unsigned long)(os_mle_data->event_log_buffer + i*4096);
-            evt_log->event_log_descr[i].size = 4096;
-            evt_log->event_log_descr[i].pcr_events_offset = 0;
-            evt_log->event_log_descr[i].next_event_offset = 0;
-        }
-        break;
-    case TB_EXTPOL_EMBEDDED:
-        for (i=0; i<evt_log->count; i++) {
+            break;
+        case TB_EXTPOL_EMBEDDED:
             evt_log->event_log_descr[i].alg = tpm->algs[i];
-            evt_log->event_log_descr[i].phys_addr =
-                    (uint64_t)(unsigned long)(os_mle_data->event_log_buffer + i*4096);
-            evt_log->event_log_descr[i].size = 4096;
-            evt_log->event_log_descr[i].pcr_events_offset = 0;
-            evt_log->event_log_descr[i].next_event_offset = 0;
+            break;
+        case TB_EXTPOL_FIXED:
+            evt_log->event_log_descr[i].alg = tpm->cur_alg;
+            break;
+        default:
+            return;
         }
-        break;
-    case TB_EXTPOL_FIXED:
-        evt_log->event_log_descr[0].alg = tpm->cur_alg;
-        evt_log->event_log_descr[0].phys_addr =
-                    (uint64_t)(unsigned long)os_mle_data->event_log_buffer;
-        evt_log->event_log_descr[0].size = 4096;
-        evt_log->event_log_descr[0].pcr_events_offset = 0;
-        evt_log->event_log_descr[0].next_event_offset = 0;
-        break;
-    default:
-        return;
+        evt_log->event_log_descr[i].phys_addr =
+                (uint64_t)(unsigned long)(g_evtlog_base + i*size);
+        evt_log->event_log_descr[i].size = size;
+        evt_log->event_log_descr[i].pcr_events_offset = 0;
+        evt_log->event_log_descr[i].next_event_offset = 0;
     }
 }
 
@@ -320,6 +400,7 @@ static void init_os_sinit_ext_data(heap_ext_data_element_t* elts)
     struct tpm_if *tpm = get_tpm();
  
     int log_type = get_evtlog_type();
+    select_evtlog_region();
     if ( log_type == EVTLOG_TPM12 ) {
         evt_log = (heap_event_log_ptr_elt_t *)elt->data;
         evt_log->event_log_phys_addr = (uint64_t)(unsigned long)init_event_log();
@@ -353,23 +434,48 @@ static void init_os_sinit_ext_data(heap_ext_data_element_t* elts)
     elt->size = sizeof(*elt);
 }
 
-bool evtlog_append_tpm12(uint8_t pcr, tb_hash_t *hash, uint32_t type)
+/*
+ * reserve one record of rec_size bytes followed by *data_size bytes of event
+ * data at *next_off in a log of log_size bytes; every append computes its
+ * record size once and goes through here.  The event data is dropped rather
+ * than failing the append when only the record itself still fits.
+ */
+static void *evtlog_reserve(void *log, uint32_t *next_off, uint32_t log_size,
+                            uint32_t rec_size, uint32_t *data_size)
 {
+    void *rec;
+
+    if ( *next_off > log_size || rec_size > log_size - *next_off )
+        return NULL;
+    if ( *data_size > log_size - *next_off - rec_size ) {
+        printk(TBOOT_WARN"event log full, dropping %u bytes of event data\n",
+               *data_size);
+        *data_size = 0;
+    }
+
+    rec = log + *next_off;
+    *next_off += rec_size + *data_size;
+    return rec;
+}
+
+bool evtlog_append_tpm12(uint8_t pcr, tb_hash_t *hash, uint32_t type,
+                         const void *data, uint32_t data_size)
+{
+    tpm12_pcr_event_t *next;
+
     if ( g_elog == NULL )
         return true;
 
-    tpm12_pcr_event_t *next = (tpm12_pcr_event_t *)
-                              ((void*)g_elog + g_elog->next_event_offset);
-    
-    if ( g_elog->next_event_offset + sizeof(*next) > g_elog->size )
+    next = evtlog_reserve(g_elog, &g_elog->next_event_offset, g_elog->size,
+                          sizeof(*next), &data_size);
+    if ( next == NULL )
         return false;
 
     next->pcr_index = pcr;
     next->type = type;
     tb_memcpy(next->digest, hash, sizeof(next->digest));
-    next->data_size = 0;
-
-    g_elog->next_event_offset += sizeof(*next) + next->data_size;
+    next->data_size = data_size;
+    tb_memcpy(next->data, data, data_size);
 
     print_event(next);
     return true;
@@ -412,7 +518,9 @@ void dump_event_2(void)
     }
 }
 
-bool evtlog_append_tpm2_legacy(uint8_t pcr, uint16_t alg, tb_hash_t *hash, uint32_t type)
+bool evtlog_append_tpm2_legacy(uint8_t pcr, uint16_t alg, tb_hash_t *hash,
+                               uint32_t type, const void *data,
+                               uint32_t data_size)
 {
     heap_event_log_descr_t *cur_desc = NULL;
     uint32_t hash_size; 
@@ -431,30 +539,33 @@ bool evtlog_append_tpm2_legacy(uint8_t pcr, uint16_t alg, tb_hash_t *hash, uint3
     if ( hash_size == 0 )
         return false;
 
-    if ( cur_desc->next_event_offset + 32 > cur_desc->size )
+    cur = next = evtlog_reserve((void *)(unsigned long)cur_desc->phys_addr,
+                                &cur_desc->next_event_offset, cur_desc->size,
+                                3*sizeof(uint32_t) + hash_size, &data_size);
+    if ( cur == NULL )
         return false;
 
-    cur = next = (void *)(unsigned long)cur_desc->phys_addr +
-                     cur_desc->next_event_offset;
     *((u32 *)next) = pcr;
     next += sizeof(u32);
     *((u32 *)next) = type;
     next += sizeof(u32);
     tb_memcpy((uint8_t *)next, hash, hash_size);
     next += hash_size;
-    *((u32 *)next) = 0;
-    cur_desc->next_event_offset += 3*sizeof(uint32_t) + hash_size; 
+    *((u32 *)next) = data_size;
+    next += sizeof(u32);
+    tb_memcpy((uint8_t *)next, data, data_size);
 
     print_event_2(cur, alg);
     return true;
 }
 
-bool evtlog_append_tpm2_tcg(uint8_t pcr, uint32_t type, hash_list_t *hl)
+bool evtlog_append_tpm2_tcg(uint8_t pcr, uint32_t type, hash_list_t *hl,
+                            const void *data, uint32_t data_size)
 {
-    uint32_t i, event_size;
+    uint32_t i, rec_size;
     unsigned int hash_size;
     tcg_pcr_event2 *event;
-    uint8_t *hash_entry;
+    uint8_t *next;
     tcg_pcr_event2 dummy;
 
     /*
@@ -462,7 +573,7 @@ bool evtlog_append_tpm2_tcg(uint8_t pcr, uint32_t type, hash_list_t *hl)
      * set to 5. Compute the static size as pcr_index + event_type +
      * digest.count + event_size. Then add the space taken up by the hashes.
      */
-    event_size = sizeof(dummy.pcr_index) + sizeof(dummy.event_type) +
+    rec_size = sizeof(dummy.pcr_index) + sizeof(dummy.event_type) +
         sizeof(dummy.digest.count) + sizeof(dummy.event_size);
 
     for (i = 0; i < hl->count; i++) {
@@ -470,55 +581,59 @@ bool evtlog_append_tpm2_tcg(uint8_t pcr, uint32_t type, hash_list_t *hl)
         if (hash_size == 0) {
             return false;
         }
-        event_size += sizeof(uint16_t); // hash_alg field
-        event_size += hash_size;
+        rec_size += sizeof(uint16_t); // hash_alg field
+        rec_size += hash_size;
     }
 
-    // Check if event will fit in buffer.
-    if (event_size + g_elog_2_1->next_record_offset >
-        g_elog_2_1->allcoated_event_container_size) {
+    event = evtlog_reserve((void *)(unsigned long)g_elog_2_1->phys_addr,
+                           &g_elog_2_1->next_record_offset,
+                           g_elog_2_1->allcoated_event_container_size,
+                           rec_size, &data_size);
+    if ( event == NULL )
         return false;
-    }
 
-    event = (tcg_pcr_event2*)(void *)(unsigned long)(g_elog_2_1->phys_addr +
-        g_elog_2_1->next_record_offset);
     event->pcr_index = pcr;
     event->event_type = type;
-    event->event_size = 0;  // No event data passed by tboot.
     event->digest.count = hl->count;
 
-    hash_entry = (uint8_t *)&event->digest.digests[0];
+    next = (uint8_t *)&event->digest.digests[0];
     for (i = 0; i < hl->count; i++) {
         // Populate individual TPMT_HA_1 structs.
-        *((uint16_t *)hash_entry) = hl->entries[i].alg; // TPMT_HA_1.hash_alg
-        hash_entry += sizeof(uint16_t);
+        *((uint16_t *)next) = hl->entries[i].alg; // TPMT_HA_1.hash_alg
+        next += sizeof(uint16_t);
         hash_size = get_hash_size(hl->entries[i].alg);  // already checked above
-        tb_memcpy(hash_entry, &(hl->entries[i].hash), hash_size);
-        hash_entry += hash_size;
+        tb_memcpy(next, &(hl->entries[i].hash), hash_size);
+        next += hash_size;
     }
 
-    g_elog_2_1->next_record_offset += event_size;
+    /* event_size follows the digests actually present, not digests[5] */
+    *((uint32_t *)next) = data_size;
+    next += sizeof(uint32_t);
+    tb_memcpy(next, data, data_size);
+
     print_event_2_1(event);
     return true;
 }
 
-bool evtlog_append(uint8_t pcr, hash_list_t *hl, uint32_t type)
+bool evtlog_append(uint8_t pcr, hash_list_t *hl, uint32_t type,
+                   const void *data, uint32_t data_size)
 {
     int log_type = get_evtlog_type();
     switch (log_type) {
     case EVTLOG_TPM12:
-        if ( !evtlog_append_tpm12(pcr, &hl->entries[0].hash, type) )
+        if ( !evtlog_append_tpm12(pcr, &hl->entries[0].hash, type,
+                                  data, data_size) )
             return false;
         break;
     case EVTLOG_TPM2_LEGACY:
         for (unsigned int i=0; i<hl->count; i++) {
             if ( !evtlog_append_tpm2_legacy(pcr, hl->entries[i].alg,
-                &hl->entries[i].hash, type))
+                &hl->entries[i].hash, type, data, data_size))
                 return false;
 	    }
         break;
     case EVTLOG_TPM2_TCG:
-        if ( !evtlog_append_tpm2_tcg(pcr, type, hl) )
+        if ( !evtlog_append_tpm2_tcg(pcr, type, hl, data, data_size) )
             return false;
         break;
     default:
@@ -745,7 +860,13 @@ static void txt_wakeup_cpus(void)
     __getsec_smctrl();
     __enable_nmi();
 
-    atomic_set(&ap_wfs_count, 0);
+    rdv_reset(&ap_wfs);
+
+    /* stacks and VMCSs for the RLPs */
+    if ( !percpu_init() )
+        apply_policy(TB_ERR_FATAL);
+    else
+        printk_ap_logs_start();
 
     /* RLPs will use our GDT and CS */
     extern char gdt_table[], gdt_table_end[];
@@ -787,30 +908,23 @@ static void txt_wakeup_cpus(void)
     /* (all TXT-capable CPUs have at least 2 cores) */
     bios_data_t *bios_data = get_bios_data_start(txt_heap);
     ap_wakeup_count = bios_data->num_logical_procs - 1;
-    if ( ap_wakeup_count >= NR_CPUS ) {
-        printk(TBOOT_INFO"there are too many CPUs (%u)\n", ap_wakeup_count);
-        ap_wakeup_count = NR_CPUS - 1;
+    if ( ap_wakeup_count >= g_percpu_cap ) {
+        printk(TBOOT_INFO"there are more CPUs (%u) than the MADT lists\n",
+               ap_wakeup_count + 1);
+        ap_wakeup_count = g_percpu_cap - 1;
     }
 
     printk(TBOOT_INFO"waiting for all APs (%d) to enter wait-for-sipi...\n",
            ap_wakeup_count);
     /* wait for all APs that woke up to have entered wait-for-sipi */
-    uint32_t timeout = AP_WFS_TIMEOUT;
-    do {
-        if ( timeout % 0x8000 == 0 )
-            printk(TBOOT_INFO".");
-        else
-            cpu_relax();
-        if ( timeout % 0x200000 == 0 )
-            printk(TBOOT_INFO"\n");
-        timeout--;
-    } while ( ( atomic_read(&ap_wfs_count) < ap_wakeup_count ) &&
-              timeout > 0 );
-    printk(TBOOT_INFO"\n");
-    if ( timeout == 0 )
+    if ( !rdv_wait_arrived(&ap_wfs, ap_wakeup_count, AP_WFS_TIMEOUT_MS) )
         printk(TBOOT_INFO"wait-for-sipi loop timed-out\n");
     else
         printk(TBOOT_INFO"all APs in wait-for-sipi\n");
+    printk_ap_logs_stop();
+    if ( percpu_overflow() != 0 )
+        printk(TBOOT_WARN"%u APs found no per-cpu slot and were halted\n",
+               percpu_overflow());
 }
 
 bool txt_is_launched(void)
@@ -854,6 +968,16 @@ tb_error_t txt_launch_environment(loader_ctx *lctx)
 
     configure_vtd();
 
+    /*
+     * the event log and per-cpu regions after tboot's image are only known
+     * once the heap is set up, so clear the most they can take of modules
+     */
+    if ( !move_modules_out_of(lctx, PAGE_UP((unsigned long)&_end),
+                              PAGE_UP((unsigned long)&_end) +
+                              get_evtlog_region_size() +
+                              get_percpu_region_size()) )
+        return TB_ERR_FATAL;
+
     /* initialize TXT heap */
     txt_heap = init_txt_heap(mle_ptab_base, g_sinit, lctx);
     if ( txt_heap == NULL )
@@ -879,7 +1003,10 @@ tb_error_t txt_launch_environment(loader_ctx *lctx)
     printk_flush();
 
     /* set MTRRs properly for AC module (SINIT) */
-    if ( !set_mtrrs_for_acmod(g_sinit) )
+    mtrr_state_t sinit_mtrr_plan;
+    if ( !plan_mtrrs_for_acmod(g_sinit, &sinit_mtrr_plan) )
+        return TB_ERR_FATAL;
+    if ( !set_mtrrs_for_acmod(&sinit_mtrr_plan) )
         return TB_ERR_FATAL;
 
    /*{
@@ -899,6 +1026,7 @@ tb_error_t txt_launch_environment(loader_ctx *lctx)
     /* (optionally) pause before executing GETSEC[SENTER] */
     if ( g_vga_delay > 0 )
         delay(g_vga_delay * 1000);
+    g_senter_tsc = rdtsc();
     __getsec_senter((uint32_t)g_sinit, (g_sinit->size)*4);
     printk(TBOOT_INFO"ERROR--we should not get here!\n");
     return TB_ERR_FATAL;
@@ -931,13 +1059,19 @@ bool txt_s3_launch_environment(void)
     */
     printk_flush();
 
-    /* set MTRRs properly for AC module (SINIT) */
-    set_mtrrs_for_acmod(g_sinit);
+    /* set MTRRs properly for AC module (SINIT); always re-plan, since the */
+    /* TXT heap is writable by the OS and can't be trusted to hold a plan */
+    mtrr_state_t sinit_mtrr_plan;
+    if ( !plan_mtrrs_for_acmod(g_sinit, &sinit_mtrr_plan) )
+        return false;
+    if ( !set_mtrrs_for_acmod(&sinit_mtrr_plan) )
+        return false;
 
     printk(TBOOT_INFO"executing GETSEC[SENTER]...\n");
     /* (optionally) pause before executing GETSEC[SENTER] */
     if ( g_vga_delay > 0 )
         delay(g_vga_delay * 1000);
+    g_senter_tsc = rdtsc();
     __getsec_senter((uint32_t)g_sinit, (g_sinit->size)*4);
     printk(TBOOT_ERR"ERROR--we should not get here!\n");
     return false;
@@ -960,6 +1094,7 @@ tb_error_t txt_launch_racm(loader_ctx *lctx)
     /* do some checks on it */
     if ( !verify_racm(racm) )
         return TB_ERR_ACMOD_VERIFY_FAILED;
+    print_acmod_cache_stats();
 
     /* save MTRRs before we alter them for RACM launch */
     /*  - not needed by far since always reboot after RACM launch */
@@ -972,7 +1107,10 @@ tb_error_t txt_launch_racm(loader_ctx *lctx)
     printk_flush();
 
     /* set MTRRs properly for AC module (RACM) */
-    if ( !set_mtrrs_for_acmod(racm) )
+    mtrr_state_t racm_mtrr_plan;
+    if ( !plan_mtrrs_for_acmod(racm, &racm_mtrr_plan) )
+        return TB_ERR_FATAL;
+    if ( !set_mtrrs_for_acmod(&racm_mtrr_plan) )
         return TB_ERR_FATAL;
 
     /* clear MSEG_BASE/SIZE registers */
@@ -1101,6 +1239,10 @@ void txt_post_launch(void)
     if ( err != TB_ERR_NONE )
         printk(TBOOT_ERR"failed to verify platform\n");
 
+    if ( g_senter_tsc != 0 )
+        printk(TBOOT_INFO"GETSEC[SENTER] took %Lu TSC ticks\n",
+               rdtsc() - g_senter_tsc);
+
     /* get saved OS state (os_mvmm_data_t) from LT heap */
     txt_heap = get_txt_heap();
     os_mle_data = get_os_mle_data_start(txt_heap);
@@ -1145,13 +1287,6 @@ void txt_post_launch(void)
 
 void ap_wait(unsigned int cpuid)
 {
-    if ( cpuid >= NR_CPUS ) {
-        printk(TBOOT_ERR"cpuid (%u) exceeds # supported CPUs\n", cpuid);
-        apply_policy(TB_ERR_FATAL);
-        mtx_leave(&ap_lock);
-        return;
-    }
-
     /* ensure MONITOR/MWAIT support is set */
     uint64_t misc;
     misc = rdmsr(MSR_IA32_MISC_ENABLE);
@@ -1162,6 +1297,9 @@ void ap_wait(unsigned int cpuid)
     atomic_inc((atomic_t *)&_tboot_shared.num_in_wfs);
     mtx_leave(&ap_lock);
 
+    /* help the BSP (e.g. with kernel loading) until it hands off */
+    ap_work_loop();
+
     printk(TBOOT_INFO"cpu %u mwait'ing\n", cpuid);
     while ( _tboot_shared.ap_wake_trigger != cpuid ) {
         cpu_monitor(&_tboot_shared.ap_wake_trigger, 0, 0);
@@ -1172,7 +1310,7 @@ void ap_wait(unsigned int cpuid)
     }
 
     uint32_t sipi_vec = (uint32_t)_tboot_shared.ap_wake_addr;
-    atomic_dec(&ap_wfs_count);
+    rdv_depart(&ap_wfs);
     atomic_dec((atomic_t *)&_tboot_shared.num_in_wfs);
     cpu_wakeup(cpuid, sipi_vec);
 }
@@ -1184,12 +1322,6 @@ void txt_cpu_wakeup(void)
     uint64_t madt_apicbase, msr_apicbase;
     unsigned int cpuid = get_apicid();
 
-    if ( cpuid >= NR_CPUS ) {
-        printk(TBOOT_ERR"cpuid (%u) exceeds # supported CPUs\n", cpuid);
-        apply_policy(TB_ERR_FATAL);
-        return;
-    }
-
     mtx_enter(&ap_lock);
 
     printk(TBOOT_INFO"cpu %u waking up from TXT sleep\n", cpuid);
@@ -1224,7 +1356,7 @@ void txt_cpu_wakeup(void)
     __getsec_smctrl();
     __enable_nmi();
 
-    atomic_inc(&ap_wfs_count);
+    rdv_arrive(&ap_wfs);
     if ( use_mwait() )
         ap_wait(cpuid);
     else
@@ -1317,10 +1449,10 @@ void txt_shutdown(void)
 
     /* if some APs are still in wait-for-sipi then SEXIT will hang */
     /* so TXT reset the platform instead, expect mwait case */
-    if ( (!use_mwait()) && atomic_read(&ap_wfs_count) > 0 ) {
+    if ( (!use_mwait()) && rdv_count(&ap_wfs) > 0 ) {
         printk(TBOOT_INFO
                "exiting with some APs still in wait-for-sipi state (%u)\n",
-               atomic_read(&ap_wfs_count));
+               rdv_count(&ap_wfs));
         write_priv_config_reg(TXTCR_CMD_RESET, 0x01);
     }
 
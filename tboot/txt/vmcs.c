@@ -49,6 +49,8 @@
 #include <mutex.h>
 #include <atomic.h>
 #include <tboot.h>
+#include <rendezvous.h>
+#include <percpu.h>
 #include <txt/txt.h>
 #include <txt/vmcs.h>
 
@@ -81,8 +83,8 @@ extern char gdt_table[];
 /* lock that protects APs against race conditions on wakeup and shutdown */
 struct mutex ap_lock;
 
-/* counter for APs entering/exiting wait-for-sipi */
-extern atomic_t ap_wfs_count;
+/* rendezvous for APs entering/exiting wait-for-sipi */
+extern rendezvous_t ap_wfs;
 
 /* flag for (all APs) exiting mini guest (1 = exit) */
 uint32_t aps_exit_guest;
@@ -139,6 +141,7 @@ static void init_vmcs_config(void)
 }
 
 extern uint32_t idle_pg_table[PAGE_SIZE / 4];
+extern unsigned long get_tboot_mem_end(void);
 
 /* build a 1-level identity-map page table [0, _end] on AP for vmxon */
 static void build_ap_pagetable(void)
@@ -147,7 +150,8 @@ static void build_ap_pagetable(void)
     uint32_t pt_entry = PTE_FLAGS;
     uint32_t *pte = &idle_pg_table[0];
 
-    while ( pt_entry <= (uint32_t)&_end + PTE_FLAGS ) {
+    /* the per-cpu stacks and VMCSs are past _end */
+    while ( pt_entry <= (uint32_t)get_tboot_mem_end() + PTE_FLAGS ) {
         *pte = pt_entry;
         /* Incriments 4MB page at a time */ 
         pt_entry += 1 << FOURMB_PAGE_SHIFT;
@@ -156,7 +160,6 @@ static void build_ap_pagetable(void)
 }
 
 extern char host_vmcs[PAGE_SIZE];
-extern char ap_vmcs[NR_CPUS][PAGE_SIZE];
 
 static bool start_vmx(unsigned int cpuid)
 {
@@ -184,7 +187,7 @@ static bool start_vmx(unsigned int cpuid)
 
     /*printk(TBOOT_INFO"per-cpu initializing VMX mini-guest on cpu %u\n", cpuid);*/
 
-    /* enable paging using 1:1 page table [0, _end] */
+    /* enable paging using 1:1 page table [0, tboot mem end] */
     /* addrs outside of tboot (e.g. MMIO) are not mapped) */
     write_cr3((unsigned long)idle_pg_table);
     write_cr4(read_cr4() | CR4_PSE);
@@ -230,6 +233,32 @@ static void stop_vmx(unsigned int cpuid)
 extern void vmx_asm_vmexit_handler(void);
 extern void _mini_guest(void);
 
+/*
+ * VMCS fields that are the same on every AP, recorded as the first AP to
+ * park writes them and replayed with VMWRITE for the rest (a VMCS region
+ * can't simply be copied, its layout is implementation-specific).  This is
+ * in bss, so it is rebuilt once per launch and S3 resume; keeping it in
+ * .data would change tboot's measurement across S3.
+ */
+#define VMCS_TMPL_MAX    96
+
+static struct {
+    unsigned long  field;
+    unsigned long  value;
+} g_vmcs_tmpl[VMCS_TMPL_MAX];
+static unsigned int g_vmcs_tmpl_count;
+static bool g_vmcs_tmpl_ready;
+
+static void vmcs_tmpl_write(unsigned long field, unsigned long value)
+{
+    if ( g_vmcs_tmpl_count < VMCS_TMPL_MAX ) {
+        g_vmcs_tmpl[g_vmcs_tmpl_count].field = field;
+        g_vmcs_tmpl[g_vmcs_tmpl_count].value = value;
+    }
+    g_vmcs_tmpl_count++;
+    __vmwrite(field, value);
+}
+
 /* consturct guest/host vmcs:
  * make guest vmcs from physical environment,
  * so only one binary switch between root and non-root
@@ -240,52 +269,52 @@ static void construct_vmcs(void)
         uint16_t  limit;
         uint32_t  base;
     } xdt;
-    unsigned long cr0, cr3, cr4, eflags, rsp;
     unsigned int tr;
     union vmcs_arbytes arbytes;
     uint16_t seg;
 
-    __vmwrite(PIN_BASED_VM_EXEC_CONTROL, pin_based_vm_exec_ctrls);
-    __vmwrite(VM_EXIT_CONTROLS, vm_exit_ctrls);
-    __vmwrite(VM_ENTRY_CONTROLS, vm_entry_ctrls);
-    __vmwrite(CPU_BASED_VM_EXEC_CONTROL, proc_based_vm_exec_ctrls);
+    g_vmcs_tmpl_count = 0;
+    vmcs_tmpl_write(PIN_BASED_VM_EXEC_CONTROL, pin_based_vm_exec_ctrls);
+    vmcs_tmpl_write(VM_EXIT_CONTROLS, vm_exit_ctrls);
+    vmcs_tmpl_write(VM_ENTRY_CONTROLS, vm_entry_ctrls);
+    vmcs_tmpl_write(CPU_BASED_VM_EXEC_CONTROL, proc_based_vm_exec_ctrls);
 
     /* segments selectors. */
     __asm__ __volatile__ ("mov %%ss, %0\n" : "=r"(seg));
-    __vmwrite(HOST_SS_SELECTOR, seg);
-    __vmwrite(GUEST_SS_SELECTOR, seg);
+    vmcs_tmpl_write(HOST_SS_SELECTOR, seg);
+    vmcs_tmpl_write(GUEST_SS_SELECTOR, seg);
 
     __asm__ __volatile__ ("mov %%ds, %0\n" : "=r"(seg));
-    __vmwrite(HOST_DS_SELECTOR, seg);
-    __vmwrite(GUEST_DS_SELECTOR, seg);
+    vmcs_tmpl_write(HOST_DS_SELECTOR, seg);
+    vmcs_tmpl_write(GUEST_DS_SELECTOR, seg);
 
     __asm__ __volatile__ ("mov %%es, %0\n" : "=r"(seg));
-    __vmwrite(HOST_ES_SELECTOR, seg);
-    __vmwrite(GUEST_ES_SELECTOR, seg);
+    vmcs_tmpl_write(HOST_ES_SELECTOR, seg);
+    vmcs_tmpl_write(GUEST_ES_SELECTOR, seg);
 
     __asm__ __volatile__ ("mov %%fs, %0\n" : "=r"(seg));
-    __vmwrite(HOST_FS_SELECTOR, seg);
-    __vmwrite(GUEST_FS_SELECTOR, seg);
+    vmcs_tmpl_write(HOST_FS_SELECTOR, seg);
+    vmcs_tmpl_write(GUEST_FS_SELECTOR, seg);
 
     __asm__ __volatile__ ("mov %%gs, %0\n" : "=r"(seg));
-    __vmwrite(HOST_GS_SELECTOR, seg);
-    __vmwrite(GUEST_GS_SELECTOR, seg);
+    vmcs_tmpl_write(HOST_GS_SELECTOR, seg);
+    vmcs_tmpl_write(GUEST_GS_SELECTOR, seg);
 
     __asm__ __volatile__ ("mov %%cs, %0\n" : "=r"(seg));
-    __vmwrite(GUEST_CS_SELECTOR, seg);
-    __vmwrite(GUEST_RIP, (uint32_t)&_mini_guest);
+    vmcs_tmpl_write(GUEST_CS_SELECTOR, seg);
+    vmcs_tmpl_write(GUEST_RIP, (uint32_t)&_mini_guest);
 
-    __vmwrite(HOST_CS_SELECTOR, seg);
-    __vmwrite(HOST_RIP, (unsigned long)vmx_asm_vmexit_handler);
+    vmcs_tmpl_write(HOST_CS_SELECTOR, seg);
+    vmcs_tmpl_write(HOST_RIP, (unsigned long)vmx_asm_vmexit_handler);
 
     /* segment limits */
 #define GUEST_SEGMENT_LIMIT     0xffffffff
-    __vmwrite(GUEST_ES_LIMIT, GUEST_SEGMENT_LIMIT);
-    __vmwrite(GUEST_SS_LIMIT, GUEST_SEGMENT_LIMIT);
-    __vmwrite(GUEST_DS_LIMIT, GUEST_SEGMENT_LIMIT);
-    __vmwrite(GUEST_FS_LIMIT, GUEST_SEGMENT_LIMIT);
-    __vmwrite(GUEST_GS_LIMIT, GUEST_SEGMENT_LIMIT);
-    __vmwrite(GUEST_CS_LIMIT, GUEST_SEGMENT_LIMIT);
+    vmcs_tmpl_write(GUEST_ES_LIMIT, GUEST_SEGMENT_LIMIT);
+    vmcs_tmpl_write(GUEST_SS_LIMIT, GUEST_SEGMENT_LIMIT);
+    vmcs_tmpl_write(GUEST_DS_LIMIT, GUEST_SEGMENT_LIMIT);
+    vmcs_tmpl_write(GUEST_FS_LIMIT, GUEST_SEGMENT_LIMIT);
+    vmcs_tmpl_write(GUEST_GS_LIMIT, GUEST_SEGMENT_LIMIT);
+    vmcs_tmpl_write(GUEST_CS_LIMIT, GUEST_SEGMENT_LIMIT);
 
     /* segment AR bytes, see boot.S for details */
     arbytes.bytes = 0;
@@ -297,40 +326,40 @@ static void construct_vmcs(void)
     arbytes.fields.g = 1;
 
     arbytes.fields.null_bit = 0;            /* not null */
-    __vmwrite(GUEST_ES_AR_BYTES, arbytes.bytes);
-    __vmwrite(GUEST_SS_AR_BYTES, arbytes.bytes);
-    __vmwrite(GUEST_DS_AR_BYTES, arbytes.bytes);
-    __vmwrite(GUEST_FS_AR_BYTES, arbytes.bytes);
-    __vmwrite(GUEST_GS_AR_BYTES, arbytes.bytes);
+    vmcs_tmpl_write(GUEST_ES_AR_BYTES, arbytes.bytes);
+    vmcs_tmpl_write(GUEST_SS_AR_BYTES, arbytes.bytes);
+    vmcs_tmpl_write(GUEST_DS_AR_BYTES, arbytes.bytes);
+    vmcs_tmpl_write(GUEST_FS_AR_BYTES, arbytes.bytes);
+    vmcs_tmpl_write(GUEST_GS_AR_BYTES, arbytes.bytes);
 
     arbytes.fields.seg_type = 0xb;          /* type = 0xb */
-    __vmwrite(GUEST_CS_AR_BYTES, arbytes.bytes);
+    vmcs_tmpl_write(GUEST_CS_AR_BYTES, arbytes.bytes);
 
     /* segment BASE */
-    __vmwrite(GUEST_ES_BASE, 0);
-    __vmwrite(GUEST_SS_BASE, 0);
-    __vmwrite(GUEST_DS_BASE, 0);
-    __vmwrite(GUEST_FS_BASE, 0);
-    __vmwrite(GUEST_GS_BASE, 0);
-    __vmwrite(GUEST_CS_BASE, 0);
+    vmcs_tmpl_write(GUEST_ES_BASE, 0);
+    vmcs_tmpl_write(GUEST_SS_BASE, 0);
+    vmcs_tmpl_write(GUEST_DS_BASE, 0);
+    vmcs_tmpl_write(GUEST_FS_BASE, 0);
+    vmcs_tmpl_write(GUEST_GS_BASE, 0);
+    vmcs_tmpl_write(GUEST_CS_BASE, 0);
 
-    __vmwrite(HOST_FS_BASE, 0);
-    __vmwrite(HOST_GS_BASE, 0);
+    vmcs_tmpl_write(HOST_FS_BASE, 0);
+    vmcs_tmpl_write(HOST_GS_BASE, 0);
 
     /* Guest LDT and TSS */
-    __vmwrite(GUEST_LDTR_SELECTOR, 0);
-    __vmwrite(GUEST_LDTR_BASE, 0);
-    __vmwrite(GUEST_LDTR_LIMIT, 0xffff);
+    vmcs_tmpl_write(GUEST_LDTR_SELECTOR, 0);
+    vmcs_tmpl_write(GUEST_LDTR_BASE, 0);
+    vmcs_tmpl_write(GUEST_LDTR_LIMIT, 0xffff);
 
     __asm__ __volatile__ ("str  (%0) \n" :: "a"(&tr) : "memory");
     if ( tr == 0 )
         printk(TBOOT_ERR"tr is 0 on ap, may vmlaunch fail.\n");
-    __vmwrite(GUEST_TR_SELECTOR, tr);
-    __vmwrite(GUEST_TR_BASE, 0);
-    __vmwrite(GUEST_TR_LIMIT, 0xffff);
+    vmcs_tmpl_write(GUEST_TR_SELECTOR, tr);
+    vmcs_tmpl_write(GUEST_TR_BASE, 0);
+    vmcs_tmpl_write(GUEST_TR_LIMIT, 0xffff);
 
-    __vmwrite(HOST_TR_SELECTOR, tr);
-    __vmwrite(HOST_TR_BASE, 0);
+    vmcs_tmpl_write(HOST_TR_SELECTOR, tr);
+    vmcs_tmpl_write(HOST_TR_BASE, 0);
 
 
     /* tboot does not use ldt */
@@ -340,7 +369,7 @@ static void construct_vmcs(void)
     arbytes.fields.p = 1;                   /* segment present */
     arbytes.fields.default_ops_size = 0;    /* 16-bit */
     arbytes.fields.g = 1;
-    __vmwrite(GUEST_LDTR_AR_BYTES, arbytes.bytes);
+    vmcs_tmpl_write(GUEST_LDTR_AR_BYTES, arbytes.bytes);
 
     /* setup a TSS for vmentry as zero TR is not allowed */
     arbytes.bytes = 0;
@@ -349,22 +378,68 @@ static void construct_vmcs(void)
     arbytes.fields.p = 1;                   /* segment present */
     arbytes.fields.default_ops_size = 0;    /* 16-bit */
     arbytes.fields.g = 1;
-    __vmwrite(GUEST_TR_AR_BYTES, arbytes.bytes);
+    vmcs_tmpl_write(GUEST_TR_AR_BYTES, arbytes.bytes);
 
     /* GDT */
     __asm__ __volatile__ ("sgdt (%0) \n" :: "a"(&xdt) : "memory");
-    __vmwrite(GUEST_GDTR_BASE, xdt.base);
-    __vmwrite(GUEST_GDTR_LIMIT, xdt.limit);
+    vmcs_tmpl_write(GUEST_GDTR_BASE, xdt.base);
+    vmcs_tmpl_write(GUEST_GDTR_LIMIT, xdt.limit);
 
-    __vmwrite(HOST_GDTR_BASE, xdt.base);
+    vmcs_tmpl_write(HOST_GDTR_BASE, xdt.base);
 
     /* IDT */
     __asm__ __volatile__ ("sidt (%0) \n" :: "a"(&xdt) : "memory");
     /*printk(TBOOT_INFO"idt.base=0x%x, limit=0x%x.\n", xdt.base, xdt.limit);*/
-    __vmwrite(GUEST_IDTR_BASE, xdt.base);
-    __vmwrite(GUEST_IDTR_LIMIT, xdt.limit);
+    vmcs_tmpl_write(GUEST_IDTR_BASE, xdt.base);
+    vmcs_tmpl_write(GUEST_IDTR_LIMIT, xdt.limit);
+
+    vmcs_tmpl_write(HOST_IDTR_BASE, xdt.base);
+
+    /* debug register */
+    vmcs_tmpl_write(GUEST_DR7, 0);
+
+    /* MSR intercepts. */
+    vmcs_tmpl_write(VM_EXIT_MSR_LOAD_ADDR, 0);
+    vmcs_tmpl_write(VM_EXIT_MSR_STORE_ADDR, 0);
+    vmcs_tmpl_write(VM_EXIT_MSR_STORE_COUNT, 0);
+    vmcs_tmpl_write(VM_EXIT_MSR_LOAD_COUNT, 0);
+    vmcs_tmpl_write(VM_ENTRY_MSR_LOAD_COUNT, 0);
 
-    __vmwrite(HOST_IDTR_BASE, xdt.base);
+    vmcs_tmpl_write(VM_ENTRY_INTR_INFO_FIELD, 0);
+
+    vmcs_tmpl_write(CR0_GUEST_HOST_MASK, ~0UL);
+    vmcs_tmpl_write(CR4_GUEST_HOST_MASK, ~0UL);
+
+    vmcs_tmpl_write(PAGE_FAULT_ERROR_CODE_MASK, 0);
+    vmcs_tmpl_write(PAGE_FAULT_ERROR_CODE_MATCH, 0);
+
+    vmcs_tmpl_write(CR3_TARGET_COUNT, 0);
+
+    vmcs_tmpl_write(GUEST_ACTIVITY_STATE, GUEST_STATE_ACTIVE);
+
+    vmcs_tmpl_write(GUEST_INTERRUPTIBILITY_INFO, 0);
+    vmcs_tmpl_write(VMCS_LINK_POINTER, ~0UL);
+
+    vmcs_tmpl_write(VMCS_LINK_POINTER_HIGH, ~0UL);
+
+    vmcs_tmpl_write(EXCEPTION_BITMAP, MONITOR_DEFAULT_EXCEPTION_BITMAP);
+
+    /* only reuse the template if it caught every field */
+    g_vmcs_tmpl_ready = (g_vmcs_tmpl_count <= VMCS_TMPL_MAX);
+
+    /*printk(TBOOT_INFO"vmcs setup done.\n");*/
+}
+
+static void clone_vmcs(void)
+{
+    for ( unsigned int i = 0; i < g_vmcs_tmpl_count; i++ )
+        __vmwrite(g_vmcs_tmpl[i].field, g_vmcs_tmpl[i].value);
+}
+
+/* fields that come from this AP's own state */
+static void construct_vmcs_percpu(void)
+{
+    unsigned long cr0, cr3, cr4, eflags, rsp;
 
     /* control registers. */
     cr0 = read_cr0();
@@ -380,9 +455,6 @@ static void construct_vmcs(void)
     __vmwrite(CR4_READ_SHADOW, cr4);
     __vmwrite(GUEST_CR3, cr3);
 
-    /* debug register */
-    __vmwrite(GUEST_DR7, 0);
-
     /* rflags & rsp */
     eflags = read_eflags();
     __vmwrite(GUEST_RFLAGS, eflags);
@@ -390,40 +462,16 @@ static void construct_vmcs(void)
     __asm__ __volatile__ ("mov %%esp,%0\n\t" :"=r" (rsp));
     __vmwrite(GUEST_RSP, rsp);
     __vmwrite(HOST_RSP, rsp);
-
-    /* MSR intercepts. */
-    __vmwrite(VM_EXIT_MSR_LOAD_ADDR, 0);
-    __vmwrite(VM_EXIT_MSR_STORE_ADDR, 0);
-    __vmwrite(VM_EXIT_MSR_STORE_COUNT, 0);
-    __vmwrite(VM_EXIT_MSR_LOAD_COUNT, 0);
-    __vmwrite(VM_ENTRY_MSR_LOAD_COUNT, 0);
-
-    __vmwrite(VM_ENTRY_INTR_INFO_FIELD, 0);
-
-    __vmwrite(CR0_GUEST_HOST_MASK, ~0UL);
-    __vmwrite(CR4_GUEST_HOST_MASK, ~0UL);
-
-    __vmwrite(PAGE_FAULT_ERROR_CODE_MASK, 0);
-    __vmwrite(PAGE_FAULT_ERROR_CODE_MATCH, 0);
-
-    __vmwrite(CR3_TARGET_COUNT, 0);
-
-    __vmwrite(GUEST_ACTIVITY_STATE, GUEST_STATE_ACTIVE);
-
-    __vmwrite(GUEST_INTERRUPTIBILITY_INFO, 0);
-    __vmwrite(VMCS_LINK_POINTER, ~0UL);
-
-    __vmwrite(VMCS_LINK_POINTER_HIGH, ~0UL);
-
-    __vmwrite(EXCEPTION_BITMAP, MONITOR_DEFAULT_EXCEPTION_BITMAP);
-
-    /*printk(TBOOT_INFO"vmcs setup done.\n");*/
 }
 
 static bool vmx_create_vmcs(unsigned int cpuid)
 {
-    struct vmcs_struct *vmcs = (struct vmcs_struct *)&ap_vmcs[cpuid];
+    struct vmcs_struct *vmcs = (struct vmcs_struct *)percpu_vmcs();
 
+    if ( vmcs == NULL ) {
+        printk(TBOOT_ERR"cpu %u is not on a per-cpu stack\n", cpuid);
+        return false;
+    }
     tb_memset(vmcs, 0, PAGE_SIZE);
 
     vmcs->vmcs_revision_id = vmcs_rev_id;
@@ -433,7 +481,11 @@ static bool vmx_create_vmcs(unsigned int cpuid)
 
     __vmptrld((unsigned long)vmcs);
 
-    construct_vmcs();
+    if ( g_vmcs_tmpl_ready )
+        clone_vmcs();
+    else
+        construct_vmcs();
+    construct_vmcs_percpu();
 
     return true;
 }
@@ -450,7 +502,7 @@ static void launch_mini_guest(unsigned int cpuid)
     __vmlaunch();
 
     /* should not reach here */
-    atomic_dec(&ap_wfs_count);
+    rdv_depart(&ap_wfs);
     atomic_dec((atomic_t *)&_tboot_shared.num_in_wfs);
     error = __vmread(VM_INSTRUCTION_ERROR);
     printk(TBOOT_ERR"vmlaunch failed for cpu %u, error code %lx\n", cpuid, error);
@@ -489,13 +541,14 @@ void vmx_vmexit_handler(void)
 {
     unsigned int apicid = get_apicid();
 
+    uint64_t start = rdtsc();
     unsigned int exit_reason = __vmread(VM_EXIT_REASON);
     /*printk("vmx_vmexit_handler, cpu= %d,  exit_reason=%x.\n", apicid, exit_reason);*/
 
     if ( (exit_reason & VMX_EXIT_REASONS_FAILED_VMENTRY) ) {
         print_failed_vmentry_reason(exit_reason);
         stop_vmx(apicid);
-        atomic_dec(&ap_wfs_count);
+        rdv_depart(&ap_wfs);
         atomic_dec((atomic_t *)&_tboot_shared.num_in_wfs);
         apply_policy(TB_ERR_FATAL);
     }
@@ -513,8 +566,10 @@ void vmx_vmexit_handler(void)
         uint32_t sipi_vec = (exit_qual & 0xffUL) << PAGE_SHIFT;
         /*printk("exiting due to SIPI: vector=%x\n", sipi_vec); */
         stop_vmx(apicid);
-        atomic_dec(&ap_wfs_count);
+        rdv_depart(&ap_wfs);
         atomic_dec((atomic_t *)&_tboot_shared.num_in_wfs);
+        printk_ap(TBOOT_DETA"cpu %u unparked in %Lu TSC ticks\n", apicid,
+                  rdtsc() - start);
         cpu_wakeup(apicid, sipi_vec);
 
         /* cpu_wakeup() doesn't return, so we should never get here */
@@ -523,7 +578,7 @@ void vmx_vmexit_handler(void)
     }
     else if ( exit_reason == EXIT_REASON_VMCALL ) {
         stop_vmx(apicid);
-        atomic_dec(&ap_wfs_count);
+        rdv_depart(&ap_wfs);
         atomic_dec((atomic_t *)&_tboot_shared.num_in_wfs);
         /* spin */
         while ( true )
@@ -538,12 +593,7 @@ void vmx_vmexit_handler(void)
 /* Launch a mini guest to handle the physical INIT-SIPI-SIPI from BSP */
 void handle_init_sipi_sipi(unsigned int cpuid)
 {
-    if ( cpuid >= NR_CPUS ) {
-        printk(TBOOT_ERR"cpuid (%u) exceeds # supported CPUs\n", cpuid);
-        apply_policy(TB_ERR_FATAL);
-        mtx_leave(&ap_lock);
-        return;
-    }
+    uint64_t start = rdtsc();
 
     /* setup a dummy tss as vmentry require a non-zero host TR */
     load_TR(3);
@@ -560,12 +610,17 @@ void handle_init_sipi_sipi(unsigned int cpuid)
     }
 
     /* 2: setup VMCS */
-    if ( vmx_create_vmcs(cpuid) ) {
+    if ( !vmx_create_vmcs(cpuid) ) {
+        apply_policy(TB_ERR_FATAL);
         mtx_leave(&ap_lock);
-
-        /* 3: launch VM */
-        launch_mini_guest(cpuid);
+        return;
     }
+    printk_ap(TBOOT_DETA"cpu %u parked in %Lu TSC ticks\n", cpuid,
+              rdtsc() - start);
+    mtx_leave(&ap_lock);
+
+    /* 3: launch VM */
+    launch_mini_guest(cpuid);
 
     printk(TBOOT_ERR"control should not return here from launch_mini_guest\n");
     apply_policy(TB_ERR_FATAL);
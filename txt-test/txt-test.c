@@ -58,9 +58,10 @@
 static struct file_operations fops;
 static int dev_major;
 
-#define TBOOT_MEM_BASE      (TBOOT_START - 4*PAGE_SIZE)
+/* tboot memory starts with the MLE page table, ahead of TBOOT_START */
+#define TBOOT_MEM_BASE      TBOOT_BASE_ADDR
                                /* 0x8c000 is Xen's start of trampoline code */
-#define TBOOT_MEM_SIZE      (0x4f000 + 3*PAGE_SIZE)
+#define TBOOT_MEM_SIZE      ((TBOOT_START - TBOOT_BASE_ADDR) + 0x4e000)
 
 #define TXT_CONFIG_REGS_SIZE        (NR_TXT_CONFIG_PAGES*PAGE_SIZE)
 #define TPM_LOCALITY_SIZE           (NR_TPM_LOCALITY_PAGES*PAGE_SIZE)
@@ -0,0 +1,778 @@
+/*
+ * txt-evtlog: Linux app that replays the TXT event log(s) written by tboot
+ *             and SINIT and prints the resulting PCR values as JSON.
+ *
+ * Copyright (c) 2020, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <safe_lib.h>
+
+#define printk   printf
+#include "../include/config.h"
+#include "../include/uuid.h"
+#include "../include/mle.h"
+#include "../tboot/include/txt/config_regs.h"
+typedef uint8_t mtrr_state_t;
+typedef uint8_t multiboot_info_t;
+#include "../include/hash.h"
+#include "../tboot/include/txt/heap.h"
+
+/*
+ * The replay only needs the event records, so logs are accepted in the
+ * three layouts tboot produces (see txt/txt.c):
+ *   tpm12      - "TXT Event Container" with SHA1 tpm12_pcr_event_t records
+ *   tpm2-legacy - one raw record stream per bank (heap_event_log_descr_t)
+ *   tpm2-tcg   - TCG crypto-agile log starting with the Spec ID header
+ * Logs come either from the TXT heap (via /dev/mem) or from files holding
+ * a captured log, so that collected logs can be checked in bulk offline.
+ */
+
+#define MAX_PCRS            24
+#define MAX_BANKS           5
+#define MAX_LOG_SIZE        (16*1024*1024)
+#define EV_NO_ACTION        0x03
+#define TCG_SPEC_ID_SIG     "Spec ID Event03"
+
+typedef struct {
+    uint16_t    alg;
+    uint32_t    extended;           /* bitmap of PCRs that saw an extend */
+    tb_hash_t   pcrs[MAX_PCRS];
+} pcr_bank_t;
+
+typedef struct {
+    const char   *format;
+    unsigned int num_events;
+    unsigned int num_banks;
+    pcr_bank_t   banks[MAX_BANKS];
+    const char   *error;
+} replay_t;
+
+/* bounds-checked reader over an untrusted log */
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+} cursor_t;
+
+static const void *take(cursor_t *c, size_t n)
+{
+    const uint8_t *p = c->p;
+
+    if ( (size_t)(c->end - c->p) < n )
+        return NULL;
+    c->p += n;
+    return p;
+}
+
+static bool take_u16(cursor_t *c, uint16_t *val)
+{
+    const void *p = take(c, sizeof(*val));
+
+    if ( p == NULL )
+        return false;
+    memcpy_s(val, sizeof(*val), p, sizeof(*val));
+    return true;
+}
+
+static bool take_u32(cursor_t *c, uint32_t *val)
+{
+    const void *p = take(c, sizeof(*val));
+
+    if ( p == NULL )
+        return false;
+    memcpy_s(val, sizeof(*val), p, sizeof(*val));
+    return true;
+}
+
+static bool replay_fail(replay_t *r, const char *error)
+{
+    if ( r->error == NULL )
+        r->error = error;
+    return false;
+}
+
+static pcr_bank_t *get_bank(replay_t *r, uint16_t alg)
+{
+    if ( alg == TB_HALG_SHA1_LG )
+        alg = TB_HALG_SHA1;
+
+    for ( unsigned int i = 0; i < r->num_banks; i++ ) {
+        if ( r->banks[i].alg == alg )
+            return &r->banks[i];
+    }
+    if ( r->num_banks == MAX_BANKS )
+        return NULL;
+
+    /* PCRs are zeroed on the dynamic launch, so no need to clear them */
+    r->banks[r->num_banks].alg = alg;
+    return &r->banks[r->num_banks++];
+}
+
+static bool extend_pcr(replay_t *r, uint16_t alg, uint32_t pcr,
+                       const uint8_t *digest)
+{
+    pcr_bank_t *bank;
+
+    if ( pcr >= MAX_PCRS )
+        return replay_fail(r, "PCR index out of range");
+    if ( get_hash_size(alg) == 0 )
+        return replay_fail(r, "unsupported hash algorithm");
+    bank = get_bank(r, alg);
+    if ( bank == NULL )
+        return replay_fail(r, "too many hash algorithms");
+
+    if ( !extend_hash(&bank->pcrs[pcr], (const tb_hash_t *)digest, bank->alg) )
+        return replay_fail(r, "hashing failed");
+    bank->extended |= 1u << pcr;
+    return true;
+}
+
+static bool replay_tpm12(replay_t *r, const uint8_t *log, size_t size)
+{
+    const event_log_container_t *elog = (const event_log_container_t *)log;
+    cursor_t c;
+
+    r->format = "tpm12";
+    if ( size < sizeof(*elog) ||
+         memcmp(elog->signature, EVTLOG_SIGNATURE, sizeof(elog->signature)) )
+        return replay_fail(r, "bad event container signature");
+    if ( elog->pcr_events_offset < sizeof(*elog) ||
+         elog->next_event_offset < elog->pcr_events_offset ||
+         elog->next_event_offset > size )
+        return replay_fail(r, "bad event container offsets");
+
+    c.p = log + elog->pcr_events_offset;
+    c.end = log + elog->next_event_offset;
+    while ( c.p < c.end ) {
+        const tpm12_pcr_event_t *evt = take(&c, sizeof(*evt));
+
+        if ( evt == NULL || take(&c, evt->data_size) == NULL )
+            return replay_fail(r, "truncated event");
+        r->num_events++;
+        if ( evt->type == EV_NO_ACTION )
+            continue;
+        if ( !extend_pcr(r, TB_HALG_SHA1, evt->pcr_index, evt->digest) )
+            return false;
+    }
+    return true;
+}
+
+/* log is one bank's record stream, from pcr_events_offset to next_event_offset */
+static bool replay_tpm2_legacy(replay_t *r, const uint8_t *log, size_t size,
+                               uint16_t alg)
+{
+    unsigned int hash_size = get_hash_size(alg);
+    cursor_t c = { log, log + size };
+
+    r->format = "tpm2-legacy";
+    if ( hash_size == 0 )
+        return replay_fail(r, "unsupported hash algorithm");
+
+    /*
+     * non-SHA1 logs start with a TPM1.2-style EV_NO_ACTION record holding
+     * the log descriptor; it is never extended (see print_evt_log_ptr_elt_2)
+     */
+    if ( alg != TB_HALG_SHA1 && alg != TB_HALG_SHA1_LG &&
+         size >= sizeof(tpm12_pcr_event_t) &&
+         ((const tpm12_pcr_event_t *)log)->type == EV_NO_ACTION ) {
+        const tpm12_pcr_event_t *hdr = take(&c, sizeof(*hdr));
+
+        if ( take(&c, hdr->data_size) == NULL )
+            return replay_fail(r, "truncated log descriptor");
+    }
+
+    while ( c.p < c.end ) {
+        uint32_t pcr, type, data_size;
+        const uint8_t *digest;
+
+        if ( !take_u32(&c, &pcr) || !take_u32(&c, &type) ||
+             (digest = take(&c, hash_size)) == NULL ||
+             !take_u32(&c, &data_size) || take(&c, data_size) == NULL )
+            return replay_fail(r, "truncated event");
+        r->num_events++;
+        if ( type == EV_NO_ACTION )
+            continue;
+        if ( !extend_pcr(r, alg, pcr, digest) )
+            return false;
+    }
+    return true;
+}
+
+/* log starts at the TCG header record, up to next_record_offset */
+static bool replay_tpm2_tcg(replay_t *r, const uint8_t *log, size_t size)
+{
+    tcg_efi_spec_id_event_algorithm_size sizes[MAX_BANKS];
+    uint32_t num_sizes = 0;
+    cursor_t c = { log, log + size };
+    const tcg_pcr_event *hdr;
+    cursor_t spec;
+
+    r->format = "tpm2-tcg";
+    hdr = take(&c, sizeof(*hdr));
+    if ( hdr == NULL || hdr->event_type != EV_NO_ACTION )
+        return replay_fail(r, "missing TCG log header");
+    spec.p = take(&c, hdr->event_data_size);
+    if ( spec.p == NULL )
+        return replay_fail(r, "truncated TCG log header");
+    spec.end = spec.p + hdr->event_data_size;
+
+    /* digest sizes come from the header so unknown algs can be skipped */
+    if ( hdr->event_data_size < offsetof(tcg_efi_specid_event_strcut,
+                                         digestSizes) ||
+         memcmp(spec.p, TCG_SPEC_ID_SIG, sizeof(TCG_SPEC_ID_SIG)) )
+        return replay_fail(r, "bad TCG Spec ID signature");
+    take(&spec, offsetof(tcg_efi_specid_event_strcut, number_of_algorithms));
+    if ( !take_u32(&spec, &num_sizes) || num_sizes > MAX_BANKS )
+        return replay_fail(r, "bad TCG algorithm count");
+    for ( uint32_t i = 0; i < num_sizes; i++ ) {
+        if ( !take_u16(&spec, &sizes[i].algorithm_id) ||
+             !take_u16(&spec, &sizes[i].digest_size) )
+            return replay_fail(r, "truncated TCG log header");
+    }
+
+    while ( c.p < c.end ) {
+        uint32_t pcr, type, count, event_size;
+        struct {
+            uint16_t      alg;
+            const uint8_t *digest;
+        } digests[MAX_BANKS];
+
+        if ( !take_u32(&c, &pcr) || !take_u32(&c, &type) ||
+             !take_u32(&c, &count) || count > MAX_BANKS )
+            return replay_fail(r, "bad TCG event");
+        for ( uint32_t i = 0; i < count; i++ ) {
+            uint32_t digest_size = 0;
+
+            if ( !take_u16(&c, &digests[i].alg) )
+                return replay_fail(r, "truncated event");
+            for ( uint32_t j = 0; j < num_sizes; j++ ) {
+                if ( sizes[j].algorithm_id == digests[i].alg )
+                    digest_size = sizes[j].digest_size;
+            }
+            if ( digest_size == 0 )
+                return replay_fail(r, "digest algorithm not in TCG log header");
+            digests[i].digest = take(&c, digest_size);
+            if ( digests[i].digest == NULL )
+                return replay_fail(r, "truncated event");
+        }
+        if ( !take_u32(&c, &event_size) || take(&c, event_size) == NULL )
+            return replay_fail(r, "truncated event");
+
+        r->num_events++;
+        if ( type == EV_NO_ACTION )
+            continue;
+        for ( uint32_t i = 0; i < count; i++ ) {
+            /* banks we cannot hash are left out of the result */
+            if ( get_hash_size(digests[i].alg) == 0 )
+                continue;
+            if ( !extend_pcr(r, digests[i].alg, pcr, digests[i].digest) )
+                return false;
+        }
+    }
+    return true;
+}
+
+/* pick the format of a captured log from its first record */
+static bool replay_buffer(replay_t *r, const uint8_t *log, size_t size,
+                          uint16_t legacy_alg)
+{
+    const tcg_pcr_event *hdr = (const tcg_pcr_event *)log;
+
+    if ( size >= sizeof(EVTLOG_SIGNATURE) &&
+         !memcmp(log, EVTLOG_SIGNATURE, sizeof(EVTLOG_SIGNATURE)) )
+        return replay_tpm12(r, log, size);
+
+    if ( size >= sizeof(*hdr) + sizeof(TCG_SPEC_ID_SIG) &&
+         hdr->event_type == EV_NO_ACTION &&
+         !memcmp(hdr->event_data, TCG_SPEC_ID_SIG, sizeof(TCG_SPEC_ID_SIG)) )
+        return replay_tpm2_tcg(r, log, size);
+
+    if ( legacy_alg == TB_HALG_NULL ) {
+        r->format = "unknown";
+        return replay_fail(r, "unrecognized log format (use --alg for legacy TPM2 logs)");
+    }
+    return replay_tpm2_legacy(r, log, size, legacy_alg);
+}
+
+/*
+ * physical memory access
+ */
+
+static int fd_mem = -1;
+
+/* read physical memory; /dev/mem may refuse read() for MMIO, so try mmap */
+static void *read_phys(uint64_t addr, size_t size)
+{
+    void *buf = malloc(size);
+    void *map;
+    size_t offset;
+
+    if ( buf == NULL )
+        return NULL;
+    if ( pread(fd_mem, buf, size, addr) == (ssize_t)size )
+        return buf;
+
+    offset = addr & (getpagesize() - 1);
+    map = mmap(NULL, size + offset, PROT_READ, MAP_PRIVATE, fd_mem,
+               addr - offset);
+    if ( map == MAP_FAILED ) {
+        free(buf);
+        return NULL;
+    }
+    memcpy_s(buf, size, map + offset, size);
+    munmap(map, size + offset);
+    return buf;
+}
+
+/* read a log region, using the heap copy when the log lives in the heap */
+static const uint8_t *get_log(const uint8_t *heap, uint64_t heap_base,
+                              uint64_t heap_size, uint64_t addr,
+                              uint64_t size, void **to_free)
+{
+    *to_free = NULL;
+    if ( size > MAX_LOG_SIZE )
+        return NULL;
+    if ( addr >= heap_base && size <= heap_size &&
+         addr - heap_base <= heap_size - size )
+        return heap + (addr - heap_base);
+
+    *to_free = read_phys(addr, size);
+    return *to_free;
+}
+
+static bool replay_heap_elt(replay_t *r, const heap_ext_data_element_t *elt,
+                            const uint8_t *heap, uint64_t heap_base,
+                            uint64_t heap_size)
+{
+    const uint8_t *log;
+    void *to_free;
+    bool ret = true;
+
+    if ( elt->type == HEAP_EXTDATA_TYPE_TPM_EVENT_LOG_PTR ) {
+        const heap_event_log_ptr_elt_t *ptr = (const void *)elt->data;
+        const event_log_container_t *elog;
+
+        if ( elt->size < sizeof(*elt) + sizeof(*ptr) )
+            return replay_fail(r, "bad event log pointer element");
+        elog = (const void *)get_log(heap, heap_base, heap_size,
+                                     ptr->event_log_phys_addr,
+                                     sizeof(*elog), &to_free);
+        if ( elog == NULL )
+            return replay_fail(r, "cannot read event container");
+        uint32_t size = elog->size;
+        free(to_free);
+
+        log = get_log(heap, heap_base, heap_size, ptr->event_log_phys_addr,
+                      size, &to_free);
+        if ( log == NULL )
+            return replay_fail(r, "cannot read event container");
+        ret = replay_tpm12(r, log, size);
+        free(to_free);
+    }
+    else if ( elt->type == HEAP_EXTDATA_TYPE_TPM_EVENT_LOG_PTR_2 ) {
+        const heap_event_log_ptr_elt2_t *ptr = (const void *)elt->data;
+
+        if ( elt->size < sizeof(*elt) + sizeof(ptr->count) ||
+             ptr->count > (elt->size - sizeof(*elt) - sizeof(ptr->count)) /
+                          sizeof(heap_event_log_descr_t) )
+            return replay_fail(r, "bad event log pointer element");
+        for ( uint32_t i = 0; ret && i < ptr->count; i++ ) {
+            const heap_event_log_descr_t *desc = &ptr->event_log_descr[i];
+
+            if ( desc->next_event_offset < desc->pcr_events_offset ||
+                 desc->next_event_offset > desc->size )
+                return replay_fail(r, "bad event log descriptor");
+            log = get_log(heap, heap_base, heap_size,
+                          desc->phys_addr + desc->pcr_events_offset,
+                          desc->next_event_offset - desc->pcr_events_offset,
+                          &to_free);
+            if ( log == NULL )
+                return replay_fail(r, "cannot read event log");
+            ret = replay_tpm2_legacy(r, log, desc->next_event_offset -
+                                     desc->pcr_events_offset, desc->alg);
+            free(to_free);
+        }
+    }
+    else if ( elt->type == HEAP_EXTDATA_TYPE_TPM_EVENT_LOG_PTR_2_1 ) {
+        const heap_event_log_ptr_elt2_1_t *ptr = (const void *)elt->data;
+
+        if ( elt->size < sizeof(*elt) + sizeof(*ptr) ||
+             ptr->next_record_offset < ptr->first_record_offset ||
+             ptr->next_record_offset > ptr->allcoated_event_container_size )
+            return replay_fail(r, "bad event log pointer element");
+        log = get_log(heap, heap_base, heap_size,
+                      ptr->phys_addr + ptr->first_record_offset,
+                      ptr->next_record_offset - ptr->first_record_offset,
+                      &to_free);
+        if ( log == NULL )
+            return replay_fail(r, "cannot read event log");
+        ret = replay_tpm2_tcg(r, log, ptr->next_record_offset -
+                              ptr->first_record_offset);
+        free(to_free);
+    }
+
+    return ret;
+}
+
+static bool replay_heap(replay_t *r)
+{
+    void *regs;
+    uint8_t *heap;
+    uint64_t heap_base, heap_size, off, size;
+    const os_sinit_data_t *os_sinit_data;
+    bool found = false;
+    bool ret = true;
+
+    fd_mem = open("/dev/mem", O_RDONLY);
+    if ( fd_mem == -1 )
+        return replay_fail(r, "cannot open /dev/mem");
+
+    regs = read_phys(TXT_PUB_CONFIG_REGS_BASE, TXT_CONFIG_REGS_SIZE);
+    if ( regs == NULL )
+        return replay_fail(r, "cannot read TXT config registers");
+    heap_base = *(uint64_t *)(regs + TXTCR_HEAP_BASE);
+    heap_size = *(uint64_t *)(regs + TXTCR_HEAP_SIZE);
+    free(regs);
+    if ( heap_base == 0 || heap_size < sizeof(uint64_t) ||
+         heap_size > MAX_LOG_SIZE )
+        return replay_fail(r, "no TXT heap");
+
+    heap = read_phys(heap_base, heap_size);
+    if ( heap == NULL )
+        return replay_fail(r, "cannot read TXT heap");
+
+    /* walk bios_data, os_mle_data to os_sinit_data, checking each size */
+    off = 0;
+    for ( int i = 0; i < 3; i++ ) {
+        if ( off > heap_size - sizeof(uint64_t) ) {
+            ret = replay_fail(r, "bad TXT heap layout");
+            goto out;
+        }
+        size = *(uint64_t *)(heap + off);
+        if ( size < sizeof(uint64_t) || size > heap_size - off ) {
+            ret = replay_fail(r, "bad TXT heap layout");
+            goto out;
+        }
+        if ( i < 2 )
+            off += size;
+    }
+    if ( size < sizeof(uint64_t) + sizeof(*os_sinit_data) ) {
+        ret = replay_fail(r, "bad TXT heap layout");
+        goto out;
+    }
+    os_sinit_data = (const os_sinit_data_t *)(heap + off + sizeof(uint64_t));
+    if ( os_sinit_data->version < 6 ) {
+        ret = replay_fail(r, "no event log (OsSinitData version < 6)");
+        goto out;
+    }
+
+    const uint8_t *p = (const uint8_t *)os_sinit_data->ext_data_elts;
+    const uint8_t *end = heap + off + size;
+    while ( ret && p + sizeof(heap_ext_data_element_t) <= end ) {
+        const heap_ext_data_element_t *elt = (const void *)p;
+
+        if ( elt->type == HEAP_EXTDATA_TYPE_END )
+            break;
+        if ( elt->size < sizeof(*elt) || elt->size > (size_t)(end - p) ) {
+            ret = replay_fail(r, "bad heap ext data element");
+            break;
+        }
+        if ( elt->type == HEAP_EXTDATA_TYPE_TPM_EVENT_LOG_PTR ||
+             elt->type == HEAP_EXTDATA_TYPE_TPM_EVENT_LOG_PTR_2 ||
+             elt->type == HEAP_EXTDATA_TYPE_TPM_EVENT_LOG_PTR_2_1 ) {
+            found = true;
+            ret = replay_heap_elt(r, elt, heap, heap_base, heap_size);
+        }
+        p += elt->size;
+    }
+    if ( ret && !found )
+        ret = replay_fail(r, "no event log pointer in OsSinitData");
+
+out:
+    free(heap);
+    return ret;
+}
+
+static bool replay_file(replay_t *r, const char *path, uint16_t legacy_alg)
+{
+    struct stat st;
+    void *map;
+    int fd;
+    bool ret;
+
+    fd = open(path, O_RDONLY);
+    if ( fd == -1 )
+        return replay_fail(r, strerror(errno));
+    if ( fstat(fd, &st) == -1 || st.st_size == 0 || st.st_size > MAX_LOG_SIZE ) {
+        close(fd);
+        return replay_fail(r, "bad file size");
+    }
+
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if ( map == MAP_FAILED )
+        return replay_fail(r, strerror(errno));
+
+    ret = replay_buffer(r, map, st.st_size, legacy_alg);
+    munmap(map, st.st_size);
+    return ret;
+}
+
+/*
+ * JSON output, one object per log
+ */
+
+static const char *alg_to_json_name(uint16_t alg)
+{
+    switch ( alg ) {
+    case TB_HALG_SHA1:   return "sha1";
+    case TB_HALG_SHA256: return "sha256";
+    case TB_HALG_SM3:    return "sm3";
+    case TB_HALG_SHA384: return "sha384";
+    case TB_HALG_SHA512: return "sha512";
+    default:             return "unknown";
+    }
+}
+
+static uint16_t json_name_to_alg(const char *name)
+{
+    static const uint16_t algs[] = { TB_HALG_SHA1, TB_HALG_SHA256,
+                                     TB_HALG_SM3, TB_HALG_SHA384,
+                                     TB_HALG_SHA512 };
+
+    for ( unsigned int i = 0; i < sizeof(algs)/sizeof(algs[0]); i++ ) {
+        if ( strcmp(name, alg_to_json_name(algs[i])) == 0 )
+            return algs[i];
+    }
+    return TB_HALG_NULL;
+}
+
+static void print_json_string(const char *s)
+{
+    putchar('"');
+    for ( ; *s != '\0'; s++ ) {
+        unsigned char ch = *s;
+
+        if ( ch == '"' || ch == '\\' )
+            printf("\\%c", ch);
+        else if ( ch < 0x20 )
+            printf("\\u%04x", ch);
+        else
+            putchar(ch);
+    }
+    putchar('"');
+}
+
+static void print_json_result(const char *source, const replay_t *r)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    printf("{\"source\":");
+    print_json_string(source);
+    if ( r->format != NULL )
+        printf(",\"format\":\"%s\"", r->format);
+    printf(",\"events\":%u", r->num_events);
+    if ( r->error != NULL ) {
+        printf(",\"error\":");
+        print_json_string(r->error);
+        printf("}\n");
+        return;
+    }
+
+    printf(",\"pcrs\":{");
+    for ( unsigned int i = 0; i < r->num_banks; i++ ) {
+        const pcr_bank_t *bank = &r->banks[i];
+        unsigned int hash_size = get_hash_size(bank->alg);
+        bool first = true;
+
+        printf("%s\"%s\":{", i ? "," : "", alg_to_json_name(bank->alg));
+        for ( unsigned int pcr = 0; pcr < MAX_PCRS; pcr++ ) {
+            char str[2*sizeof(tb_hash_t) + 1];
+
+            if ( !(bank->extended & (1u << pcr)) )
+                continue;
+            for ( unsigned int j = 0; j < hash_size; j++ ) {
+                str[2*j] = hex[bank->pcrs[pcr].sha512[j] >> 4];
+                str[2*j + 1] = hex[bank->pcrs[pcr].sha512[j] & 0xf];
+            }
+            str[2*hash_size] = '\0';
+            printf("%s\"%u\":\"%s\"", first ? "" : ",", pcr, str);
+            first = false;
+        }
+        printf("}");
+    }
+    printf("}}\n");
+}
+
+static bool process_file(const char *path, uint16_t legacy_alg)
+{
+    static replay_t r;
+    bool ret;
+
+    memset(&r, 0, sizeof(r));
+    ret = replay_file(&r, path, legacy_alg);
+    print_json_result(path, &r);
+    return ret;
+}
+
+/* list holds one log file name per line; "-" reads the list from stdin */
+static bool process_batch(const char *list, uint16_t legacy_alg)
+{
+    FILE *f = stdin;
+    char *line = NULL;
+    size_t line_size = 0;
+    ssize_t len;
+    bool ret = true;
+
+    if ( strcmp(list, "-") != 0 ) {
+        f = fopen(list, "r");
+        if ( f == NULL ) {
+            fprintf(stderr, "ERROR: cannot open %s: %s\n", list,
+                    strerror(errno));
+            return false;
+        }
+    }
+
+    while ( (len = getline(&line, &line_size, f)) != -1 ) {
+        if ( len > 0 && line[len - 1] == '\n' )
+            line[--len] = '\0';
+        if ( len == 0 )
+            continue;
+        if ( !process_file(line, legacy_alg) )
+            ret = false;
+    }
+
+    free(line);
+    if ( f != stdin )
+        fclose(f);
+    return ret;
+}
+
+static const char *short_option = "a:b:h";
+static struct option longopts[] = {
+    {"alg", 1, 0, 'a'},
+    {"batch", 1, 0, 'b'},
+    {"help", 0, 0, 'h'},
+    {0, 0, 0, 0}
+};
+static const char *usage_string =
+    "txt-evtlog [--alg ALG] [--batch LIST|-] [FILE...] [-h]";
+static const char *option_strings[] = {
+    "--alg ALG:\tdigest alg of legacy TPM2 log files\n"
+    "\t\t(sha1, sha256, sm3, sha384, sha512).\n",
+    "--batch LIST:\treplay the log files named in LIST, one per line\n"
+    "\t\t(\"-\" reads the list from stdin).\n",
+    "-h, --help:\tprint out this help message.\n",
+    NULL
+};
+
+static void print_help(const char *usage_str, const char *option_string[])
+{
+    printf("\nUsage: %s\n", usage_str);
+    printf("With no FILE or LIST, the log(s) in the TXT heap are replayed.\n");
+    for ( uint16_t i = 0; option_string[i] != NULL; i++ )
+        printf("%s", option_string[i]);
+}
+
+int main(int argc, char *argv[])
+{
+    static char out_buf[64*1024];
+    uint16_t legacy_alg = TB_HALG_NULL;
+    const char *batch = NULL;
+    bool ret = true;
+    int c;
+
+    while ( (c = getopt_long(argc, (char **const)argv,
+                             short_option, longopts, NULL)) != -1 )
+        switch ( c ) {
+        case 'a':
+            legacy_alg = json_name_to_alg(optarg);
+            if ( legacy_alg == TB_HALG_NULL ) {
+                fprintf(stderr, "ERROR: unsupported alg %s\n", optarg);
+                return 1;
+            }
+            break;
+
+        case 'b':
+            batch = optarg;
+            break;
+
+        case 'h':
+            print_help(usage_string, option_strings);
+            return 0;
+
+        default:
+            return 1;
+        }
+
+    /* results are line-oriented; don't flush per log in batch mode */
+    setvbuf(stdout, out_buf, _IOFBF, sizeof(out_buf));
+
+    if ( batch == NULL && optind == argc ) {
+        static replay_t r;
+
+        ret = replay_heap(&r);
+        print_json_result("txt-heap", &r);
+    }
+    for ( int i = optind; i < argc; i++ ) {
+        if ( !process_file(argv[i], legacy_alg) )
+            ret = false;
+    }
+    if ( batch != NULL && !process_batch(batch, legacy_alg) )
+        ret = false;
+
+    fflush(stdout);
+    return ret ? 0 : 1;
+}
+
+
+/*
+ * Local variables:
+ * mode: C
+ * c-set-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
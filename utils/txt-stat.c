@@ -38,6 +38,9 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <inttypes.h>
+#include <limits.h>
 #include <unistd.h>
 #include <string.h>
 #include <malloc.h>
@@ -57,8 +60,8 @@
 #define IS_INCLUDED    /* disable some codes in included files */
 static inline uint64_t read_config_reg(uint32_t config_regs_base, uint32_t reg);
 #include "../tboot/include/txt/config_regs.h"
+#include "../include/mle.h"
 typedef uint8_t mtrr_state_t;
-typedef uint8_t txt_caps_t;
 typedef uint8_t multiboot_info_t;
 void print_hex(const char* prefix, const void *start, size_t len);
 #include "../include/hash.h"
@@ -120,95 +123,225 @@ void print_help(const char *usage_str, const char *option_string[])
         printf("%s", option_string[i]);
 }
 
-static void display_config_regs(void *txt_config_base)
+/*
+ * --json: one object on one line, for agents that scrape many hosts.  Raw
+ * register values are strings ("0x..."), as 64-bit values do not survive
+ * every JSON parser; decoded fields are numbers and booleans.
+ */
+static bool json_output = false;
+
+static void print_error(const char *fmt, ...)
+{
+    va_list ap;
+
+    /* keep stdout parseable in --json mode */
+    va_start(ap, fmt);
+    vfprintf(json_output ? stderr : stdout, fmt, ap);
+    va_end(ap);
+}
+
+/* escapes len bytes of s for use inside a JSON string, written in bulk */
+static void print_json_chars(const char *s, size_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+    char buf[4096];
+    size_t n = 0;
+
+    for ( size_t i = 0; i < len; i++ ) {
+        unsigned char ch = s[i];
+
+        if ( n > sizeof(buf) - 6 ) {
+            fwrite(buf, 1, n, stdout);
+            n = 0;
+        }
+        if ( ch == '"' || ch == '\\' ) {
+            buf[n++] = '\\';
+            buf[n++] = ch;
+        }
+        else if ( ch == '\n' ) {
+            buf[n++] = '\\';
+            buf[n++] = 'n';
+        }
+        else if ( ch == '\t' ) {
+            buf[n++] = '\\';
+            buf[n++] = 't';
+        }
+        else if ( ch < 0x20 || ch >= 0x7f ) {
+            buf[n++] = '\\';
+            buf[n++] = 'u';
+            buf[n++] = '0';
+            buf[n++] = '0';
+            buf[n++] = hex[ch >> 4];
+            buf[n++] = hex[ch & 0xf];
+        }
+        else
+            buf[n++] = ch;
+    }
+    fwrite(buf, 1, n, stdout);
+}
+
+static void print_json_hex(const void *data, size_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+    const uint8_t *p = data;
+
+    putchar('"');
+    for ( size_t i = 0; i < len; i++ ) {
+        putchar(hex[p[i] >> 4]);
+        putchar(hex[p[i] & 0xf]);
+    }
+    putchar('"');
+}
+
+/*
+ * The registers are read once into a snapshot that everything is printed
+ * from, so config space (MMIO when it has to be mmap()ed) is not re-read
+ * field by field.
+ */
+typedef struct {
+    txt_sts_t     sts;
+    txt_ests_t    ests;
+    txt_e2sts_t   e2sts;
+    uint64_t      errorcode;
+    txt_didvid_t  didvid;
+    uint64_t      fsbif;
+    uint64_t      qpiif;
+    uint64_t      sinit_base;
+    uint64_t      sinit_size;
+    uint64_t      heap_base;
+    uint64_t      heap_size;
+    txt_dpr_t     dpr;
+    uint8_t       public_key[256/8];
+} config_regs_t;
+
+static void read_config_regs(void *txt_config_base, config_regs_t *regs)
+{
+    regs->sts._raw = read_txt_config_reg(txt_config_base, TXTCR_STS);
+    regs->ests._raw = read_txt_config_reg(txt_config_base, TXTCR_ESTS);
+    regs->e2sts._raw = read_txt_config_reg(txt_config_base, TXTCR_E2STS);
+    regs->errorcode = read_txt_config_reg(txt_config_base, TXTCR_ERRORCODE);
+    regs->didvid._raw = read_txt_config_reg(txt_config_base, TXTCR_DIDVID);
+    regs->fsbif = read_txt_config_reg(txt_config_base, TXTCR_VER_FSBIF);
+    regs->qpiif = read_txt_config_reg(txt_config_base, TXTCR_VER_QPIIF);
+    regs->sinit_base = read_txt_config_reg(txt_config_base, TXTCR_SINIT_BASE);
+    regs->sinit_size = read_txt_config_reg(txt_config_base, TXTCR_SINIT_SIZE);
+    regs->heap_base = read_txt_config_reg(txt_config_base, TXTCR_HEAP_BASE);
+    regs->heap_size = read_txt_config_reg(txt_config_base, TXTCR_HEAP_SIZE);
+    regs->dpr._raw = read_txt_config_reg(txt_config_base, TXTCR_DPR);
+    for ( unsigned int i = 0; i < sizeof(regs->public_key);
+          i += sizeof(uint64_t) ) {
+        uint64_t val = read_txt_config_reg(txt_config_base,
+                                           TXTCR_PUBLIC_KEY + i);
+        memcpy_s(&regs->public_key[i], sizeof(regs->public_key) - i,
+                 &val, sizeof(val));
+    }
+}
+
+static void display_config_regs(const config_regs_t *regs)
 {
     printf("Intel(r) TXT Configuration Registers:\n");
 
     /* STS */
-    txt_sts_t sts;
-    sts._raw = read_txt_config_reg(txt_config_base, TXTCR_STS);
-    printf("\tSTS: 0x%08jx\n", sts._raw);
-    printf("\t    senter_done: %s\n", bit_to_str(sts.senter_done_sts));
-    printf("\t    sexit_done: %s\n", bit_to_str(sts.sexit_done_sts));
-    printf("\t    mem_config_lock: %s\n", bit_to_str(sts.mem_config_lock_sts));
-    printf("\t    private_open: %s\n", bit_to_str(sts.private_open_sts));
-    printf("\t    locality_1_open: %s\n", bit_to_str(sts.locality_1_open_sts));
-    printf("\t    locality_2_open: %s\n", bit_to_str(sts.locality_2_open_sts));
+    printf("\tSTS: 0x%08jx\n", regs->sts._raw);
+    printf("\t    senter_done: %s\n", bit_to_str(regs->sts.senter_done_sts));
+    printf("\t    sexit_done: %s\n", bit_to_str(regs->sts.sexit_done_sts));
+    printf("\t    mem_config_lock: %s\n",
+           bit_to_str(regs->sts.mem_config_lock_sts));
+    printf("\t    private_open: %s\n", bit_to_str(regs->sts.private_open_sts));
+    printf("\t    locality_1_open: %s\n",
+           bit_to_str(regs->sts.locality_1_open_sts));
+    printf("\t    locality_2_open: %s\n",
+           bit_to_str(regs->sts.locality_2_open_sts));
 
     /* ESTS */
-    txt_ests_t ests;
-    ests._raw = read_txt_config_reg(txt_config_base, TXTCR_ESTS);
-    printf("\tESTS: 0x%02jx\n", ests._raw);
-    printf("\t    txt_reset: %s\n", bit_to_str(ests.txt_reset_sts));
+    printf("\tESTS: 0x%02jx\n", regs->ests._raw);
+    printf("\t    txt_reset: %s\n", bit_to_str(regs->ests.txt_reset_sts));
 
     /* E2STS */
-    txt_e2sts_t e2sts;
-    e2sts._raw = read_txt_config_reg(txt_config_base, TXTCR_E2STS);
-    printf("\tE2STS: 0x%016jx\n", e2sts._raw);
-    printf("\t    secrets: %s\n", bit_to_str(e2sts.secrets_sts));
+    printf("\tE2STS: 0x%016jx\n", regs->e2sts._raw);
+    printf("\t    secrets: %s\n", bit_to_str(regs->e2sts.secrets_sts));
 
     /* ERRORCODE */
-    printf("\tERRORCODE: 0x%08jx\n", read_txt_config_reg(txt_config_base,
-                                                       TXTCR_ERRORCODE));
+    printf("\tERRORCODE: 0x%08jx\n", regs->errorcode);
 
     /* DIDVID */
-    txt_didvid_t didvid;
-    didvid._raw = read_txt_config_reg(txt_config_base, TXTCR_DIDVID);
-    printf("\tDIDVID: 0x%016jx\n", didvid._raw);
-    printf("\t    vendor_id: 0x%x\n", didvid.vendor_id);
-    printf("\t    device_id: 0x%x\n", didvid.device_id);
-    printf("\t    revision_id: 0x%x\n", didvid.revision_id);
+    printf("\tDIDVID: 0x%016jx\n", regs->didvid._raw);
+    printf("\t    vendor_id: 0x%x\n", regs->didvid.vendor_id);
+    printf("\t    device_id: 0x%x\n", regs->didvid.device_id);
+    printf("\t    revision_id: 0x%x\n", regs->didvid.revision_id);
 
     /* FSBIF */
-    uint64_t fsbif;
-    fsbif = read_txt_config_reg(txt_config_base, TXTCR_VER_FSBIF);
-    printf("\tFSBIF: 0x%016jx\n", fsbif);
+    printf("\tFSBIF: 0x%016jx\n", regs->fsbif);
 
     /* QPIIF */
-    uint64_t qpiif;
-    qpiif = read_txt_config_reg(txt_config_base, TXTCR_VER_QPIIF);
-    printf("\tQPIIF: 0x%016jx\n", qpiif);
+    printf("\tQPIIF: 0x%016jx\n", regs->qpiif);
 
     /* SINIT.BASE/SIZE */
-    printf("\tSINIT.BASE: 0x%08jx\n", read_txt_config_reg(txt_config_base,
-                                                        TXTCR_SINIT_BASE));
-    printf("\tSINIT.SIZE: %juB (0x%jx)\n",
-           read_txt_config_reg(txt_config_base, TXTCR_SINIT_SIZE),
-           read_txt_config_reg(txt_config_base, TXTCR_SINIT_SIZE));
+    printf("\tSINIT.BASE: 0x%08jx\n", regs->sinit_base);
+    printf("\tSINIT.SIZE: %juB (0x%jx)\n", regs->sinit_size, regs->sinit_size);
 
     /* HEAP.BASE/SIZE */
-    printf("\tHEAP.BASE: 0x%08jx\n", read_txt_config_reg(txt_config_base,
-                                                       TXTCR_HEAP_BASE));
-    printf("\tHEAP.SIZE: %juB (0x%jx)\n",
-           read_txt_config_reg(txt_config_base, TXTCR_HEAP_SIZE),
-           read_txt_config_reg(txt_config_base, TXTCR_HEAP_SIZE));
+    printf("\tHEAP.BASE: 0x%08jx\n", regs->heap_base);
+    printf("\tHEAP.SIZE: %juB (0x%jx)\n", regs->heap_size, regs->heap_size);
 
     /* DPR.BASE/SIZE */
-    txt_dpr_t dpr;
-    dpr._raw = read_txt_config_reg(txt_config_base, TXTCR_DPR);
-    printf("\tDPR: 0x%016jx\n", dpr._raw);
-    printf("\t    lock: %s\n", bit_to_str(dpr.lock));
-    printf("\t    top: 0x%08x\n", (uint32_t)dpr.top << 20);
-    printf("\t    size: %uMB (%uB)\n", dpr.size, dpr.size*1024*1024);
+    printf("\tDPR: 0x%016jx\n", regs->dpr._raw);
+    printf("\t    lock: %s\n", bit_to_str(regs->dpr.lock));
+    printf("\t    top: 0x%08x\n", (uint32_t)regs->dpr.top << 20);
+    printf("\t    size: %uMB (%uB)\n", regs->dpr.size, regs->dpr.size*1024*1024);
 
     /* PUBLIC.KEY */
-    uint8_t key[256/8];
-    unsigned int i = 0;
-    do {
-        *(uint64_t *)&key[i] = read_txt_config_reg(txt_config_base,
-                                                   TXTCR_PUBLIC_KEY + i);
-        i += sizeof(uint64_t);
-    } while ( i < sizeof(key) );
     printf("\tPUBLIC.KEY:\n");
-    print_hex("\t    ", key, sizeof(key)); printf("\n");
+    print_hex("\t    ", regs->public_key, sizeof(regs->public_key));
+    printf("\n");
 
     /* easy-to-see status of TXT and secrets */
     printf("***********************************************************\n");
-    printf("\t TXT measured launch: %s\n", bit_to_str(sts.senter_done_sts));
-    printf("\t secrets flag set: %s\n", bit_to_str(e2sts.secrets_sts));
+    printf("\t TXT measured launch: %s\n",
+           bit_to_str(regs->sts.senter_done_sts));
+    printf("\t secrets flag set: %s\n", bit_to_str(regs->e2sts.secrets_sts));
     printf("***********************************************************\n");
 }
 
+static void print_json_config_regs(const config_regs_t *regs)
+{
+#define JSON_BOOL(b)    ((b) ? "true" : "false")
+    printf("\"config_regs\":{");
+    printf("\"sts\":\"0x%08jx\"", regs->sts._raw);
+    printf(",\"senter_done\":%s", JSON_BOOL(regs->sts.senter_done_sts));
+    printf(",\"sexit_done\":%s", JSON_BOOL(regs->sts.sexit_done_sts));
+    printf(",\"mem_config_lock\":%s",
+           JSON_BOOL(regs->sts.mem_config_lock_sts));
+    printf(",\"private_open\":%s", JSON_BOOL(regs->sts.private_open_sts));
+    printf(",\"locality_1_open\":%s",
+           JSON_BOOL(regs->sts.locality_1_open_sts));
+    printf(",\"locality_2_open\":%s",
+           JSON_BOOL(regs->sts.locality_2_open_sts));
+    printf(",\"ests\":\"0x%02jx\"", regs->ests._raw);
+    printf(",\"txt_reset\":%s", JSON_BOOL(regs->ests.txt_reset_sts));
+    printf(",\"e2sts\":\"0x%016jx\"", regs->e2sts._raw);
+    printf(",\"secrets\":%s", JSON_BOOL(regs->e2sts.secrets_sts));
+    printf(",\"errorcode\":\"0x%08jx\"", regs->errorcode);
+    printf(",\"didvid\":\"0x%016jx\"", regs->didvid._raw);
+    printf(",\"vendor_id\":%u", regs->didvid.vendor_id);
+    printf(",\"device_id\":%u", regs->didvid.device_id);
+    printf(",\"revision_id\":%u", regs->didvid.revision_id);
+    printf(",\"fsbif\":\"0x%016jx\"", regs->fsbif);
+    printf(",\"qpiif\":\"0x%016jx\"", regs->qpiif);
+    printf(",\"sinit_base\":\"0x%08jx\"", regs->sinit_base);
+    printf(",\"sinit_size\":%ju", regs->sinit_size);
+    printf(",\"heap_base\":\"0x%08jx\"", regs->heap_base);
+    printf(",\"heap_size\":%ju", regs->heap_size);
+    printf(",\"dpr\":\"0x%016jx\"", regs->dpr._raw);
+    printf(",\"dpr_lock\":%s", JSON_BOOL(regs->dpr.lock));
+    printf(",\"dpr_top\":\"0x%08x\"", (uint32_t)regs->dpr.top << 20);
+    printf(",\"dpr_size\":%u", regs->dpr.size*1024*1024);
+    printf(",\"public_key\":");
+    print_json_hex(regs->public_key, sizeof(regs->public_key));
+    printf("}");
+#undef JSON_BOOL
+}
+
 static void display_heap(txt_heap_t *heap)
 {
     uint64_t size = get_bios_data_size(heap);
@@ -216,15 +349,264 @@ static void display_heap(txt_heap_t *heap)
     print_bios_data(bios_data, size);
 }
 
-static void display_tboot_log(void *log_base)
+/*
+ * Heap data in --json mode comes from the snapshot, which is checked
+ * against heap_size rather than trusted like display_heap() does.
+ */
+
+/* the data of heap structure nr (0: BiosData ... 3: SinitMleData) */
+static const void *get_heap_data(const txt_heap_t *heap, uint64_t heap_size,
+                                 unsigned int nr, uint64_t *size)
+{
+    uint64_t off = 0;
+
+    for ( unsigned int i = 0; i <= nr; i++ ) {
+        if ( heap_size < sizeof(uint64_t) || off > heap_size - sizeof(uint64_t) )
+            return NULL;
+        *size = *(const uint64_t *)(heap + off);
+        if ( *size < sizeof(uint64_t) || *size > heap_size - off )
+            return NULL;
+        if ( i < nr )
+            off += *size;
+    }
+    *size -= sizeof(uint64_t);
+    return heap + off + sizeof(uint64_t);
+}
+
+static void print_json_ext_data_elt(const heap_ext_data_element_t *elt)
+{
+    size_t data_size = elt->size - sizeof(*elt);
+
+    printf("{\"type\":%u,\"size\":%u", elt->type, elt->size);
+    if ( elt->type == HEAP_EXTDATA_TYPE_BIOS_SPEC_VER &&
+         data_size >= sizeof(heap_bios_spec_ver_elt_t) ) {
+        const heap_bios_spec_ver_elt_t *ver = (const void *)elt->data;
+
+        printf(",\"spec_ver_major\":%u,\"spec_ver_minor\":%u"
+               ",\"spec_ver_rev\":%u", ver->spec_ver_major,
+               ver->spec_ver_minor, ver->spec_ver_rev);
+    }
+    else if ( elt->type == HEAP_EXTDATA_TYPE_ACM &&
+              data_size >= sizeof(heap_acm_elt_t) ) {
+        const heap_acm_elt_t *acm = (const void *)elt->data;
+        uint32_t num_acms = acm->num_acms;
+
+        if ( num_acms > (data_size - sizeof(*acm)) / sizeof(uint64_t) )
+            num_acms = (data_size - sizeof(*acm)) / sizeof(uint64_t);
+        printf(",\"acm_addrs\":[");
+        for ( uint32_t i = 0; i < num_acms; i++ )
+            printf("%s\"0x%jx\"", i ? "," : "", acm->acm_addrs[i]);
+        printf("]");
+    }
+    printf("}");
+}
+
+static void print_json_ext_data_elts(const void *elts, const void *end)
+{
+    const uint8_t *p = elts;
+    bool first = true;
+
+    printf("[");
+    while ( p + sizeof(heap_ext_data_element_t) <= (const uint8_t *)end ) {
+        const heap_ext_data_element_t *elt = (const void *)p;
+
+        if ( elt->type == HEAP_EXTDATA_TYPE_END ||
+             elt->size < sizeof(*elt) ||
+             elt->size > (size_t)((const uint8_t *)end - p) )
+            break;
+        if ( !first )
+            printf(",");
+        print_json_ext_data_elt(elt);
+        first = false;
+        p += elt->size;
+    }
+    printf("]");
+}
+
+/* where the event logs that SINIT and tboot extend are */
+static void print_json_event_logs(const os_sinit_data_t *os_sinit_data,
+                                  uint64_t size)
+{
+    const uint8_t *p = (const uint8_t *)os_sinit_data->ext_data_elts;
+    const uint8_t *end = (const uint8_t *)os_sinit_data + size;
+    bool first = true;
+
+    printf("[");
+    while ( p + sizeof(heap_ext_data_element_t) <= end ) {
+        const heap_ext_data_element_t *elt = (const void *)p;
+        size_t data_size = elt->size - sizeof(*elt);
+
+        if ( elt->type == HEAP_EXTDATA_TYPE_END ||
+             elt->size < sizeof(*elt) || elt->size > (size_t)(end - p) )
+            break;
+        if ( elt->type == HEAP_EXTDATA_TYPE_TPM_EVENT_LOG_PTR &&
+             data_size >= sizeof(heap_event_log_ptr_elt_t) ) {
+            const heap_event_log_ptr_elt_t *ptr = (const void *)elt->data;
+
+            printf("%s{\"format\":\"tpm12\",\"phys_addr\":\"0x%jx\"}",
+                   first ? "" : ",", ptr->event_log_phys_addr);
+            first = false;
+        }
+        else if ( elt->type == HEAP_EXTDATA_TYPE_TPM_EVENT_LOG_PTR_2 &&
+                  data_size >= sizeof(uint32_t) ) {
+            const heap_event_log_ptr_elt2_t *ptr = (const void *)elt->data;
+            uint32_t count = ptr->count;
+
+            if ( count > (data_size - sizeof(uint32_t)) /
+                         sizeof(heap_event_log_descr_t) )
+                count = (data_size - sizeof(uint32_t)) /
+                        sizeof(heap_event_log_descr_t);
+            for ( uint32_t i = 0; i < count; i++ ) {
+                const heap_event_log_descr_t *desc = &ptr->event_log_descr[i];
+
+                printf("%s{\"format\":\"tpm2-legacy\",\"alg\":%u"
+                       ",\"phys_addr\":\"0x%jx\",\"size\":%u"
+                       ",\"pcr_events_offset\":%u,\"next_event_offset\":%u}",
+                       first ? "" : ",", desc->alg, desc->phys_addr,
+                       desc->size, desc->pcr_events_offset,
+                       desc->next_event_offset);
+                first = false;
+            }
+        }
+        else if ( elt->type == HEAP_EXTDATA_TYPE_TPM_EVENT_LOG_PTR_2_1 &&
+                  data_size >= sizeof(heap_event_log_ptr_elt2_1_t) ) {
+            const heap_event_log_ptr_elt2_1_t *ptr = (const void *)elt->data;
+
+            printf("%s{\"format\":\"tpm2-tcg\",\"phys_addr\":\"0x%jx\""
+                   ",\"size\":%u,\"first_record_offset\":%u"
+                   ",\"next_record_offset\":%u}", first ? "" : ",",
+                   ptr->phys_addr, ptr->allcoated_event_container_size,
+                   ptr->first_record_offset, ptr->next_record_offset);
+            first = false;
+        }
+        p += elt->size;
+    }
+    printf("]");
+}
+
+static void print_json_heap(const txt_heap_t *heap, uint64_t heap_size)
+{
+    const bios_data_t *bios_data;
+    const os_sinit_data_t *os_sinit_data;
+    uint64_t size;
+
+    printf(",\"heap\":{");
+    bios_data = get_heap_data(heap, heap_size, 0, &size);
+    if ( bios_data == NULL || size < offsetof(bios_data_t, flags) ) {
+        printf("\"bios_data\":null");
+    }
+    else {
+        printf("\"bios_data\":{\"version\":%u,\"bios_sinit_size\":%u"
+               ",\"lcp_pd_base\":\"0x%jx\",\"lcp_pd_size\":%ju"
+               ",\"num_logical_procs\":%u", bios_data->version,
+               bios_data->bios_sinit_size, bios_data->lcp_pd_base,
+               bios_data->lcp_pd_size, bios_data->num_logical_procs);
+        if ( bios_data->version >= 3 && size >= sizeof(*bios_data) )
+            printf(",\"flags\":\"0x%08jx\"", bios_data->flags);
+        if ( bios_data->version >= 4 && size > sizeof(*bios_data) ) {
+            printf(",\"ext_data_elts\":");
+            print_json_ext_data_elts(bios_data->ext_data_elts,
+                                     (const uint8_t *)bios_data + size);
+        }
+        printf("}");
+    }
+
+    os_sinit_data = get_heap_data(heap, heap_size, 2, &size);
+    if ( os_sinit_data != NULL &&
+         size >= offsetof(os_sinit_data_t, ext_data_elts) ) {
+        printf(",\"os_sinit_data\":{\"version\":%u,\"flags\":\"0x%08x\"}",
+               os_sinit_data->version, os_sinit_data->flags);
+        if ( os_sinit_data->version >= 6 ) {
+            printf(",\"event_logs\":");
+            print_json_event_logs(os_sinit_data, size);
+        }
+    }
+    printf("}");
+}
+
+/*
+ * The tboot log is a series of LZ compressed chunks (zip_pos/zip_size)
+ * followed by uncompressed text up to curr_pos.  Positions come from
+ * memory tboot left behind, so they are checked against the buffer.
+ */
+#define TBOOT_LOG_BUF_SIZE   (TBOOT_SERIAL_LOG_SIZE - sizeof(tboot_log_t))
+
+static bool is_tboot_log(const tboot_log_t *log)
+{
+    return are_uuids_equal(&(log->uuid), &((uuid_t)TBOOT_LOG_UUID));
+}
+
+/* where the uncompressed text starts */
+static unsigned int get_tboot_log_tail(const tboot_log_t *log)
+{
+    uint8_t zip_count = log->zip_count;
+
+    if ( zip_count == 0 )
+        return log->zip_pos[0];
+    if ( zip_count < ZIP_COUNT_MAX )
+        return log->zip_pos[zip_count];
+    return log->zip_pos[ZIP_COUNT_MAX - 1] + log->zip_size[ZIP_COUNT_MAX - 1];
+}
+
+/*
+ * The log text is made of segments: segment i < zip_count is chunk i
+ * uncompressed into pbuf, segment zip_count is the uncompressed tail.
+ * Returns the length of segment nr and points *text at it.
+ */
+static unsigned int get_tboot_log_segments(const tboot_log_t *log)
+{
+    return log->zip_count < ZIP_COUNT_MAX ? log->zip_count : ZIP_COUNT_MAX;
+}
+
+static int get_tboot_log_segment(tboot_log_t *log, unsigned int nr,
+                                 char *pbuf, size_t pbuf_size,
+                                 const char **text)
+{
+    /* log->buf is phys addr of buf, which will not match where mmap has */
+    /* map'ed us, but since it is always just past end of struct, use that */
+    /* to uncompress tboot log */
+    char *log_buf = log->buf;
+
+    if ( nr < get_tboot_log_segments(log) ) {
+        if ( log->zip_pos[nr] + log->zip_size[nr] > TBOOT_LOG_BUF_SIZE )
+            return -1;
+        *text = pbuf;
+        return LZ_Uncompress(&log_buf[log->zip_pos[nr]], pbuf,
+                             log->zip_size[nr], pbuf_size);
+    }
+
+    unsigned int tail = get_tboot_log_tail(log);
+    *text = log_buf + tail;
+    if ( tail >= log->curr_pos || log->curr_pos > TBOOT_LOG_BUF_SIZE )
+        return 0;
+    return strnlen(log_buf + tail, log->curr_pos - tail);
+}
+
+/* calls out() with the log text, chunk by chunk, oldest first */
+static void walk_tboot_log(tboot_log_t *log,
+                           void (*out)(const char *text, size_t len))
 {
-    static char buf[512];
     char pbuf[32*1024];
-    char *out = pbuf;
+    const char *text;
+
+    for ( unsigned int i = 0; i <= get_tboot_log_segments(log); i++ ) {
+        int length = get_tboot_log_segment(log, i, pbuf, sizeof(pbuf), &text);
+        if ( length < 0 )
+            continue;
+        out(text, length);
+    }
+}
+
+static void write_text(const char *text, size_t len)
+{
+    fwrite(text, 1, len, stdout);
+}
+
+static void display_tboot_log(void *log_base)
+{
     tboot_log_t *log = (tboot_log_t *)log_base;
-    char *log_buf = log->buf;
     uint8_t i = 0;
-    if ( !are_uuids_equal(&(log->uuid), &((uuid_t)TBOOT_LOG_UUID)) ) {
+    if ( !is_tboot_log(log) ) {
         printf("unable to find TBOOT log\n");
         return;
     }
@@ -232,41 +614,207 @@ static void display_tboot_log(void *log_base)
     printf("TBOOT log:\n");
     printf("\t max_size=%d\n", log->max_size);
     printf("\t zip_count=%d\n", log->zip_count);
-    while ( i < log->zip_count) {
+    while ( i < log->zip_count && i < ZIP_COUNT_MAX ) {
         printf("\t zip_pos[%d] = %d\n", i, log->zip_pos[i]);
         printf("\t zip_size[%d] = %d\n", i, log->zip_size[i]);
           i++;
     }
-    
+
     printf("\t curr_pos=%d\n", log->curr_pos);
     printf("\t buf:\n");
-    /* log->buf is phys addr of buf, which will not match where mmap has */
-    /* map'ed us, but since it is always just past end of struct, use that */
-    /* to uncompress tboot log */ 
-    if (log->zip_count > 0) {
-        for ( i = 0; i< log->zip_count; i++) {
-            int length = LZ_Uncompress(&log_buf[log->zip_pos[i]], out, log->zip_size[i], sizeof(pbuf));
-            if ( length < 0 )
-               continue;
-            /* log is too big for single printk(), so break it up */
-            /* print out the uncompressed log */
-            for ( int curr_pos = 0; curr_pos < length; curr_pos += sizeof(buf)-1 ) {
-                if ( length - curr_pos >= (int)sizeof(buf) - 1 ) {
-                    strncpy_s(buf, sizeof(buf), out + curr_pos, sizeof(buf)-1);
-                }
-                else {
-                    strncpy_s(buf, sizeof(buf), out + curr_pos, length - curr_pos);
-                }
-                printf("%s", buf);
-            }
+    walk_tboot_log(log, write_text);
+    printf("\n");
+}
+
+static void print_json_tboot_log(void *log_base)
+{
+    tboot_log_t *log = (tboot_log_t *)log_base;
+
+    if ( !is_tboot_log(log) ) {
+        printf(",\"tboot_log\":null");
+        return;
+    }
+
+    printf(",\"tboot_log\":{\"max_size\":%u,\"zip_count\":%u,\"zips\":[",
+           log->max_size, log->zip_count);
+    for ( unsigned int i = 0; i < log->zip_count && i < ZIP_COUNT_MAX; i++ )
+        printf("%s{\"pos\":%u,\"size\":%u}", i ? "," : "", log->zip_pos[i],
+               log->zip_size[i]);
+    printf("],\"curr_pos\":%u,\"text\":\"", log->curr_pos);
+    walk_tboot_log(log, print_json_chars);
+    printf("\"}");
+}
+
+/*
+ * --follow: print only the log text added since the last run.  The cursor
+ * file records the boot, the segment and offset reached, plus a hash of
+ * everything before that point, so only the segments from there on are
+ * uncompressed and a log that tboot started over (e.g. on reboot, even if
+ * the new log happens to begin the same way) is printed from the start.
+ * When tboot compresses the tail, the new chunk holds the same text, so the
+ * offset into it stays valid.
+ */
+#define CURSOR_MAGIC    "txt-stat-cursor"
+#define BOOT_ID_FILE    "/proc/sys/kernel/random/boot_id"
+#define BOOT_ID_LEN     36
+#define FNV_OFFSET      0xcbf29ce484222325ULL
+#define FNV_PRIME       0x100000001b3ULL
+
+typedef struct {
+    char         boot_id[BOOT_ID_LEN + 1];
+    unsigned int segment;
+    unsigned int offset;
+    uint64_t     hash;
+} log_cursor_t;
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    for ( size_t i = 0; i < len; i++ ) {
+        hash ^= p[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/* hash of the compressed chunks before segment nr */
+static uint64_t hash_tboot_log_chunks(const tboot_log_t *log, unsigned int nr)
+{
+    uint64_t hash = FNV_OFFSET;
+
+    for ( unsigned int i = 0; i < nr; i++ ) {
+        if ( log->zip_pos[i] + log->zip_size[i] <= TBOOT_LOG_BUF_SIZE )
+            hash = fnv1a(hash, &log->buf[log->zip_pos[i]], log->zip_size[i]);
+    }
+    return hash;
+}
+
+/* the kernel's random id for this boot, "-" if it doesn't have one */
+static void get_boot_id(char *boot_id)
+{
+    FILE *f = fopen(BOOT_ID_FILE, "r");
+
+    if ( f == NULL || fscanf(f, "%36s", boot_id) != 1 )
+        strcpy_s(boot_id, BOOT_ID_LEN + 1, "-");
+    if ( f != NULL )
+        fclose(f);
+}
+
+static bool read_cursor(const char *file, log_cursor_t *cursor)
+{
+    FILE *f = fopen(file, "r");
+    bool ok;
+
+    if ( f == NULL ) {
+        if ( errno != ENOENT )
+            print_error("ERROR: cannot open %s: %s\n", file, strerror(errno));
+        return false;
+    }
+    ok = fscanf(f, CURSOR_MAGIC " %36s %u %u %" SCNx64, cursor->boot_id,
+                &cursor->segment, &cursor->offset, &cursor->hash) == 4;
+    fclose(f);
+    if ( !ok )
+        print_error("ERROR: %s is not a txt-stat cursor, starting over\n",
+                    file);
+    return ok;
+}
+
+static bool write_cursor(const char *file, const log_cursor_t *cursor)
+{
+    char tmp[PATH_MAX];
+    FILE *f;
+    bool ok;
+
+    /*
+     * replace the cursor atomically, synced before the rename so a crash
+     * leaves either the old position or the new one
+     */
+    if ( snprintf(tmp, sizeof(tmp), "%s.tmp", file) >= (int)sizeof(tmp) ) {
+        print_error("ERROR: cursor file name too long\n");
+        return false;
+    }
+    f = fopen(tmp, "w");
+    if ( f == NULL ) {
+        print_error("ERROR: cannot create %s: %s\n", tmp, strerror(errno));
+        return false;
+    }
+    ok = fprintf(f, CURSOR_MAGIC " %s %u %u %016" PRIx64 "\n",
+                 cursor->boot_id, cursor->segment, cursor->offset,
+                 cursor->hash) > 0;
+    ok = ok && fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = (fclose(f) == 0) && ok;
+    if ( ok && rename(tmp, file) != 0 )
+        ok = false;
+    if ( !ok ) {
+        print_error("ERROR: cannot write %s: %s\n", file, strerror(errno));
+        unlink(tmp);
+    }
+    return ok;
+}
+
+static bool follow_tboot_log(void *log_base, const char *cursor_file)
+{
+    static char pbuf[32*1024];
+    tboot_log_t *log = (tboot_log_t *)log_base;
+    void (*out)(const char *text, size_t len) =
+        json_output ? print_json_chars : write_text;
+    unsigned int segments, start = 0, skip = 0;
+    log_cursor_t cursor;
+    char boot_id[BOOT_ID_LEN + 1];
+    const char *text = NULL;
+    int length = -1;
+    bool resumed = false;
+
+    if ( !is_tboot_log(log) ) {
+        print_error("unable to find TBOOT log\n");
+        if ( json_output )
+            printf("{\"tboot_log\":null}\n");
+        return false;
+    }
+    segments = get_tboot_log_segments(log);
+    get_boot_id(boot_id);
+
+    /* pick up where the cursor says, if it still describes this log */
+    if ( read_cursor(cursor_file, &cursor) &&
+         strcmp(cursor.boot_id, boot_id) == 0 && cursor.segment <= segments ) {
+        length = get_tboot_log_segment(log, cursor.segment, pbuf,
+                                       sizeof(pbuf), &text);
+        if ( length >= 0 && cursor.offset <= (unsigned int)length &&
+             fnv1a(hash_tboot_log_chunks(log, cursor.segment), text,
+                   cursor.offset) == cursor.hash ) {
+            start = cursor.segment;
+            skip = cursor.offset;
+            resumed = true;
         }
-    } 
+        else
+            length = -1;
+    }
 
-    for ( unsigned int curr_pos = log->zip_pos[log->zip_count]; curr_pos < log->curr_pos; curr_pos += sizeof(buf)-1 ) {
-        strncpy_s(buf, sizeof(buf), log_buf + curr_pos, sizeof(buf)-1);
-        printf("%s", buf);
+    if ( json_output )
+        printf("{\"tboot_log\":{\"restarted\":%s,\"text\":\"",
+               resumed ? "false" : "true");
+    for ( unsigned int i = start; i <= segments; i++ ) {
+        if ( i != start || length < 0 )
+            length = get_tboot_log_segment(log, i, pbuf, sizeof(pbuf), &text);
+        if ( length < 0 )
+            continue;
+        if ( i == start )
+            out(text + skip, length - skip);
+        else
+            out(text, length);
     }
-    printf("\n");
+
+    /* the loop ends on the tail: that is where the next run starts */
+    strcpy_s(cursor.boot_id, sizeof(cursor.boot_id), boot_id);
+    cursor.segment = segments;
+    cursor.offset = length < 0 ? 0 : length;
+    cursor.hash = fnv1a(hash_tboot_log_chunks(log, segments), text,
+                        cursor.offset);
+    if ( json_output )
+        printf("\",\"segment\":%u,\"offset\":%u}}\n", cursor.segment,
+               cursor.offset);
+    return write_cursor(cursor_file, &cursor);
 }
 
 static bool is_txt_supported(void)
@@ -296,21 +844,31 @@ static inline uint64_t read_config_reg(uint32_t config_regs_base, uint32_t reg)
 }
 
 bool display_heap_optin = false;
+static const char *follow_file = NULL;
 static const char *short_option = "h";
 static struct option longopts[] = {
     {"heap", 0, 0, 'p'},
+    {"json", 0, 0, 'j'},
+    {"follow", 1, 0, 'f'},
     {"help", 0, 0, 'h'},
     {0, 0, 0, 0}
 };
-static const char *usage_string = "txt-stat [--heap] [-h]";
+static const char *usage_string =
+    "txt-stat [--heap] [--json] [--follow CURSOR] [-h]";
 static const char *option_strings[] = {
     "--heap:\t\tprint out heap info.\n",
+    "--json:\t\tprint everything as one JSON object.\n",
+    "--follow CURSOR:\tprint only the TBOOT log text added since the\n"
+    "\t\tposition saved in the file CURSOR, then save the new one.\n",
     "-h, --help:\tprint out this help message.\n",
     NULL
 };
 
 int main(int argc, char *argv[])
 {
+    static char out_buf[64*1024];
+    config_regs_t regs;
+    bool have_regs = false;
     uint64_t heap = 0;
     uint64_t heap_size = 0;
     void *buf = NULL;
@@ -329,37 +887,52 @@ int main(int argc, char *argv[])
             display_heap_optin = true;
             break;
 
+        case 'j':
+            json_output = true;
+            break;
+
+        case 'f':
+            follow_file = optarg;
+            break;
+
         default:
             return 1;
         }
 
     if ( !is_txt_supported() ) {
-        printf("Intel(r) TXT is not supported\n");
+        print_error("Intel(r) TXT is not supported\n");
         return 1;
     }
 
     fd_mem = open("/dev/mem", O_RDONLY);
     if ( fd_mem == -1 ) {
-        printf("ERROR: cannot open /dev/mem\n");
+        print_error("ERROR: cannot open /dev/mem\n");
         return 1;
     }
 
+    /* output is assembled piecewise, write it out in big blocks */
+    setvbuf(stdout, out_buf, _IOFBF, sizeof(out_buf));
+
+    /* only the log is wanted when following it */
+    if ( follow_file != NULL )
+        goto try_display_log;
+
     /*
      * display public config regs
      */
     seek_ret = lseek(fd_mem, TXT_PUB_CONFIG_REGS_BASE, SEEK_SET);
     if ( seek_ret == -1 )
-        printf("ERROR: seeking public config registers failed: %s, try mmap\n",
-               strerror(errno));
+        print_error("ERROR: seeking public config registers failed: %s, "
+                    "try mmap\n", strerror(errno));
     else {
         buf = malloc(TXT_CONFIG_REGS_SIZE);
         if ( buf == NULL )
-            printf("ERROR: out of memory, try mmap\n");
+            print_error("ERROR: out of memory, try mmap\n");
         else {
             read_ret = read(fd_mem, buf, TXT_CONFIG_REGS_SIZE);
             if ( read_ret != TXT_CONFIG_REGS_SIZE ) {
-                printf("ERROR: reading public config registers failed: %s,"
-                       "try mmap\n", strerror(errno));
+                print_error("ERROR: reading public config registers failed: "
+                            "%s,try mmap\n", strerror(errno));
                 free(buf);
                 buf = NULL;
             }
@@ -376,7 +949,7 @@ int main(int argc, char *argv[])
         buf = mmap(NULL, TXT_CONFIG_REGS_SIZE, PROT_READ,
                    MAP_PRIVATE, fd_mem, TXT_PUB_CONFIG_REGS_BASE);
         if ( buf == MAP_FAILED ) {
-            printf("ERROR: cannot map config regs by mmap()\n");
+            print_error("ERROR: cannot map config regs by mmap()\n");
             buf = NULL;
         }
         else
@@ -384,46 +957,67 @@ int main(int argc, char *argv[])
     }
 
     if ( buf ) {
-        display_config_regs(buf);
-        heap = read_txt_config_reg(buf, TXTCR_HEAP_BASE);
-        heap_size = read_txt_config_reg(buf, TXTCR_HEAP_SIZE);
+        read_config_regs(buf, &regs);
+        have_regs = true;
+        heap = regs.heap_base;
+        heap_size = regs.heap_size;
+    }
+    if ( json_output ) {
+        printf("{");
+        if ( have_regs )
+            print_json_config_regs(&regs);
+        else
+            printf("\"config_regs\":null");
     }
+    else if ( have_regs )
+        display_config_regs(&regs);
 
     /*
      * display heap
      */
     if ( heap && heap_size && display_heap_optin ) {
+        bool mapped = false;
+
         seek_ret = lseek(fd_mem, heap, SEEK_SET);
         if ( seek_ret == -1 ) {
-            printf("ERROR: seeking TXT heap failed by lseek(): %s, try mmap\n",
-                   strerror(errno));
+            print_error("ERROR: seeking TXT heap failed by lseek(): %s, "
+                        "try mmap\n", strerror(errno));
             goto try_mmap_heap;
         }
         buf = malloc(heap_size);
         if ( buf == NULL ) {
-            printf("ERROR: out of memory, try mmap\n");
+            print_error("ERROR: out of memory, try mmap\n");
             goto try_mmap_heap;
         }
         read_ret = read(fd_mem, buf, heap_size);
         if ( read_ret != heap_size ) {
-            printf("ERROR: reading TXT heap failed by read(): %s, try mmap\n",
-                   strerror(errno));
+            print_error("ERROR: reading TXT heap failed by read(): %s, "
+                        "try mmap\n", strerror(errno));
             free(buf);
             goto try_mmap_heap;
         }
-        display_heap((txt_heap_t *)buf);
-        free(buf);
-        goto try_display_log;
+        goto display_heap;
 
     try_mmap_heap:
 
         buf = mmap(NULL, heap_size, PROT_READ, MAP_PRIVATE, fd_mem, heap);
-        if ( buf == MAP_FAILED )
-            printf("ERROR: cannot map TXT heap by mmap()\n");
-        else {
+        if ( buf == MAP_FAILED ) {
+            print_error("ERROR: cannot map TXT heap by mmap()\n");
+            if ( json_output )
+                printf(",\"heap\":null");
+            goto try_display_log;
+        }
+        mapped = true;
+
+    display_heap:
+        if ( json_output )
+            print_json_heap((txt_heap_t *)buf, heap_size);
+        else
             display_heap((txt_heap_t *)buf);
+        if ( mapped )
             munmap(buf, heap_size);
-        }
+        else
+            free(buf);
     }
 
 try_display_log:
@@ -437,28 +1031,44 @@ try_display_log:
      */
     seek_ret = lseek(fd_mem, TBOOT_SERIAL_LOG_ADDR, SEEK_SET);
     if ( seek_ret == -1 ) {
-        printf("ERROR: seeking TBOOT log failed by lseek()\n");
-        close(fd_mem);
-        return 1;
+        print_error("ERROR: seeking TBOOT log failed by lseek()\n");
+        goto log_error;
     }
     buf = malloc(TBOOT_SERIAL_LOG_SIZE);
     if ( buf == NULL ) {
-        printf("ERROR: out of memory\n");
-        close(fd_mem);
-        return 1;
+        print_error("ERROR: out of memory\n");
+        goto log_error;
     }
     read_ret = read(fd_mem, buf, TBOOT_SERIAL_LOG_SIZE);
     if ( read_ret != TBOOT_SERIAL_LOG_SIZE ) {
-        printf("ERROR: reading TBOOT log failed by read()\n");
+        print_error("ERROR: reading TBOOT log failed by read()\n");
+        free(buf);
+        goto log_error;
+    }
+    if ( follow_file != NULL ) {
+        bool ok = follow_tboot_log(buf, follow_file);
+
         free(buf);
         close(fd_mem);
-        return 1;
+        return ok ? 0 : 1;
     }
-    display_tboot_log(buf);
+    if ( json_output ) {
+        print_json_tboot_log(buf);
+        printf("}\n");
+    }
+    else
+        display_tboot_log(buf);
     free(buf);
     close(fd_mem);
 
     return 0;
+
+log_error:
+    if ( json_output )
+        printf(follow_file != NULL ? "{\"tboot_log\":null}\n" :
+                                     ",\"tboot_log\":null}\n");
+    close(fd_mem);
+    return 1;
 }
 
 